@@ -0,0 +1,43 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if PONG_COUNT_ALLOCATIONS
+
+static std::atomic<int64_t> s_allocationCount = 0;
+
+int64_t GetAllocationCount()
+{
+	return s_allocationCount.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	void *memory = std::malloc(size ? size : 1);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t size) noexcept
+{
+	std::free(memory);
+}
+
+#else
+
+int64_t GetAllocationCount()
+{
+	return -1;
+}
+
+#endif
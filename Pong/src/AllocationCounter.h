@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations made through operator new, for the F3 overlay.
+// On by default in debug builds, the replacement operator new lives in AllocationCounter.cpp.
+#ifndef PONG_COUNT_ALLOCATIONS
+#ifdef _DEBUG
+#define PONG_COUNT_ALLOCATIONS 1
+#else
+#define PONG_COUNT_ALLOCATIONS 0
+#endif
+#endif
+
+int64_t GetAllocationCount(); // -1 when allocations aren't being counted.
@@ -0,0 +1,110 @@
+#include "AssetLoader.h"
+
+#include <cstring>
+
+AssetLoader::~AssetLoader()
+{
+	Stop();
+}
+
+void AssetLoader::Start(const std::vector<std::string> &soundNames)
+{
+	Stop();
+
+	m_soundNames = soundNames;
+	m_stopping = false;
+	m_finished = false;
+	m_thread = std::thread([this]() { LoadWorker(); });
+}
+
+void AssetLoader::Stop()
+{
+	m_stopping = true;
+	if (m_thread.joinable())
+		m_thread.join();
+
+	std::lock_guard<std::mutex> lock(m_loadedMutex);
+	for (LoadedWave &loaded : m_loaded)
+		UnloadWave(loaded.wave);
+	m_loaded.clear();
+	m_pendingCount = 0;
+	m_finished = true;
+}
+
+int AssetLoader::Poll(std::vector<Sound> &sounds)
+{
+	if (m_pendingCount == 0)
+		return 0;
+
+	std::vector<LoadedWave> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_loadedMutex);
+		loaded.swap(m_loaded);
+		m_pendingCount = 0;
+	}
+
+	// Only the upload to the audio device happens here, the decoding's already done.
+	int uploaded = 0;
+	for (LoadedWave &wave : loaded)
+	{
+		if (wave.index < sounds.size())
+		{
+			sounds[wave.index] = LoadSoundFromWave(wave.wave);
+			uploaded++;
+		}
+		UnloadWave(wave.wave);
+	}
+	return uploaded;
+}
+
+void AssetLoader::LoadWorker()
+{
+	bool haveArchive = m_archive.Open(assetArchivePath);
+	if (!haveArchive)
+		TraceLog(LOG_WARNING, "ASSETS: No archive at %s, loading loose files", assetArchivePath);
+
+	for (size_t i = 0; i < m_soundNames.size() && !m_stopping; i++)
+	{
+		Wave wave = { };
+		if (haveArchive)
+			wave = LoadFromArchive(m_soundNames[i]);
+		if (!IsWaveReady(wave)) // Not packed, try the file on its own.
+			wave = LoadWave((std::string(assetsPath) + "/" + m_soundNames[i]).c_str());
+
+		if (!IsWaveReady(wave))
+		{
+			TraceLog(LOG_WARNING, "ASSETS: Failed to load %s", m_soundNames[i].c_str());
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_loadedMutex);
+		m_loaded.push_back({ i, wave });
+		m_pendingCount++;
+	}
+
+	m_archive.Close(); // Decoded waves own their samples, the mapping isn't needed past this.
+	m_finished = true;
+}
+
+Wave AssetLoader::LoadFromArchive(const std::string &name)
+{
+	const AssetArchiveEntry *entry = m_archive.Find(name);
+	if (!entry)
+		return { };
+
+	const uint8_t *data = m_archive.GetData(*entry);
+	if (entry->format == eAssetFormat::ENCODED) // Decode straight out of the mapping.
+		return LoadWaveFromMemory(entry->fileType, data, (int)entry->size);
+
+	// Already PCM, just needs copying into memory raylib can free.
+	Wave wave = { };
+	wave.frameCount = entry->frameCount;
+	wave.sampleRate = entry->sampleRate;
+	wave.sampleSize = entry->sampleSize;
+	wave.channels = entry->channels;
+	wave.data = MemAlloc((unsigned int)entry->size);
+	if (!wave.data)
+		return { };
+	std::memcpy(wave.data, data, (size_t)entry->size);
+	return wave;
+}
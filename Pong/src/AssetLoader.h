@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include <raylib.h>
+
+#include "AssetArchive.h"
+
+constexpr const char *assetsPath = "./assets";
+constexpr const char *assetArchivePath = "./assets/assets.pak"; // Made by 'Pong_Tools pack'.
+
+// Loads sounds off the main thread so the first frame doesn't wait on them.
+// A worker maps the archive and decodes each sound into a Wave, the main thread then only has to
+// hand the samples to the audio device in Poll(). Loose files are used if there's no archive.
+class AssetLoader
+{
+public:
+	AssetLoader() = default;
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader &) = delete;
+	AssetLoader &operator=(const AssetLoader &) = delete;
+
+	void Start(const std::vector<std::string> &soundNames); // Names relative to the assets folder, e.g. "sfx/pong/score.ogg".
+	void Stop(); // Waits for the worker, anything not yet polled is thrown away.
+
+	// Main thread only, needs the audio device. Stores each sound that finished decoding at its index in sounds.
+	// Returns how many were uploaded.
+	int Poll(std::vector<Sound> &sounds);
+
+	bool IsDone() const { return m_finished && m_pendingCount == 0; } // Everything decoded and polled.
+
+private:
+	void LoadWorker();
+	Wave LoadFromArchive(const std::string &name);
+
+private:
+	struct LoadedWave
+	{
+		size_t index = 0;
+		Wave wave = { };
+	};
+
+	std::vector<std::string> m_soundNames;
+	AssetArchive m_archive;
+
+	std::thread m_thread;
+	std::atomic<bool> m_stopping = false;
+	std::atomic<bool> m_finished = true;
+
+	std::mutex m_loadedMutex;
+	std::vector<LoadedWave> m_loaded; // Worker -> main thread.
+	std::atomic<int> m_pendingCount = 0; // Decoded but not yet polled.
+
+};
@@ -1,5 +1,13 @@
 #include "Game.h"
+
+#include <cmath>
+
 #include "shared.h"
+#include "Trace.h"
+#include "Clock.h"
+#include "Logger.h"
+
+constexpr const char *traceOutputPath = "./pong_client_trace.json"; // F2 starts and stops recording.
 
 Game::Game()
 { 
@@ -23,45 +31,86 @@ void Game::Init()
 
 	m_netClient->Start(); // Start the networking client.
 
-	// Load Assets.
-	m_loadedSounds[(int)eSounds::BOUNCE] = LoadSound("./assets/sfx/pong/ball_bounce.ogg");
-	m_loadedSounds[(int)eSounds::HIT] = LoadSound("./assets/sfx/pong/ball_hit.ogg");
-	m_loadedSounds[(int)eSounds::SCORE] = LoadSound("./assets/sfx/pong/score.ogg");
+	// Load Assets, in the background. Order matches eSounds.
+	m_assetLoader.Start({ "sfx/pong/ball_bounce.ogg", "sfx/pong/ball_hit.ogg", "sfx/pong/score.ogg" });
 
 	// Init Game.
 	m_gameState.gameStarted = false;
 
-	m_ball.xPosition = 0.5f;
-	m_ball.yPosition = 0.5f;
-	m_ball.xVelocity = -1.0f;
-	m_ball.yVelocity = -1.0f;
+	m_sim = SimState(); // The server sends the real ball and random state once the game starts.
 }
 
 void Game::Shutdown()
 {
 	m_netClient->Stop();
 
+	if (Tracer::IsRecording()) // Don't lose a trace that was still going.
+		Tracer::Stop(traceOutputPath);
+
 	// Unload Assets
+	m_assetLoader.Stop();
+
+	std::lock_guard<std::mutex> lock(m_soundMutex);
 	for (int i = 0; i < (int)eSounds::SOUNDS_MAX; i++)
 		if (IsSoundReady(m_loadedSounds[i]))
 			UnloadSound(m_loadedSounds[i]);
 	m_loadedSounds.clear();
 	m_loadedSounds.resize((int)eSounds::SOUNDS_MAX);
+	m_pendingSounds.clear();
+	m_fadingSounds.clear();
+	m_predictedEvents.Clear();
 }
 
 void Game::Update(double deltaTime)
 {
 	m_textPool.Animate(deltaTime); // Update text object pool.
 
-	if (m_gameState.gameStarted == true) // Do gameplay state.
+	if (!m_assetLoader.IsDone()) // Pick up any sounds that finished loading.
 	{
-		// Update ball.
-		m_ball.xPosition += m_ball.xVelocity * (float)deltaTime;
-		m_ball.yPosition += m_ball.yVelocity * (float)deltaTime;
+		std::lock_guard<std::mutex> lock(m_soundMutex);
+		if (m_assetLoader.Poll(m_loadedSounds) > 0)
+		{
+			double now = GetTime();
+			for (auto &[sound, requested] : m_pendingSounds)
+				if (IsSoundReady(m_loadedSounds[(int)sound]) && now - requested <= pendingSoundTimeout)
+					PlaySound(m_loadedSounds[(int)sound]);
+			std::erase_if(m_pendingSounds, [this, now](const std::pair<eSounds, double> &pending)
+				{ return IsSoundReady(m_loadedSounds[(int)pending.first]) || now - pending.second > pendingSoundTimeout; });
+		}
+		if (m_assetLoader.IsDone()) // Anything still waiting failed to load.
+			m_pendingSounds.clear();
 	}
-	else // Do lobby state.
+
+	UpdateSounds();
+
+	if (IsKeyPressed(KEY_F3)) // Toggle the link stats overlay.
+		m_showNetStats = !m_showNetStats;
+
+	// Keep link stats going, spectators' too.
+	if (m_spectatorLinked || m_player.connected)
 	{
-		if (m_player.connected)
+		double now = ClockNowSeconds();
+		m_linkStats.Update(now);
+		double interval = m_clockSync.IsSynced() ? pingInterval : ClockSync::SYNC_PING_INTERVAL;
+		if (m_linkStats.ShouldPing(now, interval))
+		{
+			uint32 sequence = m_linkStats.OnPingSent(now);
+
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PING << sequence << now;
+			SendToServer(writer.GetPacket());
+			packet.Release();
+		}
+	}
+
+	if (m_spectating && m_spectatorLinked && !m_watching && ClockNowSeconds() >= m_spectateRetryAt)
+		SendSpectate();
+
+	if (m_gameState.gameStarted == false) // Do lobby state.
+	{
+		if (m_player.connected && !m_spectating)
 		{
 			if (IsKeyReleased(KEY_SPACE)) // Ready up.
 			{
@@ -72,14 +121,14 @@ void Game::Update(double deltaTime)
 				packet.Allocate(1024);
 				BCNet::PacketStreamWriter writer(packet);
 				writer << PongPackets::PONG_PLAYER_READY << m_player.ready;
-				m_netClient->SendPacketToServer(writer.GetPacket());
+				SendToServer(writer.GetPacket());
 				packet.Release();
 			}
 		}
 	}
 
 	// Get client player input.
-	if (m_player.connected)
+	if (m_player.connected && !m_spectating)
 	{
 		if (IsKeyPressed(KEY_UP))
 		{
@@ -91,7 +140,7 @@ void Game::Update(double deltaTime)
 			packet.Allocate(1024);
 			BCNet::PacketStreamWriter writer(packet);
 			writer << PongPackets::PONG_PLAYER_MOVING_UP << m_player.movingUp;
-			m_netClient->SendPacketToServer(writer.GetPacket());
+			SendToServer(writer.GetPacket());
 			packet.Release();
 		}
 		else if (IsKeyReleased(KEY_UP))
@@ -103,7 +152,7 @@ void Game::Update(double deltaTime)
 			packet.Allocate(1024);
 			BCNet::PacketStreamWriter writer(packet);
 			writer << PongPackets::PONG_PLAYER_MOVING_UP << m_player.movingUp;
-			m_netClient->SendPacketToServer(writer.GetPacket());
+			SendToServer(writer.GetPacket());
 			packet.Release();
 		}
 
@@ -116,7 +165,7 @@ void Game::Update(double deltaTime)
 			packet.Allocate(1024);
 			BCNet::PacketStreamWriter writer(packet);
 			writer << PongPackets::PONG_PLAYER_MOVING_DOWN << m_player.movingDown;
-			m_netClient->SendPacketToServer(writer.GetPacket());
+			SendToServer(writer.GetPacket());
 			packet.Release();
 		}
 		else if (IsKeyReleased(KEY_DOWN))
@@ -128,40 +177,18 @@ void Game::Update(double deltaTime)
 			packet.Allocate(1024);
 			BCNet::PacketStreamWriter writer(packet);
 			writer << PongPackets::PONG_PLAYER_MOVING_DOWN << m_player.movingDown;
-			m_netClient->SendPacketToServer(writer.GetPacket());
+			SendToServer(writer.GetPacket());
 			packet.Release();
 		}
 	}
 
-	// Update peer player.
-	if (m_peerPlayer.connected == true)
-	{
-		int input = (int)m_peerPlayer.movingUp - (int)m_peerPlayer.movingDown;
-		float move = input * paddleVSpeed * (float)deltaTime;
-
-		m_peerPlayer.yPosition -= move; // Move player.
-
-		// Clamp to bounds.
-		if (m_peerPlayer.yPosition - (paddleHeight / 2.0f) < 0.0f)
-			m_peerPlayer.yPosition = (paddleHeight / 2.0f);
-		if (m_peerPlayer.yPosition + (paddleHeight / 2.0f) > 1.0f)
-			m_peerPlayer.yPosition = 1.0f - (paddleHeight / 2.0f);
-	}
-
-	// Update client player.
-	if (m_player.connected == true)
-	{
-		int input = (int)m_player.movingUp - (int)m_player.movingDown;
-		float move = input * paddleVSpeed * (float)deltaTime;
-
-		m_player.yPosition -= move; // Move player.
+	if (m_reconnecting)
+		UpdateReconnect();
 
-		// Clamp to bounds.
-		if (m_player.yPosition - (paddleHeight / 2.0f) < 0.0f)
-			m_player.yPosition = (paddleHeight / 2.0f);
-		if (m_player.yPosition + (paddleHeight / 2.0f) > 1.0f)
-			m_player.yPosition = 1.0f - (paddleHeight / 2.0f);
-	}
+	if (m_rollback.IsActive()) // Ball and paddles.
+		StepRollback(deltaTime);
+	else
+		StepSimulation(deltaTime);
 
 	// Do Text Input for Connection Menu.
 	if (m_player.connected == false && 
@@ -177,6 +204,7 @@ void Game::Update(double deltaTime)
 				m_connectionInput[m_connectionInputCount] = (char)key;
 				m_connectionInput[m_connectionInputCount + 1] = '\0'; // Null terminator.
 				m_connectionInputCount++;
+				m_connectionInputWidth = -1;
 			}
 			key = GetCharPressed(); // Might be multiple keys pressed within a frame.
 		}
@@ -187,6 +215,7 @@ void Game::Update(double deltaTime)
 			m_connectionInputCount--;
 			if (m_connectionInputCount < 0) m_connectionInputCount = 0;
 			m_connectionInput[m_connectionInputCount] = '\0'; // Null terminator.
+			m_connectionInputWidth = -1;
 		}
 	}
 
@@ -195,11 +224,13 @@ void Game::Update(double deltaTime)
 
 void Game::Draw()
 {
-	ClearBackground(BLACK);
+	m_renderer.BeginFrame();
 
 	// Draw the Connection Menu.
-	if (m_player.connected == false)
+	if (m_player.connected == false && m_watching == false)
 	{
+		ClearBackground(BLACK);
+
 		// TODO: Clean this up.
 		constexpr static int textSize = 36;
 		constexpr static int textOffset = 12;
@@ -207,23 +238,27 @@ void Game::Draw()
 		int i = 0;
 
 		#define M_nextTextPos ( (int)((textSize + textOffset) * i++) )
-		#define M_textXPosition(t) ( (int)(clientWidth / 2.0f) - (MeasureText(t, textSize) / 2) )
+		#define M_textXPositionFromWidth(w) ( (int)(clientWidth / 2.0f) - ((w) / 2) )
+		#define M_textXPosition(t) M_textXPositionFromWidth(m_renderer.MeasureStaticText(t, textSize))
 		#define M_textYPosition ( (int)(clientHeight / 2.0f) - (int)(textSize / 2.0f) + M_nextTextPos - (int)((textSize + textOffset) * (maxTextElements - 1) / 2.0f) )
 
-		std::string connectionText = "Connect to a host!";
-		DrawText(connectionText.c_str(), M_textXPosition(connectionText.c_str()), M_textYPosition, textSize, WHITE);
+		if (m_connectionInputWidth < 0) // Input has changed since it was last measured.
+			m_connectionInputWidth = MeasureText(m_connectionInput, textSize);
+
+		const char *connectionText = "Connect to a host!";
+		m_renderer.DrawText(connectionText, M_textXPosition(connectionText), M_textYPosition, textSize, WHITE);
 		if (m_ipEntered == false) // IP address has not been entered, so ask the player to enter it.
 		{
-			std::string descText = "Enter the IP Address!";
-			DrawText(descText.c_str(), M_textXPosition(descText.c_str()), M_textYPosition, textSize, WHITE);
+			const char *descText = "Enter the IP Address!";
+			m_renderer.DrawText(descText, M_textXPosition(descText), M_textYPosition, textSize, WHITE);
 
 			int yPos = M_textYPosition;
-			DrawText(m_connectionInput, M_textXPosition(m_connectionInput), yPos, textSize, WHITE); // Render what the player is entering.
+			m_renderer.DrawText(m_connectionInput, M_textXPositionFromWidth(m_connectionInputWidth), yPos, textSize, WHITE); // Render what the player is entering.
 			if (m_connectionInputCount < MAX_INPUT)
 			{
 				// Render a '_' to signal to the player that they can type.
 				if (((m_frameCounter / 24) % 2) == 0)
-					DrawText("_", M_textXPosition("_") + ((MeasureText(m_connectionInput, textSize) + textSize) / 2), yPos, textSize, WHITE);
+					m_renderer.DrawText("_", M_textXPosition("_") + ((m_connectionInputWidth + textSize) / 2), yPos, textSize, WHITE);
 			}
 
 			if (IsKeyReleased(KEY_ENTER))
@@ -233,23 +268,22 @@ void Game::Draw()
 
 				m_connectionInput[0] = '\0'; // Reset input string.
 				m_connectionInputCount = 0;
+				m_connectionInputWidth = -1;
 				m_ipEntered = true; // The ip has been entered.
-
-				std::cout << m_enteredIPAddress << std::endl; // Debug.
 			}
 		}
 		else if (m_portEntered == false) // The ip address has been entered but the port hasn't, so ask the player for it.
 		{
-			std::string descText = "Enter the port!";
-			DrawText(descText.c_str(), M_textXPosition(descText.c_str()), M_textYPosition, textSize, WHITE);
+			const char *descText = "Enter the port!";
+			m_renderer.DrawText(descText, M_textXPosition(descText), M_textYPosition, textSize, WHITE);
 
 			int yPos = M_textYPosition;
-			DrawText(m_connectionInput, M_textXPosition(m_connectionInput), yPos, textSize, WHITE); // Render what the player is entering.
+			m_renderer.DrawText(m_connectionInput, M_textXPositionFromWidth(m_connectionInputWidth), yPos, textSize, WHITE); // Render what the player is entering.
 			if (m_connectionInputCount < MAX_INPUT)
 			{
 				// Render a '_' to signal to the player that they can type.
 				if (((m_frameCounter / 24) % 2) == 0)
-					DrawText("_", M_textXPosition("_") + ((MeasureText(m_connectionInput, textSize) + textSize) / 2), yPos, textSize, WHITE);
+					m_renderer.DrawText("_", M_textXPosition("_") + ((m_connectionInputWidth + textSize) / 2), yPos, textSize, WHITE);
 			}
 
 			if (IsKeyReleased(KEY_ENTER))
@@ -260,17 +294,16 @@ void Game::Draw()
 
 				m_connectionInput[0] = '\0'; // Reset input string.
 				m_connectionInputCount = 0;
+				m_connectionInputWidth = -1;
 				m_portEntered = true; // The port has been entered.
-
-				std::cout << std::to_string(m_enteredPort) << std::endl; // Debug.
 			}
 		}
 
 		// Both the ip address and port has been entered so try connecting.
 		if (m_ipEntered && m_portEntered)
 		{
-			std::string descText = "Connecting...";
-			DrawText(descText.c_str(), M_textXPosition(descText.c_str()), M_textYPosition, textSize, WHITE);
+			const char *descText = m_reconnecting ? "Reconnecting..." : (m_matchQueued ? "Finding an opponent..." : (m_spectatorLinked ? "Waiting for a match to watch..." : "Connecting..."));
+			m_renderer.DrawText(descText, M_textXPosition(descText), M_textYPosition, textSize, WHITE);
 
 			if (m_tryConnect == false) // Don't try connecting every frame.
 			{
@@ -280,170 +313,587 @@ void Game::Draw()
 				// Workaround.
 				// TODO: Handle incorrect inputs.
 				std::string connectCommand("/connect " + m_enteredIPAddress + " " + std::to_string(m_enteredPort));
-				std::cout << descText << std::endl;
-				std::cout << connectCommand << std::endl;
+				PONG_LOG(CLIENT_CONNECTING, descText, m_enteredIPAddress, m_enteredPort);
 				m_netClient->PushInputAsCommand(connectCommand); // Command still works despite bug?
 
 				m_tryConnect = true; // Set this to true so it doesn't enter this scope the next frame.
 			}
 		}
 
+		#undef M_nextTextPos
+		#undef M_textXPositionFromWidth
+		#undef M_textXPosition
+		#undef M_textYPosition
+
+		m_renderer.EndFrame();
 		return; // Return so the rest of the game isn't drawn over the connection menu.
 	}
 
 	// ----------------- Draw game.
 
-	// Draw Centre-line.
-	for (int i = 0; i < clientHeight; i += 24)
-	{
-		DrawRectangle((int)((clientWidth / 2.0f) - 4), i - 4, 8, 12, WHITE);
-	}
+	// Draw the court, baked once.
+	m_renderer.DrawCourt();
 
-	// Draw Ball.
-	int ballXPos = (int)(m_ball.xPosition * clientWidth);
-	int ballYPos = (int)(m_ball.yPosition * clientHeight);
+	// Queue Ball.
+	int ballXPos = (int)(SimToFloat(m_sim.ball.xPosition) * clientWidth);
+	int ballYPos = (int)(SimToFloat(m_sim.ball.yPosition) * clientHeight);
 	int ballW = (int)(ballWidth * clientWidth);
 	int ballH = (int)(ballHeight * clientHeight);
 
 	int ballCenterX = ballXPos - (int)(ballW / 2.0f);
 	int ballCenterY = ballYPos - (int)(ballH / 2.0f);
 
-	DrawRectangle(ballCenterX, ballCenterY, ballW, ballH, WHITE);
+	m_renderer.AddQuad(ballCenterX, ballCenterY, ballW, ballH, WHITE);
 
-	// Draw Peer Player.
-	if (m_peerPlayer.connected == true)
-	{
-		int playerXPos = m_peerPlayer.rightSide ? (int)((1.0f - paddleXOffset) * clientWidth) : (int)(paddleXOffset * clientWidth);
-		int playerYPos = (int)(m_peerPlayer.yPosition * clientHeight);
-		int playerWidth = (int)(paddleWidth * clientWidth);
-		int playerHeight = (int)(paddleHeight * clientHeight);
+	// Queue Players.
+	int playerWidth = (int)(paddleWidth * clientWidth);
+	int playerHeight = (int)(paddleHeight * clientHeight);
 
-		int playerCenterX = playerXPos - (int)(playerWidth / 2.0f);
-		int playerCenterY = playerYPos - (int)(playerHeight / 2.0f);
+	int peerXPos = m_peerPlayer.rightSide ? (int)((1.0f - paddleXOffset) * clientWidth) : (int)(paddleXOffset * clientWidth);
+	int peerYPos = (int)(SimToFloat(m_sim.paddles[m_peerPlayer.Side()].yPosition) * clientHeight);
+	if (m_peerPlayer.OnCourt())
+		m_renderer.AddQuad(peerXPos - (int)(playerWidth / 2.0f), peerYPos - (int)(playerHeight / 2.0f), playerWidth, playerHeight, RED);
 
-		DrawRectangle(playerCenterX, playerCenterY, playerWidth, playerHeight, RED);
+	int playerXPos = m_player.rightSide ? (int)((1.0f - paddleXOffset) * clientWidth) : (int)(paddleXOffset * clientWidth);
+	int playerYPos = (int)(SimToFloat(m_sim.paddles[m_player.Side()].yPosition) * clientHeight);
+	if (m_player.OnCourt())
+		m_renderer.AddQuad(playerXPos - (int)(playerWidth / 2.0f), playerYPos - (int)(playerHeight / 2.0f), playerWidth, playerHeight, BLUE);
 
-		// Draw their Score.
-		constexpr int screenHalf = clientWidth / 2;
-		constexpr int leftHalf = screenHalf / 2;
-		constexpr int rightHalf = screenHalf + leftHalf;
-		int scoreXPos = m_peerPlayer.rightSide ? rightHalf : leftHalf;
+	m_renderer.FlushQuads(); // Ball and paddles in one go.
 
-		std::string scoreText = std::to_string(m_peerPlayer.score);
-		DrawText(scoreText.c_str(), scoreXPos, clientHeight / 5, 48, RED);
+	// Draw Peer Player's HUD.
+	if (m_peerPlayer.OnCourt())
+	{
+		m_renderer.DrawScore(m_peerPlayer.rightSide, m_peerPlayer.score, RED);
 
 		// Draw if they're ready or not.
 		if (m_gameState.gameStarted == false)
-		{
-			std::string readyText = m_peerPlayer.ready ? "Is Ready" : "Not Ready";
+			m_renderer.DrawReadyText(m_peerPlayer.ready, m_peerPlayer.rightSide, peerXPos, peerYPos, playerHeight, RED);
+	}
 
-			int textXPos = playerXPos + 12;
-			if (m_peerPlayer.rightSide)
-			{
-				int textWidth = MeasureText(readyText.c_str(), 24);
-				textXPos = playerXPos - textWidth - 12;
-			}
+	// Draw Client Player's HUD.
+	if (m_player.OnCourt())
+	{
+		m_renderer.DrawScore(m_player.rightSide, m_player.score, BLUE);
 
-			int textYPos = playerYPos - playerHeight;
-			if (textYPos < 0)
-				textYPos = 0;
-			if (textYPos > clientHeight - 24)
-				textYPos = clientHeight - 24;
+		// Draw if they're ready or not.
+		if (m_gameState.gameStarted == false)
+			m_renderer.DrawReadyText(m_player.ready, m_player.rightSide, playerXPos, playerYPos, playerHeight, BLUE);
 
-			DrawText(readyText.c_str(), textXPos, textYPos, 24, RED);
+		// Tell player to ready up.
+		if (m_gameState.gameStarted == false && m_player.ready == false && !m_spectating)
+		{
+			const char *readyMessage = "Press the spacebar to ready up!";
+			int textWidth = m_renderer.MeasureStaticText(readyMessage, 24);
+			m_renderer.DrawText(readyMessage, (int)(clientWidth / 2.0f) - (int)(textWidth / 2.0f), (int)(clientHeight / 2.0f) - 12, 24, BLUE);
 		}
 	}
 
-	// Draw Client Player.
-	if (m_player.connected == true)
-	{
-		int playerXPos = m_player.rightSide ? (int)((1.0f - paddleXOffset) * clientWidth) : (int)(paddleXOffset * clientWidth);
-		int playerYPos = (int)(m_player.yPosition * clientHeight);
-		int playerWidth = (int)(paddleWidth * clientWidth);
-		int playerHeight = (int)(paddleHeight * clientHeight);
+	m_textPool.Draw(); // Draw the text object pool.
 
-		int playerCenterX = playerXPos - (int)(playerWidth / 2.0f);
-		int playerCenterY = playerYPos - (int)(playerHeight / 2.0f);
+	m_renderer.EndFrame();
 
-		DrawRectangle(playerCenterX, playerCenterY, playerWidth, playerHeight, BLUE);
+	// Debug overlay.
+	if (m_showNetStats)
+	{
+		std::string statsText = m_linkStats.GetStats().ToString();
+		DrawText(statsText.c_str(), 4, clientHeight - 16, 10, GREEN);
 
-		// Draw their Score.
-		constexpr int screenHalf = clientWidth / 2;
-		constexpr int leftHalf = screenHalf / 2;
-		constexpr int rightHalf = screenHalf + leftHalf;
-		int scoreXPos = m_player.rightSide ? rightHalf : leftHalf;
+		std::string clockText = "clock offset " + std::to_string(m_clockSync.GetOffset() * 1000.0) + "ms (+/-" + std::to_string(m_clockSync.GetErrorBound() * 1000.0) + ")";
+		DrawText(clockText.c_str(), 4, clientHeight - 28, 10, GREEN);
 
-		std::string scoreText = std::to_string(m_player.score);
-		DrawText(scoreText.c_str(), scoreXPos, (int)(clientHeight / 5.0f), 48, BLUE);
+		const RenderStats &renderStats = m_renderer.GetLastFrameStats();
+		std::string renderText = "draw calls " + std::to_string(renderStats.drawCalls) + " allocations " + (renderStats.allocations >= 0 ? std::to_string(renderStats.allocations) : std::string("-"));
+		DrawText(renderText.c_str(), 4, clientHeight - 40, 10, GREEN);
 
-		// Draw if they're ready or not.
-		if (m_gameState.gameStarted == false)
+		if (m_lastResumeTime >= 0.0)
 		{
-			std::string readyText = m_player.ready ? "Is Ready" : "Not Ready";
+			std::string resumeText = "last reconnect back in play after " + std::to_string(m_lastResumeTime * 1000.0) + "ms";
+			DrawText(resumeText.c_str(), 4, 4, 10, GREEN);
+		}
 
-			int textXPos = playerXPos + 12;
-			if (m_player.rightSide)
-			{
-				int textWidth = MeasureText(readyText.c_str(), 24);
-				textXPos = playerXPos - textWidth - 12;
-			}
+		if (m_rollback.IsActive())
+		{
+			const RollbackStats &rollbackStats = m_rollback.GetStats();
+			std::string rollbackText = "rollback tick " + std::to_string(m_rollback.GetTick()) + " confirmed " + std::to_string(m_rollback.GetConfirmedTick()) +
+				" rollbacks " + std::to_string(rollbackStats.rollbacks) + " max depth " + std::to_string(rollbackStats.maxRollbackDepth) +
+				" stalls " + std::to_string(rollbackStats.stalls) + (m_rollback.HasDesynced() ? " DESYNC" : "");
+			DrawText(rollbackText.c_str(), 4, clientHeight - 52, 10, m_rollback.HasDesynced() ? RED : GREEN);
+		}
+	}
+}
+
+void Game::StepRollback(double deltaTime)
+{
+	std::lock_guard<std::mutex> lock(m_rollbackMutex);
 
-			int textYPos = playerYPos - playerHeight;
-			if (textYPos < 0)
-				textYPos = 0;
-			if (textYPos > clientHeight - 24)
-				textYPos = clientHeight - 24;
+	m_simAccumulator += deltaTime;
 
-			DrawText(readyText.c_str(), textXPos, textYPos, 24, BLUE);
+	int steps = 0;
+	while (m_simAccumulator >= simTickTime && steps < maxSimStepsPerFrame)
+	{
+		if (!m_rollback.CanAdvance()) // Too far ahead of the peer, wait for them.
+		{
+			m_simAccumulator = simTickTime;
+			break;
 		}
 
-		// Tell player to ready up.
-		if (m_gameState.gameStarted == false && m_player.ready == false)
+		uint8_t input = (m_player.movingUp ? SIM_INPUT_UP : 0) | (m_player.movingDown ? SIM_INPUT_DOWN : 0);
+		uint32_t inputTick = m_rollback.AddLocalInput(input);
+
+		uint32_t events;
+		m_rollback.Advance(events);
+		SendRollbackInput(inputTick);
+
+		m_simAccumulator -= simTickTime;
+		steps++;
+
+		// Nobody's going to confirm these, the match is ours. A rollback's corrections come in with the tick after it.
+		std::lock_guard<std::mutex> soundLock(m_soundMutex);
+		if (events & (SIM_EVENT_HIT_LEFT | SIM_EVENT_HIT_RIGHT))
+			PlaySFX(eSounds::HIT);
+		if (events & SIM_EVENT_BOUNCE)
+			PlaySFX(eSounds::BOUNCE);
+		if (events & (SIM_EVENT_GOAL_LEFT | SIM_EVENT_GOAL_RIGHT))
+			PlaySFX(eSounds::SCORE);
+	}
+
+	if (steps == maxSimStepsPerFrame)
+		m_simAccumulator = 0.0;
+
+	m_sim = m_rollback.GetState();
+	m_player.score = m_sim.paddles[m_player.Side()].score;
+	m_peerPlayer.score = m_sim.paddles[m_peerPlayer.Side()].score;
+
+	if (m_rollback.HasDesynced() && !m_desyncReported)
+	{
+		PONG_LOG(CLIENT_DESYNC, m_rollback.GetDesyncTick());
+		m_desyncReported = true;
+	}
+}
+
+void Game::SendRollbackInput(uint32_t lastTick)
+{
+	// The last few inputs every time, so a lost or late packet is covered by the next one.
+	uint32_t firstTick = lastTick + 1 >= rollbackInputRedundancy ? lastTick + 1 - rollbackInputRedundancy : 0;
+	uint32_t count = lastTick - firstTick + 1;
+
+	uint32_t checksumTick = m_rollback.GetLatestChecksumTick();
+	uint32_t checksum = 0;
+	if (checksumTick != UINT32_MAX)
+		m_rollback.GetChecksum(checksumTick, checksum);
+
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_ROLLBACK_INPUT << firstTick << count;
+	for (uint32_t tick = firstTick; tick <= lastTick; tick++)
+		writer << m_rollback.GetLocalInput(tick);
+	writer << checksumTick << checksum;
+	SendToServer(writer.GetPacket());
+	packet.Release();
+}
+
+double Game::ServerNow() const
+{
+	return m_clockSync.ServerNow(ClockNowSeconds());
+}
+
+void Game::SendToServer(const BCNet::Packet packet)
+{
+	m_netClient->SendPacketToServer(packet);
+	m_linkStats.OnBytesSent(packet.Size);
+}
+
+void Game::StepSimulation(double deltaTime)
+{
+	m_simAccumulator += deltaTime;
+
+	int steps = 0;
+	while (m_simAccumulator >= simTickTime && steps < maxSimStepsPerFrame)
+	{
+		SimInputs inputs;
+		for (PlayerInfo *player : { &m_player, &m_peerPlayer }) // Peer's input is whatever they last told the server.
+			if (player->connected)
+				inputs.paddles[player->Side()] = (player->movingUp ? SIM_INPUT_UP : 0) | (player->movingDown ? SIM_INPUT_DOWN : 0);
+
+		uint32_t events;
+		m_sim = SimStep(m_sim, inputs, simTickTime, events);
+		m_simAccumulator -= simTickTime;
+		steps++;
+
+		// Don't wait a round trip to hear it. Scores still wait for the server.
+		if (events & (SIM_EVENT_HIT_LEFT | SIM_EVENT_HIT_RIGHT))
+			PredictSFX(eSounds::HIT);
+		if (events & SIM_EVENT_BOUNCE)
+			PredictSFX(eSounds::BOUNCE);
+		if (events & (SIM_EVENT_GOAL_LEFT | SIM_EVENT_GOAL_RIGHT))
+			PredictSFX(eSounds::SCORE);
+	}
+
+	if (steps == maxSimStepsPerFrame) // Hitched, the server will correct us.
+		m_simAccumulator = 0.0;
+}
+
+void Game::UpdateSounds()
+{
+	std::lock_guard<std::mutex> lock(m_soundMutex);
+
+	double now = GetTime();
+
+	// The server should agree within about a round trip.
+	LinkStats stats = m_linkStats.GetStats();
+	m_predictedEvents.SetWindow(stats.hasRtt ? stats.smoothedRtt + 4.0 * stats.rttDeviation : maxPredictionWindow);
+
+	// Anything it didn't agree with gets cancelled.
+	std::vector<int> mispredicted;
+	m_predictedEvents.Expire(now, mispredicted);
+	for (int sound : mispredicted)
+	{
+		if (IsSoundReady(m_loadedSounds[sound]) && IsSoundPlaying(m_loadedSounds[sound]))
+			m_fadingSounds.emplace_back((eSounds)sound, now);
+		std::erase_if(m_pendingSounds, [sound](const std::pair<eSounds, double> &pending) { return (int)pending.first == sound; });
+	}
+
+	// Fade cancelled sounds out.
+	for (auto &[sound, started] : m_fadingSounds)
+	{
+		Sound &loaded = m_loadedSounds[(int)sound];
+		float volume = 1.0f - (float)((now - started) / cancelFadeTime);
+		if (volume > 0.0f)
 		{
-			std::string readyMessage = "Press the spacebar to ready up!";
-			int textWidth = MeasureText(readyMessage.c_str(), 24);
-			DrawText(readyMessage.c_str(), (int)(clientWidth / 2.0f) - (int)(textWidth / 2.0f), (int)(clientHeight / 2.0f) - 12, 24, BLUE);
+			SetSoundVolume(loaded, volume);
+			continue;
 		}
+
+		StopSound(loaded);
+		SetSoundVolume(loaded, 1.0f);
 	}
+	std::erase_if(m_fadingSounds, [now](const std::pair<eSounds, double> &fading) { return now - fading.second >= cancelFadeTime; });
+}
 
-	m_textPool.Draw(); // Draw the text object pool.
+void Game::PredictSFX(eSounds sound)
+{
+	std::lock_guard<std::mutex> lock(m_soundMutex);
+	if (m_predictedEvents.Predict((int)sound, GetTime()))
+		PlaySFX(sound);
+}
+
+void Game::ConfirmSFX(eSounds sound)
+{
+	std::lock_guard<std::mutex> lock(m_soundMutex);
+	if (m_predictedEvents.Confirm((int)sound, GetTime())) // Only if we didn't already play it.
+		PlaySFX(sound);
 }
 
 void Game::PlaySFX(eSounds sound)
 {
-	// Not really necessary, probably. It's just old code from another project.
+	// Replaying a sound that's fading out, it's wanted again after all.
+	for (auto it = m_fadingSounds.begin(); it != m_fadingSounds.end(); ++it)
+	{
+		if (it->first == sound)
+		{
+			SetSoundVolume(m_loadedSounds[(int)sound], 1.0f);
+			m_fadingSounds.erase(it);
+			break;
+		}
+	}
+
 	if (IsSoundReady(m_loadedSounds[(int)sound])) { PlaySound(m_loadedSounds[(int)sound]); }
+	else if (!m_assetLoader.IsDone()) { m_pendingSounds.emplace_back(sound, GetTime()); } // Still loading, play it when it's ready if that's soon enough.
 }
 
 void Game::OnConnected()
 { 
-	m_tryConnect = false; // Reset.
+	// m_tryConnect stays set while we're connected, we sit in the server's matchmaking queue until it finds us a match.
+
+	m_linkStats.Reset();
+	m_clockSync.Reset();
+
+	if (m_reconnecting)
+		m_reconnectedAt = ClockNowSeconds();
+
+	if (m_spectating)
+	{
+		m_spectatorLinked = true;
+		SendSpectate();
+	}
+}
+
+void Game::SendSpectate()
+{
+	m_spectateRetryAt = ClockNowSeconds() + spectateRetryInterval;
+
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_SPECTATE << m_spectateMatchId;
+	SendToServer(writer.GetPacket());
+	packet.Release();
 }
 
 void Game::OnDisconnected()
 { 
+	// Dropped out of a match the server's holding for us, keep everything and try to get back into it.
+	bool inMatch = m_player.connected && !m_rollback.IsActive();
+	if (m_reconnecting || (inMatch && m_sessionToken != 0 && m_sessionGrace > 0.0))
+	{
+		if (!m_reconnecting)
+		{
+			PONG_LOG(CLIENT_DROPPED);
+			m_droppedAt = ClockNowSeconds();
+		}
+		m_reconnecting = true;
+		m_reconnectAttemptAt = ClockNowSeconds();
+		m_reconnectedAt = 0.0;
+		m_tryConnect = false; // The menu connects again with what was entered.
+		m_matchQueued = false;
+		m_player.connected = false;
+		m_sim.playing = false;
+		return;
+	}
+
+	ResetConnection();
+}
+
+void Game::UpdateReconnect()
+{
+	double now = ClockNowSeconds();
+	if (now - m_droppedAt > m_sessionGrace) // The server's given our slot up by now.
+	{
+		PONG_LOG(CLIENT_RECONNECT_EXPIRED);
+		m_reconnecting = false;
+		if (m_reconnectedAt == 0.0) // Never got through.
+			ResetConnection();
+		else // Connected, just not back into the match. We're in the queue like anyone new.
+			m_playerCount = 0;
+		return;
+	}
+
+	if (m_reconnectedAt == 0.0 && now - m_reconnectAttemptAt >= reconnectRetryInterval)
+	{
+		m_reconnectAttemptAt = now;
+		m_tryConnect = false;
+	}
+}
+
+void Game::ResetConnection()
+{
 	// Reset variables.
 	m_ipEntered = false;
 	m_portEntered = false;
+	m_tryConnect = false;
+	m_matchQueued = false;
+	m_spectatorLinked = false;
+	m_watching = false;
 
 	m_player.connected = false;
+	m_player.occupied = false;
 	m_player.ready = false;
+	m_peerPlayer.connected = false;
+	m_peerPlayer.occupied = false;
 	m_playerCount = 0;
+	m_gameState.gameStarted = false;
+	m_sim.playing = false;
+
+	std::lock_guard<std::mutex> lock(m_rollbackMutex);
+	m_rollback.Stop();
 }
 
 void Game::PacketReceived(const BCNet::Packet packet)
 {
+	PONG_TRACE_THREAD_NAME("network");
+	PONG_TRACE_SCOPE("PacketReceived");
+
+	m_linkStats.OnBytesReceived(packet.Size);
+
 	BCNet::PacketStreamReader reader(packet);
 	int packetID;
 	reader >> packetID;
 
 	switch (packetID)
 	{
+		case (int)PongPackets::PONG_PING:
+		{
+			// Server wants to know our RTT, answer straight away.
+			uint32 sequence;
+			double sentTime;
+			reader >> sequence >> sentTime;
+
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PONG << sequence << sentTime;
+			SendToServer(writer.GetPacket());
+			packet.Release();
+		} break;
+		case (int)PongPackets::PONG_PONG:
+		{
+			// Answer to one of our pings.
+			uint32 sequence;
+			double sentTime, serverTime;
+			reader >> sequence >> sentTime >> serverTime;
+
+			double now = ClockNowSeconds();
+			m_linkStats.OnPongReceived(sequence, sentTime, now);
+			m_clockSync.AddSample(sentTime, serverTime, now);
+		} break;
 		case (int)BCNet::DefaultPacketID::PACKET_SERVER: // Need this to see messages from server.
 		{
 			std::string message;
 			reader >> message;
-			std::cout << message << std::endl; // Just print it out.
+			PONG_LOG(CLIENT_SERVER_MESSAGE, message); // Just print it out.
+		} break;
+		case (int)PongPackets::PONG_SESSION_TOKEN:
+		{
+			// First thing on every connection. If we dropped out of a match, ask for our slot back with the last one.
+			uint64_t token;
+			double grace;
+			reader >> token >> grace;
+			if (m_spectating) // Nothing to come back to.
+				break;
+
+			if (m_reconnecting && m_sessionToken != 0)
+			{
+				BCNet::Packet packet;
+				packet.Allocate(1024);
+				BCNet::PacketStreamWriter writer(packet);
+				writer << PongPackets::PONG_SESSION_RESUME << m_sessionToken;
+				SendToServer(writer.GetPacket());
+				packet.Release();
+			}
+
+			m_sessionToken = token;
+			m_sessionGrace = grace;
+		} break;
+		case (int)PongPackets::PONG_SESSION_RESUME:
+		{
+			// Back in our old slot on this side, the match itself follows. Otherwise it's gone and we're just a new player
+			// now, the server queues us like one.
+			bool resumed;
+			reader >> resumed;
+			if (!m_reconnecting)
+				break;
+
+			if (resumed)
+			{
+				reader >> m_player.rightSide;
+				m_player.connected = true;
+				m_player.movingUp = false; // Whatever we were pressing when we dropped, the server let go of it.
+				m_player.movingDown = false;
+				break;
+			}
+
+			PONG_LOG(CLIENT_MATCH_GONE);
+			m_reconnecting = false;
+			m_player.connected = false;
+			m_peerPlayer.connected = false;
+			m_playerCount = 0;
+			m_gameState.gameStarted = false;
+			m_sim.playing = false;
+		} break;
+		case (int)PongPackets::PONG_MATCH_SNAPSHOT:
+		{
+			// The whole match as the server has it, on joining or resuming. Sides we don't know yet are the peer's.
+			bool gameStarted, paused;
+			float countdown;
+			double serverTime;
+			float xPosition, yPosition, xVelocity, yVelocity;
+			reader >> gameStarted >> paused >> countdown >> m_sim.rngSeed >> m_sim.rngCounter;
+			reader >> serverTime >> xPosition >> yPosition >> xVelocity >> yVelocity;
+
+			for (int side = 0; side < SIM_SIDES; side++)
+			{
+				bool occupied, ready, movingUp, movingDown, away;
+				float paddleY;
+				int score;
+				reader >> occupied >> ready >> movingUp >> movingDown >> away >> paddleY >> score;
+				m_sim.paddles[side].yPosition = SimFromFloat(paddleY);
+				m_sim.paddles[side].score = score;
+
+				if (m_spectating)
+				{
+					PlayerInfo &watched = side == SIM_LEFT ? m_player : m_peerPlayer;
+					watched.occupied = occupied;
+					watched.rightSide = side == SIM_RIGHT;
+					watched.ready = ready;
+					watched.movingUp = movingUp;
+					watched.movingDown = movingDown;
+					watched.away = away;
+					watched.score = score;
+					continue;
+				}
+
+				if (side == m_player.Side())
+				{
+					m_player.ready = ready;
+					m_player.score = score;
+					continue;
+				}
+
+				m_peerPlayer.connected = occupied;
+				m_peerPlayer.rightSide = side == SIM_RIGHT;
+				m_peerPlayer.ready = ready;
+				m_peerPlayer.movingUp = movingUp;
+				m_peerPlayer.movingDown = movingDown;
+				m_peerPlayer.away = away;
+				m_peerPlayer.score = score;
+			}
+			m_playerCount = m_peerPlayer.connected ? 2 : 1;
+
+			// Same catch up as PONG_BALL_VELOCITY, though after a reconnect the clock sync's only just started again.
+			// Spectators don't, what they're sent is deliberately behind when it comes through a relay.
+			float catchUp = 0.0f;
+			if (m_clockSync.IsSynced() && gameStarted && !paused && !m_spectating)
+			{
+				double elapsed = ServerNow() - serverTime;
+				if (elapsed < 0.0) elapsed = 0.0;
+				if (elapsed > maxCatchUpTime) elapsed = maxCatchUpTime;
+				catchUp = (float)elapsed;
+			}
+			m_sim.ball.xPosition = SimFromFloat(xPosition + xVelocity * catchUp);
+			m_sim.ball.yPosition = SimFromFloat(yPosition + yVelocity * catchUp);
+			m_sim.ball.xVelocity = SimFromFloat(xVelocity);
+			m_sim.ball.yVelocity = SimFromFloat(yVelocity);
+
+			m_matchQueued = false;
+			m_gameState.gameStarted = gameStarted;
+			m_sim.playing = gameStarted && !paused && !m_spectating; // They get one every tick, nothing to predict.
+			m_simAccumulator = 0.0;
+			m_watching = m_spectating;
+
+			if (countdown > 0.0f && !m_spectating) // Joined partway through one, the rest of it comes as usual.
+			{
+				std::string countDownText = std::to_string((int)std::ceil(countdown));
+				int textWidth = MeasureText(countDownText.c_str(), 48);
+				float textXPosition = (clientWidth / 2.0f) - (textWidth / 2.0f);
+				float textYPosition = (clientHeight / 2.0f) - 24.0f;
+				m_textPool.Init(countDownText, textXPosition, textYPosition, 1.0f, 48, BLUE);
+			}
+
+			if (m_reconnecting)
+			{
+				double now = ClockNowSeconds();
+				m_lastResumeTime = m_reconnectedAt > 0.0 ? now - m_reconnectedAt : 0.0;
+				PONG_LOG(CLIENT_RESUMED, m_lastResumeTime * 1000.0, now - m_droppedAt);
+				m_reconnecting = false;
+			}
+		} break;
+		case (int)PongPackets::PONG_PLAYER_AWAY:
+		{
+			// Peer dropped and the server's paused the match for them, or they're back. The ball's sent again when it carries on.
+			bool away;
+			reader >> away;
+			m_peerPlayer.away = away;
+			m_sim.playing = m_gameState.gameStarted && !away;
+			if (away)
+			{
+				const char *waitingText = "Waiting for opponent...";
+				int textWidth = MeasureText(waitingText, 24);
+				float textXPosition = (clientWidth / 2.0f) - (textWidth / 2.0f);
+				float textYPosition = (clientHeight / 2.0f) - 12.0f;
+				m_textPool.Init(waitingText, textXPosition, textYPosition, 2.0f, 24, RED);
+			}
 		} break;
 		case (int)PongPackets::PONG_PLAYER_CONNECTED:
 		{
@@ -456,62 +906,71 @@ void Game::PacketReceived(const BCNet::Packet packet)
 			if (m_playerCount < 1) // Client has connected.
 			{
 				// Setup player.
+				m_matchQueued = false;
 				m_player.connected = true;
 				m_player.movingUp = false;
 				m_player.movingDown = false;
-				m_player.yPosition = 0.5f;
 				m_player.score = 0;
 				m_player.rightSide = rightSide;
 				m_player.ready = false;
+				m_sim.paddles[m_player.Side()] = SimPaddle();
 
-				// Request peer info from the server if any.
-				BCNet::Packet packet;
-				packet.Allocate(1024);
-				BCNet::PacketStreamWriter writer(packet);
-				writer << PongPackets::PONG_PLAYER_REQUEST_PEERS;
-				m_netClient->SendPacketToServer(writer.GetPacket());
-				packet.Release();
+				m_playerCount++; // Anyone already here comes in the PONG_MATCH_SNAPSHOT that follows.
 			}
 			else // Someone else has connected.
 			{
 				// Setup peer player.
+				if (!m_peerPlayer.connected)
+					m_playerCount++;
 				m_peerPlayer.connected = true;
 				m_peerPlayer.movingUp = false;
 				m_peerPlayer.movingDown = false;
-				m_peerPlayer.yPosition = 0.5f;
 				m_peerPlayer.score = 0;
 				m_peerPlayer.rightSide = rightSide;
 				m_peerPlayer.ready = false;
+				m_sim.paddles[m_peerPlayer.Side()] = SimPaddle();
 			}
-
-			m_playerCount++;
 		} break;
 		case (int)PongPackets::PONG_PLAYER_DISCONNECTED:
 		{
 			uint32 id;
 			reader >> id;
 
-			// Reset peer player.
+			// Reset peer player, we stay in the match and the server finds someone else.
+			if (m_peerPlayer.connected)
+				m_playerCount--;
 			m_peerPlayer.connected = false;
 			m_peerPlayer.ready = false;
-
-			m_playerCount--;
+			m_peerPlayer.away = false;
 
 			m_gameState.gameStarted = false;
+			m_sim.playing = false;
+
+			std::lock_guard<std::mutex> lock(m_rollbackMutex);
+			m_rollback.Stop();
 		} break;
-		case (int)PongPackets::PONG_PLAYER_REQUEST_PEERS:
+		case (int)PongPackets::PONG_MATCH_QUEUED:
 		{
-			// Get peer player info if there's already one in the game upon joining.
-			m_peerPlayer.connected = true;
-
-			reader >> m_peerPlayer.rightSide;
-			reader >> m_peerPlayer.score;
-			reader >> m_peerPlayer.ready;
-			reader >> m_peerPlayer.yPosition;
-			reader >> m_peerPlayer.movingDown;
-			reader >> m_peerPlayer.movingUp;
-
-			//m_playerCount++;
+			// Connected, the server's looking for someone for us to play.
+			uint32 queued;
+			reader >> queued;
+			m_matchQueued = true;
+			if (m_reconnecting) // Queued before the server saw our token, our old match comes next.
+				break;
+
+			// Queued again mid match when the gateway moves us off a worker that went down, whoever we were playing is gone.
+			if (m_peerPlayer.connected)
+				m_playerCount--;
+			m_peerPlayer.connected = false;
+			m_peerPlayer.ready = false;
+			m_player.ready = false;
+			m_gameState.gameStarted = false;
+			m_sim.playing = false;
+			{
+				std::lock_guard<std::mutex> lock(m_rollbackMutex);
+				m_rollback.Stop();
+			}
+			PONG_LOG(CLIENT_QUEUED, queued);
 		} break;
 		case (int)PongPackets::PONG_PLAYER_MOVING_UP:
 		{
@@ -536,13 +995,24 @@ void Game::PacketReceived(const BCNet::Packet packet)
 		} break;
 		case (int)PongPackets::PONG_GAME_STARTED:
 		{
-			// Game has begun.
+			// Game has begun, with the match seed so ball resets can be predicted.
+			reader >> m_sim.rngSeed >> m_sim.rngCounter;
 			m_gameState.gameStarted = true;
+			m_sim.playing = true;
 		} break;
 		case (int)PongPackets::PONG_GAME_ENDED:
 		{
-			// Game has ended, unused.
+			// The match we were watching has closed, or there wasn't one. Ask again in a bit.
+			m_watching = false;
+			m_spectateRetryAt = ClockNowSeconds() + spectateRetryInterval;
+			m_player.occupied = false;
+			m_peerPlayer.occupied = false;
 			m_gameState.gameStarted = false;
+			m_sim.playing = false;
+			{
+				std::lock_guard<std::mutex> lock(m_rollbackMutex);
+				m_rollback.Stop();
+			}
 			m_player.ready = false;
 			m_peerPlayer.ready = false;
 		} break;
@@ -552,30 +1022,80 @@ void Game::PacketReceived(const BCNet::Packet packet)
 			std::string countDownText;
 			reader >> countDownText;
 
-			m_netClient->Log(countDownText);
+			PONG_LOG(CLIENT_COUNTDOWN, countDownText);
 
 			int textWidth = MeasureText(countDownText.c_str(), 48);
 			float textXPosition = (clientWidth / 2.0f) - (textWidth / 2.0f);
 			float textYPosition = (clientHeight / 2.0f) - 24.0f;
 			m_textPool.Init(countDownText, textXPosition, textYPosition, 1.0f, 48, BLUE);
 		} break;
+		case (int)PongPackets::PONG_ROLLBACK_START:
+		{
+			// Rollback match, both clients run it from the same seed and the server only passes inputs along.
+			uint64_t seed;
+			int inputDelay;
+			reader >> seed >> inputDelay;
+
+			SimState initial = SimInit(seed);
+			initial.playing = true;
+
+			std::lock_guard<std::mutex> lock(m_rollbackMutex);
+			m_rollback.Start(initial, m_player.Side(), inputDelay);
+			m_simAccumulator = 0.0;
+			m_desyncReported = false;
+		} break;
+		case (int)PongPackets::PONG_ROLLBACK_INPUT:
+		{
+			// Peer's inputs, relayed by the server.
+			uint32 firstTick, count;
+			reader >> firstTick >> count;
+
+			std::lock_guard<std::mutex> lock(m_rollbackMutex);
+			for (uint32 i = 0; i < count && i < rollbackHistorySize; i++)
+			{
+				uint8_t input;
+				reader >> input;
+				m_rollback.AddRemoteInput(firstTick + i, input);
+			}
+
+			uint32 checksumTick, checksum;
+			reader >> checksumTick >> checksum;
+			if (checksumTick != UINT32_MAX)
+				m_rollback.AddRemoteChecksum(checksumTick, checksum);
+		} break;
 		case (int)PongPackets::PONG_BALL_RESET:
 		{
-			// Ball has reset.
-			m_ball.xPosition = 0.5f;
-			m_ball.yPosition = 0.5f;
-			m_ball.xVelocity = -1.0f;
-			m_ball.yVelocity = -1.0f;
+			// Ball has reset, its velocity follows in the same tick so that's what catches up.
+			double serverTime;
+			reader >> serverTime;
+			reader >> m_sim.rngCounter; // Back in step with the server, whether or not we predicted the goal.
+
+			m_sim.ball.xPosition = 0.5f;
+			m_sim.ball.yPosition = 0.5f;
 		} break;
 		case (int)PongPackets::PONG_BALL_VELOCITY:
 		{
 			// Ball has changed direction.
-			float xVelocity, yVelocity;
-			reader >> xVelocity;
-			reader >> yVelocity;
+			double serverTime;
+			float xPosition, yPosition, xVelocity, yVelocity;
+			reader >> serverTime;
+			reader >> xPosition >> yPosition;
+			reader >> xVelocity >> yVelocity;
+
+			// The server sent where the ball was at serverTime, move it on to where it should be now.
+			float catchUp = 0.0f;
+			if (m_clockSync.IsSynced())
+			{
+				double elapsed = ServerNow() - serverTime;
+				if (elapsed < 0.0) elapsed = 0.0;
+				if (elapsed > maxCatchUpTime) elapsed = maxCatchUpTime;
+				catchUp = (float)elapsed;
+			}
 
-			m_ball.xVelocity = xVelocity;
-			m_ball.yVelocity = yVelocity;
+			m_sim.ball.xPosition = SimFromFloat(xPosition + xVelocity * catchUp);
+			m_sim.ball.yPosition = SimFromFloat(yPosition + yVelocity * catchUp);
+			m_sim.ball.xVelocity = SimFromFloat(xVelocity);
+			m_sim.ball.yVelocity = SimFromFloat(yVelocity);
 		} break;
 		case (int)PongPackets::PONG_PLAYER_SCORE:
 		{
@@ -590,17 +1110,17 @@ void Game::PacketReceived(const BCNet::Packet packet)
 			if (m_peerPlayer.rightSide == rightSide)
 				m_peerPlayer.score = score;
 
-			PlaySFX(eSounds::SCORE);
+			ConfirmSFX(eSounds::SCORE);
 		} break;
 		case (int)PongPackets::PONG_BALL_BOUNCE:
 		{
 			// Ball has bounced off the vertical bounds.
-			PlaySFX(eSounds::BOUNCE);
+			ConfirmSFX(eSounds::BOUNCE);
 		} break;
 		case (int)PongPackets::PONG_PLAYER_HIT:
 		{
 			// A player's paddle has hit the ball.
-			PlaySFX(eSounds::HIT);
+			ConfirmSFX(eSounds::HIT);
 		} break;
 		default:
 		{
@@ -610,6 +1130,9 @@ void Game::PacketReceived(const BCNet::Packet packet)
 
 void Game::Run()
 {
+	double startTime = ClockNowSeconds(); // For time to first frame.
+	bool firstFrame = true;
+
 	InitAudioDevice();
 
 	InitWindow(clientWidth, clientHeight, "Pong Client");
@@ -617,9 +1140,12 @@ void Game::Run()
 	SetExitKey(NULL);
 
 	Init();
+	m_renderer.Init(clientWidth, clientHeight);
 
 	double lastTime = 1.0 / 60.0; // Delta time.
 
+	PONG_TRACE_THREAD_NAME("main");
+
 	// Game loop.
 	m_running = true;
 	while (m_running)
@@ -628,15 +1154,41 @@ void Game::Run()
 		double deltaTime = currentTime - lastTime;
 		lastTime = currentTime;
 
-		Update(deltaTime);
+		PONG_TRACE_COUNTER("frame time (ms)", deltaTime * 1000.0);
+
+		if (IsKeyPressed(KEY_F2)) // Start or stop recording a timeline.
+		{
+			if (Tracer::IsRecording())
+				Tracer::Stop(traceOutputPath);
+			else
+				Tracer::Start();
+		}
+
+		{
+			PONG_TRACE_SCOPE("Update");
+			Update(deltaTime);
+		}
 
 		BeginDrawing();
-		Draw();
-		EndDrawing();
+		{
+			PONG_TRACE_SCOPE("Draw");
+			Draw();
+		}
+		{
+			PONG_TRACE_SCOPE("EndDrawing"); // Includes waiting for the target frame rate.
+			EndDrawing();
+		}
+
+		if (firstFrame)
+		{
+			PONG_LOG(CLIENT_FIRST_FRAME, (ClockNowSeconds() - startTime) * 1000.0);
+			firstFrame = false;
+		}
 
 		m_running = !WindowShouldClose() || m_netClient->IsRunning();
 	}
 
+	m_renderer.Shutdown();
 	Shutdown();
 
 	CloseWindow();
@@ -5,6 +5,8 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <utility>
 
 #include <raylib.h>
 #include <raymath.h>
@@ -13,51 +15,45 @@
 #include <BCNet/BCNetPacket.h>
 
 #include "TextObject.h"
-
-// Game Constants.
-constexpr unsigned int defaultClientWidth = 800; // Basis resolution.
-constexpr unsigned int defaultClientHeight = 600;
-
-constexpr float paddleWidth = (12.0f / defaultClientWidth); // Remap 0-1 for resolution independency
-constexpr float paddleHeight = (96.0f / defaultClientHeight);
-constexpr float paddleXOffset = (64.0f / defaultClientWidth);
-constexpr float paddleVSpeed = (256.0f / defaultClientHeight);
-
-constexpr float ballWidth = (10.0f / defaultClientWidth);
-constexpr float ballHeight = (10.0f / defaultClientHeight);
-constexpr float ballHSpeed = (256.0f / defaultClientWidth);
-constexpr float ballVSpeed = (256.0f / defaultClientHeight);
-
+#include "Renderer.h"
+#include "NetStats.h"
+#include "ClockSync.h"
+#include "AssetLoader.h"
+#include "PredictedEvents.h"
+#include "Simulation.h"
+#include "Rollback.h"
+
+// Game Constants, the physics ones are in Simulation.h.
 constexpr unsigned int clientWidth = defaultClientWidth; // Actual resolution.
 constexpr unsigned int clientHeight = defaultClientHeight;
 
+constexpr double maxCatchUpTime = 0.5; // Don't extrapolate received state further than this, e.g. a stale packet after a hitch.
+constexpr double reconnectRetryInterval = 1.0; // Seconds between connection attempts while the server holds our slot.
+constexpr double spectateRetryInterval = 1.0; // Seconds between asking for something to watch when there's nothing.
+
 // Game Objects.
 struct GameState
 {
 	bool gameStarted = false;
 };
 
-struct BallInfo
-{
-	float xPosition = 0.5f;
-	float yPosition = 0.5f;
-	float xVelocity = -1.0f;
-	float yVelocity = -1.0f;
-};
-
 struct PlayerInfo
 {
 	bool connected = false;
 
-	float yPosition = 0.5f;
-	bool rightSide = false;
+	bool rightSide = false; // Paddle position lives in the simulation, see Side().
 
 	bool movingUp = false;
 	bool movingDown = false;
 
-	unsigned int score = 0;
+	unsigned int score = 0; // Only ever what the server says, predicted goals don't count.
 
 	bool ready = false;
+	bool away = false; // Peer only, dropped and the server's waiting on them.
+	bool occupied = false; // Spectating only, someone's playing this side. Connected is only ever about us playing.
+
+	int Side() const { return rightSide ? SIM_RIGHT : SIM_LEFT; }
+	bool OnCourt() const { return connected || occupied; } // Has a paddle to draw.
 };
 
 enum class eSounds
@@ -68,6 +64,9 @@ enum class eSounds
 	SOUNDS_MAX
 };
 
+constexpr double cancelFadeTime = 0.03; // Mispredicted sounds fade out over this rather than cutting off with a click.
+constexpr double pendingSoundTimeout = 0.25; // Sounds asked for before they've loaded still play if they load within this, otherwise they're dropped.
+
 // Game Class.
 class Game
 {
@@ -77,6 +76,11 @@ public:
 
 	void Run();
 
+	LinkStats GetLinkStats() const { return m_linkStats.GetStats(); } // RTT, loss and bandwidth to the server, safe from any thread.
+	double ServerNow() const; // Current time on the server's clock, estimated.
+
+	void SetSpectate(uint32 matchId) { m_spectating = true; m_spectateMatchId = matchId; } // Before Run(). Zero watches whatever the server's showing.
+
 private:
 	void Init();
 	void Shutdown();
@@ -84,10 +88,22 @@ private:
 	void Update(double deltaTime = 0.0f);
 	void Draw();
 
-	void PlaySFX(eSounds sound);
+	void SendToServer(const BCNet::Packet packet); // Counts bandwidth.
+
+	void StepSimulation(double deltaTime); // Predicts the ball and paddles with the same simulation the server runs, sounds play straight away.
+	void StepRollback(double deltaTime); // Rollback matches, we run the match ourselves.
+	void SendRollbackInput(uint32_t lastTick);
+	void UpdateSounds(); // Cancels mispredictions and fades.
+
+	void PredictSFX(eSounds sound); // Seen locally.
+	void ConfirmSFX(eSounds sound); // Sent by the server.
+	void PlaySFX(eSounds sound); // m_soundMutex must be held.
 
 	void OnConnected();
 	void OnDisconnected();
+	void SendSpectate();
+	void ResetConnection(); // Back to the connection menu.
+	void UpdateReconnect();
 	void PacketReceived(const BCNet::Packet packet);
 
 private:
@@ -95,7 +111,16 @@ private:
 
 	BCNet::IBCNetClient *m_netClient;
 
+	ConnectionStats m_linkStats;
+	ClockSync m_clockSync;
+	bool m_showNetStats = false; // F3.
+
+	AssetLoader m_assetLoader;
+	std::mutex m_soundMutex; // PlaySFX comes from the network thread, sounds are loaded on the main thread.
 	std::vector<Sound> m_loadedSounds;
+	std::vector<std::pair<eSounds, double>> m_pendingSounds; // Played before loading finished, with when.
+	std::vector<std::pair<eSounds, double>> m_fadingSounds; // Being cancelled, with when the fade started.
+	PredictedEvents m_predictedEvents; // Types are eSounds.
 
 	GameState m_gameState;
 
@@ -103,20 +128,46 @@ private:
 	PlayerInfo m_peerPlayer; // Other client. Only two max players so only need just one reference to a peer.
 	unsigned int m_playerCount = 0; // Not the count of how many is connected to the server, just how many the client knows about. Peer clients should always be >1.
 
-	BallInfo m_ball;
+	SimState m_sim; // Predicted ball and paddles.
+	double m_simAccumulator = 0.0; // Time not yet stepped.
+
+	std::mutex m_rollbackMutex; // Remote inputs arrive on the network thread.
+	RollbackSession m_rollback; // Only active when the server starts a rollback match.
+	bool m_desyncReported = false;
 
 	TextObjectPool m_textPool;
 
+	Renderer m_renderer;
+
 	// Text input stuff for connection menu.
 	constexpr static unsigned int MAX_INPUT = 16;
 	char m_connectionInput[MAX_INPUT + 1] = "\0";
 	int m_connectionInputCount = 0;
+	int m_connectionInputWidth = -1; // Measured width of the input, -1 when it needs measuring again.
 	bool m_ipEntered = false;
 	bool m_portEntered = false;
 	bool m_tryConnect = false;
+	bool m_matchQueued = false; // Connected and waiting for the server to find an opponent.
 	std::string m_enteredIPAddress;
 	int m_enteredPort = -1;
 
+	// Dropped mid match, the server holds our slot for m_sessionGrace seconds if we come back with the token.
+	uint64_t m_sessionToken = 0;
+	double m_sessionGrace = 0.0;
+	bool m_reconnecting = false;
+	double m_droppedAt = 0.0; // ClockNowSeconds().
+	double m_reconnectAttemptAt = 0.0;
+	double m_reconnectedAt = 0.0; // When the new connection came up, zero until it has.
+	double m_lastResumeTime = -1.0; // Seconds from reconnecting to playing again, for the overlay.
+
+	// --spectate, to a server or a Pong_Relay. Left side is m_player and right is m_peerPlayer, nothing we press is sent.
+	// Neither is ever connected, who's playing comes through their occupied.
+	bool m_spectating = false;
+	uint32 m_spectateMatchId = 0;
+	bool m_spectatorLinked = false; // Connected.
+	bool m_watching = false; // Being sent a match.
+	double m_spectateRetryAt = 0.0;
+
 	int m_frameCounter = 0; // Mainly used for the '_' animation with the input.
 
 };
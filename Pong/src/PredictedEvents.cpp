@@ -0,0 +1,51 @@
+#include "PredictedEvents.h"
+
+#include <algorithm>
+
+void PredictedEvents::SetWindow(double window)
+{
+	m_window = std::clamp(window, minPredictionWindow, maxPredictionWindow);
+}
+
+bool PredictedEvents::Predict(int type, double now)
+{
+	if (FindRecent(type, now)) // Already predicted, or the server's was already played.
+		return false;
+
+	m_events.push_back({ type, now, true, false });
+	return true;
+}
+
+bool PredictedEvents::Confirm(int type, double now)
+{
+	if (Event *event = FindRecent(type, now))
+	{
+		event->confirmed = true; // Also swallows the server repeating itself, e.g. a hit over several ticks.
+		return false;
+	}
+
+	m_events.push_back({ type, now, false, true }); // Missed locally, still stops us predicting it late.
+	return true;
+}
+
+void PredictedEvents::Expire(double now, std::vector<int> &mispredicted)
+{
+	for (const Event &event : m_events)
+		if (now - event.time > m_window && event.predicted && !event.confirmed)
+			mispredicted.push_back(event.type);
+
+	std::erase_if(m_events, [this, now](const Event &event) { return now - event.time > m_window; });
+}
+
+void PredictedEvents::Clear()
+{
+	m_events.clear();
+}
+
+PredictedEvents::Event *PredictedEvents::FindRecent(int type, double now)
+{
+	for (Event &event : m_events)
+		if (event.type == type && now - event.time <= m_window)
+			return &event;
+	return nullptr;
+}
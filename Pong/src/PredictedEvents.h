@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+constexpr double minPredictionWindow = 0.1; // How long a predicted event waits for the server to agree, at the least.
+constexpr double maxPredictionWindow = 0.5;
+
+// Matches events the client predicted locally against the server's version of them.
+// Whichever comes first gets played, the other one is absorbed. A prediction the server never
+// confirms within the window was a misprediction and is handed back to be cancelled.
+class PredictedEvents
+{
+public:
+	PredictedEvents() = default;
+	~PredictedEvents() = default;
+
+	void SetWindow(double window); // Usually about one round trip, clamped to the min/max above.
+	double GetWindow() const { return m_window; }
+
+	bool Predict(int type, double now); // True if it should be played now, false if the server beat us to it.
+	bool Confirm(int type, double now); // True if nobody predicted it and it should be played now.
+	void Expire(double now, std::vector<int> &mispredicted); // Appends the types of predictions that were never confirmed.
+
+	void Clear();
+
+private:
+	struct Event
+	{
+		int type = 0;
+		double time = 0.0;
+		bool predicted = false; // Client saw it first.
+		bool confirmed = false; // Server has sent it.
+	};
+
+	Event *FindRecent(int type, double now);
+
+private:
+	std::vector<Event> m_events; // Only ever a handful, at most one per type per window.
+	double m_window = minPredictionWindow;
+
+};
@@ -0,0 +1,182 @@
+#include "Renderer.h"
+
+#include <cstdio>
+
+#include <rlgl.h>
+
+#include "AllocationCounter.h"
+
+void Renderer::Init(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	// raylib points shapes at the default font's white glyph so they batch with text. Set it ourselves, the same way
+	// InitWindow does, so we know what it is and the quad batch can use it too.
+	m_shapesTexture = rlGetTextureIdDefault();
+	m_shapesSource = { 0.0f, 0.0f, 1.0f, 1.0f };
+	Font font = GetFontDefault();
+	if (font.texture.id != 0 && font.glyphCount > 95)
+	{
+		Rectangle glyph = font.recs[95];
+		Rectangle source = { glyph.x + 1, glyph.y + 1, glyph.width - 2, glyph.height - 2 }; // Padded against bleeding with MSAA.
+		SetShapesTexture(font.texture, source);
+
+		m_shapesTexture = font.texture.id;
+		m_shapesSource = { source.x / font.texture.width, source.y / font.texture.height, source.width / font.texture.width, source.height / font.texture.height };
+	}
+
+	// Bake the court.
+	m_court = LoadRenderTexture(width, height);
+	m_courtBaked = IsRenderTextureReady(m_court);
+	if (m_courtBaked)
+	{
+		BeginTextureMode(m_court);
+		ClearBackground(BLACK);
+		for (int i = 0; i < height; i += 24)
+		{
+			DrawRectangle((int)((width / 2.0f) - 4), i - 4, 8, 12, WHITE);
+		}
+		EndTextureMode();
+	}
+}
+
+void Renderer::Shutdown()
+{
+	if (m_courtBaked)
+		UnloadRenderTexture(m_court);
+	m_courtBaked = false;
+
+	m_quadCount = 0;
+	m_widthCount = 0;
+	m_scores[0].valid = false;
+	m_scores[1].valid = false;
+}
+
+void Renderer::BeginFrame()
+{
+	m_frameStats = RenderStats();
+	m_frameStartAllocations = GetAllocationCount();
+}
+
+void Renderer::EndFrame()
+{
+	if (m_frameStartAllocations >= 0)
+		m_frameStats.allocations = GetAllocationCount() - m_frameStartAllocations;
+
+	m_lastFrameStats = m_frameStats;
+}
+
+void Renderer::DrawCourt()
+{
+	if (!m_courtBaked) // Couldn't make the render texture, draw it the slow way.
+	{
+		ClearBackground(BLACK);
+		for (int i = 0; i < m_height; i += 24)
+		{
+			DrawRectangle((int)((m_width / 2.0f) - 4), i - 4, 8, 12, WHITE);
+			m_frameStats.drawCalls++;
+		}
+		return;
+	}
+
+	// Render textures are upside down in OpenGL.
+	Rectangle source = { 0.0f, 0.0f, (float)m_court.texture.width, -(float)m_court.texture.height };
+	DrawTextureRec(m_court.texture, source, { 0.0f, 0.0f }, WHITE);
+	m_frameStats.drawCalls++;
+}
+
+void Renderer::AddQuad(int x, int y, int width, int height, Color color)
+{
+	if (m_quadCount >= MAX_QUADS)
+		FlushQuads();
+
+	m_quads[m_quadCount++] = { (float)x, (float)y, (float)width, (float)height, color };
+}
+
+void Renderer::FlushQuads()
+{
+	if (m_quadCount == 0)
+		return;
+
+	rlCheckRenderBatchLimit(4 * m_quadCount);
+
+	float left = m_shapesSource.x, top = m_shapesSource.y;
+	float right = left + m_shapesSource.width, bottom = top + m_shapesSource.height;
+
+	rlSetTexture(m_shapesTexture); // Same texture as shapes and text, so this batches with them.
+	rlBegin(RL_QUADS);
+	rlNormal3f(0.0f, 0.0f, 1.0f);
+	for (unsigned int i = 0; i < m_quadCount; i++)
+	{
+		const Quad &quad = m_quads[i];
+		rlColor4ub(quad.color.r, quad.color.g, quad.color.b, quad.color.a);
+
+		rlTexCoord2f(left, top);
+		rlVertex2f(quad.x, quad.y);
+		rlTexCoord2f(left, bottom);
+		rlVertex2f(quad.x, quad.y + quad.height);
+		rlTexCoord2f(right, bottom);
+		rlVertex2f(quad.x + quad.width, quad.y + quad.height);
+		rlTexCoord2f(right, top);
+		rlVertex2f(quad.x + quad.width, quad.y);
+	}
+	rlEnd();
+	rlSetTexture(0);
+
+	m_quadCount = 0;
+	m_frameStats.drawCalls++;
+}
+
+void Renderer::DrawScore(bool rightSide, unsigned int score, Color color)
+{
+	CachedScore &cached = m_scores[rightSide ? 1 : 0];
+	if (!cached.valid || cached.score != score) // Only format when it changes.
+	{
+		std::snprintf(cached.text, sizeof(cached.text), "%u", score);
+		cached.score = score;
+		cached.valid = true;
+	}
+
+	int screenHalf = m_width / 2;
+	int leftHalf = screenHalf / 2;
+	int rightHalf = screenHalf + leftHalf;
+	int scoreXPos = rightSide ? rightHalf : leftHalf;
+
+	DrawText(cached.text, scoreXPos, (int)(m_height / 5.0f), 48, color);
+}
+
+void Renderer::DrawReadyText(bool ready, bool rightSide, int playerXPos, int playerYPos, int playerHeight, Color color)
+{
+	const char *readyText = ready ? "Is Ready" : "Not Ready";
+
+	int textXPos = playerXPos + 12;
+	if (rightSide)
+		textXPos = playerXPos - MeasureStaticText(readyText, 24) - 12;
+
+	int textYPos = playerYPos - playerHeight;
+	if (textYPos < 0)
+		textYPos = 0;
+	if (textYPos > m_height - 24)
+		textYPos = m_height - 24;
+
+	DrawText(readyText, textXPos, textYPos, 24, color);
+}
+
+void Renderer::DrawText(const char *text, int x, int y, int fontSize, Color color)
+{
+	::DrawText(text, x, y, fontSize, color);
+	m_frameStats.drawCalls++;
+}
+
+int Renderer::MeasureStaticText(const char *text, int fontSize)
+{
+	for (unsigned int i = 0; i < m_widthCount; i++)
+		if (m_widths[i].text == text && m_widths[i].fontSize == fontSize)
+			return m_widths[i].width;
+
+	int width = MeasureText(text, fontSize);
+	if (m_widthCount < MAX_CACHED_WIDTHS)
+		m_widths[m_widthCount++] = { text, fontSize, width };
+	return width;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+#include <raylib.h>
+
+// Per frame counters, shown on the F3 overlay.
+struct RenderStats
+{
+	int drawCalls = 0; // Draw submissions we make, i.e. texture/quad batch/text calls, not GPU draw calls.
+	int64_t allocations = -1; // Heap allocations during the frame, -1 when not counted (see AllocationCounter.h).
+};
+
+// Caches everything that doesn't change from frame to frame.
+// The court is baked into a render texture once, HUD text is formatted and measured only when its value changes,
+// and the paddles and ball go out as one quad batch.
+class Renderer
+{
+public:
+	Renderer() = default;
+	~Renderer() = default;
+
+	void Init(int width, int height); // Needs the window to be open.
+	void Shutdown();
+
+	void BeginFrame();
+	void EndFrame();
+
+	void DrawCourt(); // Background and centre-line.
+
+	void AddQuad(int x, int y, int width, int height, Color color); // Queued until FlushQuads().
+	void FlushQuads();
+
+	void DrawScore(bool rightSide, unsigned int score, Color color);
+	void DrawReadyText(bool ready, bool rightSide, int playerXPos, int playerYPos, int playerHeight, Color color);
+
+	void DrawText(const char *text, int x, int y, int fontSize, Color color); // Counted DrawText.
+
+	// Width of a string literal, measured once. Keyed on the pointer so only use it with strings that never change.
+	int MeasureStaticText(const char *text, int fontSize);
+
+	const RenderStats &GetLastFrameStats() const { return m_lastFrameStats; }
+
+private:
+	struct Quad
+	{
+		float x, y, width, height;
+		Color color;
+	};
+
+	struct CachedScore
+	{
+		unsigned int score = 0;
+		bool valid = false;
+		char text[16] = "";
+	};
+
+	struct CachedWidth
+	{
+		const char *text = nullptr;
+		int fontSize = 0;
+		int width = 0;
+	};
+
+private:
+	int m_width = 0;
+	int m_height = 0;
+
+	RenderTexture2D m_court = { };
+	bool m_courtBaked = false;
+
+	// What shapes and text are drawn with, the default font's texture. Quads on anything else would be a draw of their own.
+	unsigned int m_shapesTexture = 0;
+	Rectangle m_shapesSource = { 0.0f, 0.0f, 1.0f, 1.0f }; // In texture coordinates.
+
+	constexpr static unsigned int MAX_QUADS = 16;
+	Quad m_quads[MAX_QUADS];
+	unsigned int m_quadCount = 0;
+
+	CachedScore m_scores[2]; // Left, right.
+
+	constexpr static unsigned int MAX_CACHED_WIDTHS = 32;
+	CachedWidth m_widths[MAX_CACHED_WIDTHS];
+	unsigned int m_widthCount = 0;
+
+	RenderStats m_frameStats;
+	RenderStats m_lastFrameStats;
+	int64_t m_frameStartAllocations = 0;
+
+};
@@ -1,13 +1,30 @@
+#include <string>
+
 #include "Game.h"
+#include "SimConformance.h"
+#include "Logger.h"
 
-int main()
+int main(int argc, char **argv)
 {
+	if (argc >= 4 && std::string(argv[1]) == "--sim-conformance") // Replay recorded inputs with this build's simulation and exit.
+		return RunSimConformance(argv[2], argv[3]);
+	if (argc >= 3 && std::string(argv[1]) == "--sim-golden") // Check this build's simulation against checked in hashes and exit.
+		return RunSimGoldenCheck(argv[2]);
+
 	Game *game = new Game();
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--spectate") // Watch instead of play, optionally a match ID. Works against a server or a Pong_Relay.
+			game->SetSpectate(i + 1 < argc && argv[i + 1][0] != '-' ? (uint32)std::stoul(argv[++i]) : 0);
+	}
+	Logger::Start(); // Messages and the countdown are written from the network thread, this keeps the console off it.
 	game->Run();
 
 	if (game)
 		delete game;
 	game = nullptr;
+	Logger::Stop();
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,559 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <memory>
+
+#include <BCNet/IBCNetServer.h>
+#include <BCNet/BCNetPacket.h>
+#include <BCNet/BCNetUtil.h>
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "HashRing.h"
+#include "WorkerLink.h"
+#include "ShmLink.h"
+
+// Front door for any number of Pong_Server workers on the same host, started with --worker-port.
+// Clients connect here exactly as they would to a server. Each is given a match ID two at a time, the match ID is
+// hashed onto the ring of healthy workers and everything the client sends goes to that worker, and back.
+// A worker that stops answering health checks is taken off the ring and its matches are handed to whoever they hash
+// to now, the players start over in that worker's queue. Live matches stay where they are when a worker comes back.
+// A client reconnecting lands wherever the open match is, if the worker holding its old slot is another one, that worker
+// forwards its token here and it's moved over.
+// Workers are reached over loopback UDP, or with --link shm over shared memory rings, one region per worker.
+
+static BCNet::IBCNetServer *g_server;
+static std::atomic<bool> g_stopRequested = false;
+
+constexpr int gatewayMaxClients = 1024;
+constexpr int playersPerMatch = 2;
+constexpr double healthCheckInterval = 0.25; // Seconds between pings to each worker.
+constexpr double workerTimeout = 1.0; // Seconds without a pong before a worker is down.
+constexpr double defaultReportInterval = 10.0;
+
+struct GatewayWorker
+{
+	uint16_t port = 0;
+	bool healthy = false; // On the ring.
+	double lastPong = 0.0;
+	double lastPing = 0.0;
+	uint32_t nextSequence = 0;
+
+	uint32_t players = 0; // As of the last pong.
+	uint32_t matches = 0;
+	LatencyHistogram linkRtt; // Gateway -> worker -> gateway, nanoseconds.
+
+	std::unique_ptr<ShmLink> shm; // --link shm, each worker has its own rings and a thread reading them.
+	std::thread shmThread;
+	bool reopenShm = false; // Map it again, see CheckHealth().
+	std::vector<uint32_t> movedClients; // Taken off it while it was down, it's told they've gone before it's back on the ring.
+};
+
+struct GatewayMatch
+{
+	uint16_t workerPort = 0; // Zero until there's a healthy worker to put it on.
+	int players = 0;
+};
+
+struct GatewayClient
+{
+	uint32_t matchId = 0;
+	uint16_t workerPort = 0;
+};
+
+// A dropped client's slot, held by a worker under the token the client will come back with.
+struct GatewaySession
+{
+	uint16_t workerPort = 0;
+	double expiresAt = 0.0;
+};
+
+// --------------------- Main Class
+class Gateway
+{
+public:
+	void AddWorker(uint16_t port)
+	{
+		GatewayWorker worker;
+		worker.port = port;
+		m_workers.push_back(std::move(worker));
+	}
+
+	void SetUseShm(bool useShm) { m_useShm = useShm; }
+
+	bool Run(double reportInterval)
+	{
+		m_linkRunning = true;
+		std::thread linkThread;
+		if (m_useShm)
+		{
+			for (GatewayWorker &worker : m_workers)
+			{
+				worker.shm = std::make_unique<ShmLink>();
+				worker.shmThread = std::thread([this, &worker]() { ShmLoop(worker); });
+			}
+			std::cout << "Gateway up, " << m_workers.size() << " workers over shared memory" << std::endl;
+		}
+		else
+		{
+			if (!m_link.Open(0))
+			{
+				std::cout << "Couldn't open the worker link" << std::endl;
+				return false;
+			}
+			linkThread = std::thread([this]() { LinkLoop(); });
+			std::cout << "Gateway up, " << m_workers.size() << " workers, link on port " << m_link.GetPort() << std::endl;
+		}
+
+		double lastReport = ClockNowSeconds();
+		while (!g_stopRequested)
+		{
+			double now = ClockNowSeconds();
+			CheckHealth(now);
+
+			if (now - lastReport >= reportInterval)
+			{
+				std::cout << Report();
+				lastReport = now;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		m_linkRunning = false;
+		if (linkThread.joinable())
+			linkThread.join();
+		for (GatewayWorker &worker : m_workers)
+		{
+			if (worker.shmThread.joinable())
+				worker.shmThread.join();
+		}
+
+		std::cout << Report();
+		m_link.Close();
+		return true;
+	}
+
+public:
+	void OnConnected(const BCNet::ClientInfo &clientInfo)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Everyone joins the open match until it's full, so players who connect together end up on the same worker.
+		if (m_openMatchId == 0 || m_matches[m_openMatchId].players >= playersPerMatch)
+			m_openMatchId = m_nextMatchId++;
+
+		GatewayMatch &match = m_matches[m_openMatchId];
+		match.players++;
+
+		GatewayClient &client = m_clients[clientInfo.id];
+		client.matchId = m_openMatchId;
+		client.workerPort = RouteMatch(m_openMatchId, match);
+		if (client.workerPort != 0)
+			SendToWorker(client.workerPort, WORKER_CLIENT_CONNECTED, clientInfo.id, &client.matchId, sizeof(client.matchId));
+	}
+
+	void OnDisconnected(const BCNet::ClientInfo &clientInfo)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_clients.find(clientInfo.id);
+		if (it == m_clients.end())
+			return;
+
+		if (it->second.workerPort != 0)
+			SendToWorker(it->second.workerPort, WORKER_CLIENT_DISCONNECTED, clientInfo.id);
+
+		LeaveMatch(it->second.matchId);
+		m_clients.erase(it);
+	}
+
+	void PacketReceived(const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet)
+	{
+		int64_t received = ClockNowNanoseconds();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_clients.find(clientInfo.id);
+		if (it == m_clients.end() || it->second.workerPort == 0) // Nowhere to send it yet.
+			return;
+
+		if (SendToWorker(it->second.workerPort, WORKER_CLIENT_PACKET, clientInfo.id, packet.Data, packet.Size))
+			m_toWorkerCost.Record(ClockNowNanoseconds() - received);
+	}
+
+private:
+	void LinkLoop()
+	{
+		WorkerMessage message;
+		while (m_linkRunning)
+		{
+			if (m_link.Receive(message, 0.1))
+				HandleWorkerMessage(message);
+		}
+	}
+
+	void ShmLoop(GatewayWorker &worker)
+	{
+		WorkerMessage message;
+		while (m_linkRunning)
+		{
+			bool reopen;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				reopen = worker.reopenShm || !worker.shm->IsOpen();
+				worker.reopenShm = false;
+			}
+
+			// The worker creates the region, keep trying until it's there.
+			if (reopen && !worker.shm->Open(worker.port, SHM_LINK_GATEWAY))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(250));
+				continue;
+			}
+
+			if (worker.shm->Receive(message, 0.1))
+				HandleWorkerMessage(message);
+		}
+		worker.shm->Close();
+	}
+
+	void HandleWorkerMessage(const WorkerMessage &message)
+	{
+		int64_t received = ClockNowNanoseconds();
+
+		switch (message.type)
+		{
+			case WORKER_CLIENT_PACKET:
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto it = m_clients.find(message.clientId);
+				if (it == m_clients.end() || it->second.workerPort != message.fromPort) // Gone, or moved since.
+					break;
+
+				BCNet::Packet packet;
+				packet.Allocate(message.size);
+				std::memcpy(packet.Data, message.payload, message.size);
+				g_server->SendPacketToClient(message.clientId, packet);
+				packet.Release();
+
+				m_toClientCost.Record(ClockNowNanoseconds() - received);
+			} break;
+			case WORKER_HEALTH_PONG:
+			{
+				if (message.size < sizeof(WorkerHealthPong))
+					break;
+
+				WorkerHealthPong pong;
+				std::memcpy(&pong, message.payload, sizeof(pong));
+				OnHealthPong(message.fromPort, pong, received);
+			} break;
+			case WORKER_SESSION_HELD:
+			{
+				if (message.size < sizeof(WorkerSessionHeld))
+					break;
+
+				WorkerSessionHeld held;
+				std::memcpy(&held, message.payload, sizeof(held));
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_heldSessions[held.token] = { message.fromPort, ClockNowSeconds() + held.grace };
+			} break;
+			case WORKER_SESSION_FORWARD:
+			{
+				uint64_t token;
+				if (message.size < sizeof(token))
+					break;
+
+				std::memcpy(&token, message.payload, sizeof(token));
+				MoveToHeldSession(message.fromPort, message.clientId, token);
+			} break;
+			default:
+				break;
+		}
+	}
+
+	void MoveToHeldSession(uint16_t fromPort, uint32_t clientId, uint64_t token)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto client = m_clients.find(clientId);
+		if (client == m_clients.end() || client->second.workerPort != fromPort) // Gone, or moved since.
+			return;
+
+		auto session = m_heldSessions.find(token);
+		GatewayWorker *owner = session != m_heldSessions.end() ? FindWorker(session->second.workerPort) : nullptr;
+		if (!owner || !owner->healthy || owner->port == fromPort)
+		{
+			SendToWorker(fromPort, WORKER_SESSION_REFUSED, clientId);
+			return;
+		}
+		m_heldSessions.erase(session);
+
+		// Out of the match it was put in and into one of its own, pinned to the worker its old match is on.
+		SendToWorker(fromPort, WORKER_CLIENT_DISCONNECTED, clientId);
+		LeaveMatch(client->second.matchId);
+
+		client->second.matchId = m_nextMatchId++;
+		client->second.workerPort = owner->port;
+		GatewayMatch &match = m_matches[client->second.matchId];
+		match.workerPort = owner->port;
+		match.players = 1;
+
+		SendToWorker(owner->port, WORKER_CLIENT_RESUMING, clientId, &token, sizeof(token));
+		m_movedResumes++;
+	}
+
+	void LeaveMatch(uint32_t matchId)
+	{
+		auto match = m_matches.find(matchId);
+		if (match != m_matches.end() && --match->second.players <= 0 && match->first != m_openMatchId)
+			m_matches.erase(match);
+	}
+
+	bool SendToWorker(uint16_t port, uint8_t type, uint32_t clientId, const void *payload = nullptr, size_t size = 0)
+	{
+		if (!m_useShm)
+			return m_link.Send(port, type, clientId, payload, size);
+
+		GatewayWorker *worker = FindWorker(port);
+		return worker && worker->shm && worker->shm->Send(type, clientId, payload, size);
+	}
+
+	void CheckHealth(double now)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (GatewayWorker &worker : m_workers)
+		{
+			if (worker.healthy && now - worker.lastPong > workerTimeout)
+				OnWorkerDown(worker);
+
+			if (now - worker.lastPing < healthCheckInterval)
+				continue;
+
+			// Down workers are still pinged, they're put back on the ring as soon as they answer.
+			WorkerHealthPing ping;
+			ping.sequence = worker.nextSequence++;
+			ping.sentTime = ClockNowNanoseconds();
+			SendToWorker(worker.port, WORKER_HEALTH_PING, 0, &ping, sizeof(ping));
+			worker.lastPing = now;
+
+			// A restarted worker makes a new region under the same name, our mapping could be of the old one.
+			if (!worker.healthy)
+				worker.reopenShm = m_useShm;
+		}
+
+		for (auto it = m_heldSessions.begin(); it != m_heldSessions.end();)
+		{
+			if (now > it->second.expiresAt) // The worker's given the slot up by now.
+				it = m_heldSessions.erase(it);
+			else
+				++it;
+		}
+	}
+
+	void OnHealthPong(uint16_t port, const WorkerHealthPong &pong, int64_t received)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		GatewayWorker *worker = FindWorker(port);
+		if (!worker)
+			return;
+
+		worker->linkRtt.Record(received - pong.sentTime);
+		worker->lastPong = ClockNowSeconds();
+		worker->players = pong.players;
+		worker->matches = pong.matches;
+
+		if (worker->healthy)
+			return;
+
+		// It might only have been slow and still think it has the players we moved, it'd keep their matches running.
+		for (uint32_t id : worker->movedClients)
+			SendToWorker(port, WORKER_CLIENT_DISCONNECTED, id);
+		worker->movedClients.clear();
+
+		worker->healthy = true;
+		m_ring.AddNode(port);
+		std::cout << "Worker " << port << " is up, " << m_ring.GetNodeCount() << " on the ring" << std::endl;
+
+		// Anyone who connected while there was nowhere to put them.
+		for (auto &[id, client] : m_clients)
+		{
+			if (client.workerPort != 0)
+				continue;
+
+			client.workerPort = RouteMatch(client.matchId, m_matches[client.matchId]);
+			if (client.workerPort != 0)
+				SendToWorker(client.workerPort, WORKER_CLIENT_CONNECTED, id, &client.matchId, sizeof(client.matchId));
+		}
+	}
+
+	void OnWorkerDown(GatewayWorker &worker)
+	{
+		worker.healthy = false;
+		m_ring.RemoveNode(worker.port);
+
+		// Its matches go wherever they hash to now. Only those move, the other workers' matches stay put.
+		int movedMatches = 0;
+		for (auto &[id, match] : m_matches)
+		{
+			if (match.workerPort != worker.port)
+				continue;
+
+			match.workerPort = 0;
+			RouteMatch(id, match);
+			movedMatches++;
+		}
+
+		// Their matches went with it.
+		for (auto it = m_heldSessions.begin(); it != m_heldSessions.end();)
+		{
+			if (it->second.workerPort == worker.port)
+				it = m_heldSessions.erase(it);
+			else
+				++it;
+		}
+
+		int movedClients = 0;
+		for (auto &[id, client] : m_clients)
+		{
+			if (client.workerPort != worker.port)
+				continue;
+
+			// Best effort, a dead worker won't hear it. Sent again when it answers, see OnHealthPong().
+			SendToWorker(worker.port, WORKER_CLIENT_DISCONNECTED, id);
+			worker.movedClients.push_back(id);
+
+			client.workerPort = m_matches[client.matchId].workerPort;
+			if (client.workerPort != 0)
+				SendToWorker(client.workerPort, WORKER_CLIENT_CONNECTED, id, &client.matchId, sizeof(client.matchId));
+			movedClients++;
+		}
+
+		m_rebalances++;
+		std::cout << "Worker " << worker.port << " is down, moved " << movedMatches << " matches and " << movedClients << " players, "
+			<< m_ring.GetNodeCount() << " left on the ring" << std::endl;
+	}
+
+	uint16_t RouteMatch(uint32_t matchId, GatewayMatch &match)
+	{
+		// Sticky once placed, so a worker coming back doesn't pull matches away from the ones that took them over.
+		uint32_t node;
+		if (match.workerPort == 0 && m_ring.Lookup(matchId, node))
+			match.workerPort = (uint16_t)node;
+		return match.workerPort;
+	}
+
+	GatewayWorker *FindWorker(uint16_t port)
+	{
+		for (GatewayWorker &worker : m_workers)
+			if (worker.port == port)
+				return &worker;
+		return nullptr;
+	}
+
+	std::string Report()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// What the hop costs a client's round trip: our forwarding both ways plus the link there and back.
+		LatencyHistogram allLinks;
+		for (GatewayWorker &worker : m_workers)
+			allLinks.Merge(worker.linkRtt);
+
+		std::ostringstream report;
+		report << "gateway: " << m_clients.size() << " players, " << m_matches.size() << " matches, " << m_rebalances << " rebalances, "
+			<< m_heldSessions.size() << " slots held, " << m_movedResumes << " reconnects moved to their slot's worker\n";
+		for (GatewayWorker &worker : m_workers)
+		{
+			report << "  worker " << worker.port << ": " << (worker.healthy ? "up" : "down") << ", " << worker.players << " players, "
+				<< worker.matches << " matches, link rtt p50 " << worker.linkRtt.Percentile(50.0) / 1000 << "us p99 " << worker.linkRtt.Percentile(99.0) / 1000 << "us\n";
+		}
+		report << "  forwarding to workers p50 " << m_toWorkerCost.Percentile(50.0) / 1000 << "us p99 " << m_toWorkerCost.Percentile(99.0) / 1000
+			<< "us, back to clients p50 " << m_toClientCost.Percentile(50.0) / 1000 << "us p99 " << m_toClientCost.Percentile(99.0) / 1000 << "us\n";
+		report << "  hop adds about " << (allLinks.Percentile(50.0) + m_toWorkerCost.Percentile(50.0) + m_toClientCost.Percentile(50.0)) / 1000
+			<< "us to a round trip (p50), " << (allLinks.Percentile(99.0) + m_toWorkerCost.Percentile(99.0) + m_toClientCost.Percentile(99.0)) / 1000 << "us (p99)\n";
+		return report.str();
+	}
+
+private:
+	bool m_useShm = false;
+	WorkerLink m_link; // Loopback UDP, one socket for every worker.
+	std::atomic<bool> m_linkRunning = false;
+
+	std::mutex m_mutex; // Everything below, clients come and go on BCNet's thread and workers answer on the link thread.
+	std::vector<GatewayWorker> m_workers;
+	HashRing m_ring; // Healthy workers by port.
+	std::unordered_map<uint32_t, GatewayMatch> m_matches;
+	std::unordered_map<uint32_t, GatewayClient> m_clients;
+	uint32_t m_nextMatchId = 1;
+	uint32_t m_openMatchId = 0; // Still waiting for its second player.
+	uint64_t m_rebalances = 0;
+	std::unordered_map<uint64_t, GatewaySession> m_heldSessions; // By token.
+	uint64_t m_movedResumes = 0;
+
+	LatencyHistogram m_toWorkerCost; // Client packet received -> sent on to its worker, nanoseconds.
+	LatencyHistogram m_toClientCost; // Worker packet received -> sent on to its client.
+
+};
+
+// ------------------------- Entry point.
+int main(int argc, char **argv)
+{
+	Gateway gateway;
+	double reportInterval = defaultReportInterval;
+	int workerCount = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--workers" && i + 1 < argc) // Comma separated link ports, whatever each Pong_Server was given as --worker-port.
+		{
+			std::stringstream ports(argv[++i]);
+			std::string port;
+			while (std::getline(ports, port, ','))
+			{
+				gateway.AddWorker((uint16_t)std::stoi(port));
+				workerCount++;
+			}
+		}
+		else if (arg == "--report" && i + 1 < argc) // Seconds between stats.
+			reportInterval = std::stod(argv[++i]);
+		else if (arg == "--link" && i + 1 < argc) // udp (default) or shm, the workers have to be given the same.
+			gateway.SetUseShm(std::string(argv[++i]) == "shm");
+	}
+
+	if (workerCount == 0)
+	{
+		std::cout << "Usage: Pong_Gateway --workers <port,port,...> [--link udp|shm] [--report <seconds>]" << std::endl;
+		return 1;
+	}
+
+	std::signal(SIGINT, [](int) { g_stopRequested = true; });
+
+	g_server = BCNet::InitServer(); // Clients connect to us like they would to a server.
+
+	// Setup callbacks.
+	g_server->SetConnectedCallback([&](const BCNet::ClientInfo &clientInfo) { gateway.OnConnected(clientInfo); });
+	g_server->SetDisconnectedCallback([&](const BCNet::ClientInfo &clientInfo) { gateway.OnDisconnected(clientInfo); });
+	g_server->SetPacketReceivedCallback([&](const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet) { gateway.PacketReceived(clientInfo, packet); });
+
+	g_server->SetMaxClients(gatewayMaxClients);
+
+	g_server->Start();
+
+	int exitCode = gateway.Run(reportInterval) ? 0 : 1;
+
+	g_server->Stop();
+
+	// Clean up.
+	delete g_server;
+	g_server = nullptr;
+
+	return exitCode;
+}
@@ -0,0 +1,270 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+
+#include <BCNet/IBCNetServer.h>
+#include <BCNet/IBCNetClient.h>
+#include <BCNet/BCNetPacket.h>
+#include <BCNet/BCNetUtil.h>
+
+#include "shared.h"
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "SpectatorRelay.h"
+
+// Streams one match on to any number of spectators, so watching it costs the game server a single connection.
+// Connects to a Pong_Server or Pong_Gateway as a spectator, holds every frame it's sent back by --delay seconds, then
+// sends it as is to everyone connected here. Spectators connect with 'Pong --spectate', the same as to a server.
+// BCNet's server only listens on its default port, so run it on a different host from the server it's watching.
+
+static BCNet::IBCNetServer *g_server;
+static BCNet::IBCNetClient *g_upstream;
+static std::atomic<bool> g_stopRequested = false;
+
+constexpr int relayMaxClients = 4096;
+constexpr double upstreamRetryInterval = 1.0; // Seconds between connecting, or asking for a match, upstream.
+constexpr double defaultRelayReportInterval = 10.0;
+
+// --------------------- Main Class
+class Relay
+{
+public:
+	void SetUpstream(const std::string &address, int port) { m_upstreamAddress = address; m_upstreamPort = port; }
+	void SetMatchId(uint32 matchId) { m_matchId = matchId; }
+	void SetDelay(double seconds) { m_relay.SetDelay(seconds); }
+
+	void Run(double reportInterval)
+	{
+		std::cout << "Relaying match " << (m_matchId != 0 ? std::to_string(m_matchId) : std::string("on screen")) << " from " << m_upstreamAddress
+			<< " with a " << m_relay.GetDelay() << "s delay" << std::endl;
+
+		double lastReport = ClockNowSeconds();
+		while (!g_stopRequested)
+		{
+			double now = ClockNowSeconds();
+			UpdateUpstream(now);
+
+			m_relay.Flush(now, [](const uint8_t *data, size_t size, const std::vector<uint32_t> &subscribers)
+			{
+				// One copy for everyone.
+				BCNet::Packet packet;
+				packet.Allocate(size);
+				std::memcpy(packet.Data, data, size);
+				for (uint32_t id : subscribers)
+					g_server->SendPacketToClient(id, packet);
+				packet.Release();
+			});
+
+			if (now - lastReport >= reportInterval)
+			{
+				std::cout << Report(now - lastReport);
+				lastReport = now;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Frames are due a tick apart, this is plenty.
+		}
+
+		std::cout << Report(0.0);
+	}
+
+public:
+	// Spectators, downstream.
+	void OnSpectatorConnected(const BCNet::ClientInfo &clientInfo) { m_relay.Subscribe(clientInfo.id); }
+	void OnSpectatorDisconnected(const BCNet::ClientInfo &clientInfo) { m_relay.Unsubscribe(clientInfo.id); }
+
+	void SpectatorPacketReceived(const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet)
+	{
+		// Their pings, so their clock sync and link stats work like anywhere else. Nothing else they send matters.
+		BCNet::PacketStreamReader reader(packet);
+		int packetID;
+		reader >> packetID;
+		if (packetID != (int)PongPackets::PONG_PING)
+			return;
+
+		uint32 sequence;
+		double sentTime;
+		reader >> sequence >> sentTime;
+
+		BCNet::Packet pong;
+		pong.Allocate(1024);
+		BCNet::PacketStreamWriter writer(pong);
+		writer << PongPackets::PONG_PONG << sequence << sentTime << ClockNowSeconds();
+		g_server->SendPacketToClient(clientInfo.id, writer.GetPacket());
+		pong.Release();
+	}
+
+	// The server, upstream.
+	void OnUpstreamConnected()
+	{
+		m_upstreamConnected = true;
+		m_watching = false;
+		m_nextUpstreamAttempt = 0.0; // Ask for the match straight away.
+	}
+
+	void OnUpstreamDisconnected()
+	{
+		m_upstreamConnected = false;
+		m_watching = false;
+	}
+
+	void UpstreamPacketReceived(const BCNet::Packet packet)
+	{
+		double now = ClockNowSeconds();
+
+		BCNet::PacketStreamReader reader(packet);
+		int packetID;
+		reader >> packetID;
+
+		switch (packetID)
+		{
+			case (int)PongPackets::PONG_PING:
+			{
+				// The server's RTT pings, answered like a client would.
+				uint32 sequence;
+				double sentTime;
+				reader >> sequence >> sentTime;
+
+				BCNet::Packet pong;
+				pong.Allocate(1024);
+				BCNet::PacketStreamWriter writer(pong);
+				writer << PongPackets::PONG_PONG << sequence << sentTime;
+				g_upstream->SendPacketToServer(writer.GetPacket());
+				pong.Release();
+			} break;
+			case (int)PongPackets::PONG_MATCH_SNAPSHOT:
+			{
+				m_watching = true;
+				m_relay.Push(packet.Data, packet.Size, now);
+			} break;
+			case (int)PongPackets::PONG_GAME_ENDED:
+			{
+				// Passed on in order, then we ask for whatever's next.
+				m_watching = false;
+				m_nextUpstreamAttempt = now + upstreamRetryInterval;
+				m_relay.Push(packet.Data, packet.Size, now);
+			} break;
+			default:
+				break;
+		}
+	}
+
+private:
+	void UpdateUpstream(double now)
+	{
+		if (m_watching || now < m_nextUpstreamAttempt)
+			return;
+		m_nextUpstreamAttempt = now + upstreamRetryInterval;
+
+		if (!m_upstreamConnected)
+		{
+			std::string connectCommand("/connect " + m_upstreamAddress + " " + std::to_string(m_upstreamPort));
+			g_upstream->PushInputAsCommand(connectCommand); // Same workaround as the client.
+			return;
+		}
+
+		BCNet::Packet packet;
+		packet.Allocate(1024);
+		BCNet::PacketStreamWriter writer(packet);
+		writer << PongPackets::PONG_SPECTATE << m_matchId;
+		g_upstream->SendPacketToServer(writer.GetPacket());
+		packet.Release();
+	}
+
+	std::string Report(double interval)
+	{
+		SpectatorRelayStats stats = m_relay.GetStats();
+
+		std::ostringstream report;
+		report << "relay: " << m_relay.GetSubscriberCount() << " spectators, " << m_relay.GetBufferedCount() << " frames buffered, "
+			<< stats.framesIn << " in, " << stats.framesOut << " out, " << stats.framesDropped << " dropped";
+		if (interval > 0.0)
+			report << ", " << (stats.sends - m_lastSends) / interval << " sends/s, " << (stats.bytesOut - m_lastBytes) / interval / 1024.0 << " KiB/s";
+		report << "\n  fan out per frame p50 " << stats.fanOut.Percentile(50.0) / 1000 << "us p99 " << stats.fanOut.Percentile(99.0) / 1000
+			<< "us, late p99 " << stats.lateness.Percentile(99.0) / 1000 << "us\n";
+
+		m_lastSends = stats.sends;
+		m_lastBytes = stats.bytesOut;
+		return report.str();
+	}
+
+private:
+	SpectatorRelay m_relay;
+
+	std::string m_upstreamAddress = "127.0.0.1";
+	int m_upstreamPort = -1; // Same as the client's connection menu, -1 is BCNet's default.
+	uint32 m_matchId = 0;
+	std::atomic<bool> m_upstreamConnected = false;
+	std::atomic<bool> m_watching = false; // Frames are coming.
+	std::atomic<double> m_nextUpstreamAttempt = 0.0;
+
+	uint64_t m_lastSends = 0; // As of the last report.
+	uint64_t m_lastBytes = 0;
+
+};
+
+// ------------------------- Entry point.
+int main(int argc, char **argv)
+{
+	Relay relay;
+	double reportInterval = defaultRelayReportInterval;
+	std::string address;
+	int port = -1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--server" && i + 1 < argc) // Address of the Pong_Server or Pong_Gateway to watch.
+			address = argv[++i];
+		else if (arg == "--port" && i + 1 < argc)
+			port = std::stoi(argv[++i]);
+		else if (arg == "--match" && i + 1 < argc) // Match ID, whatever the server has on screen if not given.
+			relay.SetMatchId((uint32)std::stoul(argv[++i]));
+		else if (arg == "--delay" && i + 1 < argc) // Seconds spectators are held behind the match.
+			relay.SetDelay(std::stod(argv[++i]));
+		else if (arg == "--report" && i + 1 < argc) // Seconds between stats.
+			reportInterval = std::stod(argv[++i]);
+	}
+
+	if (address.empty())
+	{
+		std::cout << "Usage: Pong_Relay --server <address> [--port <port>] [--match <id>] [--delay <seconds>] [--report <seconds>]" << std::endl;
+		return 1;
+	}
+	relay.SetUpstream(address, port);
+
+	std::signal(SIGINT, [](int) { g_stopRequested = true; });
+
+	g_upstream = BCNet::InitClient();
+	g_upstream->SetConnectedCallback([&]() { relay.OnUpstreamConnected(); });
+	g_upstream->SetDisconnectedCallback([&]() { relay.OnUpstreamDisconnected(); });
+	g_upstream->SetPacketReceivedCallback([&](const BCNet::Packet packet) { relay.UpstreamPacketReceived(packet); });
+
+	g_server = BCNet::InitServer(); // Spectators connect to us like they would to a server.
+	g_server->SetConnectedCallback([&](const BCNet::ClientInfo &clientInfo) { relay.OnSpectatorConnected(clientInfo); });
+	g_server->SetDisconnectedCallback([&](const BCNet::ClientInfo &clientInfo) { relay.OnSpectatorDisconnected(clientInfo); });
+	g_server->SetPacketReceivedCallback([&](const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet) { relay.SpectatorPacketReceived(clientInfo, packet); });
+	g_server->SetMaxClients(relayMaxClients);
+
+	g_upstream->Start();
+	g_server->Start();
+
+	relay.Run(reportInterval);
+
+	g_server->Stop();
+	g_upstream->Stop();
+
+	// Clean up.
+	if (g_server)
+		delete g_server;
+	g_server = nullptr;
+	if (g_upstream)
+		delete g_upstream;
+	g_upstream = nullptr;
+
+	return 0;
+}
@@ -0,0 +1,665 @@
+#include "Match.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "Profiler.h"
+#include "Clock.h"
+#include "Rollback.h"
+#include "ByteIO.h"
+#include "Logger.h"
+
+constexpr uint32_t matchSnapshotMagic = 0x54414D50; // "PMAT".
+constexpr double updateCostSmoothing = 0.05; // Weight of each new Update() in the cost, about a second's worth at 60Hz.
+constexpr size_t joinSnapshotCapacity = 1024;
+
+enum eMatchSnapshotFlags
+{
+	MATCH_SNAPSHOT_FIXED_POINT = 1 << 0, // Same as the replay flag, a float build can't carry on a fixed point match.
+};
+
+Match::Match(uint32 id, IMatchHost &host, bool rollbackMode)
+	: m_id(id), m_host(host), m_rollbackMode(rollbackMode)
+{
+	m_joinSnapshotBuffer.Allocate(joinSnapshotCapacity);
+	Reset();
+}
+
+Match::~Match()
+{
+	m_replay->Stop();
+	m_joinSnapshotBuffer.Release();
+
+	for (BCNet::Packet &packet : m_outgoingPackets)
+		packet.Release();
+}
+
+bool Match::AddPlayer(uint32 clientId)
+{
+	if (IsFull() || HasPlayer(clientId))
+		return false;
+
+	// Take whichever side is free, one player per paddle.
+	bool leftTaken = false;
+	for (auto &[id, info] : m_players)
+		if (!info.rightSide)
+			leftTaken = true;
+
+	// Setup player with defaults.
+	PlayerInfo &player = m_players[clientId];
+	player.movingUp = false;
+	player.movingDown = false;
+	player.rightSide = leftTaken;
+	player.ready = false;
+	m_sim.paddles[player.Side()] = SimPaddle();
+	m_joinSnapshotStale = true;
+
+	// Tell everyone in the match that another player has connected, the new player always hears about themself first.
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_PLAYER_CONNECTED << clientId << player.rightSide;
+	m_host.SendToClient(clientId, writer.GetPacket());
+	SendToOtherPlayers(writer.GetPacket(), clientId);
+	packet.Release();
+
+	m_host.SendToClient(clientId, GetJoinSnapshot()); // Then everything else, so they're right from their first frame.
+	return true;
+}
+
+void Match::RemovePlayer(uint32 clientId)
+{
+	// Get rid of disconnected player.
+	auto it = m_players.find(clientId);
+	if (it == m_players.end())
+		return;
+	if (it->second.away)
+		m_awayCount--;
+	m_players.erase(it);
+	m_joinSnapshotStale = true;
+
+	// Tell the client a player has disconnected.
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_PLAYER_DISCONNECTED << clientId;
+	SendToPlayers(writer.GetPacket());
+	packet.Release();
+
+	// Reset the game, whoever's left keeps their side and waits for someone new.
+	Reset();
+	m_gameState.playersReady = CountReadyPlayers();
+}
+
+void Match::AddSpectator(uint32 clientId)
+{
+	if (std::find(m_spectators.begin(), m_spectators.end(), clientId) != m_spectators.end())
+		return;
+
+	m_spectators.push_back(clientId);
+	m_host.SendToClient(clientId, GetJoinSnapshot()); // Don't wait for the tick.
+}
+
+void Match::RemoveSpectator(uint32 clientId)
+{
+	std::erase(m_spectators, clientId);
+}
+
+void Match::EndSpectating()
+{
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_GAME_ENDED;
+	for (uint32 id : m_spectators)
+		m_host.SendToClient(id, writer.GetPacket());
+	packet.Release();
+	m_spectators.clear();
+}
+
+void Match::SetPlayerAway(uint32 clientId)
+{
+	auto it = m_players.find(clientId);
+	if (it == m_players.end() || it->second.away)
+		return;
+
+	// Nobody's steering their paddle, so nothing moves until they're back.
+	PlayerInfo &player = it->second;
+	player.away = true;
+	player.movingUp = false;
+	player.movingDown = false;
+	if (m_awayCount++ == 0)
+		m_pausedAt = ClockNowSeconds();
+	m_joinSnapshotStale = true;
+
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_PLAYER_AWAY << true;
+	SendToOtherPlayers(writer.GetPacket(), clientId);
+	packet.Release();
+}
+
+bool Match::ResumePlayer(uint32 oldClientId, uint32 newClientId)
+{
+	auto it = m_players.find(oldClientId);
+	if (it == m_players.end() || !it->second.away || HasPlayer(newClientId))
+		return false;
+
+	PlayerInfo player = it->second;
+	player.away = false;
+	m_players.erase(it);
+	m_players[newClientId] = player;
+	m_joinSnapshotStale = true;
+
+	if (--m_awayCount == 0)
+	{
+		// Carry on from where it stopped, the ball's state is as of now rather than when they dropped.
+		m_ballStateTime = ClockNowSeconds() - m_simAccumulator;
+		PONG_LOG(MATCH_RESUMED, m_id, ClockNowSeconds() - m_pausedAt);
+	}
+
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_PLAYER_AWAY << false;
+	SendToOtherPlayers(writer.GetPacket(), newClientId);
+	packet.Release();
+
+	// Which side is theirs, then the match as anyone joining would get it.
+	packet.Allocate(1024);
+	writer = BCNet::PacketStreamWriter(packet);
+	writer << PongPackets::PONG_SESSION_RESUME << true << player.rightSide;
+	m_host.SendToClient(newClientId, writer.GetPacket());
+	packet.Release();
+	m_host.SendToClient(newClientId, GetJoinSnapshot());
+	if (m_gameState.gameStarted) // The other player's prediction ran on while it waited, put it back.
+		QueueBallVelocity();
+	return true;
+}
+
+void Match::PacketReceived(uint32 clientId, int packetID, BCNet::PacketStreamReader &reader, const BCNet::Packet packet)
+{
+	m_joinSnapshotStale = true; // Inputs and readiness are in it.
+
+	switch (packetID)
+	{
+		case (int)PongPackets::PONG_PLAYER_MOVING_UP:
+		{
+			// A client has told us that they're moving up, or not.
+			bool moving;
+			reader >> moving;
+			m_players[clientId].movingUp = moving;
+
+			// Tell other clients that they're moving up, or not.
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PLAYER_MOVING_UP << moving;
+			SendToOtherPlayers(writer.GetPacket(), clientId);
+			packet.Release();
+		} break;
+		case (int)PongPackets::PONG_PLAYER_MOVING_DOWN:
+		{
+			// A client has told us that they're moving down, or not.
+			bool moving;
+			reader >> moving;
+			m_players[clientId].movingDown = moving;
+
+			// Tell other clients that they're moving down, or not.
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PLAYER_MOVING_DOWN << moving;
+			SendToOtherPlayers(writer.GetPacket(), clientId);
+			packet.Release();
+		} break;
+		case (int)PongPackets::PONG_ROLLBACK_INPUT:
+		{
+			// Rollback match, the clients simulate it so their inputs just go straight to the other one.
+			SendToOtherPlayers(packet, clientId);
+		} break;
+		case (int)PongPackets::PONG_PLAYER_READY:
+		{
+			// A client has told us that they're ready.
+			bool ready;
+			reader >> ready;
+			m_players[clientId].ready = ready;
+			m_gameState.playersReady = CountReadyPlayers();
+
+			// Tell other clients that they readied up.
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PLAYER_READY << ready;
+			SendToOtherPlayers(writer.GetPacket(), clientId);
+			packet.Release();
+		} break;
+		default:
+			break;
+	}
+}
+
+void Match::Update(double deltaTime)
+{
+	int64_t start = ClockNowNanoseconds();
+
+	if (!IsPaused()) // Waiting on someone to reconnect, everything holds where it is.
+	{
+		m_joinSnapshotStale = true;
+
+		if (m_gameState.gameStarted == false) // Do lobby state.
+			UpdateCountdown(deltaTime);
+
+		StepSimulation(deltaTime);
+	}
+
+	SendQueuedPackets(); // Everything the tick produced goes out together.
+
+	if (!m_spectators.empty()) // Written once for all of them.
+	{
+		PONG_PROFILE_SCOPE(eProfilePhase::NETWORK_SEND);
+		const BCNet::Packet &frame = GetJoinSnapshot();
+		for (uint32 id : m_spectators)
+			m_host.SendToClient(id, frame);
+	}
+
+	m_updateCost += ((double)(ClockNowNanoseconds() - start) - m_updateCost) * updateCostSmoothing;
+}
+
+void Match::Serialize(MatchSnapshot &snapshot)
+{
+	// Everything that carries over from one tick to the next, field by field. Player inputs are only ever the latest
+	// moving flags, nothing is buffered past the tick.
+	std::vector<uint8_t> &buffer = snapshot.state;
+	buffer.clear();
+
+	uint32_t flags = PONG_FIXED_POINT_SIM ? MATCH_SNAPSHOT_FIXED_POINT : 0;
+	BytesPut(buffer, matchSnapshotMagic);
+	BytesPut(buffer, matchSnapshotVersion);
+	BytesPut(buffer, flags);
+
+	BytesPut(buffer, m_id);
+	BytesPut(buffer, (uint8_t)m_rollbackMode);
+	BytesPut(buffer, (int32_t)m_gameState.playersReady);
+	BytesPut(buffer, (uint8_t)m_gameState.gameStarted);
+
+	ReplayPutState(buffer, m_sim);
+	BytesPut(buffer, m_simAccumulator);
+	BytesPut(buffer, m_ballStateTime); // Same clock in every process on the host, so this still lines up with the clients after a handoff.
+	BytesPut(buffer, m_timer);
+	BytesPut(buffer, (uint32_t)m_lastCountDown);
+	BytesPut(buffer, m_updateCost);
+	BytesPut(buffer, m_pausedAt);
+
+	// Which connection plays which side.
+	BytesPut(buffer, (uint32_t)m_players.size());
+	for (auto &[id, info] : m_players)
+	{
+		BytesPut(buffer, id);
+		BytesPut(buffer, (uint8_t)(info.rightSide | (info.movingUp << 1) | (info.movingDown << 2) | (info.ready << 3) | (info.away << 4)));
+	}
+
+	BytesPut(buffer, (uint32_t)m_spectators.size());
+	for (uint32 id : m_spectators)
+		BytesPut(buffer, id);
+
+	// Normally empty between ticks, but anything queued still has to go out.
+	BytesPut(buffer, (uint32_t)m_outgoingPackets.size());
+	for (const BCNet::Packet &packet : m_outgoingPackets)
+	{
+		BytesPut(buffer, (uint32_t)packet.Size);
+		buffer.insert(buffer.end(), (const uint8_t *)packet.Data, (const uint8_t *)packet.Data + packet.Size);
+	}
+
+	snapshot.replay = std::move(m_replay);
+	m_replay = std::make_unique<ReplayWriter>(); // The recording's moved on, nothing left to stop here.
+}
+
+std::unique_ptr<Match> Match::Restore(MatchSnapshot &snapshot, IMatchHost &host)
+{
+	const uint8_t *data = snapshot.state.data();
+	const uint8_t *end = data + snapshot.state.size();
+
+	uint32_t magic = 0, version = 0, flags = 0;
+	uint32_t expectedFlags = PONG_FIXED_POINT_SIM ? MATCH_SNAPSHOT_FIXED_POINT : 0;
+	if (!BytesGet(data, end, magic) || !BytesGet(data, end, version) || !BytesGet(data, end, flags) ||
+		magic != matchSnapshotMagic || version != matchSnapshotVersion || flags != expectedFlags)
+		return nullptr;
+
+	uint32 id = 0;
+	uint8_t rollbackMode = 0, gameStarted = 0;
+	int32_t playersReady = 0;
+	if (!BytesGet(data, end, id) || !BytesGet(data, end, rollbackMode) || !BytesGet(data, end, playersReady) || !BytesGet(data, end, gameStarted))
+		return nullptr;
+
+	std::unique_ptr<Match> match = std::make_unique<Match>(id, host, rollbackMode != 0);
+	match->m_gameState.playersReady = playersReady;
+	match->m_gameState.gameStarted = gameStarted != 0;
+
+	uint32_t lastCountDown = 0, playerCount = 0, packetCount = 0;
+	if (!ReplayGetState(data, end, match->m_sim) || !BytesGet(data, end, match->m_simAccumulator) || !BytesGet(data, end, match->m_ballStateTime) ||
+		!BytesGet(data, end, match->m_timer) || !BytesGet(data, end, lastCountDown) || !BytesGet(data, end, match->m_updateCost) || !BytesGet(data, end, match->m_pausedAt) ||
+		!BytesGet(data, end, playerCount) || playerCount > SIM_SIDES)
+		return nullptr;
+	match->m_lastCountDown = lastCountDown;
+
+	for (uint32_t i = 0; i < playerCount; i++)
+	{
+		uint32 clientId = 0;
+		uint8_t bits = 0;
+		if (!BytesGet(data, end, clientId) || !BytesGet(data, end, bits))
+			return nullptr;
+
+		PlayerInfo &player = match->m_players[clientId];
+		player.rightSide = (bits & 1) != 0;
+		player.movingUp = (bits & 2) != 0;
+		player.movingDown = (bits & 4) != 0;
+		player.ready = (bits & 8) != 0;
+		player.away = (bits & 16) != 0;
+		match->m_awayCount += player.away ? 1 : 0;
+	}
+
+	uint32_t spectatorCount = 0;
+	if (!BytesGet(data, end, spectatorCount) || (size_t)(end - data) / sizeof(uint32) < spectatorCount)
+		return nullptr;
+	match->m_spectators.resize(spectatorCount);
+	for (uint32 &id : match->m_spectators)
+		BytesGet(data, end, id);
+
+	if (!BytesGet(data, end, packetCount))
+		return nullptr;
+	for (uint32_t i = 0; i < packetCount; i++)
+	{
+		uint32_t size = 0;
+		if (!BytesGet(data, end, size) || (size_t)(end - data) < size)
+			return nullptr;
+
+		BCNet::Packet packet;
+		packet.Allocate(size);
+		std::memcpy(packet.Data, data, size);
+		match->m_outgoingPackets.push_back(packet); // Released by the match from here on, even if we bail out below.
+		data += size;
+	}
+
+	if (data != end)
+		return nullptr;
+
+	if (snapshot.replay)
+		match->m_replay = std::move(snapshot.replay);
+	return match;
+}
+
+void Match::ResumeRecording()
+{
+	if (!m_gameState.gameStarted || m_rollbackMode || m_replay->IsRecording())
+		return;
+
+	// Named after the tick it picks up from too, so it doesn't overwrite the part the last process finished.
+	char replayPath[80];
+	snprintf(replayPath, sizeof(replayPath), "%s%016llx_%u.prpl", replayPathPrefix, (unsigned long long)m_sim.rngSeed, m_sim.tick);
+	if (!m_replay->Start(replayPath, m_sim))
+		PONG_LOG(MATCH_RECORDING_FAILED, replayPath);
+}
+
+void Match::Reset()
+{
+	// Setup game defaults.
+	m_gameState.gameStarted = false;
+	m_gameState.playersReady = 0;
+
+	// Every match gets its own seed, the whole match can be replayed from it and the inputs.
+	m_replay->Stop(); // Whatever was being played is over.
+
+	m_sim.playing = false;
+	m_sim.rngSeed = m_host.NewMatchSeed();
+	m_sim.rngCounter = 0;
+	SimResetBall(m_sim);
+
+	m_timer = 0.0f;
+	m_lastCountDown = 4;
+}
+
+// Times SimStep's phases into the profiler. Steps never nest, so one start time per phase per thread is enough.
+static void ProfileSimPhase(eSimPhase phase, bool begin)
+{
+	constexpr eProfilePhase phases[SIM_PHASES_MAX] = { eProfilePhase::COLLISION, eProfilePhase::SCORING, eProfilePhase::PADDLE_UPDATE };
+	thread_local int64_t started[SIM_PHASES_MAX] = { };
+
+	if (begin)
+		started[phase] = ClockNowNanoseconds();
+	else
+		Profiler::Record(phases[phase], ClockNowNanoseconds() - started[phase]);
+}
+
+void Match::StepSimulation(double deltaTime)
+{
+	// Fixed steps so every build, and every client predicting it, gets the same result.
+	m_simAccumulator += deltaTime;
+	double now = ClockNowSeconds();
+
+	int steps = 0;
+	while (m_simAccumulator >= simTickTime && steps < maxSimStepsPerFrame)
+	{
+		SimInputs inputs;
+		for (auto &[id, info] : m_players)
+			inputs.paddles[info.Side()] = (info.movingUp ? SIM_INPUT_UP : 0) | (info.movingDown ? SIM_INPUT_DOWN : 0);
+
+		uint32_t events;
+		{
+			PONG_PROFILE_SCOPE(eProfilePhase::SIM_STEP);
+			m_sim = SimStep(m_sim, inputs, simTickTime, events, Profiler::IsEnabled() ? ProfileSimPhase : nullptr);
+		}
+
+		if (m_replay->IsRecording())
+			m_replay->RecordTick(inputs, m_sim);
+
+		m_simAccumulator -= simTickTime;
+		m_ballStateTime = now - m_simAccumulator; // The step's state is for a little in the past, by whatever's left over.
+		steps++;
+
+		if (events)
+			QueueSimEvents(events);
+	}
+
+	if (steps == maxSimStepsPerFrame) // Hitched, drop the time instead of trying to catch it all up.
+		m_simAccumulator = 0.0;
+}
+
+void Match::QueueSimEvents(uint32_t events)
+{
+	PONG_PROFILE_SCOPE(eProfilePhase::SIM_EVENTS);
+
+	// Goals, tell the clients the score then that the ball has been reset.
+	for (int side = 0; side < SIM_SIDES; side++)
+	{
+		uint32_t goal = side == SIM_LEFT ? SIM_EVENT_GOAL_LEFT : SIM_EVENT_GOAL_RIGHT;
+		if (!(events & goal))
+			continue;
+
+		BCNet::Packet packet;
+		packet.Allocate(1024);
+		BCNet::PacketStreamWriter writer(packet);
+		writer << PongPackets::PONG_PLAYER_SCORE << (side == SIM_RIGHT) << (int)m_sim.paddles[side].score;
+		QueuePacketToPlayers(writer.GetPacket());
+
+		packet.Allocate(1024);
+		writer = BCNet::PacketStreamWriter(packet);
+		writer << PongPackets::PONG_BALL_RESET << m_ballStateTime << m_sim.rngCounter;
+		QueuePacketToPlayers(writer.GetPacket());
+	}
+
+	QueueBallVelocity(); // Update clients on the ball's new velocity.
+
+	if (events & (SIM_EVENT_HIT_LEFT | SIM_EVENT_HIT_RIGHT))
+	{
+		// Tell the clients that a player's paddle has hit the ball.
+		BCNet::Packet packet;
+		packet.Allocate(1024);
+		BCNet::PacketStreamWriter writer(packet);
+		writer << PongPackets::PONG_PLAYER_HIT;
+		QueuePacketToPlayers(writer.GetPacket());
+	}
+
+	if (events & SIM_EVENT_BOUNCE)
+	{
+		// Tell the clients that the ball has bounced.
+		BCNet::Packet packet;
+		packet.Allocate(1024);
+		BCNet::PacketStreamWriter writer(packet);
+		writer << PongPackets::PONG_BALL_BOUNCE;
+		QueuePacketToPlayers(writer.GetPacket());
+	}
+}
+
+void Match::UpdateCountdown(double deltaTime)
+{
+	PONG_PROFILE_SCOPE(eProfilePhase::COUNTDOWN);
+
+	if (m_gameState.playersReady >= 2) // Both players are ready.
+	{
+		// Start count down.
+		m_timer += (float)deltaTime;
+		unsigned int countDown = (unsigned int)(std::ceilf(3.0f - m_timer));
+
+		if (countDown != m_lastCountDown) // So the stuff inside isn't called each frame,
+		{
+			m_lastCountDown = countDown; // only when the countdown has changed.
+
+			// Count down!
+			std::string countDownText = std::to_string(countDown);
+			if (countDown <= 0)
+				countDownText = "GO!";
+
+			m_host.OnCountdown(*this, countDownText);
+
+			// Alert the clients on the count down.
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PLAYER_COUNTDOWN << countDownText;
+			QueuePacketToPlayers(writer.GetPacket());
+
+			PONG_LOG(MATCH_COUNTDOWN, m_id, countDownText); // Every match does this, it can't wait on the console.
+		}
+
+		if (m_timer >= 3.0f) // The count down has ended!
+		{
+			// Start game! In rollback mode the clients run the ball, we only relay their inputs.
+			m_gameState.gameStarted = true;
+			m_sim.playing = !m_rollbackMode;
+
+			if (!m_rollbackMode) // Only record what we actually simulated.
+			{
+				char replayPath[64];
+				snprintf(replayPath, sizeof(replayPath), "%s%016llx.prpl", replayPathPrefix, (unsigned long long)m_sim.rngSeed);
+				if (!m_replay->Start(replayPath, m_sim))
+					PONG_LOG(MATCH_RECORDING_FAILED, replayPath);
+			}
+
+			// Tell the clients that the game has commenced, with the match seed so they can predict the ball's resets.
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_GAME_STARTED << m_sim.rngSeed << m_sim.rngCounter;
+			QueuePacketToPlayers(writer.GetPacket());
+
+			QueueBallVelocity(); // Update the clients on the ball's new velocity.
+
+			if (m_rollbackMode)
+			{
+				packet.Allocate(1024);
+				writer = BCNet::PacketStreamWriter(packet);
+				writer << PongPackets::PONG_ROLLBACK_START << m_sim.rngSeed << defaultInputDelay;
+				QueuePacketToPlayers(writer.GetPacket());
+			}
+		}
+	}
+	else
+	{
+		m_timer = 0.0f; // Reset timer.
+	}
+}
+
+int Match::CountReadyPlayers() const
+{
+	int ready = 0;
+	for (auto &[id, info] : m_players)
+		ready += info.ready ? 1 : 0;
+	return ready;
+}
+
+const BCNet::Packet &Match::GetJoinSnapshot()
+{
+	if (!m_joinSnapshotStale)
+		return m_joinSnapshot;
+
+	// Everything a client would have built up from the packets since the match began, by side so it's the same for everyone.
+	// The countdown's time left, or negative when there isn't one going.
+	float countdown = !m_gameState.gameStarted && m_gameState.playersReady >= 2 ? 3.0f - m_timer : -1.0f;
+
+	BCNet::PacketStreamWriter writer(m_joinSnapshotBuffer);
+	writer << PongPackets::PONG_MATCH_SNAPSHOT << m_gameState.gameStarted << IsPaused() << countdown << m_sim.rngSeed << m_sim.rngCounter
+		<< m_ballStateTime << SimToFloat(m_sim.ball.xPosition) << SimToFloat(m_sim.ball.yPosition) << SimToFloat(m_sim.ball.xVelocity) << SimToFloat(m_sim.ball.yVelocity);
+	for (int side = 0; side < SIM_SIDES; side++)
+	{
+		PlayerInfo player;
+		bool occupied = false;
+		for (auto &[id, info] : m_players)
+		{
+			if (info.Side() == side)
+			{
+				player = info;
+				occupied = true;
+			}
+		}
+		writer << occupied << player.ready << player.movingUp << player.movingDown << player.away
+			<< SimToFloat(m_sim.paddles[side].yPosition) << (int)m_sim.paddles[side].score;
+	}
+
+	m_joinSnapshot = writer.GetPacket();
+	m_joinSnapshotStale = false;
+	return m_joinSnapshot;
+}
+
+void Match::QueueBallVelocity()
+{
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	writer << PongPackets::PONG_BALL_VELOCITY << m_ballStateTime << SimToFloat(m_sim.ball.xPosition) << SimToFloat(m_sim.ball.yPosition) << SimToFloat(m_sim.ball.xVelocity) << SimToFloat(m_sim.ball.yVelocity);
+	QueuePacketToPlayers(writer.GetPacket());
+}
+
+void Match::SendToPlayers(const BCNet::Packet packet)
+{
+	for (auto &[id, info] : m_players)
+		if (!info.away) // Nobody on the other end.
+			m_host.SendToClient(id, packet);
+}
+
+void Match::SendToOtherPlayers(const BCNet::Packet packet, uint32 exclude)
+{
+	for (auto &[id, info] : m_players)
+		if (id != exclude && !info.away)
+			m_host.SendToClient(id, packet);
+}
+
+void Match::QueuePacketToPlayers(const BCNet::Packet packet)
+{
+	m_outgoingPackets.push_back(packet); // Takes ownership, released once it's sent.
+}
+
+void Match::SendQueuedPackets()
+{
+	PONG_PROFILE_SCOPE(eProfilePhase::NETWORK_SEND);
+
+	for (BCNet::Packet &packet : m_outgoingPackets)
+	{
+		SendToPlayers(packet);
+		packet.Release();
+	}
+	m_outgoingPackets.clear();
+}
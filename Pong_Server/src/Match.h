@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include <BCNet/BCNetPacket.h>
+#include <BCNet/BCNetUtil.h>
+
+#include "shared.h"
+#include "Simulation.h"
+#include "Replay.h"
+
+constexpr const char *replayPathPrefix = "./replay_"; // Every match is recorded to this plus its seed, see 'Pong_Tools replay'.
+constexpr uint32_t matchSnapshotVersion = 3;
+
+// Game Objects
+struct GameState
+{
+	int playersReady = 0;
+	bool gameStarted = false;
+};
+
+struct PlayerInfo // Paddle position and score live in the simulation, see Side().
+{
+	bool rightSide = false;
+
+	bool movingUp = false;
+	bool movingDown = false;
+
+	bool ready = false;
+	bool away = false; // Dropped, their slot's held for them to resume.
+
+	int Side() const { return rightSide ? SIM_RIGHT : SIM_LEFT; }
+};
+
+class Match;
+
+// A match's whole state between two ticks, so it can carry on somewhere else from exactly where it left off.
+struct MatchSnapshot
+{
+	std::vector<uint8_t> state; // See Match::Serialize(), no pointers so it can leave the process.
+	std::unique_ptr<ReplayWriter> replay; // The recording still in progress, only follows the match within a process.
+};
+
+// What a match needs from the server it runs in, so it doesn't care how its players are connected.
+class IMatchHost
+{
+public:
+	virtual ~IMatchHost() = default;
+
+	virtual void SendToClient(uint32 id, const BCNet::Packet packet) = 0; // Doesn't take ownership.
+	virtual uint64_t NewMatchSeed() = 0;
+	virtual void OnCountdown(const Match &match, const std::string &text) = 0;
+};
+
+// One game of pong between two players, the server runs as many as it has players for.
+class Match
+{
+public:
+	Match(uint32 id, IMatchHost &host, bool rollbackMode);
+	~Match();
+
+	Match(const Match &match) = delete;
+	Match &operator=(const Match &match) = delete;
+
+	uint32 GetId() const { return m_id; }
+
+	bool AddPlayer(uint32 clientId); // Takes whichever side is free, false if both are taken.
+	void RemovePlayer(uint32 clientId); // Back to the lobby, the one left waits for someone new.
+	void SetPlayerAway(uint32 clientId); // Dropped, the match pauses until they're resumed or removed.
+	bool ResumePlayer(uint32 oldClientId, uint32 newClientId); // Back on a new connection, which is sent a snapshot.
+	bool IsPaused() const { return m_awayCount > 0; }
+	bool HasPlayer(uint32 clientId) const { return m_players.count(clientId) != 0; }
+	int GetPlayerCount() const { return (int)m_players.size(); }
+	bool IsFull() const { return m_players.size() >= SIM_SIDES; }
+
+	void AddSpectator(uint32 clientId); // Sent the match every tick from now on.
+	void RemoveSpectator(uint32 clientId);
+	void EndSpectating(); // Closing, tells them it's over.
+	const std::vector<uint32> &GetSpectators() const { return m_spectators; }
+
+	void PacketReceived(uint32 clientId, int packetID, BCNet::PacketStreamReader &reader, const BCNet::Packet packet);
+	void Update(double deltaTime); // Countdown, simulation, then everything it produced goes out, and the match to spectators.
+
+	// Between ticks only. The replay goes with the snapshot, this match shouldn't be updated again after.
+	void Serialize(MatchSnapshot &snapshot);
+	// Null if the state is damaged or from a build with a different simulation.
+	static std::unique_ptr<Match> Restore(MatchSnapshot &snapshot, IMatchHost &host);
+	void ResumeRecording(); // Restored without its replay, i.e. from another process, so it starts a new one from here.
+
+	const SimState &GetSim() const { return m_sim; }
+	const GameState &GetGameState() const { return m_gameState; }
+	const std::unordered_map<uint32, PlayerInfo> &GetPlayers() const { return m_players; }
+	double GetUpdateCost() const { return m_updateCost; } // Nanoseconds per Update(), smoothed.
+
+private:
+	void Reset();
+
+	void StepSimulation(double deltaTime);
+	void QueueSimEvents(uint32_t events);
+	void UpdateCountdown(double deltaTime);
+	int CountReadyPlayers() const; // Counted rather than kept, so players coming and going can't throw it off.
+
+	const BCNet::Packet &GetJoinSnapshot(); // Encoded at most once per tick, however many join.
+	void QueueBallVelocity();
+
+	void SendToPlayers(const BCNet::Packet packet);
+	void SendToOtherPlayers(const BCNet::Packet packet, uint32 exclude);
+	void QueuePacketToPlayers(const BCNet::Packet packet);
+	void SendQueuedPackets();
+
+private:
+	uint32 m_id;
+	IMatchHost &m_host;
+	bool m_rollbackMode; // Clients simulate the match themselves.
+
+	GameState m_gameState;
+
+	std::unordered_map<uint32, PlayerInfo> m_players;
+	std::vector<uint32> m_spectators;
+	SimState m_sim; // Ball, paddles and scores.
+	std::unique_ptr<ReplayWriter> m_replay = std::make_unique<ReplayWriter>(); // Never null, swapped out when the match moves.
+	double m_simAccumulator = 0.0; // Time not yet stepped.
+	double m_ballStateTime = 0.0; // Server clock time the ball's position is valid for, sent along with it so clients can catch up.
+
+	float m_timer = 0.0f;
+	unsigned int m_lastCountDown = 4;
+
+	std::vector<BCNet::Packet> m_outgoingPackets; // Queued by the tick, see SendQueuedPackets().
+
+	double m_updateCost = 0.0; // What the shards are balanced on.
+
+	int m_awayCount = 0;
+	double m_pausedAt = 0.0; // ClockNowSeconds() when the first of them dropped.
+
+	BCNet::Packet m_joinSnapshotBuffer; // Allocated once, rewritten in place.
+	BCNet::Packet m_joinSnapshot; // The written part of it.
+	bool m_joinSnapshotStale = true; // Anything it covers has changed since it was written.
+
+};
@@ -1,6 +1,18 @@
 #include <iostream>
 #include <string>
+#include <vector>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 
 #include <BCNet/IBCNetServer.h>
 #include <BCNet/BCNetPacket.h>
@@ -10,95 +22,125 @@
 #include <raymath.h>
 
 #include "shared.h"
+#include "Profiler.h"
+#include "NetStats.h"
+#include "Simulation.h"
+#include "SimConformance.h"
+#include "Matchmaker.h"
+#include "Match.h"
+#include "WorkerLink.h"
+#include "ShmLink.h"
+#include "Handoff.h"
+#include "ByteIO.h"
+#include "BotBatch.h"
+#include "Logger.h"
 
 #include "TextObject.h"
 
 static BCNet::IBCNetServer *g_server;
 
-// Game Constants.
-constexpr unsigned int defaultClientWidth = 800; // Basis resolution.
-constexpr unsigned int defaultClientHeight = 600;
-
-constexpr float paddleWidth = (12.0f / defaultClientWidth); // Remap 0-1 for resolution independency
-constexpr float paddleHeight = (96.0f / defaultClientHeight);
-constexpr float paddleXOffset = (64.0f / defaultClientWidth);
-constexpr float paddleVSpeed = (256.0f / defaultClientHeight);
-
-constexpr float ballWidth = (10.0f / defaultClientWidth);
-constexpr float ballHeight = (10.0f / defaultClientHeight);
-constexpr float ballHSpeed = (256.0f / defaultClientWidth);
-constexpr float ballVSpeed = (256.0f / defaultClientHeight);
-
+// Game Constants, the physics ones are in Simulation.h.
 constexpr unsigned int clientWidth = defaultClientWidth; // Actual resolution.
 constexpr unsigned int clientHeight = defaultClientHeight;
 
-// Game Objects
-struct GameState
+constexpr const char *profileDumpPath = "./server_profile.txt"; // Written on F1 and on shutdown.
+constexpr const char *traceOutputPath = "./pong_server_trace.json"; // F2 starts and stops recording.
+constexpr int maxClients = 256; // Across every match and the queue.
+constexpr int defaultShardCount = 4;
+constexpr double matchmakingRttWait = 1.0; // Seconds to wait for a first RTT sample before queueing without one.
+constexpr double migrationImbalance = 0.25; // Shards this far apart, as a fraction of the busiest one's cost, get evened out.
+constexpr double migrationMinimumGap = 20000.0; // Nanoseconds per tick, below this it isn't worth moving anything.
+constexpr double migrationCooldown = 0.5; // Seconds between migrations, so the costs settle before the next one.
+constexpr uint32_t handoffStateMagic = 0x56525350; // "PSRV", the server's half of a handoff, see HandOff().
+constexpr uint32_t handoffStateVersion = 2;
+constexpr double defaultReconnectGrace = 10.0; // Seconds a dropped player's slot is held for them to resume, see ClientDisconnected().
+constexpr uint32 botClientIdBase = 0x80000000; // Server bots' client IDs count up from here, clear of any a connection's given.
+
+static bool IsBotId(uint32 id) { return id >= botClientIdBase; }
+
+// A group of matches stepped together on its own thread. Players are placed in whichever has the fewest matches,
+// after that matches are moved between shards to keep their measured costs even, see BalanceShards().
+struct MatchShard
 {
-	int playersReady = 0;
-	bool gameStarted = false;
+	std::vector<std::unique_ptr<Match>> matches;
+	double cost = 0.0; // Nanoseconds per tick, its matches' costs added up as of the last step.
 };
 
-struct BallInfo
+// Zero-downtime upgrades behind the gateway, see Handoff.h.
+enum eHandoffState
 {
-	float xPosition = 0.5f;
-	float yPosition = 0.5f;
-	float xVelocity = -1.0f;
-	float yVelocity = -1.0f;
-	float currentHSpeed = ballHSpeed;
-	float currentVSpeed = ballVSpeed;
+	HANDOFF_IDLE = 0, // Listening for a replacement, if --handoff was given.
+	HANDOFF_DRAINING, // Replacement's connected. No new matches, waiting on the link thread to stop.
+	HANDOFF_DONE, // It has everything, or might have, we're exiting.
 };
 
-struct PlayerInfo
+struct MigrationStats
 {
-	float yPosition = 0.5f;
-	bool rightSide = false;
-
-	bool movingUp = false;
-	bool movingDown = false;
-
-	unsigned int score = 0;
-
-	bool ready = false;
+	uint64_t migrations = 0;
+	uint64_t failed = 0; // Snapshots that didn't restore, the match stayed where it was.
+	double firstMigrationTime = 0.0;
+	LatencyHistogram pauses; // Nanoseconds from serializing a match to it being ready on its new shard.
 };
 
-// Utility functions.
-float CalculateBallAngle()
+// A player who dropped mid match, kept under the token they were given so they can take their slot back.
+struct HeldPlayer
 {
-	// Recycled from old code.
-	float angle = (float)GetRandomValue(0, (int)(360 * DEG2RAD));
-	if (angle == 0 || angle == (90 * DEG2RAD) || angle == (180 * DEG2RAD) || angle == (270 * DEG2RAD) || angle == (360 * DEG2RAD)) // Recalculates the angle if goes straight along an axis.
-		return CalculateBallAngle(); // TODO: Uh oh, recursive function.
-	return angle;
-}
+	uint32 clientId = 0; // Their old connection's, still the one in the match.
+	uint32 matchId = 0; // Not the match itself, migrations and handoffs replace it.
+	double heldSince = 0.0;
+};
 
-bool AABB(BallInfo &ball, PlayerInfo &paddle) // Ball-Paddle collision detection.
+struct ReconnectStats
 {
-	float paddleXPos = paddleXOffset;
-	if (paddle.rightSide)
-		paddleXPos = 1.0f - paddleXOffset;
+	uint64_t held = 0;
+	uint64_t resumed = 0;
+	uint64_t expired = 0; // Didn't make it back in time, removed like any other disconnect.
+	uint64_t refused = 0; // Token didn't match a held slot.
+	LatencyHistogram timeAway; // Nanoseconds from dropping to being back in their match.
+};
 
-	bool collX = ball.xPosition - (ballWidth/2.0f) <= paddleXPos + (paddleWidth/2.0f) && // Ball intersects paddle on X axis.
-		ball.xPosition + (ballWidth/2.0f) >= paddleXPos - (paddleWidth/2.0f);
-	bool collY = ball.yPosition - (ballHeight/2.0f) <= paddle.yPosition + (paddleHeight/2.0f) && // Ball intersects paddle on Y axis.
-		ball.yPosition + (ballHeight/2.0f) >= paddle.yPosition - (paddleHeight/2.0f);
+// A bot playing in a match, its inputs come from m_bots. See UpdateBots().
+struct ServerBot
+{
+	bool load = false; // One of --bot-matches', plays on with nobody else in its match.
+};
 
-	return collX && collY;
-}
+struct BotStats
+{
+	uint64_t added = 0;
+	LatencyHistogram think; // Nanoseconds per tick for every bot, observing, deciding and sending their inputs.
+};
 
 // --------------------- Main Class
-class Game
+class Game : public IMatchHost
 {
 public:
-	void Run()
+	bool Run() // False if it couldn't start.
 	{
 		InitWindow(clientWidth, clientHeight, "Pong Server");
 		SetTargetFPS(60);
 		SetExitKey(NULL);
 
-		Init();
+		m_shards.resize(m_shardCount);
+		StartShardThreads();
 
 		double lastTime = 1.0 / 60.0; // Delta time.
+		if (IsWorker())
+		{
+			// Here rather than before the window opens, so a handoff isn't held up by it.
+			if (!StartWorkerLink())
+			{
+				Shutdown();
+				CloseWindow();
+				return false;
+			}
+			if (m_resumedFrom > 0.0) // Taken over, the first tick steps the time since the old server's last one.
+				lastTime = GetTime() - (ClockNowSeconds() - m_resumedFrom);
+		}
+		if (m_resumedFrom == 0.0) // Taken over, any bot matches came with the rest.
+			StartBotMatches();
+
+		PONG_TRACE_THREAD_NAME("simulation");
 
 		// Game loop.
 		m_gameRunning = true;
@@ -109,369 +151,1370 @@ public:
 			lastTime = currentTime;
 
 			Update(deltaTime);
+			PingClients();
+			UpdateHandoff();
+
+			if (IsKeyPressed(KEY_F1)) // Dump tick timings and link stats on demand.
+			{
+				if (DumpStats())
+					PONG_LOG(SERVER_STATS_WRITTEN, profileDumpPath);
+			}
+			if (IsKeyPressed(KEY_F3)) // Toggle the link stats overlay.
+				m_showNetStats = !m_showNetStats;
+			if (IsKeyPressed(KEY_F2)) // Start or stop recording a timeline.
+			{
+				if (Tracer::IsRecording())
+					Tracer::Stop(traceOutputPath);
+				else
+					Tracer::Start();
+			}
+			if (IsKeyPressed(KEY_TAB)) // Watch the next match.
+				WatchNextMatch();
 
 			BeginDrawing();
-			Draw();
-			EndDrawing();
+			{
+				PONG_TRACE_SCOPE("Draw");
+				Draw();
+			}
+			{
+				PONG_TRACE_SCOPE("EndDrawing");
+				EndDrawing();
+			}
 
-			m_gameRunning = !WindowShouldClose();
+			m_gameRunning = !WindowShouldClose() && m_handoffState != HANDOFF_DONE;
 		}
 
 		Shutdown();
 
 		CloseWindow();
+		return true;
 	}
 
 public:
 	void OnDisconnected(const BCNet::ClientInfo &clientInfo)
 	{
-		// Get rid of disconnected player.
-		m_players.erase(clientInfo.id);
+		PONG_TRACE_THREAD_NAME("network");
+		ClientDisconnected(clientInfo.id);
+	}
+
+	void OnConnected(const BCNet::ClientInfo &clientInfo)
+	{
+		PONG_TRACE_THREAD_NAME("network");
+		ClientConnected(clientInfo.id);
+	}
+
+	void PacketReceived(const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet)
+	{
+		PONG_TRACE_THREAD_NAME("network");
+		ClientPacketReceived(clientInfo.id, packet);
+	}
+
+	// Behind Pong_Gateway clients arrive over the worker link instead of BCNet, see LinkLoop().
+	bool StartWorkerLink()
+	{
+		bool opened = !m_handoffPath.empty() && TakeOver(); // A server's already running on the port, carry on its matches.
+		if (!opened)
+			opened = m_useShmLink ? m_shmLink.Open(m_workerPort, SHM_LINK_WORKER) : m_workerLink.Open(m_workerPort);
+		if (!opened)
+		{
+			PONG_LOG(SERVER_WORKER_PORT_FAILED, m_workerPort);
+			return false;
+		}
+
+		if (!m_handoffPath.empty() && !m_handoffListener.Listen(m_handoffPath))
+			PONG_LOG(SERVER_HANDOFF_LISTEN_FAILED, m_handoffPath);
+
+		StartLinkThread();
+		return true;
+	}
+
+	void StopWorkerLink()
+	{
+		m_workerLinkRunning = false;
+		if (m_workerLinkThread.joinable())
+			m_workerLinkThread.join();
+		m_workerLink.Close();
+		m_shmLink.Close();
+		m_handoffListener.Close();
+	}
+
+	void StartLinkThread()
+	{
+		m_workerLinkStopped = false;
+		m_workerLinkRunning = true;
+		m_workerLinkThread = std::thread([this]() { LinkLoop(); });
+	}
+
+	// IMatchHost. Every send goes through SendToClient so each connection's bandwidth is counted.
+	void SendToClient(uint32 id, const BCNet::Packet packet) override
+	{
+		if (IsBotId(id)) // They read the match directly.
+			return;
+
+		SendRaw(id, packet);
+
+		std::shared_ptr<ConnectionStats> stats = GetConnectionStats(id);
+		if (stats)
+			stats->OnBytesSent(packet.Size);
+	}
+
+	uint64_t NewMatchSeed() override
+	{
+		std::lock_guard<std::mutex> lock(m_seedMutex); // Shards reset their matches in parallel.
+		return ((uint64_t)m_seedSource() << 32) | m_seedSource();
+	}
+
+	void OnCountdown(const Match &match, const std::string &text) override
+	{
+		if (match.GetId() != m_watchedMatchId) // Only the match on screen gets it drawn.
+			return;
 
-		// Tell the client a player has disconnected.
+		int textWidth = MeasureText(text.c_str(), 48);
+		float textXPosition = (clientWidth / 2.0f) - (textWidth / 2.0f);
+		float textYPosition = (clientHeight / 2.0f) - 24.0f;
+		m_textPool.Init(text, textXPosition, textYPosition, 1.0f, 48, BLUE);
+	}
+
+private:
+	void ClientDisconnected(uint32 id)
+	{
+		PONG_PROFILE_SCOPE(eProfilePhase::EVENT_DRAIN);
+
+		{
+			std::unique_lock<std::shared_mutex> lock(m_statsMutex);
+			m_connectionStats.erase(id);
+		}
+
+		// Out of the queue, or out of their match. A match with nobody left is closed on the next tick.
+		std::lock_guard<std::mutex> lock(m_matchMutex);
+		m_pendingClients.erase(id);
+		m_matchmaker.Remove(id);
+
+		uint64_t token = 0;
+		auto tokenIt = m_clientTokens.find(id);
+		if (tokenIt != m_clientTokens.end())
+		{
+			token = tokenIt->second;
+			m_clientTokens.erase(tokenIt);
+		}
+
+		auto spectator = m_spectators.find(id);
+		if (spectator != m_spectators.end())
+		{
+			Match *watched = FindMatch(spectator->second);
+			if (watched)
+				watched->RemoveSpectator(id);
+			m_spectators.erase(spectator);
+			return;
+		}
+
+		auto it = m_clientMatches.find(id);
+		if (it == m_clientMatches.end())
+			return;
+
+		// Dropped rather than left, as far as we can tell. Their match waits for them to come back with the token.
+		if (token != 0 && m_reconnectGrace > 0.0 && !m_rollbackMode)
+		{
+			it->second->SetPlayerAway(id);
+			m_heldPlayers[token] = { id, it->second->GetId(), ClockNowSeconds() };
+			m_reconnectStats.held++;
+
+			// They could come back through the gateway onto another worker, it sends them here.
+			if (IsWorker())
+			{
+				WorkerSessionHeld held;
+				held.token = token;
+				held.grace = m_reconnectGrace;
+				SendToGateway(WORKER_SESSION_HELD, id, &held, sizeof(held));
+			}
+			return;
+		}
+
+		it->second->RemovePlayer(id);
+		m_clientMatches.erase(it);
+	}
+
+	void ClientConnected(uint32 id, uint64_t resumeToken = 0)
+	{
+		PONG_PROFILE_SCOPE(eProfilePhase::EVENT_DRAIN);
+
+		AddConnectionStats(id);
+
+		// They're queued once we've had a chance to measure their RTT, see UpdateMatchmaking().
+		uint64_t token = NewSessionToken();
+		{
+			std::lock_guard<std::mutex> lock(m_matchMutex);
+			m_pendingClients[id] = ClockNowSeconds();
+			m_clientTokens[id] = token;
+		}
+
+		// Sent here by the gateway with the token they asked for their slot with on another worker. Answered before their
+		// new token, so they don't ask again with the one that worker gave them.
+		if (resumeToken != 0)
+			ResumeSession(id, resumeToken, false);
+
+		// Before anything else, so a client that's reconnecting can answer with its old token before it's queued.
 		BCNet::Packet packet;
 		packet.Allocate(1024);
 		BCNet::PacketStreamWriter writer(packet);
-		writer << PongPackets::PONG_PLAYER_DISCONNECTED << clientInfo.id;
-		g_server->SendPacketToAllClients(writer.GetPacket(), clientInfo.id);
+		writer << PongPackets::PONG_SESSION_TOKEN << token << (m_rollbackMode ? 0.0 : m_reconnectGrace);
+		SendToClient(id, writer.GetPacket());
 		packet.Release();
+	}
+
+	void ResumeSession(uint32 id, uint64_t token, bool forward = true)
+	{
+		bool resumed = false;
+		{
+			std::lock_guard<std::mutex> lock(m_matchMutex);
+			auto held = m_heldPlayers.find(token);
+			if (held == m_heldPlayers.end() && forward && IsWorker())
+			{
+				// Might be held on another worker, the gateway moves them there or sends back WORKER_SESSION_REFUSED.
+				SendToGateway(WORKER_SESSION_FORWARD, id, &token, sizeof(token));
+				return;
+			}
 
-		// Reset the game.
-		Init();
+			Match *match = held != m_heldPlayers.end() && m_clientMatches.count(id) == 0 ? FindMatch(held->second.matchId) : nullptr;
+			if (match && match->ResumePlayer(held->second.clientId, id))
+			{
+				// Whatever this connection was waiting for, it has its old match back instead.
+				m_pendingClients.erase(id);
+				m_matchmaker.Remove(id);
+				m_clientMatches.erase(held->second.clientId);
+				m_clientMatches[id] = match;
+
+				m_reconnectStats.resumed++;
+				m_reconnectStats.timeAway.Record((int64_t)((ClockNowSeconds() - held->second.heldSince) * 1e9));
+				m_heldPlayers.erase(held);
+				resumed = true;
+			}
+		}
+
+		if (!resumed)
+			RefuseSession(id);
 	}
 
-	void OnConnected(const BCNet::ClientInfo &clientInfo)
+	void RefuseSession(uint32 id)
 	{
-		// Setup player with defaults.
-		m_players[clientInfo.id].movingUp = false;
-		m_players[clientInfo.id].movingDown = false;
-		m_players[clientInfo.id].yPosition = 0.5f;
-		m_players[clientInfo.id].score = 0;
-		m_players[clientInfo.id].rightSide = g_server->GetConnectedCount() > 1;
-		m_players[clientInfo.id].ready = false;
+		{
+			std::lock_guard<std::mutex> lock(m_matchMutex);
+			m_reconnectStats.refused++;
+		}
 
-		// Tell any connected clients that another player has connected.
+		// Carries on as the new player it connected as.
 		BCNet::Packet packet;
 		packet.Allocate(1024);
 		BCNet::PacketStreamWriter writer(packet);
-		writer << PongPackets::PONG_PLAYER_CONNECTED << clientInfo.id << m_players[clientInfo.id].rightSide;
-		g_server->SendPacketToAllClients(writer.GetPacket());
+		writer << PongPackets::PONG_SESSION_RESUME << false;
+		SendToClient(id, writer.GetPacket());
 		packet.Release();
 	}
 
-	void PacketReceived(const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet)
+	void Spectate(uint32 id, uint32 matchId)
 	{
+		Match *match = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_matchMutex);
+			if (m_clientMatches.count(id) != 0) // Playing already.
+				return;
+
+			// Watching instead of waiting for a match.
+			m_pendingClients.erase(id);
+			m_matchmaker.Remove(id);
+
+			auto previous = m_spectators.find(id);
+			if (previous != m_spectators.end())
+			{
+				Match *watched = FindMatch(previous->second);
+				if (watched)
+					watched->RemoveSpectator(id);
+				m_spectators.erase(previous);
+			}
+
+			match = FindMatch(matchId != 0 ? matchId : m_watchedMatchId);
+			if (match)
+			{
+				match->AddSpectator(id);
+				m_spectators[id] = match->GetId();
+				return;
+			}
+		}
+
+		// Nothing to watch, they can ask again.
+		BCNet::Packet packet;
+		packet.Allocate(1024);
+		BCNet::PacketStreamWriter writer(packet);
+		writer << PongPackets::PONG_GAME_ENDED;
+		SendToClient(id, writer.GetPacket());
+		packet.Release();
+	}
+
+	void ExpireHeldPlayers()
+	{
+		double now = ClockNowSeconds();
+		for (auto it = m_heldPlayers.begin(); it != m_heldPlayers.end();)
+		{
+			if (now - it->second.heldSince < m_reconnectGrace)
+			{
+				++it;
+				continue;
+			}
+
+			// Gone for good, same as if the grace window was off.
+			Match *match = FindMatch(it->second.matchId);
+			if (match)
+				match->RemovePlayer(it->second.clientId);
+			m_clientMatches.erase(it->second.clientId);
+			m_reconnectStats.expired++;
+			it = m_heldPlayers.erase(it);
+		}
+	}
+
+	uint64_t NewSessionToken()
+	{
+		std::lock_guard<std::mutex> lock(m_seedMutex);
+		uint64_t token = 0;
+		while (token == 0) // Zero is no token.
+			token = ((uint64_t)m_seedSource() << 32) | m_seedSource();
+		return token;
+	}
+
+	void ClientPacketReceived(uint32 id, const BCNet::Packet packet)
+	{
+		PONG_PROFILE_SCOPE(eProfilePhase::EVENT_DRAIN);
+
+		std::shared_ptr<ConnectionStats> stats = GetConnectionStats(id);
+		if (stats)
+			stats->OnBytesReceived(packet.Size);
+
 		BCNet::PacketStreamReader reader(packet);
 		int packetID;
 		reader >> packetID;
 
 		switch (packetID)
 		{
-			case (int)PongPackets::PONG_PLAYER_REQUEST_PEERS:
-			{
-				// A client has requested info from any connected peers.
-				for (auto [id, info] : m_players)
-				{
-					if (id == clientInfo.id) // Makes sure not to give them their own info.
-						continue;
-					BCNet::Packet packet;
-					packet.Allocate(1024);
-					BCNet::PacketStreamWriter writer(packet);
-					writer << PongPackets::PONG_PLAYER_REQUEST_PEERS
-						<< info.rightSide << info.score << info.ready << info.yPosition
-						<< info.movingDown << info.movingUp;
-					g_server->SendPacketToClient(clientInfo.id, writer.GetPacket());
-					packet.Release();
-				}
-			} break;
-			case (int)PongPackets::PONG_PLAYER_MOVING_UP:
+			case (int)PongPackets::PONG_PING:
 			{
-				// A client has told us that they're moving up, or not.
-				bool moving;
-				reader >> moving;
-				m_players[clientInfo.id].movingUp = moving;
+				// Answer straight away so the client's RTT doesn't include our tick.
+				uint32 sequence;
+				double sentTime;
+				reader >> sequence >> sentTime;
 
-				// Tell other clients that they're moving up, or not.
 				BCNet::Packet packet;
 				packet.Allocate(1024);
 				BCNet::PacketStreamWriter writer(packet);
-				writer << PongPackets::PONG_PLAYER_MOVING_UP << moving;
-				g_server->SendPacketToAllClients(writer.GetPacket(), clientInfo.id);
+				writer << PongPackets::PONG_PONG << sequence << sentTime << ClockNowSeconds();
+				SendToClient(id, writer.GetPacket());
 				packet.Release();
 			} break;
-			case (int)PongPackets::PONG_PLAYER_MOVING_DOWN:
+			case (int)PongPackets::PONG_PONG:
 			{
-				// A client has told us that they're moving down, or not.
-				bool moving;
-				reader >> moving;
-				m_players[clientInfo.id].movingDown = moving;
+				// Answer to one of our pings.
+				uint32 sequence;
+				double sentTime;
+				reader >> sequence >> sentTime;
 
-				// Tell other clients that they're moving down, or not.
-				BCNet::Packet packet;
-				packet.Allocate(1024);
-				BCNet::PacketStreamWriter writer(packet);
-				writer << PongPackets::PONG_PLAYER_MOVING_DOWN << moving;
-				g_server->SendPacketToAllClients(writer.GetPacket(), clientInfo.id);
-				packet.Release();
+				if (stats)
+					stats->OnPongReceived(sequence, sentTime, ClockNowSeconds());
 			} break;
-			case (int)PongPackets::PONG_PLAYER_READY:
+			case (int)PongPackets::PONG_SESSION_RESUME:
 			{
-				// A client has told us that they're ready.
-				bool ready;
-				reader >> ready;
-				m_players[clientInfo.id].ready = ready;
-				m_gameState.playersReady += ready ? 1 : -1;
-
-				// Tell other clients that they readied up.
-				BCNet::Packet packet;
-				packet.Allocate(1024);
-				BCNet::PacketStreamWriter writer(packet);
-				writer << PongPackets::PONG_PLAYER_READY << ready;
-				g_server->SendPacketToAllClients(writer.GetPacket(), clientInfo.id);
-				packet.Release();
+				// Reconnected, wants the slot it dropped out of back.
+				uint64_t token;
+				reader >> token;
+				ResumeSession(id, token);
+			} break;
+			case (int)PongPackets::PONG_SPECTATE:
+			{
+				// A spectator, or a Pong_Relay streaming a match on to its own.
+				uint32 matchId;
+				reader >> matchId;
+				Spectate(id, matchId);
 			} break;
 			default:
-				break;
+			{
+				// Everything else is for their match, if they're in one yet.
+				std::lock_guard<std::mutex> lock(m_matchMutex);
+				auto it = m_clientMatches.find(id);
+				if (it != m_clientMatches.end())
+					it->second->PacketReceived(id, packetID, reader, packet);
+			} break;
 		}
 	}
 
-private:
-	void Init()
+	void LinkLoop()
 	{
-		// Setup game defaults.
-		m_gameState.gameStarted = false;
-		m_gameState.playersReady = 0;
+		PONG_TRACE_THREAD_NAME("gateway link");
+
+		WorkerMessage message;
+		while (m_workerLinkRunning)
+		{
+			if (!(m_useShmLink ? m_shmLink.Receive(message, 0.1) : m_workerLink.Receive(message, 0.1)))
+				continue;
 
-		m_ball.xPosition = 0.5f;
-		m_ball.yPosition = 0.5f;
-		m_ball.xVelocity = -1.0f;
-		m_ball.yVelocity = -1.0f;
-		m_ball.currentHSpeed = ballHSpeed;
-		m_ball.currentVSpeed = ballVSpeed;
+			m_gatewayPort = message.fromPort; // Replies go back to whoever's sending, there's only the one gateway.
+
+			switch (message.type)
+			{
+				case WORKER_CLIENT_CONNECTED:
+					ClientConnected(message.clientId);
+					break;
+				case WORKER_CLIENT_RESUMING:
+				{
+					uint64_t token = 0;
+					if (message.size >= sizeof(token))
+						std::memcpy(&token, message.payload, sizeof(token));
+					ClientConnected(message.clientId, token);
+				} break;
+				case WORKER_SESSION_REFUSED:
+					RefuseSession(message.clientId);
+					break;
+				case WORKER_CLIENT_DISCONNECTED:
+					ClientDisconnected(message.clientId);
+					break;
+				case WORKER_CLIENT_PACKET:
+				{
+					BCNet::Packet packet;
+					packet.Allocate(message.size);
+					std::memcpy(packet.Data, message.payload, message.size);
+					ClientPacketReceived(message.clientId, packet);
+					packet.Release();
+				} break;
+				case WORKER_HEALTH_PING:
+				{
+					if (message.size < sizeof(WorkerHealthPing))
+						break;
 
-		float angle = CalculateBallAngle();
-		m_ball.xVelocity = ballHSpeed * cosf(angle);
-		m_ball.yVelocity = ballVSpeed * sinf(angle);
+					WorkerHealthPing ping;
+					std::memcpy(&ping, message.payload, sizeof(ping));
 
-		m_timer = 0.0f;
+					WorkerHealthPong pong;
+					pong.sequence = ping.sequence;
+					pong.sentTime = ping.sentTime;
+					{
+						std::shared_lock<std::shared_mutex> lock(m_statsMutex);
+						pong.players = (uint32_t)m_connectionStats.size();
+					}
+					{
+						std::lock_guard<std::mutex> lock(m_matchMutex);
+						for (MatchShard &shard : m_shards)
+							pong.matches += (uint32_t)shard.matches.size();
+					}
+					SendToGateway(WORKER_HEALTH_PONG, 0, &pong, sizeof(pong));
+				} break;
+				default:
+					break;
+			}
+		}
+
+		if (m_useShmLink)
+			m_shmLink.ReleaseReceived(); // Our last message is handled, whoever reads the ring next starts after it.
+		m_workerLinkStopped = true; // Anything after this stays in the socket or ring for whoever reads it next.
 	}
 
+	void SendRaw(uint32 id, const BCNet::Packet packet)
+	{
+		if (IsWorker())
+			SendToGateway(WORKER_CLIENT_PACKET, id, packet.Data, packet.Size);
+		else
+			g_server->SendPacketToClient(id, packet);
+	}
+
+	void SendToGateway(uint8_t type, uint32 clientId, const void *payload, size_t size)
+	{
+		if (m_useShmLink)
+			m_shmLink.Send(type, clientId, payload, size);
+		else
+			m_workerLink.Send(m_gatewayPort, type, clientId, payload, size);
+	}
+
+private:
 	void Shutdown()
 	{
-		std::cout << "Shutting down" << std::endl;
+		PONG_LOG(SERVER_SHUTTING_DOWN);
+
+		StopShardThreads();
+
+		{
+			std::lock_guard<std::mutex> lock(m_matchMutex);
+			m_shards.clear(); // Finishes off any replays still being written.
+			m_clientMatches.clear();
+		}
+
+		if (Profiler::IsEnabled())
+			DumpStats();
+		if (Tracer::IsRecording())
+			Tracer::Stop(traceOutputPath);
 	}
 
 	void Update(double deltaTime = 0.0f)
 	{
+		PONG_PROFILE_SCOPE(eProfilePhase::TICK);
+
 		//std::cout << "delta: " << deltaTime << std::endl;
 
 		m_textPool.Animate(deltaTime); // Update text object pool.
 
-		// Do gameplay state.
-		if (m_gameState.gameStarted == true)
+		std::lock_guard<std::mutex> lock(m_matchMutex);
+
+		ExpireHeldPlayers();
+		UpdateMatchmaking();
+		UpdateBots();
+
+		StepShards(deltaTime);
+
+		if (m_migrationEnabled)
+			BalanceShards();
+	}
+
+	void StartShardThreads()
+	{
+		// The first shard is stepped on the tick thread itself, it would only be waiting otherwise.
+		m_shardsRunning = true;
+		for (size_t i = 1; i < m_shards.size(); i++)
+			m_shardThreads.emplace_back([this, i]() { ShardLoop(i); });
+	}
+
+	void StopShardThreads()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_stepMutex);
+			m_shardsRunning = false;
+		}
+		m_stepStart.notify_all();
+		for (std::thread &thread : m_shardThreads)
+			thread.join();
+		m_shardThreads.clear();
+	}
+
+	void ShardLoop(size_t index)
+	{
+		PONG_TRACE_THREAD_NAME("shard"); // Kept as a pointer, so no number on the end.
+
+		uint64_t stepped = 0;
+		while (true)
 		{
-			// Check ball collision.
-			for (auto &[id, info] : m_players)
+			double deltaTime;
 			{
-				bool collided = false;
-				if (AABB(m_ball, info)) // TODO: Better collision detection.
-					collided = true;
+				std::unique_lock<std::mutex> lock(m_stepMutex);
+				m_stepStart.wait(lock, [&]() { return !m_shardsRunning || m_stepGeneration != stepped; });
+				if (!m_shardsRunning)
+					return;
+				stepped = m_stepGeneration;
+				deltaTime = m_stepDeltaTime;
+			}
 
-				// Paddle hit ball.
-				if (collided)
-				{
-					// Calculate bounce angle
-					float intersectY = info.yPosition - m_ball.yPosition; // How far from the middle of the paddle did the ball hit?
-					float normalizedIntersect = intersectY / (paddleHeight / 2.0f); // -1 <-> 1
-					float bounceAngle = normalizedIntersect * (45 * DEG2RAD);
-					m_ball.currentHSpeed = ballHSpeed + abs(normalizedIntersect) * ballHSpeed;
-					m_ball.currentVSpeed = ballVSpeed + abs(normalizedIntersect) * ballVSpeed;
-
-					// Set balls new velocity based on new angle and which direction they've been hit from.
-					if (info.rightSide == false)
-					{
-						m_ball.xVelocity = m_ball.currentHSpeed * cosf(bounceAngle);
-						m_ball.yVelocity = m_ball.currentVSpeed * -sinf(bounceAngle);
-					}
-					else
-					{
-						m_ball.xVelocity = m_ball.currentHSpeed * -cosf(bounceAngle);
-						m_ball.yVelocity = m_ball.currentVSpeed * sinf(bounceAngle);
-					}
+			StepShard(m_shards[index], deltaTime);
 
-					// Update clients on the ball's new velocity.
-					BCNet::Packet packet;
-					packet.Allocate(1024);
-					BCNet::PacketStreamWriter writer(packet);
-					writer << PongPackets::PONG_BALL_VELOCITY << m_ball.xVelocity << m_ball.yVelocity;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
+			std::lock_guard<std::mutex> lock(m_stepMutex);
+			if (--m_shardsStepping == 0)
+				m_stepDone.notify_one();
+		}
+	}
 
-					// Tell the clients that a player's paddle has hit the ball.
-					packet.Allocate(1024);
-					writer = BCNet::PacketStreamWriter(packet);
-					writer << PongPackets::PONG_PLAYER_HIT;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
-				}
+	// With m_matchMutex held, so nothing else touches a match while the shards are stepping them.
+	void StepShards(double deltaTime)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_stepMutex);
+			m_stepDeltaTime = deltaTime;
+			m_shardsStepping = (int)m_shardThreads.size();
+			m_stepGeneration++;
+		}
+		m_stepStart.notify_all();
 
-				// Check if ball goes out of bounds, i.e. goal.
-				if (m_ball.xPosition > 1.0f && info.rightSide == false) // Update score for the left player.
-				{
-					info.score += 1;
+		StepShard(m_shards.front(), deltaTime);
 
-					// Tell the clients that a player's score has been updated.
-					BCNet::Packet packet;
-					packet.Allocate(1024);
-					BCNet::PacketStreamWriter writer(packet);
-					writer << PongPackets::PONG_PLAYER_SCORE << info.rightSide << info.score;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
-				}
-				else if (m_ball.xPosition < 0.0f && info.rightSide == true) // Update score for the right player.
-				{
-					info.score += 1;
+		std::unique_lock<std::mutex> lock(m_stepMutex);
+		m_stepDone.wait(lock, [&]() { return m_shardsStepping == 0; });
+	}
 
-					// Tell the clients that a player's score has been updated.
-					BCNet::Packet packet;
-					packet.Allocate(1024);
-					BCNet::PacketStreamWriter writer(packet);
-					writer << PongPackets::PONG_PLAYER_SCORE << info.rightSide << info.score;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
-				}
+	void StepShard(MatchShard &shard, double deltaTime)
+	{
+		shard.cost = 0.0;
+		for (auto it = shard.matches.begin(); it != shard.matches.end();)
+		{
+			Match &match = **it;
+			if (match.GetPlayerCount() == 0) // Everyone's gone.
+			{
+				match.EndSpectating();
+				it = shard.matches.erase(it);
+				continue;
+			}
+
+			match.Update(deltaTime);
+			shard.cost += match.GetUpdateCost();
+			++it;
+		}
+	}
+
+	void BalanceShards()
+	{
+		// Between ticks, every shard's stopped. At most one match moves per cooldown, from the busiest shard to the idlest.
+		double now = ClockNowSeconds();
+		if (m_shards.size() < 2 || now - m_lastMigrationTime < migrationCooldown)
+			return;
+
+		MatchShard *busiest = &m_shards.front(), *idlest = &m_shards.front();
+		for (MatchShard &shard : m_shards)
+		{
+			if (shard.cost > busiest->cost)
+				busiest = &shard;
+			if (shard.cost < idlest->cost)
+				idlest = &shard;
+		}
+
+		double gap = busiest->cost - idlest->cost;
+		if (gap < migrationMinimumGap || gap < busiest->cost * migrationImbalance)
+			return;
+
+		// The match closest to half the gap evens them out the most. Anything costing more than the gap would only swap
+		// which shard's busiest.
+		size_t chosen = SIZE_MAX;
+		double chosenDistance = gap / 2.0;
+		for (size_t i = 0; i < busiest->matches.size(); i++)
+		{
+			double distance = std::abs(busiest->matches[i]->GetUpdateCost() - gap / 2.0);
+			if (distance < chosenDistance)
+			{
+				chosen = i;
+				chosenDistance = distance;
 			}
+		}
+		if (chosen == SIZE_MAX)
+			return;
+
+		MigrateMatch(*busiest, chosen, *idlest);
+		m_lastMigrationTime = now;
+	}
+
+	void MigrateMatch(MatchShard &from, size_t index, MatchShard &to)
+	{
+		// Through a snapshot rather than handing the pointer over, so it's the same path a handoff to another process takes.
+		int64_t start = ClockNowNanoseconds();
+
+		std::unique_ptr<Match> &source = from.matches[index];
+		MatchSnapshot snapshot;
+		source->Serialize(snapshot);
+
+		std::unique_ptr<Match> match = Match::Restore(snapshot, *this);
+		if (!match)
+		{
+			m_migrationStats.failed++; // Carries on where it is, just without the rest of its replay.
+			PONG_LOG(SERVER_MIGRATION_FAILED, source->GetId());
+			return;
+		}
+
+		for (auto &[id, info] : match->GetPlayers())
+			m_clientMatches[id] = match.get();
+
+		double cost = match->GetUpdateCost();
+		from.cost -= cost;
+		to.cost += cost;
+		from.matches.erase(from.matches.begin() + index);
+		to.matches.push_back(std::move(match));
+
+		int64_t pause = ClockNowNanoseconds() - start;
+		if (m_migrationStats.migrations == 0)
+			m_migrationStats.firstMigrationTime = ClockNowSeconds();
+		m_migrationStats.migrations++;
+		m_migrationStats.pauses.Record(pause);
+		PONG_TRACE_INSTANT("Match migrated");
+	}
+
+	void UpdateMatchmaking()
+	{
+		PONG_PROFILE_SCOPE(eProfilePhase::MATCHMAKING);
 
-			// Check if ball hits vertical bounds.
-			if (m_ball.yPosition < 0.0f || m_ball.yPosition > 1.0f) // Flip y direction if hit ceiling or floor.
+		if (m_handoffState != HANDOFF_IDLE) // Draining, everyone waiting goes over to the new server as they are.
+			return;
+
+		double now = ClockNowSeconds();
+
+		// Queue anyone whose RTT we know by now, or who we've waited long enough on.
+		for (auto it = m_pendingClients.begin(); it != m_pendingClients.end();)
+		{
+			MatchmakingTicket ticket;
+			ticket.playerId = it->first;
+
+			std::shared_ptr<ConnectionStats> stats = GetConnectionStats(it->first);
+			LinkStats link = stats ? stats->GetStats() : LinkStats();
+			if (!link.hasRtt && now - it->second < matchmakingRttWait)
 			{
-				m_ball.yVelocity *= -1; // Bounce.
+				++it;
+				continue;
+			}
+			ticket.rtt = link.hasRtt ? link.smoothedRtt : 0.0;
 
-				// Update clients on the ball's new velocity.
-				BCNet::Packet packet;
-				packet.Allocate(1024);
-				BCNet::PacketStreamWriter writer(packet);
-				writer << PongPackets::PONG_BALL_VELOCITY << m_ball.xVelocity << m_ball.yVelocity;
-				g_server->SendPacketToAllClients(writer.GetPacket());
-				packet.Release();
+			m_matchmaker.Enqueue(ticket, now);
+			it = m_pendingClients.erase(it);
 
-				// Tell the clients that the ball has bounced.
-				packet.Allocate(1024);
-				writer = BCNet::PacketStreamWriter(packet);
-				writer << PongPackets::PONG_BALL_BOUNCE;
-				g_server->SendPacketToAllClients(writer.GetPacket());
-				packet.Release();
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_MATCH_QUEUED << (uint32)m_matchmaker.GetQueuedCount();
+			SendToClient(ticket.playerId, writer.GetPacket());
+			packet.Release();
+		}
+
+		// Matches someone left get the closest match from the queue first.
+		for (MatchShard &shard : m_shards)
+		{
+			for (std::unique_ptr<Match> &match : shard.matches)
+			{
+				if (match->GetPlayerCount() != 1)
+					continue;
+
+				uint32 remainingId = match->GetPlayers().begin()->first;
+				std::shared_ptr<ConnectionStats> stats = GetConnectionStats(remainingId);
+				LinkStats link = stats ? stats->GetStats() : LinkStats();
+
+				MatchmakingTicket remaining, taken;
+				remaining.playerId = remainingId;
+				remaining.rtt = link.hasRtt ? link.smoothedRtt : 0.0;
+				if (m_matchmaker.TakeClosest(remaining, now, taken) && match->AddPlayer(taken.playerId))
+					m_clientMatches[taken.playerId] = match.get();
 			}
+		}
+
+		// Then everyone else is paired up into new matches.
+		m_pairs.clear();
+		m_matchmaker.Pair(now, m_pairs);
+		for (const MatchmakingPair &pair : m_pairs)
+		{
+			MatchShard &shard = LeastLoadedShard();
+			shard.matches.push_back(std::make_unique<Match>(m_nextMatchId++, *this, m_rollbackMode));
+			Match *match = shard.matches.back().get();
 
-			// Reset the ball when out of bounds.
-			if (m_ball.xPosition > 1.0f || m_ball.xPosition < 0.0f)
+			for (const MatchmakingTicket &ticket : pair.players)
 			{
-				m_ball.xPosition = 0.5f;
-				m_ball.yPosition = 0.5f;
-				m_ball.xVelocity = -1.0f;
-				m_ball.yVelocity = -1.0f;
-				m_ball.currentHSpeed = ballHSpeed;
-				m_ball.currentVSpeed = ballVSpeed;
-
-				float angle = CalculateBallAngle();
-				m_ball.xVelocity = ballHSpeed * cosf(angle);
-				m_ball.yVelocity = ballVSpeed * sinf(angle);
-
-				// Tell the clients that the ball has been reset.
-				BCNet::Packet packet;
-				packet.Allocate(1024);
-				BCNet::PacketStreamWriter writer(packet);
-				writer << PongPackets::PONG_BALL_RESET;
-				g_server->SendPacketToAllClients(writer.GetPacket());
-				packet.Release();
+				match->AddPlayer(ticket.playerId);
+				m_clientMatches[ticket.playerId] = match;
+			}
 
-				// Update the clients on the ball's new velocity.
-				packet.Allocate(1024);
-				writer = BCNet::PacketStreamWriter(packet);
-				writer << PongPackets::PONG_BALL_VELOCITY << m_ball.xVelocity << m_ball.yVelocity;
-				g_server->SendPacketToAllClients(writer.GetPacket());
-				packet.Release();
+			if (!FindMatch(m_watchedMatchId)) // Nothing on screen, watch the new one.
+				m_watchedMatchId = match->GetId();
+		}
+
+		if (m_botFillWait > 0.0 && !m_rollbackMode)
+			FillWithBots(now);
+	}
+
+	void FillWithBots(double now)
+	{
+		// Nobody's come along for them in time, they get a bot. First whoever's still queued, alone in a match of their own.
+		m_botFills.clear();
+		m_matchmaker.TakeWaiting(m_botFillWait, now, m_botFills);
+		for (const MatchmakingTicket &ticket : m_botFills)
+		{
+			MatchShard &shard = LeastLoadedShard();
+			shard.matches.push_back(std::make_unique<Match>(m_nextMatchId++, *this, m_rollbackMode));
+			Match *match = shard.matches.back().get();
+
+			match->AddPlayer(ticket.playerId);
+			m_clientMatches[ticket.playerId] = match;
+			AddBot(*match, false);
+
+			if (!FindMatch(m_watchedMatchId))
+				m_watchedMatchId = match->GetId();
+		}
+
+		// Then anyone whose opponent left and wasn't replaced from the queue. Not while they're away, their match is paused.
+		m_loneMatches.swap(m_lastLoneMatches);
+		m_loneMatches.clear();
+		for (MatchShard &shard : m_shards)
+		{
+			for (std::unique_ptr<Match> &match : shard.matches)
+			{
+				if (match->GetPlayerCount() != 1 || match->IsPaused() || IsBotId(match->GetPlayers().begin()->first))
+					continue;
+
+				auto last = m_lastLoneMatches.find(match->GetId());
+				double since = last != m_lastLoneMatches.end() ? last->second : now;
+				if (now - since >= m_botFillWait)
+					AddBot(*match, false);
+				else
+					m_loneMatches[match->GetId()] = since;
 			}
+		}
+	}
 
-			// Update ball.
-			m_ball.xPosition += m_ball.xVelocity * (float)deltaTime;
-			m_ball.yPosition += m_ball.yVelocity * (float)deltaTime;
+	void StartBotMatches()
+	{
+		if ((m_botMatchCount > 0 || m_botFillWait > 0.0) && m_rollbackMode) // They'd need to run the match themselves.
+		{
+			PONG_LOG(SERVER_BOTS_NEED_SIMULATION);
+			m_botFillWait = 0.0;
+			return;
 		}
-		else // Do lobby state.
+
+		std::lock_guard<std::mutex> lock(m_matchMutex);
+		for (int i = 0; i < m_botMatchCount; i++)
 		{
-			if (m_gameState.playersReady >= 2) // Both players are ready.
+			MatchShard &shard = LeastLoadedShard();
+			shard.matches.push_back(std::make_unique<Match>(m_nextMatchId++, *this, m_rollbackMode));
+			Match *match = shard.matches.back().get();
+			AddBot(*match, true);
+			AddBot(*match, true);
+		}
+		if (m_botMatchCount > 0)
+			m_watchedMatchId = m_shards.front().matches.front()->GetId();
+	}
+
+	void AddBot(Match &match, bool load)
+	{
+		uint32 id = m_nextBotId++;
+		if (!match.AddPlayer(id))
+			return;
+
+		m_clientMatches[id] = &match;
+		m_botPlayers[id].load = load;
+		m_bots.Add(id, match.GetPlayers().at(id).Side(), id); // Seeded by ID, so the same server run gets the same bots.
+		m_botStats.added++;
+	}
+
+	void RemoveBot(uint32 id)
+	{
+		auto it = m_clientMatches.find(id);
+		if (it != m_clientMatches.end())
+		{
+			it->second->RemovePlayer(id);
+			m_clientMatches.erase(it);
+		}
+		m_botPlayers.erase(id);
+		m_bots.Remove(id);
+	}
+
+	static bool HasHumanPlayer(const Match &match)
+	{
+		for (auto &[id, info] : match.GetPlayers())
+			if (!IsBotId(id))
+				return true;
+		return false;
+	}
+
+	void UpdateBots()
+	{
+		if (m_bots.GetCount() == 0)
+			return;
+
+		PONG_PROFILE_SCOPE(eProfilePhase::BOTS);
+		int64_t start = ClockNowNanoseconds();
+
+		// Sitting in for someone who's left, they go too. A match with nobody left is closed on the next tick.
+		for (size_t i = 0; i < m_bots.GetCount();)
+		{
+			uint32 id = m_bots.GetId(i);
+			auto it = m_clientMatches.find(id);
+			if (it != m_clientMatches.end() && (m_botPlayers[id].load || HasHumanPlayer(*it->second)))
+				i++;
+			else
+				RemoveBot(id); // The last bot's moved into this index.
+		}
+
+		// What every bot can see, then all of them decide at once.
+		for (size_t i = 0; i < m_bots.GetCount(); i++)
+		{
+			uint32 id = m_bots.GetId(i);
+			const Match &match = *m_clientMatches[id];
+			const SimState &sim = match.GetSim();
+
+			BotObservation observation;
+			observation.ballX = SimToFloat(sim.ball.xPosition);
+			observation.ballY = SimToFloat(sim.ball.yPosition);
+			observation.ballXVelocity = SimToFloat(sim.ball.xVelocity);
+			observation.ballYVelocity = SimToFloat(sim.ball.yVelocity);
+			observation.paddleY = SimToFloat(sim.paddles[match.GetPlayers().at(id).Side()].yPosition);
+			observation.playing = sim.playing;
+			m_bots.Observe(i, observation);
+		}
+		m_bots.Think();
+
+		// Their inputs go in the same way a remote player's do, and only when they change.
+		for (size_t i = 0; i < m_bots.GetCount(); i++)
+		{
+			uint32 id = m_bots.GetId(i);
+			Match &match = *m_clientMatches[id];
+			const PlayerInfo &info = match.GetPlayers().at(id);
+
+			uint8_t input = m_bots.GetInput(i);
+			bool up = (input & SIM_INPUT_UP) != 0, down = (input & SIM_INPUT_DOWN) != 0;
+			if (up != info.movingUp)
+				SendBotPacket(match, id, PongPackets::PONG_PLAYER_MOVING_UP, up);
+			if (down != info.movingDown)
+				SendBotPacket(match, id, PongPackets::PONG_PLAYER_MOVING_DOWN, down);
+			if (!info.ready && !match.GetGameState().gameStarted) // Always up for it.
+				SendBotPacket(match, id, PongPackets::PONG_PLAYER_READY, true);
+		}
+
+		m_botStats.think.Record(ClockNowNanoseconds() - start);
+	}
+
+	void SendBotPacket(Match &match, uint32 id, PongPackets type, bool value)
+	{
+		BCNet::PacketStreamWriter writer(m_botPacket); // Rewritten for every one, see the constructor.
+		writer << type << value;
+
+		BCNet::PacketStreamReader reader(writer.GetPacket());
+		int packetID;
+		reader >> packetID;
+		match.PacketReceived(id, packetID, reader, writer.GetPacket());
+	}
+
+	void UpdateHandoff()
+	{
+		// Between ticks on the tick thread, so the matches are handed over exactly where the last tick left them.
+		if (m_handoffState == HANDOFF_IDLE)
+		{
+			if (!m_handoffListener.IsOpen() || !m_handoffListener.Accept(m_handoffConnection, 0.0))
+				return;
+
+			PONG_LOG(SERVER_HANDOFF_DRAINING);
+			m_handoffState = HANDOFF_DRAINING;
+			m_workerLinkRunning = false; // Matches keep ticking until it's stopped, so nobody notices the wait.
+			return;
+		}
+
+		if (m_handoffState != HANDOFF_DRAINING || !m_workerLinkStopped)
+			return;
+
+		m_workerLinkThread.join();
+		HandOff();
+	}
+
+	void HandOff()
+	{
+		std::vector<uint8_t> state;
+		std::vector<std::pair<Match *, MatchSnapshot>> snapshots;
+
+		std::unique_lock<std::mutex> lock(m_matchMutex);
+
+		BytesPut(state, handoffStateMagic);
+		BytesPut(state, handoffStateVersion);
+		BytesPut(state, ClockNowSeconds()); // When the last tick was, the new server steps from here.
+		BytesPut(state, (uint8_t)m_useShmLink);
+		BytesPut(state, (uint16_t)m_gatewayPort);
+		BytesPut(state, m_nextMatchId);
+
+		// Players waiting for a match, with how long they've been waiting so they don't lose their place.
+		std::vector<MatchmakingTicket> queued;
+		m_matchmaker.GetQueued(queued);
+		BytesPut(state, (uint32_t)queued.size());
+		for (const MatchmakingTicket &ticket : queued)
+		{
+			BytesPut(state, ticket.playerId);
+			BytesPut(state, ticket.rtt);
+			BytesPut(state, (int32_t)ticket.skill);
+			BytesPut(state, ticket.queuedTime);
+		}
+		BytesPut(state, (uint32_t)m_pendingClients.size());
+		for (auto &[id, connectedTime] : m_pendingClients)
+		{
+			BytesPut(state, id);
+			BytesPut(state, connectedTime);
+		}
+
+		// Session tokens, and the slots held for them, so a player can drop during an upgrade and still come back.
+		BytesPut(state, (uint32_t)m_clientTokens.size());
+		for (auto &[id, token] : m_clientTokens)
+		{
+			BytesPut(state, id);
+			BytesPut(state, token);
+		}
+		BytesPut(state, (uint32_t)m_heldPlayers.size());
+		for (auto &[token, held] : m_heldPlayers)
+		{
+			BytesPut(state, token);
+			BytesPut(state, held.clientId);
+			BytesPut(state, held.matchId);
+			BytesPut(state, held.heldSince);
+		}
+
+		uint32_t matchCount = 0;
+		for (MatchShard &shard : m_shards)
+			matchCount += (uint32_t)shard.matches.size();
+		BytesPut(state, matchCount);
+		for (MatchShard &shard : m_shards)
+		{
+			for (std::unique_ptr<Match> &match : shard.matches)
 			{
-				// Start count down.
-				m_timer += (float)deltaTime;
-				static unsigned int lastCountDown = 4;
-				unsigned int countDown = (unsigned int)(std::ceilf(3.0f - m_timer));
+				snapshots.emplace_back(match.get(), MatchSnapshot());
+				match->Serialize(snapshots.back().second);
 
-				if (countDown != lastCountDown) // So the stuff inside isn't called each frame,
-				{
-					lastCountDown = countDown; // only when the countdown has changed.
+				const std::vector<uint8_t> &matchState = snapshots.back().second.state;
+				BytesPut(state, (uint32_t)matchState.size());
+				state.insert(state.end(), matchState.begin(), matchState.end());
+			}
+		}
 
-					// Count down!
-					std::string countDownText = std::to_string(countDown);
-					if (countDown <= 0)
-						countDownText = "GO!";
+		int descriptor = m_useShmLink ? m_shmLink.GetDescriptor() : m_workerLink.GetDescriptor();
+		bool sent = m_handoffConnection.Send(state, &descriptor, 1);
+		bool acked = sent && m_handoffConnection.ReceiveAck(handoffAckTimeout);
+		m_handoffConnection.Close();
 
-					int textWidth = MeasureText(countDownText.c_str(), 48);
-					float textXPosition = (clientWidth / 2.0f) - (textWidth / 2.0f);
-					float textYPosition = (clientHeight / 2.0f) - 24.0f;
-					m_textPool.Init(countDownText, textXPosition, textYPosition, 1.0f, 48, BLUE);
+		// Once it has all of it, the replacement could be running the matches and reading the link whether or not its ack
+		// got here. Two of us on the same rings would corrupt them, so it's theirs either way and we never touch it again.
+		if (sent)
+		{
+			// Our copies go quietly, the snapshots finish off the replays as they're destroyed.
+			for (MatchShard &shard : m_shards)
+				shard.matches.clear();
+			m_clientMatches.clear();
+			m_pendingClients.clear();
+			m_clientTokens.clear();
+			m_heldPlayers.clear();
+			m_shmLink.Detach();
+			m_workerLink.Close();
+			m_handoffState = HANDOFF_DONE;
+			if (acked)
+				PONG_LOG(SERVER_HANDOFF_DONE, matchCount);
+			else
+				PONG_LOG(SERVER_HANDOFF_UNCONFIRMED, matchCount);
+			return;
+		}
 
-					// Alert the clients on the count down.
-					BCNet::Packet packet;
-					packet.Allocate(1024);
-					BCNet::PacketStreamWriter writer(packet);
-					writer << PongPackets::PONG_PLAYER_COUNTDOWN << countDownText;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
+		// It never got the state, so it can't have started. Take the replays back and carry on as if it never connected.
+		PONG_LOG(SERVER_HANDOFF_FAILED);
+		for (auto &[original, snapshot] : snapshots)
+		{
+			std::unique_ptr<Match> restored = Match::Restore(snapshot, *this);
+			if (restored)
+				ReplaceMatch(original, std::move(restored));
+		}
+		lock.unlock();
 
-					g_server->Log(countDownText);
-				}
+		m_handoffState = HANDOFF_IDLE;
+		m_handoffListener.Listen(m_handoffPath);
+		StartLinkThread();
+	}
 
-				if (m_timer >= 3.0f) // The count down has ended!
-				{
-					// Start game!
-					m_gameState.gameStarted = true;
+	bool TakeOver()
+	{
+		HandoffSocket connection;
+		if (!connection.Connect(m_handoffPath)) // Nothing running, start fresh.
+			return false;
 
-					// Tell the clients that the game has commenced!
-					BCNet::Packet packet;
-					packet.Allocate(1024);
-					BCNet::PacketStreamWriter writer(packet);
-					writer << PongPackets::PONG_GAME_STARTED;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
+		PONG_LOG(SERVER_TAKING_OVER);
 
-					// Update the clients on the ball's new velocity.
-					packet.Allocate(1024);
-					writer = BCNet::PacketStreamWriter(packet);
-					writer << PongPackets::PONG_BALL_VELOCITY << m_ball.xVelocity << m_ball.yVelocity;
-					g_server->SendPacketToAllClients(writer.GetPacket());
-					packet.Release();
+		std::vector<uint8_t> state;
+		std::vector<int> descriptors;
+		if (!connection.Receive(state, descriptors, handoffAckTimeout) || descriptors.size() != 1)
+		{
+			PONG_LOG(SERVER_TAKE_OVER_NO_STATE);
+			HandoffCloseDescriptors(descriptors);
+			return false;
+		}
+
+		if (!RestoreHandoff(state, descriptors.front()))
+		{
+			PONG_LOG(SERVER_TAKE_OVER_FAILED);
+			std::lock_guard<std::mutex> lock(m_matchMutex);
+			for (MatchShard &shard : m_shards)
+				shard.matches.clear();
+			m_clientMatches.clear();
+			m_pendingClients.clear();
+			m_clientTokens.clear();
+			m_heldPlayers.clear();
+			m_workerLink.Close();
+			m_shmLink.Detach(); // The old server still has it.
+			return false;
+		}
+
+		connection.SendAck(); // The old server stops as soon as we have the state, a lost ack doesn't change that.
+		return true;
+	}
+
+	bool RestoreHandoff(const std::vector<uint8_t> &state, int descriptor)
+	{
+		const uint8_t *data = state.data();
+		const uint8_t *end = data + state.size();
+
+		uint32_t magic = 0, version = 0;
+		double snapshotTime = 0.0;
+		uint8_t useShmLink = 0;
+		uint16_t gatewayPort = 0;
+		if (!BytesGet(data, end, magic) || !BytesGet(data, end, version) || magic != handoffStateMagic || version != handoffStateVersion ||
+			!BytesGet(data, end, snapshotTime) || !BytesGet(data, end, useShmLink) || !BytesGet(data, end, gatewayPort) ||
+			!BytesGet(data, end, m_nextMatchId))
+			return false;
+
+		// The link the gateway's already using, whatever --link this one was started with.
+		m_useShmLink = useShmLink != 0;
+		if (!(m_useShmLink ? m_shmLink.Adopt(descriptor, m_workerPort) : m_workerLink.Adopt(descriptor)))
+			return false;
+		m_gatewayPort = gatewayPort;
+
+		std::lock_guard<std::mutex> lock(m_matchMutex);
+
+		uint32_t queuedCount = 0;
+		if (!BytesGet(data, end, queuedCount))
+			return false;
+		for (uint32_t i = 0; i < queuedCount; i++)
+		{
+			MatchmakingTicket ticket;
+			int32_t skill = 0;
+			if (!BytesGet(data, end, ticket.playerId) || !BytesGet(data, end, ticket.rtt) || !BytesGet(data, end, skill) || !BytesGet(data, end, ticket.queuedTime))
+				return false;
+			ticket.skill = skill;
+			m_matchmaker.Enqueue(ticket, ticket.queuedTime);
+			AddConnectionStats(ticket.playerId);
+		}
+
+		uint32_t pendingCount = 0;
+		if (!BytesGet(data, end, pendingCount))
+			return false;
+		for (uint32_t i = 0; i < pendingCount; i++)
+		{
+			uint32 id = 0;
+			double connectedTime = 0.0;
+			if (!BytesGet(data, end, id) || !BytesGet(data, end, connectedTime))
+				return false;
+			m_pendingClients[id] = connectedTime;
+			AddConnectionStats(id);
+		}
+
+		uint32_t tokenCount = 0;
+		if (!BytesGet(data, end, tokenCount))
+			return false;
+		for (uint32_t i = 0; i < tokenCount; i++)
+		{
+			uint32 id = 0;
+			uint64_t token = 0;
+			if (!BytesGet(data, end, id) || !BytesGet(data, end, token))
+				return false;
+			m_clientTokens[id] = token;
+		}
+		uint32_t heldCount = 0;
+		if (!BytesGet(data, end, heldCount))
+			return false;
+		for (uint32_t i = 0; i < heldCount; i++)
+		{
+			uint64_t token = 0;
+			HeldPlayer held;
+			if (!BytesGet(data, end, token) || !BytesGet(data, end, held.clientId) || !BytesGet(data, end, held.matchId) || !BytesGet(data, end, held.heldSince))
+				return false;
+			m_heldPlayers[token] = held;
+		}
+
+		uint32_t matchCount = 0;
+		if (!BytesGet(data, end, matchCount))
+			return false;
+		for (uint32_t i = 0; i < matchCount; i++)
+		{
+			uint32_t size = 0;
+			if (!BytesGet(data, end, size) || (size_t)(end - data) < size)
+				return false;
+
+			MatchSnapshot snapshot;
+			snapshot.state.assign(data, data + size);
+			data += size;
+
+			std::unique_ptr<Match> match = Match::Restore(snapshot, *this);
+			if (!match)
+				return false;
+			match->ResumeRecording();
+
+			bool botsOnly = !HasHumanPlayer(*match);
+			for (auto &[id, info] : match->GetPlayers())
+			{
+				m_clientMatches[id] = match.get();
+				if (!IsBotId(id))
+				{
+					AddConnectionStats(id);
+					continue;
 				}
+
+				// Same ID and seed, they carry on as they were bar what they'd seen of the ball.
+				m_botPlayers[id].load = botsOnly;
+				m_bots.Add(id, info.Side(), id);
+				m_nextBotId = std::max(m_nextBotId, id + 1);
 			}
-			else
+			for (uint32 id : match->GetSpectators())
+			{
+				m_spectators[id] = match->GetId();
+				AddConnectionStats(id);
+			}
+			if (!FindMatch(m_watchedMatchId))
+				m_watchedMatchId = match->GetId();
+			LeastLoadedShard().matches.push_back(std::move(match));
+		}
+
+		m_resumedFrom = snapshotTime;
+		PONG_LOG(SERVER_TAKEN_OVER, matchCount, queuedCount + pendingCount);
+		return data == end;
+	}
+
+	void ReplaceMatch(Match *original, std::unique_ptr<Match> replacement)
+	{
+		for (MatchShard &shard : m_shards)
+		{
+			for (std::unique_ptr<Match> &match : shard.matches)
+			{
+				if (match.get() != original)
+					continue;
+
+				for (auto &[id, info] : replacement->GetPlayers())
+					m_clientMatches[id] = replacement.get();
+				match = std::move(replacement);
+				return;
+			}
+		}
+	}
+
+	void AddConnectionStats(uint32 id)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_statsMutex);
+		m_connectionStats[id] = std::make_shared<ConnectionStats>();
+	}
+
+	MatchShard &LeastLoadedShard()
+	{
+		MatchShard *leastLoaded = &m_shards.front();
+		for (MatchShard &shard : m_shards)
+			if (shard.matches.size() < leastLoaded->matches.size())
+				leastLoaded = &shard;
+		return *leastLoaded;
+	}
+
+	Match *FindMatch(uint32 id)
+	{
+		for (MatchShard &shard : m_shards)
+			for (std::unique_ptr<Match> &match : shard.matches)
+				if (match->GetId() == id)
+					return match.get();
+		return nullptr;
+	}
+
+	void WatchNextMatch()
+	{
+		// The lowest match ID after the watched one, wrapping round.
+		std::lock_guard<std::mutex> lock(m_matchMutex);
+		uint32 next = UINT32_MAX, first = UINT32_MAX;
+		for (MatchShard &shard : m_shards)
+		{
+			for (std::unique_ptr<Match> &match : shard.matches)
 			{
-				m_timer = 0.0f; // Reset timer.
+				uint32 id = match->GetId();
+				if (id < first)
+					first = id;
+				if (id > m_watchedMatchId && id < next)
+					next = id;
 			}
 		}
+		m_watchedMatchId = next != UINT32_MAX ? next : first;
+	}
+
+	// A reference of its own, the network thread can drop the connection while shards are still sending to it.
+	std::shared_ptr<ConnectionStats> GetConnectionStats(uint32 id)
+	{
+		std::shared_lock<std::shared_mutex> lock(m_statsMutex);
+		auto it = m_connectionStats.find(id);
+		return it != m_connectionStats.end() ? it->second : nullptr;
+	}
 
-		// Update players.
-		for (auto &[id, info] : m_players)
+	void PingClients()
+	{
+		double now = ClockNowSeconds();
+
+		std::shared_lock<std::shared_mutex> lock(m_statsMutex);
+		for (auto &[id, stats] : m_connectionStats)
 		{
-			int input = (int)info.movingUp - (int)info.movingDown;
-			float move = input * paddleVSpeed * (float)deltaTime;
+			stats->Update(now);
+			if (!stats->ShouldPing(now))
+				continue;
+
+			uint32 sequence = stats->OnPingSent(now);
+
+			BCNet::Packet packet;
+			packet.Allocate(1024);
+			BCNet::PacketStreamWriter writer(packet);
+			writer << PongPackets::PONG_PING << sequence << now;
+			SendRaw(id, writer.GetPacket());
+			stats->OnBytesSent(writer.GetPacket().Size);
+			packet.Release();
+		}
+	}
+
+	std::string ConnectionStatsReport()
+	{
+		std::string report;
+
+		std::shared_lock<std::shared_mutex> lock(m_statsMutex);
+		for (auto &[id, stats] : m_connectionStats)
+			report += "client " + std::to_string(id) + ": " + stats->GetStats().ToString() + "\n";
+		return report;
+	}
 
-			info.yPosition -= move; // Move the player.
+	std::string MatchmakingReport()
+	{
+		std::lock_guard<std::mutex> lock(m_matchMutex);
+		const MatchmakingStats &stats = m_matchmaker.GetStats();
+		uint64_t paired = stats.pairsMade * 2 + stats.backfills + stats.botFills;
+
+		std::string report = "matchmaking: " + std::to_string(m_matchmaker.GetQueuedCount()) + " queued, " +
+			std::to_string(stats.pairsMade) + " pairs, " + std::to_string(stats.backfills) + " backfills, " + std::to_string(stats.botFills) + " given bots";
+		if (paired > 0)
+			report += ", average wait " + std::to_string(stats.totalWait / paired) + "s, longest " + std::to_string(stats.longestWait) + "s";
+		report += "\n";
+
+		for (size_t i = 0; i < m_shards.size(); i++)
+			report += "shard " + std::to_string(i) + ": " + std::to_string(m_shards[i].matches.size()) + " matches, " +
+				std::to_string(m_shards[i].cost / 1000.0) + "us per tick\n";
+		size_t spectators = 0;
+		for (MatchShard &shard : m_shards)
+			for (std::unique_ptr<Match> &match : shard.matches)
+				spectators += match->GetSpectators().size();
+		report += "spectators: " + std::to_string(spectators) + "\n";
+
+		// Against what the shards spend stepping every match, which is what bots are meant to be a small part of.
+		double simCost = 0.0;
+		for (MatchShard &shard : m_shards)
+			simCost += shard.cost;
+		const BotStats &bots = m_botStats;
+		report += "bots: " + std::to_string(m_bots.GetCount()) + " playing, " + std::to_string(bots.added) + " added";
+		if (bots.think.Count() > 0)
+		{
+			double think = (double)bots.think.Percentile(50.0);
+			report += ", p50 " + std::to_string(think / 1000.0) + "us, p99 " + std::to_string(bots.think.Percentile(99.0) / 1000.0) + "us per tick";
+			if (simCost > 0.0)
+				report += ", " + std::to_string(think / simCost * 100.0) + "% of the matches' cost";
+		}
+		report += "\n";
 
-			// Clamp to bounds.
-			if (info.yPosition - (paddleHeight / 2.0f) < 0.0f)
-				info.yPosition = (paddleHeight / 2.0f);
-			if (info.yPosition + (paddleHeight / 2.0f) > 1.0f)
-				info.yPosition = 1.0f - (paddleHeight / 2.0f);
+		const MigrationStats &migration = m_migrationStats;
+		report += "migrations: " + std::to_string(migration.migrations) + ", " + std::to_string(migration.failed) + " failed";
+		if (migration.migrations > 0)
+		{
+			double minutes = (ClockNowSeconds() - migration.firstMigrationTime) / 60.0;
+			if (minutes > 0.0)
+				report += ", " + std::to_string(migration.migrations / minutes) + " per minute";
+			report += ", pause p50 " + std::to_string(migration.pauses.Percentile(50.0) / 1000.0) + "us, p99 " +
+				std::to_string(migration.pauses.Percentile(99.0) / 1000.0) + "us, max " + std::to_string(migration.pauses.Max() / 1000.0) + "us";
 		}
+		report += "\n";
+
+		const ReconnectStats &reconnects = m_reconnectStats;
+		report += "reconnects: " + std::to_string(reconnects.held) + " held, " + std::to_string(reconnects.resumed) + " resumed, " +
+			std::to_string(reconnects.expired) + " expired, " + std::to_string(reconnects.refused) + " refused, " + std::to_string(m_heldPlayers.size()) + " waiting";
+		if (reconnects.resumed > 0)
+			report += ", away p50 " + std::to_string(reconnects.timeAway.Percentile(50.0) / 1e6) + "ms, p99 " +
+				std::to_string(reconnects.timeAway.Percentile(99.0) / 1e6) + "ms, max " + std::to_string(reconnects.timeAway.Max() / 1e6) + "ms";
+		report += "\n";
+
+		LoggerStats log = Logger::GetStats();
+		report += "log: " + std::to_string(log.written) + " lines, " + std::to_string(log.dropped) + " dropped, " + std::to_string(log.suppressed) + " held back\n";
+		return report;
+	}
+
+	bool DumpStats()
+	{
+		std::ofstream file(profileDumpPath, std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file << Profiler::Report() << "\n" << MatchmakingReport() << "\n" << ConnectionStatsReport();
+		return true;
 	}
 
 	void Draw()
@@ -484,83 +1527,182 @@ private:
 			DrawRectangle((int)((clientWidth / 2.0f) - 4), i - 4, 8, 12, WHITE);
 		}
 
-		// Draw Ball.
-		int ballXPos = (int)(m_ball.xPosition * clientWidth);
-		int ballYPos = (int)(m_ball.yPosition * clientHeight);
-		int ballW = (int)(ballWidth * clientWidth);
-		int ballH = (int)(ballHeight * clientHeight);
-		
-		int ballCenterX = ballXPos - (int)(ballW / 2.0f);
-		int ballCenterY = ballYPos - (int)(ballH / 2.0f);
+		std::unique_lock<std::mutex> lock(m_matchMutex);
 
-		DrawRectangle(ballCenterX, ballCenterY, ballW, ballH, WHITE);
+		// Only one match fits on screen, Tab goes through them.
+		size_t matchCount = 0;
+		for (MatchShard &shard : m_shards)
+			matchCount += shard.matches.size();
+		std::string serverText = std::to_string(matchCount) + " matches, " + std::to_string(m_matchmaker.GetQueuedCount()) + " queued";
 
-		// Draw Players.
-		for (auto &[id, info] : m_players)
+		Match *match = FindMatch(m_watchedMatchId);
+		if (match)
 		{
-			int playerXPos = info.rightSide ? (int)((1.0f - paddleXOffset) * clientWidth) : (int)(paddleXOffset * clientWidth);
-			int playerYPos = (int)(info.yPosition * clientHeight);
-			int playerWidth = (int)(paddleWidth * clientWidth);
-			int playerHeight = (int)(paddleHeight * clientHeight);
-
-			int playerCenterX = playerXPos - (int)(playerWidth / 2.0f);
-			int playerCenterY = playerYPos - (int)(playerHeight / 2.0f);
+			const SimState &sim = match->GetSim();
+			serverText += ", watching match " + std::to_string(match->GetId());
+
+			// Draw Ball.
+			int ballXPos = (int)(SimToFloat(sim.ball.xPosition) * clientWidth);
+			int ballYPos = (int)(SimToFloat(sim.ball.yPosition) * clientHeight);
+			int ballW = (int)(ballWidth * clientWidth);
+			int ballH = (int)(ballHeight * clientHeight);
+			
+			int ballCenterX = ballXPos - (int)(ballW / 2.0f);
+			int ballCenterY = ballYPos - (int)(ballH / 2.0f);
+
+			DrawRectangle(ballCenterX, ballCenterY, ballW, ballH, WHITE);
+
+			// Draw Players.
+			for (auto &[id, info] : match->GetPlayers())
+			{
+				int playerXPos = info.rightSide ? (int)((1.0f - paddleXOffset) * clientWidth) : (int)(paddleXOffset * clientWidth);
+				int playerYPos = (int)(SimToFloat(sim.paddles[info.Side()].yPosition) * clientHeight);
+				int playerWidth = (int)(paddleWidth * clientWidth);
+				int playerHeight = (int)(paddleHeight * clientHeight);
 
-			Color color = info.rightSide ? RED : BLUE;
+				int playerCenterX = playerXPos - (int)(playerWidth / 2.0f);
+				int playerCenterY = playerYPos - (int)(playerHeight / 2.0f);
 
-			DrawRectangle(playerCenterX, playerCenterY, playerWidth, playerHeight, color);
+				Color color = info.rightSide ? RED : BLUE;
 
-			// Draw Score.
-			constexpr int screenHalf = clientWidth / 2;
-			constexpr int leftHalf = screenHalf / 2;
-			constexpr int rightHalf = screenHalf + leftHalf;
-			int scoreXPos = info.rightSide ? rightHalf : leftHalf;
+				DrawRectangle(playerCenterX, playerCenterY, playerWidth, playerHeight, color);
 
-			std::string scoreText = std::to_string(info.score);
-			DrawText(scoreText.c_str(), scoreXPos, (int)(clientHeight / 5.0f), 48, color);
+				// Draw Score.
+				constexpr int screenHalf = clientWidth / 2;
+				constexpr int leftHalf = screenHalf / 2;
+				constexpr int rightHalf = screenHalf + leftHalf;
+				int scoreXPos = info.rightSide ? rightHalf : leftHalf;
 
-			// Draw whether they're ready or not.
-			if (m_gameState.gameStarted == false)
-			{
-				std::string readyText = info.ready ? "Is Ready" : "Not Ready";
+				std::string scoreText = std::to_string(sim.paddles[info.Side()].score);
+				DrawText(scoreText.c_str(), scoreXPos, (int)(clientHeight / 5.0f), 48, color);
 
-				int textXPos = playerXPos + 12;
-				if (info.rightSide)
+				// Draw whether they're ready or not.
+				if (match->GetGameState().gameStarted == false)
 				{
-					int textWidth = MeasureText(readyText.c_str(), 24);
-					textXPos = playerXPos - textWidth - 12;
-				}
+					std::string readyText = info.ready ? "Is Ready" : "Not Ready";
 
-				int textYPos = playerYPos - playerHeight;
-				if (textYPos < 0)
-					textYPos = 0;
-				if (textYPos > clientHeight - 24)
-					textYPos = clientHeight - 24;
+					int textXPos = playerXPos + 12;
+					if (info.rightSide)
+					{
+						int textWidth = MeasureText(readyText.c_str(), 24);
+						textXPos = playerXPos - textWidth - 12;
+					}
 
-				DrawText(readyText.c_str(), textXPos, textYPos, 24, color);
+					int textYPos = playerYPos - playerHeight;
+					if (textYPos < 0)
+						textYPos = 0;
+					if (textYPos > clientHeight - 24)
+						textYPos = clientHeight - 24;
+
+					DrawText(readyText.c_str(), textXPos, textYPos, 24, color);
+				}
 			}
 		}
+		lock.unlock();
+
+		DrawText(serverText.c_str(), 4, 4, 10, GRAY);
 
 		m_textPool.Draw(); // Draw the text object pool.
+
+		// Draw link stats for each client.
+		if (m_showNetStats)
+		{
+			int textYPos = clientHeight - 16;
+			std::shared_lock<std::shared_mutex> lock(m_statsMutex);
+			for (auto &[id, stats] : m_connectionStats)
+			{
+				std::string statsText = std::to_string(id) + ": " + stats->GetStats().ToString();
+				DrawText(statsText.c_str(), 4, textYPos, 10, GREEN);
+				textYPos -= 12;
+			}
+		}
 	}
 
 private:
 	bool m_gameRunning = false;
 
-	GameState m_gameState;
+	std::mutex m_matchMutex; // Matches and the queue, players come and go on the network thread.
+	std::vector<MatchShard> m_shards;
+	int m_shardCount = defaultShardCount;
+
+	std::vector<std::thread> m_shardThreads; // One per shard after the first.
+	std::mutex m_stepMutex; // The step handshake between the tick and the shard threads.
+	std::condition_variable m_stepStart, m_stepDone;
+	uint64_t m_stepGeneration = 0;
+	int m_shardsStepping = 0;
+	double m_stepDeltaTime = 0.0;
+	bool m_shardsRunning = false;
+
+	bool m_migrationEnabled = true; // --no-migration turns it off.
+	double m_lastMigrationTime = 0.0;
+	MigrationStats m_migrationStats;
+	std::unordered_map<uint32, Match *> m_clientMatches; // Which match each player is in.
+	std::unordered_map<uint32, double> m_pendingClients; // Connected but not queued yet, with when they connected.
+	std::unordered_map<uint32, uint64_t> m_clientTokens; // Session token each connection was given.
+	std::unordered_map<uint64_t, HeldPlayer> m_heldPlayers; // By token.
+	std::unordered_map<uint32, uint32> m_spectators; // Match ID each is watching, may have closed since.
+	double m_reconnectGrace = defaultReconnectGrace; // --reconnect-grace, zero drops players straight away.
+	ReconnectStats m_reconnectStats;
+	Matchmaker m_matchmaker;
+	std::vector<MatchmakingPair> m_pairs; // Reused every tick.
+	BotBatch m_bots;
+	std::unordered_map<uint32, ServerBot> m_botPlayers; // By the bot's client ID, the same one it plays under.
+	uint32 m_nextBotId = botClientIdBase;
+	double m_botFillWait = 0.0; // --bot-fill, seconds alone before a bot joins them. Zero for no bots.
+	int m_botMatchCount = 0; // --bot-matches, bot against bot as a load to measure the server with.
+	std::vector<MatchmakingTicket> m_botFills; // Reused every tick.
+	std::unordered_map<uint32, double> m_loneMatches, m_lastLoneMatches; // Match ID to when it was left with one player.
+	BCNet::Packet m_botPacket;
+	BotStats m_botStats;
+	uint32 m_nextMatchId = 1;
+	uint32 m_watchedMatchId = 0; // Drawn in the window.
+
+	std::random_device m_seedSource; // Match seeds.
+	std::mutex m_seedMutex;
+	bool m_rollbackMode = false; // --rollback, clients simulate the match themselves.
 
-	std::unordered_map<uint32, PlayerInfo> m_players;
-	BallInfo m_ball;
-
-	float m_timer = 0.0f;
 	TextObjectPool m_textPool;
 
+	std::shared_mutex m_statsMutex; // Connections come and go on the network thread, every shard looks them up as it sends.
+	std::unordered_map<uint32, std::shared_ptr<ConnectionStats>> m_connectionStats;
+	bool m_showNetStats = false;
+
+	uint16_t m_workerPort = 0; // --worker-port, zero when clients connect to us directly.
+	WorkerLink m_workerLink;
+	ShmLink m_shmLink; // --link shm, in place of m_workerLink.
+	bool m_useShmLink = false;
+	std::thread m_workerLinkThread;
+	std::atomic<bool> m_workerLinkRunning = false;
+	std::atomic<uint16_t> m_gatewayPort = 0;
+	std::atomic<bool> m_workerLinkStopped = false; // LinkLoop() has returned.
+
+	std::string m_handoffPath; // --handoff, a Unix socket shared by this server and whichever binary replaces it.
+	HandoffSocket m_handoffListener;
+	HandoffSocket m_handoffConnection; // To the replacement, while handing over.
+	eHandoffState m_handoffState = HANDOFF_IDLE;
+	double m_resumedFrom = 0.0; // ClockNowSeconds() of the last server's last tick, if we took over from one.
+
 public:
-	Game() { }
-	~Game() { }
+	Game() { m_botPacket.Allocate(1024); }
+	~Game() { m_botPacket.Release(); }
 
 	static Game *Instance() { return s_instance; }
 
+	void SetRollbackMode(bool rollback) { m_rollbackMode = rollback; }
+	void SetShardCount(int count) { m_shardCount = count > 0 ? count : 1; }
+	void SetMigrationEnabled(bool enabled) { m_migrationEnabled = enabled; }
+	void SetReconnectGrace(double seconds) { m_reconnectGrace = seconds > 0.0 ? seconds : 0.0; }
+	void SetMatchmakingBucketing(eMatchmakingBucketing bucketing) { m_matchmaker.SetBucketing(bucketing); }
+	void SetBotFillWait(double seconds) { m_botFillWait = seconds > 0.0 ? seconds : 0.0; }
+	void SetBotMatchCount(int count) { m_botMatchCount = count > 0 ? count : 0; }
+	void SetBotReactionTime(double seconds) { m_bots.SetReactionTime((float)seconds); }
+	void SetBotError(double error) { m_bots.SetError((float)error); }
+	void SetWorkerPort(uint16_t port) { m_workerPort = port; }
+	void SetUseShmLink(bool useShm) { m_useShmLink = useShm; }
+	void SetHandoffPath(const std::string &path) { m_handoffPath = path; }
+	bool HasHandoffPath() const { return !m_handoffPath.empty(); }
+	bool IsWorker() const { return m_workerPort != 0; }
+
 private:
 	Game(const Game &game) = delete;
 
@@ -570,9 +1712,60 @@ private:
 Game *Game::s_instance = new Game(); // Make sure the singleton actually exists.
 
 // ------------------------- Entry point.
-int main()
+int main(int argc, char **argv)
 {
+	if (argc >= 4 && std::string(argv[1]) == "--sim-conformance") // Replay recorded inputs with this build's simulation and exit.
+		return RunSimConformance(argv[2], argv[3]);
+	if (argc >= 3 && std::string(argv[1]) == "--sim-golden") // Check this build's simulation against checked in hashes and exit.
+		return RunSimGoldenCheck(argv[2]);
+
 	Game *game = Game::Instance();
+	std::string logPath;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--rollback") // Clients simulate matches with rollback instead of following ours.
+			game->SetRollbackMode(true);
+		else if (arg == "--shards" && i + 1 < argc) // How many threads the matches are spread over.
+			game->SetShardCount(std::stoi(argv[++i]));
+		else if (arg == "--no-migration") // Matches stay on the shard they started on.
+			game->SetMigrationEnabled(false);
+		else if (arg == "--reconnect-grace" && i + 1 < argc) // Seconds a dropped player has to come back before their match resets, 0 for none.
+			game->SetReconnectGrace(std::stod(argv[++i]));
+		else if (arg == "--bot-fill" && i + 1 < argc) // Seconds a player waits alone before a bot plays them, none if not given.
+			game->SetBotFillWait(std::stod(argv[++i]));
+		else if (arg == "--bot-matches" && i + 1 < argc) // Bot against bot matches to start with, as a steady load.
+			game->SetBotMatchCount(std::stoi(argv[++i]));
+		else if (arg == "--bot-reaction" && i + 1 < argc) // Seconds behind the ball bots are.
+			game->SetBotReactionTime(std::stod(argv[++i]));
+		else if (arg == "--bot-error" && i + 1 < argc) // Furthest off bots aim, as a fraction of the court's height.
+			game->SetBotError(std::stod(argv[++i]));
+		else if (arg == "--match-by" && i + 1 < argc) // rtt (default), skill or none.
+		{
+			std::string by = argv[++i];
+			game->SetMatchmakingBucketing(by == "skill" ? MATCHMAKING_BY_SKILL : (by == "none" ? MATCHMAKING_BY_NOTHING : MATCHMAKING_BY_RTT));
+		}
+		else if (arg == "--worker-port" && i + 1 < argc) // Run behind Pong_Gateway, which talks to us on this port.
+			game->SetWorkerPort((uint16_t)std::stoi(argv[++i]));
+		else if (arg == "--link" && i + 1 < argc) // udp (default) or shm, how the gateway reaches us. Has to match its --link.
+			game->SetUseShmLink(std::string(argv[++i]) == "shm");
+		else if (arg == "--handoff" && i + 1 < argc) // Unix socket path. Start another with the same one and it takes over our matches.
+			game->SetHandoffPath(argv[++i]);
+		else if (arg == "--log" && i + 1 < argc) // File to log to instead of the console.
+			logPath = argv[++i];
+		else if (arg == "--log-rate" && i + 1 < argc) // Lines a second each kind of message is held to, 0 for no limit.
+			Logger::SetRateLimit(std::stod(argv[++i]));
+	}
+
+	if (!Logger::Start(logPath)) // Before anything can log, nothing on the tick writes to the console itself.
+	{
+		std::cout << "Couldn't open " << logPath << " to log to" << std::endl;
+		return 1;
+	}
+
+	if (!game->IsWorker() && game->HasHandoffPath()) // Clients' connections belong to BCNet's socket, there's nothing we could pass on.
+		PONG_LOG(SERVER_HANDOFF_NEEDS_WORKER);
 
 	g_server = BCNet::InitServer(); // Get networking server's interface.
 
@@ -581,13 +1774,26 @@ int main()
 	g_server->SetDisconnectedCallback([&](const BCNet::ClientInfo &clientInfo) { game->OnDisconnected(clientInfo); });
 	g_server->SetPacketReceivedCallback([&](const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet) { game->PacketReceived(clientInfo, packet); });
 
-	g_server->SetMaxClients(2);
+	g_server->SetMaxClients(maxClients);
+
+	if (game->IsWorker())
+	{
+		if (!game->Run()) // Clients come through the gateway, BCNet's server isn't started. Run() opens the link.
+		{
+			Logger::Stop();
+			return 1;
+		}
 
-	g_server->Start(); // Start the server.
+		game->StopWorkerLink();
+	}
+	else
+	{
+		g_server->Start(); // Start the server.
 
-	game->Run(); // Start the game.
+		game->Run(); // Start the game.
 
-	g_server->Stop(); // This doesn't get called immediately after because both the game class and the server have loops.
+		g_server->Stop(); // This doesn't get called immediately after because both the game class and the server have loops.
+	}
 
 	// Clean up.
 	if (g_server)
@@ -598,5 +1804,7 @@ int main()
 		delete game;
 	game = nullptr;
 
+	Logger::Stop(); // Writes out the rest.
+
 	return 0;
 }
@@ -0,0 +1,109 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#include <raylib.h>
+
+#include "AssetArchive.h"
+
+// Packs every sound under the assets folder into one archive the client can memory map.
+// With --decode the sounds are stored as PCM so the client skips decoding entirely, at the cost of a bigger file.
+
+constexpr const char *defaultAssetsPath = "./assets";
+constexpr const char *defaultArchivePath = "./assets/assets.pak";
+
+static bool PackFile(AssetArchiveWriter &writer, const std::string &assetsPath, const char *filePath, bool decode)
+{
+	std::string name = filePath + assetsPath.size() + 1; // Relative to the assets folder.
+	for (char &c : name)
+		if (c == '\\')
+			c = '/';
+
+	AssetArchiveEntry entry;
+	if (name.size() >= sizeof(entry.name))
+	{
+		std::cout << "  skipping " << name << ", name is too long" << std::endl;
+		return false;
+	}
+	std::strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+
+	if (decode)
+	{
+		Wave wave = LoadWave(filePath);
+		if (!IsWaveReady(wave))
+			return false;
+
+		entry.format = eAssetFormat::PCM;
+		entry.sampleRate = wave.sampleRate;
+		entry.sampleSize = wave.sampleSize;
+		entry.channels = wave.channels;
+		entry.frameCount = wave.frameCount;
+		uint64_t size = (uint64_t)wave.frameCount * wave.channels * (wave.sampleSize / 8);
+		writer.Add(entry, wave.data, size);
+
+		std::cout << "  " << name << " (pcm, " << size << " bytes)" << std::endl;
+		UnloadWave(wave);
+		return true;
+	}
+
+	unsigned int size = 0;
+	unsigned char *data = LoadFileData(filePath, &size);
+	if (!data)
+		return false;
+
+	entry.format = eAssetFormat::ENCODED;
+	std::strncpy(entry.fileType, GetFileExtension(filePath), sizeof(entry.fileType) - 1);
+	writer.Add(entry, data, size);
+
+	std::cout << "  " << name << " (" << entry.fileType << ", " << size << " bytes)" << std::endl;
+	UnloadFileData(data);
+	return true;
+}
+
+int RunAssetPacker(int argc, char **argv)
+{
+	std::string assetsPath = defaultAssetsPath;
+	std::string archivePath = defaultArchivePath;
+	bool decode = false;
+
+	for (int i = 0; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--assets" && i + 1 < argc)
+			assetsPath = argv[++i];
+		else if (arg == "--out" && i + 1 < argc)
+			archivePath = argv[++i];
+		else if (arg == "--decode")
+			decode = true;
+		else
+		{
+			std::cout << "Usage: Pong_Tools pack [--assets <dir>] [--out <file>] [--decode]" << std::endl;
+			return 1;
+		}
+	}
+
+	SetTraceLogLevel(LOG_WARNING); // raylib's loaders are chatty.
+
+	FilePathList files = LoadDirectoryFilesEx(assetsPath.c_str(), ".ogg;.wav;.mp3", true);
+	std::cout << "Packing " << files.count << " sounds from " << assetsPath << std::endl;
+
+	AssetArchiveWriter writer;
+	int failed = 0;
+	for (unsigned int i = 0; i < files.count; i++)
+	{
+		if (!PackFile(writer, assetsPath, files.paths[i], decode))
+			failed++;
+	}
+	UnloadDirectoryFiles(files);
+
+	if (!writer.Write(archivePath))
+	{
+		std::cout << "Failed to write " << archivePath << std::endl;
+		return 1;
+	}
+
+	std::cout << "Wrote " << archivePath << (failed ? ", some files failed to pack" : "") << std::endl;
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <filesystem>
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "Simulation.h"
+#include "BotBatch.h"
+#include "../../Pong_Server/src/Match.h"
+
+// Bot against bot matches with nothing else in the way, the same BotBatch the server's bots use.
+// Every match and bot is seeded from its index, so the same options always play the same games out to the same final
+// hash, which makes it a load that can be compared run to run. Reports what thinking costs against the server's whole
+// match update, stepping, events, packets and the replays it records, and how long rallies last as a measure of how good
+// the bots are at those settings.
+
+constexpr uint32_t defaultBotBenchMatches = 1000;
+constexpr double defaultBotBenchSeconds = 60.0;
+constexpr const char *botBenchDirectory = "pong_bot_bench"; // Under the temp directory, the matches' replays go here.
+
+// Stands in for the server. Nobody's connected so packets go nowhere, they're only looked at to count the play.
+class BotBenchHost : public IMatchHost
+{
+public:
+	void SendToClient(uint32 id, const BCNet::Packet packet) override
+	{
+		if (id % 2 != 0) // Both players get the same packets, count the left one's.
+			return;
+
+		BCNet::PacketStreamReader reader(packet);
+		int packetID;
+		reader >> packetID;
+		hits += packetID == (int)PongPackets::PONG_PLAYER_HIT;
+		goals += packetID == (int)PongPackets::PONG_PLAYER_SCORE;
+	}
+	uint64_t NewMatchSeed() override { return ++m_seeds; }
+	void OnCountdown(const Match &match, const std::string &text) override { }
+
+	uint64_t hits = 0;
+	uint64_t goals = 0;
+
+private:
+	uint64_t m_seeds = 0;
+
+};
+
+// How the server's bots play, see UpdateBots() there: inputs go in as the packets a remote player sends, when they change.
+static void SendBotPacket(BCNet::Packet &buffer, Match &match, uint32 id, PongPackets type, bool value)
+{
+	BCNet::PacketStreamWriter writer(buffer);
+	writer << type << value;
+
+	BCNet::PacketStreamReader reader(writer.GetPacket());
+	int packetID;
+	reader >> packetID;
+	match.PacketReceived(id, packetID, reader, writer.GetPacket());
+}
+
+int RunBotBench(int argc, char **argv)
+{
+	uint32_t matchCount = defaultBotBenchMatches;
+	double seconds = defaultBotBenchSeconds;
+	BotBatch bots;
+	for (int i = 0; i < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--matches" && i + 1 < argc)
+			matchCount = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--seconds" && i + 1 < argc) // Of match time, not how long it takes to run.
+			seconds = std::stod(argv[i + 1]);
+		else if (arg == "--reaction" && i + 1 < argc)
+			bots.SetReactionTime(std::stof(argv[i + 1]));
+		else if (arg == "--error" && i + 1 < argc)
+			bots.SetError(std::stof(argv[i + 1]));
+		else
+		{
+			std::cout << "Usage: Pong_Tools bots [--matches <n>] [--seconds <match seconds>] [--reaction <seconds>] [--error <fraction>]" << std::endl;
+			return 1;
+		}
+	}
+	if (matchCount == 0)
+		return 1;
+
+	// Matches record replays into the working directory like the server's, somewhere they can be cleared away after.
+	std::error_code error;
+	std::filesystem::path previousDirectory = std::filesystem::current_path();
+	std::filesystem::path directory = std::filesystem::temp_directory_path(error) / botBenchDirectory;
+	std::filesystem::create_directories(directory, error);
+	std::filesystem::current_path(directory, error);
+	if (error)
+	{
+		std::cout << "Couldn't work in " << directory.string() << std::endl;
+		return 1;
+	}
+
+	// Bot 2 * i plays the left of match i, 2 * i + 1 the right.
+	BotBenchHost host;
+	std::vector<std::unique_ptr<Match>> matches(matchCount);
+	for (uint32_t i = 0; i < matchCount; i++)
+	{
+		matches[i] = std::make_unique<Match>(i + 1, host, false);
+		matches[i]->AddPlayer(2 * i);
+		matches[i]->AddPlayer(2 * i + 1);
+		bots.Add(2 * i, SIM_LEFT, 2 * i);
+		bots.Add(2 * i + 1, SIM_RIGHT, 2 * i + 1);
+	}
+
+	BCNet::Packet botPacket;
+	botPacket.Allocate(64);
+
+	LatencyHistogram think, decide, update; // Nanoseconds per tick, every match. Deciding is the part of thinking in BotBatch.
+	uint32_t ticks = (uint32_t)(seconds * simTickRate);
+	for (uint32_t tick = 0; tick < ticks; tick++)
+	{
+		int64_t start = ClockNowNanoseconds();
+		for (size_t i = 0; i < bots.GetCount(); i++)
+		{
+			const Match &match = *matches[i / 2];
+			const SimState &sim = match.GetSim();
+
+			BotObservation observation;
+			observation.ballX = SimToFloat(sim.ball.xPosition);
+			observation.ballY = SimToFloat(sim.ball.yPosition);
+			observation.ballXVelocity = SimToFloat(sim.ball.xVelocity);
+			observation.ballYVelocity = SimToFloat(sim.ball.yVelocity);
+			observation.paddleY = SimToFloat(sim.paddles[match.GetPlayers().at(bots.GetId(i)).Side()].yPosition);
+			observation.playing = sim.playing;
+			bots.Observe(i, observation);
+		}
+		bots.Think();
+		int64_t decided = ClockNowNanoseconds();
+
+		for (size_t i = 0; i < bots.GetCount(); i++)
+		{
+			uint32 id = bots.GetId(i);
+			Match &match = *matches[i / 2];
+			const PlayerInfo &info = match.GetPlayers().at(id);
+
+			uint8_t input = bots.GetInput(i);
+			bool up = (input & SIM_INPUT_UP) != 0, down = (input & SIM_INPUT_DOWN) != 0;
+			if (up != info.movingUp)
+				SendBotPacket(botPacket, match, id, PongPackets::PONG_PLAYER_MOVING_UP, up);
+			if (down != info.movingDown)
+				SendBotPacket(botPacket, match, id, PongPackets::PONG_PLAYER_MOVING_DOWN, down);
+			if (!info.ready && !match.GetGameState().gameStarted)
+				SendBotPacket(botPacket, match, id, PongPackets::PONG_PLAYER_READY, true);
+		}
+		int64_t thought = ClockNowNanoseconds();
+
+		for (std::unique_ptr<Match> &match : matches)
+			match->Update(simTickTime);
+		int64_t updated = ClockNowNanoseconds();
+
+		think.Record(thought - start);
+		decide.Record(decided - start);
+		update.Record(updated - thought);
+	}
+
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (const std::unique_ptr<Match> &match : matches)
+		hash = (hash ^ SimHash(match->GetSim())) * 0x100000001B3ULL;
+
+	matches.clear(); // Finishes the replays off before they're cleared away.
+	botPacket.Release();
+	std::filesystem::current_path(previousDirectory, error);
+	std::filesystem::remove_all(directory, error);
+
+	double thinkCost = (double)think.Percentile(50.0), updateCost = (double)update.Percentile(50.0);
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << matchCount << " matches, " << bots.GetCount() << " bots, " << ticks << " ticks, reaction " << bots.GetReactionTime()
+		<< "s, error " << bots.GetError() << std::endl;
+	std::cout << "  bots:    p50 " << std::setw(9) << thinkCost / 1000.0 << "us p99 " << std::setw(9) << think.Percentile(99.0) / 1000.0
+		<< "us a tick, " << thinkCost / bots.GetCount() << "ns a bot, observing, deciding and sending their inputs" << std::endl;
+	std::cout << "  deciding: p50 " << std::setw(8) << decide.Percentile(50.0) / 1000.0 << "us of it, " << decide.Percentile(50.0) / bots.GetCount()
+		<< "ns a bot, BotBatch's own share" << std::endl;
+	std::cout << "  matches: p50 " << std::setw(9) << updateCost / 1000.0 << "us p99 " << std::setw(9) << update.Percentile(99.0) / 1000.0
+		<< "us a tick, " << updateCost / matchCount << "ns a match, Match::Update" << std::endl;
+	std::cout << "  bots are " << (thinkCost + updateCost > 0.0 ? thinkCost / (thinkCost + updateCost) * 100.0 : 0.0) << "% of the tick" << std::endl;
+	std::cout << "  " << host.hits << " hits, " << host.goals << " goals, " << (host.goals ? (double)host.hits / host.goals : (double)host.hits)
+		<< " hits a point" << std::endl;
+	std::cout << "  final hash " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << std::setfill(' ') << std::endl;
+	std::cout << std::defaultfloat;
+	return 0;
+}
@@ -0,0 +1,266 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
+
+#include <BCNet/IBCNetServer.h>
+#include <BCNet/IBCNetClient.h>
+#include <BCNet/BCNetPacket.h>
+
+#include "shared.h"
+#include "Clock.h"
+#include "LatencyHistogram.h"
+
+// Follows a paddle input the same way the game does:
+// client A SendPacketToServer -> server PacketReceived -> SendPacketToAllClients(..., exclude) -> client B PacketReceived -> client B's next Draw.
+// Everything runs in this process so all the timestamps come from the same clock.
+
+struct ProbeSample
+{
+	int64_t pressed = 0; // When the key was physically pressed, somewhere within the sender's previous frame.
+	int64_t sent = 0; // Sender polled input and called SendPacketToServer.
+	int64_t serverReceived = 0; // Server's PacketReceived callback.
+	int64_t serverForwarded = 0; // Server is about to SendPacketToAllClients.
+	int64_t peerReceived = 0; // Peer's PacketReceived callback.
+	int64_t displayed = 0; // Peer's next Draw after receiving it.
+};
+
+enum class eProbeStage
+{
+	INPUT_SAMPLING = 0, // Key press waits for the sender's next frame.
+	CLIENT_TO_SERVER, // Client send, network, server poll.
+	SERVER_RELAY, // Server handling before it forwards.
+	SERVER_TO_PEER, // Server send, network, peer poll.
+	PEER_FRAME, // Peer waits for its next Draw.
+	TOTAL,
+	STAGES_MAX
+};
+
+static const char *s_stageNames[(int)eProbeStage::STAGES_MAX] = {
+	"input sampling (sender frame)",
+	"client -> server",
+	"server relay",
+	"server -> peer",
+	"peer frame pacing",
+	"total",
+};
+
+struct HeadlessClient
+{
+	BCNet::IBCNetClient *netClient = nullptr;
+	std::atomic<bool> connected = false;
+
+	std::mutex receivedMutex;
+	std::vector<ProbeSample> received; // Probes received since the last frame, network thread -> frame loop.
+};
+
+static bool WaitFor(const std::atomic<bool> &flag, double timeout)
+{
+	double start = ClockNowSeconds();
+	while (!flag)
+	{
+		if (ClockNowSeconds() - start > timeout)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+static void PrintStage(const char *name, const LatencyHistogram &histogram)
+{
+	std::cout << std::left << std::setw(32) << name << std::right
+		<< std::setw(10) << histogram.Percentile(50.0) / 1000
+		<< std::setw(10) << histogram.Percentile(99.0) / 1000
+		<< std::setw(10) << histogram.Percentile(99.9) / 1000
+		<< std::setw(10) << histogram.Max() / 1000 << std::endl;
+}
+
+int RunLatencyBench(int argc, char **argv)
+{
+	// Options.
+	int port = -1; // Same as the client's connection menu, no port will just use the default.
+	int sampleCount = 2000;
+	int framesPerSecond = 60;
+	int frameInterval = 2; // Frames between each probe, so probes don't queue up behind each other.
+
+	for (int i = 0; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--port" && i + 1 < argc) port = std::stoi(argv[++i]);
+		else if (arg == "--samples" && i + 1 < argc) sampleCount = std::stoi(argv[++i]);
+		else if (arg == "--fps" && i + 1 < argc) framesPerSecond = std::stoi(argv[++i]);
+		else if (arg == "--interval" && i + 1 < argc) frameInterval = std::stoi(argv[++i]);
+		else
+		{
+			std::cout << "Usage: Pong_Tools latency [--port N] [--samples N] [--fps N] [--interval frames]" << std::endl;
+			return 1;
+		}
+	}
+	if (framesPerSecond < 1) framesPerSecond = 1;
+	if (frameInterval < 1) frameInterval = 1;
+
+	// Server, relays probes exactly like Pong_Server relays paddle input.
+	BCNet::IBCNetServer *server = BCNet::InitServer();
+	std::atomic<int> serverConnections = 0;
+	server->SetConnectedCallback([&](const BCNet::ClientInfo &clientInfo) { serverConnections++; });
+	server->SetDisconnectedCallback([&](const BCNet::ClientInfo &clientInfo) { serverConnections--; });
+	server->SetPacketReceivedCallback([&](const BCNet::ClientInfo &clientInfo, const BCNet::Packet packet)
+	{
+		int64_t received = ClockNowNanoseconds();
+
+		BCNet::PacketStreamReader reader(packet);
+		int packetID;
+		reader >> packetID;
+		if (packetID != (int)PongPackets::PONG_LATENCY_PROBE)
+			return;
+
+		int64_t pressed, sent;
+		reader >> pressed >> sent;
+
+		BCNet::Packet relay;
+		relay.Allocate(1024);
+		BCNet::PacketStreamWriter writer(relay);
+		writer << PongPackets::PONG_LATENCY_PROBE << pressed << sent << received << ClockNowNanoseconds();
+		server->SendPacketToAllClients(writer.GetPacket(), clientInfo.id);
+		relay.Release();
+	});
+	server->SetMaxClients(2);
+	server->Start();
+
+	// Two headless clients, A sends input and B displays it.
+	HeadlessClient clients[2];
+	for (HeadlessClient &client : clients)
+	{
+		HeadlessClient *self = &client;
+		client.netClient = BCNet::InitClient();
+		client.netClient->SetConnectedCallback([self]() { self->connected = true; });
+		client.netClient->SetDisconnectedCallback([self]() { self->connected = false; });
+		client.netClient->SetPacketReceivedCallback([self](const BCNet::Packet packet)
+		{
+			int64_t received = ClockNowNanoseconds();
+
+			BCNet::PacketStreamReader reader(packet);
+			int packetID;
+			reader >> packetID;
+			if (packetID != (int)PongPackets::PONG_LATENCY_PROBE)
+				return;
+
+			ProbeSample sample;
+			reader >> sample.pressed >> sample.sent >> sample.serverReceived >> sample.serverForwarded;
+			sample.peerReceived = received;
+
+			std::lock_guard<std::mutex> lock(self->receivedMutex);
+			self->received.push_back(sample);
+		});
+		client.netClient->Start();
+	}
+
+	// Connect one at a time so A is always the first player.
+	std::string connectCommand("/connect 127.0.0.1 " + std::to_string(port));
+	bool connected = true;
+	for (HeadlessClient &client : clients)
+	{
+		client.netClient->PushInputAsCommand(connectCommand);
+		connected = connected && WaitFor(client.connected, 10.0);
+	}
+
+	int exitCode = 0;
+	if (!connected)
+	{
+		std::cout << "Couldn't connect both clients to the server." << std::endl;
+		exitCode = 1;
+	}
+	else
+	{
+		HeadlessClient &sender = clients[0];
+		HeadlessClient &peer = clients[1];
+
+		LatencyHistogram stages[(int)eProbeStage::STAGES_MAX];
+		std::vector<ProbeSample> frameSamples;
+		std::mt19937 random(12345); // Fixed seed so runs are comparable.
+
+		const int64_t frameTime = 1000000000LL / framesPerSecond;
+		std::uniform_int_distribution<int64_t> pressOffset(0, frameTime - 1);
+
+		int sent = 0;
+		int displayed = 0;
+		int64_t frame = 0;
+		int64_t nextFrame = ClockNowNanoseconds();
+		int64_t deadline = nextFrame + (int64_t)((sampleCount + 1) * frameInterval + 10 * framesPerSecond) * frameTime;
+
+		// Frame loop, paced like SetTargetFPS().
+		while (displayed < sampleCount && ClockNowNanoseconds() < deadline)
+		{
+			std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(nextFrame)));
+			nextFrame += frameTime;
+
+			// Peer's Draw, anything received since the last frame is now on screen.
+			int64_t drawTime = ClockNowNanoseconds();
+			{
+				std::lock_guard<std::mutex> lock(peer.receivedMutex);
+				frameSamples.swap(peer.received);
+			}
+			for (ProbeSample &sample : frameSamples)
+			{
+				sample.displayed = drawTime;
+
+				stages[(int)eProbeStage::INPUT_SAMPLING].Record(sample.sent - sample.pressed);
+				stages[(int)eProbeStage::CLIENT_TO_SERVER].Record(sample.serverReceived - sample.sent);
+				stages[(int)eProbeStage::SERVER_RELAY].Record(sample.serverForwarded - sample.serverReceived);
+				stages[(int)eProbeStage::SERVER_TO_PEER].Record(sample.peerReceived - sample.serverForwarded);
+				stages[(int)eProbeStage::PEER_FRAME].Record(sample.displayed - sample.peerReceived);
+				stages[(int)eProbeStage::TOTAL].Record(sample.displayed - sample.pressed);
+				displayed++;
+			}
+			frameSamples.clear();
+
+			// Sender's Update, the key was pressed at some point during the last frame and is only seen now.
+			if (sent < sampleCount && (frame % frameInterval) == 0)
+			{
+				int64_t now = ClockNowNanoseconds();
+				int64_t pressed = now - pressOffset(random);
+
+				BCNet::Packet packet;
+				packet.Allocate(1024);
+				BCNet::PacketStreamWriter writer(packet);
+				writer << PongPackets::PONG_LATENCY_PROBE << pressed << now;
+				sender.netClient->SendPacketToServer(writer.GetPacket());
+				packet.Release();
+
+				sent++;
+			}
+
+			frame++;
+		}
+
+		// Report.
+		std::cout << "Probes sent: " << sent << ", displayed: " << displayed << " (" << framesPerSecond << " fps)" << std::endl;
+		std::cout << std::left << std::setw(32) << "stage (us)" << std::right
+			<< std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p999" << std::setw(10) << "max" << std::endl;
+		for (int i = 0; i < (int)eProbeStage::STAGES_MAX; i++)
+			PrintStage(s_stageNames[i], stages[i]);
+
+		if (displayed < sent)
+			std::cout << (sent - displayed) << " probes were lost or timed out." << std::endl;
+	}
+
+	// Clean up.
+	for (HeadlessClient &client : clients)
+	{
+		client.netClient->Stop();
+		delete client.netClient;
+		client.netClient = nullptr;
+	}
+
+	server->Stop();
+	delete server;
+	server = nullptr;
+
+	return exitCode;
+}
@@ -0,0 +1,195 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "WorkerLink.h"
+#include "ShmLink.h"
+
+// Gateway <-> worker transports against each other, both ends in this process but each with its own socket or mapping
+// like they'd have in two.
+//   stream:    one thread sends paddle input sized messages as fast as it can, the other receives them.
+//   pingpong:  one message at a time there and back, so every message has to wake the other side.
+// CPU is the whole process's user and system time, both ends included.
+
+constexpr uint32_t defaultStreamMessages = 1000000;
+constexpr uint32_t defaultPingPongs = 50000;
+constexpr size_t benchPayloadSize = 24; // A packet ID and a few fields, what most game packets are.
+constexpr uint16_t benchShmPort = 47999; // Only names the region, nothing listens on it.
+
+static double ProcessCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+	auto seconds = [](const FILETIME &time) { return (double)(((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) / 1e7; };
+	return seconds(kernel) + seconds(user);
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+// Both transports look the same from here, one end each way.
+struct BenchEnds
+{
+	const char *name;
+	std::function<bool(const void *, size_t)> sendToWorker;
+	std::function<bool(WorkerMessage &, double)> workerReceive;
+	std::function<bool(const void *, size_t)> sendToGateway;
+	std::function<bool(WorkerMessage &, double)> gatewayReceive;
+};
+
+static void RunStream(BenchEnds &ends, uint32_t messages)
+{
+	std::atomic<bool> sending = true;
+	uint64_t received = 0;
+
+	double cpuStart = ProcessCpuSeconds();
+	int64_t start = ClockNowNanoseconds();
+
+	std::thread receiver([&]()
+	{
+		WorkerMessage message;
+		while (received < messages)
+		{
+			if (ends.workerReceive(message, 0.2))
+				received++;
+			else if (!sending) // UDP can drop when the socket buffer fills, stop once it's gone quiet.
+				break;
+		}
+	});
+
+	uint8_t payload[benchPayloadSize] = {};
+	uint64_t retries = 0;
+	for (uint32_t i = 0; i < messages; i++)
+	{
+		std::memcpy(payload, &i, sizeof(i));
+		while (!ends.sendToWorker(payload, sizeof(payload))) // Full, let the receiver catch up.
+		{
+			retries++;
+			std::this_thread::yield();
+		}
+	}
+	sending = false;
+	receiver.join();
+
+	double seconds = (ClockNowNanoseconds() - start) / 1e9;
+	double cpu = ProcessCpuSeconds() - cpuStart;
+
+	std::cout << "  stream:   " << std::setw(6) << received / seconds / 1e6 << "M messages/s, " << std::setw(6) << cpu / received * 1e9 << "ns CPU each, "
+		<< (messages - received) << " lost, " << retries << " full" << std::endl;
+}
+
+static void RunPingPong(BenchEnds &ends, uint32_t roundTrips)
+{
+	std::atomic<bool> running = true;
+	LatencyHistogram roundTrip;
+
+	std::thread worker([&]()
+	{
+		WorkerMessage message;
+		while (running)
+			if (ends.workerReceive(message, 0.1))
+				ends.sendToGateway(message.payload, message.size);
+	});
+
+	double cpuStart = ProcessCpuSeconds();
+	uint32_t completed = 0;
+	WorkerMessage message;
+	for (uint32_t i = 0; i < roundTrips; i++)
+	{
+		int64_t sent = ClockNowNanoseconds();
+		uint8_t payload[benchPayloadSize] = {};
+		if (!ends.sendToWorker(payload, sizeof(payload)) || !ends.gatewayReceive(message, 1.0))
+			continue;
+		roundTrip.Record(ClockNowNanoseconds() - sent);
+		completed++;
+	}
+	double cpu = ProcessCpuSeconds() - cpuStart;
+
+	running = false;
+	worker.join();
+
+	std::cout << "  pingpong: p50 " << std::setw(6) << roundTrip.Percentile(50.0) / 1000.0 << "us, p99 " << std::setw(6) << roundTrip.Percentile(99.0) / 1000.0
+		<< "us, " << std::setw(6) << (completed ? cpu / completed * 1e9 : 0.0) << "ns CPU per round trip" << std::endl;
+}
+
+int RunLinkBench(int argc, char **argv)
+{
+	uint32_t messages = defaultStreamMessages;
+	uint32_t roundTrips = defaultPingPongs;
+	for (int i = 0; i < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--messages" && i + 1 < argc)
+			messages = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--roundtrips" && i + 1 < argc)
+			roundTrips = (uint32_t)std::stoul(argv[i + 1]);
+		else
+		{
+			std::cout << "Usage: Pong_Tools link [--messages <n>] [--roundtrips <n>]" << std::endl;
+			return 1;
+		}
+	}
+
+	WorkerLink gatewaySocket, workerSocket;
+	if (!gatewaySocket.Open(0) || !workerSocket.Open(0))
+	{
+		std::cout << "Couldn't open loopback sockets" << std::endl;
+		return 1;
+	}
+	uint16_t gatewayPort = gatewaySocket.GetPort(), workerPort = workerSocket.GetPort();
+
+	ShmLink workerShm, gatewayShm;
+	if (!workerShm.Open(benchShmPort, SHM_LINK_WORKER) || !gatewayShm.Open(benchShmPort, SHM_LINK_GATEWAY))
+	{
+		std::cout << "Couldn't create the shared memory link" << std::endl;
+		return 1;
+	}
+
+	BenchEnds transports[] = {
+		{
+			"loopback UDP",
+			[&](const void *payload, size_t size) { return gatewaySocket.Send(workerPort, WORKER_CLIENT_PACKET, 1, payload, size); },
+			[&](WorkerMessage &message, double timeout) { return workerSocket.Receive(message, timeout); },
+			[&](const void *payload, size_t size) { return workerSocket.Send(gatewayPort, WORKER_CLIENT_PACKET, 1, payload, size); },
+			[&](WorkerMessage &message, double timeout) { return gatewaySocket.Receive(message, timeout); },
+		},
+		{
+			"shared memory",
+			[&](const void *payload, size_t size) { return gatewayShm.Send(WORKER_CLIENT_PACKET, 1, payload, size); },
+			[&](WorkerMessage &message, double timeout) { return workerShm.Receive(message, timeout); },
+			[&](const void *payload, size_t size) { return workerShm.Send(WORKER_CLIENT_PACKET, 1, payload, size); },
+			[&](WorkerMessage &message, double timeout) { return gatewayShm.Receive(message, timeout); },
+		},
+	};
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << messages << " messages streamed, " << roundTrips << " round trips, " << benchPayloadSize << " byte payloads, "
+		<< std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	for (BenchEnds &ends : transports)
+	{
+		std::cout << ends.name << std::endl;
+		RunStream(ends, messages);
+		RunPingPong(ends, roundTrips);
+	}
+	std::cout << std::defaultfloat;
+	return 0;
+}
@@ -0,0 +1,134 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+// What a log line costs the thread that writes it, the way the server used to and through Logger.
+// Every thread stands in for a shard logging its matches' countdowns as fast as it can, both ways write the same lines
+// to the same file.
+//   flushed: a shared stream, locked, with std::endl after each line, what std::cout << ... << std::endl does.
+//   logger:  PONG_LOG, formatted and written on the logger's thread. Lines its rings had no room for are dropped and
+//            counted, that's the logger choosing not to block, not lost time. A dropped line costs next to nothing, so
+//            its timings only mean something next to how many were dropped.
+
+constexpr int defaultLogBenchThreads = 4;
+constexpr uint32_t defaultLogBenchLines = 2000; // Per thread, about what a ring holds at ~26 bytes a line so none are dropped.
+constexpr const char *defaultLogBenchPath = "./pong_log_bench.txt";
+
+// Runs line(thread, index) on every thread and times each call.
+template<typename Function>
+static LatencyHistogram TimeLines(int threadCount, uint32_t lines, double &seconds, Function line)
+{
+	std::vector<LatencyHistogram> histograms(threadCount);
+	std::vector<std::thread> threads;
+
+	double start = ClockNowSeconds();
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (uint32_t i = 0; i < lines; i++)
+			{
+				int64_t before = ClockNowNanoseconds();
+				line(t, i);
+				histograms[t].Record(ClockNowNanoseconds() - before);
+			}
+		});
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	seconds = ClockNowSeconds() - start;
+
+	LatencyHistogram merged;
+	for (const LatencyHistogram &histogram : histograms)
+		merged.Merge(histogram);
+	return merged;
+}
+
+static void PrintCost(const char *name, const LatencyHistogram &histogram, double seconds, const std::string &note = "")
+{
+	std::cout << "  " << std::left << std::setw(9) << name << std::right << "p50 " << std::setw(9) << histogram.Percentile(50.0) << "ns p99 "
+		<< std::setw(9) << histogram.Percentile(99.0) << "ns p999 " << std::setw(9) << histogram.Percentile(99.9) << "ns max "
+		<< std::setw(11) << histogram.Max() << "ns, " << histogram.Count() / seconds << " lines/s" << note << std::endl;
+}
+
+int RunLogBench(int argc, char **argv)
+{
+	int threadCount = defaultLogBenchThreads;
+	uint32_t lines = defaultLogBenchLines;
+	std::string path = defaultLogBenchPath;
+	double rate = 0.0; // Off, every line should reach the file unless a ring fills.
+	for (int i = 0; i < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc)
+			threadCount = std::stoi(argv[i + 1]);
+		else if (arg == "--lines" && i + 1 < argc) // Per thread.
+			lines = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--path" && i + 1 < argc)
+			path = argv[i + 1];
+		else if (arg == "--rate" && i + 1 < argc) // The logger's per format limit, lines a second.
+			rate = std::stod(argv[i + 1]);
+		else
+		{
+			std::cout << "Usage: Pong_Tools log [--threads <n>] [--lines <n per thread>] [--path <file>] [--rate <lines a second>]" << std::endl;
+			return 1;
+		}
+	}
+	if (threadCount <= 0 || lines == 0)
+		return 1;
+
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Couldn't open " << path << std::endl;
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << threadCount << " threads, " << lines << " lines each, to " << path << std::endl;
+
+	double flushedSeconds;
+	std::mutex fileMutex;
+	LatencyHistogram flushed = TimeLines(threadCount, lines, flushedSeconds, [&](int thread, uint32_t)
+	{
+		std::lock_guard<std::mutex> lock(fileMutex);
+		file << "Match " << thread << " counting down, " << "GO!" << std::endl;
+	});
+	file.close();
+	PrintCost("flushed", flushed, flushedSeconds);
+
+	Logger::SetRateLimit(rate);
+	if (!Logger::Start(path))
+	{
+		std::cout << "Couldn't open " << path << std::endl;
+		return 1;
+	}
+	double loggerSeconds;
+	LatencyHistogram logged = TimeLines(threadCount, lines, loggerSeconds, [](int thread, uint32_t)
+	{
+		PONG_LOG(MATCH_COUNTDOWN, thread, "GO!");
+	});
+	double stopStart = ClockNowSeconds();
+	Logger::Stop();
+	double drainSeconds = ClockNowSeconds() - stopStart;
+
+	LoggerStats stats = Logger::GetStats();
+	std::ostringstream dropRate;
+	dropRate << std::fixed << std::setprecision(1) << ", " << 100.0 * (double)stats.dropped / ((double)threadCount * lines) << "% dropped";
+	PrintCost("logger", logged, loggerSeconds, dropRate.str());
+	std::cout << "  logger wrote " << stats.written << ", dropped " << stats.dropped << ", held back " << stats.suppressed
+		<< ", took " << std::setprecision(1) << drainSeconds * 1000.0 << "ms to write out the rest" << std::endl;
+	std::cout << std::defaultfloat;
+	return 0;
+}
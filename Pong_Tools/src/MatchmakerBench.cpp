@@ -0,0 +1,157 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "Matchmaker.h"
+
+// Matchmaking queue throughput, no networking involved.
+//   burst:  everyone queues at once and is paired in one go.
+//   steady: players arrive faster than matches can be made for them, some leave while they wait, and Pair runs every
+//           tick with a cap on how many matches it can start. Once the queue reaches --queue arrivals drop to what's
+//           paired, so it stays about there.
+// Each tick's queue work is timed, it has to stay well inside a 60Hz tick however long the queue is.
+
+constexpr uint32_t defaultBenchQueue = 50000;
+constexpr uint32_t benchArrivalsPerTick = 300; // Until the queue is full.
+constexpr uint32_t benchPairsPerTick = 100; // Matches the server can start in one tick.
+constexpr double benchLeaveChance = 0.02;
+constexpr double benchTickTime = 1.0 / 60.0;
+constexpr uint32_t benchSteadyTicks = 60 * 30; // Ticks measured once the queue is full.
+
+static MatchmakingTicket RandomTicket(uint32_t id, std::mt19937 &random)
+{
+	// Most players are close by, with a long tail.
+	std::lognormal_distribution<double> rtt(-3.0, 0.6);
+	std::normal_distribution<double> skill(800.0, 250.0);
+
+	MatchmakingTicket ticket;
+	ticket.playerId = id;
+	ticket.rtt = rtt(random);
+	ticket.skill = (int)skill(random);
+	return ticket;
+}
+
+static void PrintWaits(const Matchmaker &matchmaker)
+{
+	const MatchmakingStats &stats = matchmaker.GetStats();
+	uint64_t paired = stats.pairsMade * 2;
+	std::cout << "  waited " << (paired ? stats.totalWait / paired : 0.0) << "s on average, " << stats.longestWait << "s at most" << std::endl;
+}
+
+static void RunBurst(uint32_t players, eMatchmakingBucketing bucketing)
+{
+	Matchmaker matchmaker;
+	matchmaker.SetBucketing(bucketing);
+	std::mt19937 random(1);
+
+	std::vector<MatchmakingTicket> tickets;
+	tickets.reserve(players);
+	for (uint32_t i = 0; i < players; i++)
+		tickets.push_back(RandomTicket(i + 1, random));
+
+	double start = ClockNowSeconds();
+	for (const MatchmakingTicket &ticket : tickets)
+		matchmaker.Enqueue(ticket, 0.0);
+	double queued = ClockNowSeconds();
+
+	// Long enough after that anyone left over can widen as far as they need to.
+	std::vector<MatchmakingPair> pairs;
+	pairs.reserve(players / 2);
+	size_t made = matchmaker.Pair(matchmakingWidenTime * matchmakingBucketCount, pairs);
+	double paired = ClockNowSeconds();
+
+	std::cout << "Burst, " << players << " players" << std::endl;
+	std::cout << "  queued in " << (queued - start) * 1000.0 << "ms (" << players / (queued - start) / 1e6 << "M a second)" << std::endl;
+	std::cout << "  " << made << " pairs in " << (paired - queued) * 1000.0 << "ms (" << made / (paired - queued) / 1e6 << "M pairs a second), "
+		<< matchmaker.GetQueuedCount() << " left over" << std::endl;
+}
+
+static void RunSteady(uint32_t queueTarget, eMatchmakingBucketing bucketing)
+{
+	Matchmaker matchmaker;
+	matchmaker.SetBucketing(bucketing);
+	matchmaker.Reserve(queueTarget + benchArrivalsPerTick);
+	std::mt19937 random(2);
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+	std::vector<uint32_t> waiting; // Candidates to leave, some already paired, Remove just says no to those.
+	std::vector<MatchmakingPair> pairs;
+	pairs.reserve(benchPairsPerTick);
+
+	LatencyHistogram tickCost;
+	uint32_t nextId = 1;
+	uint64_t measuredPairs = 0;
+	double measuredTime = 0.0;
+	uint32_t measuredTicks = 0;
+
+	for (uint32_t tick = 0; measuredTicks < benchSteadyTicks; tick++)
+	{
+		double now = tick * benchTickTime;
+		bool measuring = matchmaker.GetQueuedCount() >= queueTarget;
+
+		uint32_t arrivals = measuring ? benchPairsPerTick * 2 : benchArrivalsPerTick;
+
+		int64_t start = ClockNowNanoseconds();
+		for (uint32_t i = 0; i < arrivals; i++)
+		{
+			matchmaker.Enqueue(RandomTicket(nextId, random), now);
+			waiting.push_back(nextId++);
+		}
+		for (uint32_t i = 0; i < arrivals; i++)
+		{
+			if (chance(random) >= benchLeaveChance || waiting.empty())
+				continue;
+			size_t leaver = (size_t)(chance(random) * waiting.size());
+			matchmaker.Remove(waiting[leaver]);
+			waiting[leaver] = waiting.back();
+			waiting.pop_back();
+		}
+
+		pairs.clear();
+		size_t made = matchmaker.Pair(now, pairs, benchPairsPerTick);
+		int64_t took = ClockNowNanoseconds() - start;
+
+		if (measuring)
+		{
+			tickCost.Record(took);
+			measuredPairs += made;
+			measuredTime += took / 1e9;
+			measuredTicks++;
+		}
+	}
+
+	std::cout << "Steady, up to " << benchPairsPerTick << " pairs a tick, " << matchmaker.GetQueuedCount() << " queued at the end" << std::endl;
+	std::cout << "  queue work per tick: p50 " << tickCost.Percentile(50.0) / 1000.0 << "us, p99 " << tickCost.Percentile(99.0) / 1000.0
+		<< "us, max " << tickCost.Max() / 1000.0 << "us (tick is " << benchTickTime * 1e6 << "us)" << std::endl;
+	std::cout << "  " << measuredPairs / measuredTime / 1e6 << "M pairs a second of queue time" << std::endl;
+	PrintWaits(matchmaker);
+}
+
+int RunMatchmakerBench(int argc, char **argv)
+{
+	uint32_t queue = defaultBenchQueue;
+	eMatchmakingBucketing bucketing = MATCHMAKING_BY_RTT;
+	for (int i = 0; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--queue")
+			queue = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--by")
+		{
+			std::string by = argv[i + 1];
+			bucketing = by == "skill" ? MATCHMAKING_BY_SKILL : (by == "none" ? MATCHMAKING_BY_NOTHING : MATCHMAKING_BY_RTT);
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	RunBurst(queue, bucketing);
+	RunSteady(queue, bucketing);
+	std::cout << std::defaultfloat;
+	return 0;
+}
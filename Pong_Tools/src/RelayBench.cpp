@@ -0,0 +1,191 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "WorkerLink.h"
+#include "SpectatorRelay.h"
+
+// How many spectators one Pong_Relay core keeps up with. Each spectator is a loopback UDP send of a snapshot sized
+// frame, about what BCNet does per client underneath, with one thread draining them on the other end.
+//   fan out: frames flushed back to back at each spectator count, per frame and per send cost, and from that how many
+//            spectators fit in one core at the server's tick rate.
+//   paced:   frames pushed at the tick rate with the delay on, at the largest count, to check they leave on time.
+
+constexpr size_t benchFrameSize = 72; // A two player PONG_MATCH_SNAPSHOT.
+constexpr uint32_t defaultFanOutFrames = 200;
+constexpr double defaultPacedSeconds = 5.0;
+constexpr double benchTickRate = 60.0;
+
+struct RelayBenchSink
+{
+	WorkerLink sender, receiver;
+	std::atomic<bool> running = true;
+	std::atomic<uint64_t> received = 0;
+	uint64_t failed = 0; // Sends the socket turned away.
+	std::thread drain;
+
+	bool Open()
+	{
+		if (!sender.Open(0) || !receiver.Open(0))
+			return false;
+
+		drain = std::thread([this]()
+		{
+			WorkerMessage message;
+			while (running)
+				if (receiver.Receive(message, 0.1))
+					received++;
+		});
+		return true;
+	}
+
+	void Close()
+	{
+		running = false;
+		if (drain.joinable())
+			drain.join();
+	}
+
+	SpectatorRelay::FanOutFunction FanOut()
+	{
+		return [this](const uint8_t *data, size_t size, const std::vector<uint32_t> &subscribers)
+		{
+			uint16_t port = receiver.GetPort();
+			for (uint32_t id : subscribers)
+				if (!sender.Send(port, WORKER_CLIENT_PACKET, id, data, size))
+					failed++;
+		};
+	}
+};
+
+static void Subscribe(SpectatorRelay &relay, uint32_t spectators)
+{
+	for (uint32_t id = 1; id <= spectators; id++)
+		relay.Subscribe(id);
+}
+
+static void RunFanOut(RelayBenchSink &sink, uint32_t spectators, uint32_t frames)
+{
+	SpectatorRelay relay;
+	relay.SetDelay(0.0);
+	Subscribe(relay, spectators);
+
+	uint8_t frame[benchFrameSize] = {};
+	auto fanOut = sink.FanOut();
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		frame[0] = (uint8_t)i;
+		relay.Push(frame, sizeof(frame), ClockNowSeconds());
+		relay.Flush(ClockNowSeconds(), fanOut);
+	}
+
+	SpectatorRelayStats stats = relay.GetStats();
+	double perFrame = (double)stats.fanOut.Percentile(50.0);
+	double perSend = perFrame / spectators;
+	double perCore = 1e9 / benchTickRate / perSend; // Every spectator gets every tick.
+
+	std::cout << "  " << std::setw(6) << spectators << " spectators: p50 " << std::setw(9) << perFrame / 1000.0 << "us p99 " << std::setw(9)
+		<< stats.fanOut.Percentile(99.0) / 1000.0 << "us a frame, " << std::setw(6) << perSend << "ns a send, ~" << (uint64_t)perCore
+		<< " spectators a core at " << benchTickRate << "Hz" << std::endl;
+}
+
+static void RunPaced(RelayBenchSink &sink, uint32_t spectators, double delay, double seconds)
+{
+	SpectatorRelay relay;
+	relay.SetDelay(delay);
+	Subscribe(relay, spectators);
+
+	// The upstream connection's thread, pushing a frame a tick like the server sends them.
+	std::atomic<bool> pushing = true;
+	std::thread upstream([&]()
+	{
+		uint8_t frame[benchFrameSize] = {};
+		double start = ClockNowSeconds();
+		for (uint32_t tick = 0; ClockNowSeconds() - start < seconds; tick++)
+		{
+			frame[0] = (uint8_t)tick;
+			relay.Push(frame, sizeof(frame), ClockNowSeconds());
+			std::this_thread::sleep_until(std::chrono::steady_clock::now() + std::chrono::duration<double>(start + (tick + 1) / benchTickRate - ClockNowSeconds()));
+		}
+		pushing = false;
+	});
+
+	// The relay's main loop.
+	auto fanOut = sink.FanOut();
+	while (pushing || relay.GetBufferedCount() > 0)
+	{
+		relay.Flush(ClockNowSeconds(), fanOut);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	upstream.join();
+
+	SpectatorRelayStats stats = relay.GetStats();
+	std::cout << "  " << std::setw(6) << spectators << " spectators, " << delay << "s delay: " << stats.framesOut << " frames, late p50 "
+		<< stats.lateness.Percentile(50.0) / 1000.0 << "us p99 " << stats.lateness.Percentile(99.0) / 1000.0 << "us max "
+		<< stats.lateness.Max() / 1000.0 << "us, " << stats.framesDropped << " dropped" << std::endl;
+}
+
+int RunRelayBench(int argc, char **argv)
+{
+	std::vector<uint32_t> counts = { 100, 1000, 5000 };
+	uint32_t frames = defaultFanOutFrames;
+	double delay = defaultSpectatorDelay;
+	double seconds = defaultPacedSeconds;
+	for (int i = 0; i < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--spectators" && i + 1 < argc) // Comma separated.
+		{
+			counts.clear();
+			std::stringstream list(argv[i + 1]);
+			std::string count;
+			while (std::getline(list, count, ','))
+				counts.push_back((uint32_t)std::stoul(count));
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+			frames = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--delay" && i + 1 < argc)
+			delay = std::stod(argv[i + 1]);
+		else if (arg == "--seconds" && i + 1 < argc) // Of the paced run, zero skips it.
+			seconds = std::stod(argv[i + 1]);
+		else
+		{
+			std::cout << "Usage: Pong_Tools relay [--spectators <n,n,...>] [--frames <n>] [--delay <seconds>] [--seconds <seconds>]" << std::endl;
+			return 1;
+		}
+	}
+	if (counts.empty())
+		return 1;
+
+	RelayBenchSink sink;
+	if (!sink.Open())
+	{
+		std::cout << "Couldn't open loopback sockets" << std::endl;
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << benchFrameSize << " byte frames, loopback UDP, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	std::cout << "fan out, " << frames << " frames each" << std::endl;
+	for (uint32_t spectators : counts)
+		RunFanOut(sink, spectators, frames);
+
+	if (seconds > 0.0)
+	{
+		std::cout << "paced, " << seconds << "s at " << benchTickRate << "Hz" << std::endl;
+		RunPaced(sink, counts.back(), delay, seconds);
+	}
+
+	sink.Close();
+	std::cout << sink.received << " of the sends arrived, " << sink.failed << " turned away" << std::endl;
+	std::cout << std::defaultfloat;
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <random>
+
+#include "Clock.h"
+#include "MappedFile.h"
+#include "Simulation.h"
+#include "SimConformance.h"
+#include "Replay.h"
+
+// Match replays, as recorded by the server into its working directory (./replay_<seed>.prpl, see replayPathPrefix):
+//   Pong_Tools replay info <replay>             length, keyframes and the final score
+//   Pong_Tools replay seek <replay> <tick>      the state at any tick, from the nearest keyframe
+//   Pong_Tools replay verify <replay>           resimulates every span and checks it lands on the next keyframe
+//   Pong_Tools replay record <inputs> <replay>  turns a 'simcheck record' input stream into a replay
+
+constexpr int replaySeekSamples = 1000; // Random seeks timed by verify.
+
+static void PrintState(const SimState &state)
+{
+	std::cout << std::fixed << std::setprecision(4);
+	std::cout << "  tick " << state.tick << " (" << std::setprecision(2) << state.tick / (float)simTickRate << "s)" << std::endl;
+	std::cout << std::setprecision(4);
+	std::cout << "  ball (" << SimToFloat(state.ball.xPosition) << ", " << SimToFloat(state.ball.yPosition) << ") moving (" <<
+		SimToFloat(state.ball.xVelocity) << ", " << SimToFloat(state.ball.yVelocity) << ")" << std::endl;
+	std::cout << "  paddles " << SimToFloat(state.paddles[SIM_LEFT].yPosition) << ", " << SimToFloat(state.paddles[SIM_RIGHT].yPosition) << std::endl;
+	std::cout << "  score " << state.paddles[SIM_LEFT].score << " - " << state.paddles[SIM_RIGHT].score << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+static bool OpenReplay(const std::string &path, MappedFile &file, ReplayReader &reader)
+{
+	if (!file.Open(path))
+	{
+		std::cout << "Couldn't open " << path << std::endl;
+		return false;
+	}
+	if (!reader.Open(file.GetData(), file.GetSize()))
+	{
+		std::cout << path << " isn't a replay, or was recorded with a different simulation mode" << std::endl;
+		return false;
+	}
+	if (reader.WasRecovered())
+		std::cout << "No index, the recording was cut short. Recovered up to tick " << reader.GetLastTick() << std::endl;
+	return true;
+}
+
+static int ReplayInfo(const std::string &path)
+{
+	MappedFile file;
+	ReplayReader reader;
+	if (!OpenReplay(path, file, reader))
+		return 1;
+
+	uint32_t ticks = reader.GetLastTick() - reader.GetFirstTick();
+	float minutes = ticks / (float)simTickRate / 60.0f;
+	std::cout << path << std::endl;
+	std::cout << "  seed " << std::hex << reader.GetHeader().seed << std::dec << std::endl;
+	std::cout << "  ticks " << reader.GetFirstTick() << " to " << reader.GetLastTick() << " (" << std::fixed << std::setprecision(1) << minutes << " minutes)" << std::endl;
+	std::cout << "  " << reader.GetKeyframeCount() << " keyframes, " << file.GetSize() << " bytes";
+	if (minutes > 0.0f)
+		std::cout << " (" << (int)(file.GetSize() / minutes) << " bytes a minute)";
+	std::cout << std::defaultfloat << std::endl;
+
+	SimState state;
+	if (!reader.Seek(reader.GetLastTick(), state))
+	{
+		std::cout << "Couldn't play to the end" << std::endl;
+		return 1;
+	}
+	std::cout << "Final state:" << std::endl;
+	PrintState(state);
+	return 0;
+}
+
+static int ReplaySeek(const std::string &path, uint32_t tick)
+{
+	MappedFile file;
+	ReplayReader reader;
+	if (!OpenReplay(path, file, reader))
+		return 1;
+
+	SimState state;
+	double start = ClockNowSeconds();
+	if (!reader.Seek(tick, state))
+	{
+		std::cout << "Tick " << tick << " is outside the replay (" << reader.GetFirstTick() << " to " << reader.GetLastTick() << ")" << std::endl;
+		return 1;
+	}
+	double took = ClockNowSeconds() - start;
+
+	std::cout << "From the keyframe at tick " << reader.GetKeyframeTick(reader.FindKeyframe(tick)) << " in " << std::fixed << std::setprecision(3) << took * 1000.0 << "ms" << std::defaultfloat << std::endl;
+	PrintState(state);
+	return 0;
+}
+
+static int ReplayVerify(const std::string &path)
+{
+	MappedFile file;
+	ReplayReader reader;
+	if (!OpenReplay(path, file, reader))
+		return 1;
+
+	// Every span between keyframes should land exactly on the next one.
+	for (size_t i = 0; i + 1 < reader.GetKeyframeCount(); i++)
+	{
+		SimState simulated, recorded;
+		uint32_t tick = reader.GetKeyframeTick(i + 1);
+		if (!reader.Simulate(i, tick, simulated) || !reader.ReadKeyframe(i + 1, recorded))
+		{
+			std::cout << "Couldn't read the span starting at tick " << reader.GetKeyframeTick(i) << std::endl;
+			return 1;
+		}
+		if (SimHash(simulated) != SimHash(recorded))
+		{
+			std::cout << "Desync between ticks " << reader.GetKeyframeTick(i) << " and " << tick << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "All " << reader.GetKeyframeCount() << " keyframes match" << std::endl;
+
+	// How long a seek takes, anywhere in the match.
+	std::mt19937 random(1);
+	std::uniform_int_distribution<uint32_t> pick(reader.GetFirstTick(), reader.GetLastTick());
+	double worst = 0.0, total = 0.0;
+	for (int i = 0; i < replaySeekSamples; i++)
+	{
+		SimState state;
+		double start = ClockNowSeconds();
+		reader.Seek(pick(random), state);
+		double took = ClockNowSeconds() - start;
+		total += took;
+		if (took > worst)
+			worst = took;
+	}
+	std::cout << std::fixed << std::setprecision(3) << "Seek: " << total / replaySeekSamples * 1000.0 << "ms average, " << worst * 1000.0 << "ms worst" << std::defaultfloat << std::endl;
+	return 0;
+}
+
+static int ReplayRecord(const std::string &inputsPath, const std::string &path)
+{
+	SimInputLog log;
+	if (!LoadSimInputs(inputsPath, log))
+	{
+		std::cout << "Couldn't read " << inputsPath << std::endl;
+		return 1;
+	}
+
+	// Through the same writer the server uses.
+	SimState state = SimInit(log.seed);
+	state.playing = true;
+
+	ReplayWriter writer;
+	if (!writer.Start(path, state))
+	{
+		std::cout << "Couldn't write " << path << std::endl;
+		return 1;
+	}
+	for (const SimInputs &inputs : log.ticks)
+	{
+		uint32_t events;
+		state = SimStep(state, inputs, simTickTime, events);
+		writer.RecordTick(inputs, state);
+	}
+	writer.Stop();
+
+	std::cout << "Recorded " << log.ticks.size() << " ticks, final score " << state.paddles[SIM_LEFT].score << " - " << state.paddles[SIM_RIGHT].score << std::endl;
+	return ReplayInfo(path);
+}
+
+static void PrintReplayUsage()
+{
+	std::cout << "Usage: Pong_Tools replay info <replay>" << std::endl;
+	std::cout << "       Pong_Tools replay seek <replay> <tick>" << std::endl;
+	std::cout << "       Pong_Tools replay verify <replay>" << std::endl;
+	std::cout << "       Pong_Tools replay record <inputs> <replay>" << std::endl;
+}
+
+int RunReplayPlayer(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		PrintReplayUsage();
+		return 1;
+	}
+
+	std::string command = argv[0];
+	if (command == "info")
+		return ReplayInfo(argv[1]);
+	if (command == "seek" && argc >= 3)
+		return ReplaySeek(argv[1], (uint32_t)std::stoul(argv[2]));
+	if (command == "verify")
+		return ReplayVerify(argv[1]);
+	if (command == "record" && argc >= 3)
+		return ReplayRecord(argv[1], argv[2]);
+
+	PrintReplayUsage();
+	return 1;
+}
@@ -0,0 +1,282 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+#include <raylib.h>
+
+#include "Clock.h"
+#include "MappedFile.h"
+#include "Simulation.h"
+#include "Replay.h"
+
+// Fleet wide stats over a folder of replays, every core replaying its own files. Each replay is mapped and played a
+// run at a time, so memory stays flat however many there are.
+//   Pong_Tools scan <folder> [--threads <n>] [--out <stats.csv|stats.json>]
+
+constexpr const char *defaultScanOutPath = "./replay_stats.csv";
+
+constexpr int rallyHitBuckets = 32; // Hits per rally, the last bucket takes everything longer.
+constexpr int rallySecondBuckets = 60; // Whole seconds per rally.
+constexpr int hitAngleBuckets = 18; // 10 degree buckets from -90 to 90.
+constexpr int ballSpeedBuckets = 20;
+constexpr float ballSpeedBucketSize = 0.05f; // Screens a second.
+
+struct ScanStats
+{
+	uint64_t files = 0;
+	uint64_t badFiles = 0;
+	uint64_t bytes = 0;
+	uint64_t ticks = 0;
+	uint64_t playingTicks = 0; // Ticks with the ball in play, the only ones its speed is counted on.
+
+	uint64_t rallies = 0;
+	uint64_t hits = 0;
+	uint64_t bounces = 0;
+	uint64_t tunnels = 0; // The ball crossed a paddle it overlapped without hitting it.
+	uint64_t wallOvershoots = 0; // Ticks the ball spent past the top or bottom before bouncing back.
+	uint64_t paddleClamps = 0; // Ticks a paddle was held against the edge.
+	double ballSpeedTotal = 0.0;
+
+	uint64_t rallyHits[rallyHitBuckets] = { };
+	uint64_t rallySeconds[rallySecondBuckets] = { };
+	uint64_t hitAngles[hitAngleBuckets] = { };
+	uint64_t ballSpeeds[ballSpeedBuckets] = { };
+
+	void Merge(const ScanStats &other)
+	{
+		files += other.files;
+		badFiles += other.badFiles;
+		bytes += other.bytes;
+		ticks += other.ticks;
+		playingTicks += other.playingTicks;
+		rallies += other.rallies;
+		hits += other.hits;
+		bounces += other.bounces;
+		tunnels += other.tunnels;
+		wallOvershoots += other.wallOvershoots;
+		paddleClamps += other.paddleClamps;
+		ballSpeedTotal += other.ballSpeedTotal;
+		for (int i = 0; i < rallyHitBuckets; i++)
+			rallyHits[i] += other.rallyHits[i];
+		for (int i = 0; i < rallySecondBuckets; i++)
+			rallySeconds[i] += other.rallySeconds[i];
+		for (int i = 0; i < hitAngleBuckets; i++)
+			hitAngles[i] += other.hitAngles[i];
+		for (int i = 0; i < ballSpeedBuckets; i++)
+			ballSpeeds[i] += other.ballSpeeds[i];
+	}
+};
+
+static int Bucket(float value, float bucketSize, int buckets)
+{
+	int bucket = (int)(value / bucketSize);
+	return bucket < 0 ? 0 : (bucket >= buckets ? buckets - 1 : bucket);
+}
+
+static bool ScanReplay(const std::string &path, ScanStats &stats)
+{
+	MappedFile file;
+	ReplayReader reader;
+	if (!file.Open(path) || !reader.Open(file.GetData(), file.GetSize()))
+		return false;
+
+	uint32_t rallyHits = 0;
+	uint32_t rallyStart = reader.GetFirstTick();
+
+	bool played = reader.Play([&](const SimState &before, const SimInputs &inputs, const SimState &after, uint32_t events)
+	{
+		stats.ticks++;
+		if (!after.playing)
+			return;
+		stats.playingTicks++;
+
+		const SimBall &ball = after.ball;
+		float xVelocity = SimToFloat(ball.xVelocity), yVelocity = SimToFloat(ball.yVelocity);
+		float speed = sqrtf(xVelocity * xVelocity + yVelocity * yVelocity);
+		stats.ballSpeedTotal += speed;
+		stats.ballSpeeds[Bucket(speed, ballSpeedBucketSize, ballSpeedBuckets)]++;
+
+		for (int side = 0; side < SIM_SIDES; side++)
+		{
+			if (events & (side == SIM_LEFT ? SIM_EVENT_HIT_LEFT : SIM_EVENT_HIT_RIGHT))
+			{
+				// Angle off the horizontal, as the ball leaves the paddle.
+				float angle = atan2f(yVelocity / ballVSpeed, fabsf(xVelocity) / ballHSpeed) / simDegToRad;
+				stats.hitAngles[Bucket(angle + 90.0f, 180.0f / hitAngleBuckets, hitAngleBuckets)]++;
+				stats.hits++;
+				rallyHits++;
+			}
+			else if (!(events & (SIM_EVENT_GOAL_LEFT | SIM_EVENT_GOAL_RIGHT)))
+			{
+				// Went from one side of the paddle's face to the other while level with it, without a hit.
+				float paddleX = SimToFloat(SimPaddleX(side));
+				float beforeX = SimToFloat(before.ball.xPosition), afterX = SimToFloat(ball.xPosition);
+				float ballY = SimToFloat(ball.yPosition), paddleY = SimToFloat(after.paddles[side].yPosition);
+				bool crossed = (beforeX < paddleX) != (afterX < paddleX);
+				if (crossed && fabsf(ballY - paddleY) <= (paddleHeight + ballHeight) / 2.0f)
+					stats.tunnels++;
+			}
+
+			// Pushing into the edge and going nowhere.
+			float paddleY = SimToFloat(after.paddles[side].yPosition);
+			bool atTop = paddleY <= paddleHeight / 2.0f + 0.0001f, atBottom = paddleY >= 1.0f - paddleHeight / 2.0f - 0.0001f;
+			if ((atTop && (inputs.paddles[side] & SIM_INPUT_UP)) || (atBottom && (inputs.paddles[side] & SIM_INPUT_DOWN)))
+				stats.paddleClamps++;
+		}
+
+		if (events & SIM_EVENT_BOUNCE)
+			stats.bounces++;
+		float ballY = SimToFloat(ball.yPosition);
+		if (ballY < 0.0f || ballY > 1.0f)
+			stats.wallOvershoots++;
+
+		if (events & (SIM_EVENT_GOAL_LEFT | SIM_EVENT_GOAL_RIGHT))
+		{
+			stats.rallies++;
+			stats.rallyHits[rallyHits < (uint32_t)rallyHitBuckets ? rallyHits : rallyHitBuckets - 1]++;
+			stats.rallySeconds[Bucket((after.tick - rallyStart) / (float)simTickRate, 1.0f, rallySecondBuckets)]++;
+			rallyHits = 0;
+			rallyStart = after.tick;
+		}
+	});
+
+	stats.bytes += file.GetSize();
+	return played;
+}
+
+static void WriteHistogramCsv(std::ofstream &out, const char *name, const uint64_t *counts, int buckets, float bucketStart, float bucketSize)
+{
+	for (int i = 0; i < buckets; i++)
+		out << name << "," << bucketStart + i * bucketSize << "," << counts[i] << "\n";
+}
+
+static void WriteHistogramJson(std::ofstream &out, const char *name, const uint64_t *counts, int buckets, float bucketStart, float bucketSize, bool last)
+{
+	out << "  \"" << name << "\": { \"start\": " << bucketStart << ", \"bucket\": " << bucketSize << ", \"counts\": [";
+	for (int i = 0; i < buckets; i++)
+		out << (i ? ", " : "") << counts[i];
+	out << "] }" << (last ? "\n" : ",\n");
+}
+
+static bool WriteStats(const std::string &path, const ScanStats &stats)
+{
+	std::ofstream out(path, std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	float averageSpeed = stats.playingTicks ? (float)(stats.ballSpeedTotal / stats.playingTicks) : 0.0f;
+	bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+	if (json)
+	{
+		out << "{\n";
+		out << "  \"files\": " << stats.files << ", \"badFiles\": " << stats.badFiles << ", \"ticks\": " << stats.ticks << ",\n";
+		out << "  \"rallies\": " << stats.rallies << ", \"hits\": " << stats.hits << ", \"bounces\": " << stats.bounces << ",\n";
+		out << "  \"tunnels\": " << stats.tunnels << ", \"wallOvershoots\": " << stats.wallOvershoots << ", \"paddleClamps\": " << stats.paddleClamps << ",\n";
+		out << "  \"averageBallSpeed\": " << averageSpeed << ",\n";
+		WriteHistogramJson(out, "rallyHits", stats.rallyHits, rallyHitBuckets, 0.0f, 1.0f, false);
+		WriteHistogramJson(out, "rallySeconds", stats.rallySeconds, rallySecondBuckets, 0.0f, 1.0f, false);
+		WriteHistogramJson(out, "hitAngle", stats.hitAngles, hitAngleBuckets, -90.0f, 180.0f / hitAngleBuckets, false);
+		WriteHistogramJson(out, "ballSpeed", stats.ballSpeeds, ballSpeedBuckets, 0.0f, ballSpeedBucketSize, true);
+		out << "}\n";
+	}
+	else
+	{
+		// One row per value, totals first then every histogram bucket.
+		out << "stat,bucket,value\n";
+		out << "files,," << stats.files << "\n" << "badFiles,," << stats.badFiles << "\n" << "ticks,," << stats.ticks << "\n";
+		out << "rallies,," << stats.rallies << "\n" << "hits,," << stats.hits << "\n" << "bounces,," << stats.bounces << "\n";
+		out << "tunnels,," << stats.tunnels << "\n" << "wallOvershoots,," << stats.wallOvershoots << "\n" << "paddleClamps,," << stats.paddleClamps << "\n";
+		out << "averageBallSpeed,," << averageSpeed << "\n";
+		WriteHistogramCsv(out, "rallyHits", stats.rallyHits, rallyHitBuckets, 0.0f, 1.0f);
+		WriteHistogramCsv(out, "rallySeconds", stats.rallySeconds, rallySecondBuckets, 0.0f, 1.0f);
+		WriteHistogramCsv(out, "hitAngle", stats.hitAngles, hitAngleBuckets, -90.0f, 180.0f / hitAngleBuckets);
+		WriteHistogramCsv(out, "ballSpeed", stats.ballSpeeds, ballSpeedBuckets, 0.0f, ballSpeedBucketSize);
+	}
+	return out.good();
+}
+
+int RunReplayScan(int argc, char **argv)
+{
+	if (argc < 1)
+	{
+		std::cout << "Usage: Pong_Tools scan <folder> [--threads <n>] [--out <stats.csv|stats.json>]" << std::endl;
+		return 1;
+	}
+
+	std::string folder = argv[0];
+	std::string outPath = defaultScanOutPath;
+	unsigned int threadCount = std::thread::hardware_concurrency();
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--threads")
+			threadCount = (unsigned int)std::stoul(argv[i + 1]);
+		else if (arg == "--out")
+			outPath = argv[i + 1];
+	}
+	if (threadCount == 0)
+		threadCount = 1;
+
+	std::vector<std::string> paths;
+	FilePathList files = LoadDirectoryFilesEx(folder.c_str(), ".prpl", true);
+	for (unsigned int i = 0; i < files.count; i++)
+		paths.push_back(files.paths[i]);
+	UnloadDirectoryFiles(files);
+
+	if (paths.empty())
+	{
+		std::cout << "No replays under " << folder << std::endl;
+		return 1;
+	}
+	std::cout << "Scanning " << paths.size() << " replays on " << threadCount << " threads" << std::endl;
+
+	// Each thread takes the next file as it finishes one, so a few long matches don't hold the rest up.
+	std::vector<ScanStats> threadStats(threadCount);
+	std::vector<std::thread> threads;
+	std::atomic<size_t> nextFile = 0;
+
+	double start = ClockNowSeconds();
+	for (unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			ScanStats &stats = threadStats[t];
+			for (size_t i = nextFile++; i < paths.size(); i = nextFile++)
+			{
+				if (ScanReplay(paths[i], stats))
+					stats.files++;
+				else
+					stats.badFiles++;
+			}
+		});
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	double took = ClockNowSeconds() - start;
+
+	ScanStats total;
+	for (const ScanStats &stats : threadStats)
+		total.Merge(stats);
+
+	double matchHours = total.ticks / (double)simTickRate / 3600.0;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Scanned " << total.files << " replays (" << total.badFiles << " unreadable), " << total.bytes / (1024.0 * 1024.0) << "MB in " << took << "s" << std::endl;
+	std::cout << "  " << total.ticks / took / 1e6 << "M ticks/s, " << total.bytes / took / (1024.0 * 1024.0) << "MB/s, " << matchHours / took << " hours of play a second" << std::endl;
+	std::cout << "  " << total.rallies << " rallies, " << total.hits << " hits, " << total.tunnels << " tunnels, " << total.paddleClamps << " paddle clamps" << std::endl;
+	std::cout << std::defaultfloat;
+
+	if (!WriteStats(outPath, total))
+	{
+		std::cout << "Couldn't write " << outPath << std::endl;
+		return 1;
+	}
+	std::cout << "Stats written to " << outPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <deque>
+#include <random>
+
+#include "Clock.h"
+#include "Simulation.h"
+#include "Rollback.h"
+
+// How much rollback the simulation can take. Two sessions play each other in-process, every input reaches the
+// other side a fixed number of ticks late and changes far more often than a real player's would, so nearly every
+// tick rolls back as far as it can. Both sides swap checksums the whole time, --inject-desync corrupts one input
+// to show a desync gets caught.
+
+constexpr uint32_t defaultBenchTicks = simTickRate * 60 * 2;
+constexpr int defaultBenchLatency = 6; // Ticks, 100ms at 60Hz.
+
+struct BenchMessage
+{
+	uint32_t arrival = 0; // Frame it's delivered on.
+	uint32_t tick = 0;
+	uint8_t input = 0;
+	uint32_t checksumTick = UINT32_MAX;
+	uint32_t checksum = 0;
+};
+
+struct BenchPeer
+{
+	RollbackSession session;
+	std::deque<BenchMessage> inbox;
+	uint8_t input = 0;
+};
+
+static double MeasureRawSteps(uint32_t ticks)
+{
+	SimState state = SimInit(1);
+	state.playing = true;
+
+	SimInputs inputs;
+	int64_t start = ClockNowNanoseconds();
+	for (uint32_t tick = 0; tick < ticks; tick++)
+	{
+		inputs.paddles[SIM_LEFT] = (uint8_t)((tick / 20) % 3);
+		inputs.paddles[SIM_RIGHT] = (uint8_t)((tick / 27) % 3);
+		uint32_t events;
+		state = SimStep(state, inputs, simTickTime, events);
+	}
+	double seconds = (ClockNowNanoseconds() - start) / 1e9;
+
+	if (state.tick != ticks) // Uses the result so the loop can't be optimised away.
+		std::cout << "Unexpected tick count" << std::endl;
+	return ticks / seconds;
+}
+
+int RunRollbackBench(int argc, char **argv)
+{
+	uint32_t ticks = defaultBenchTicks;
+	int latency = defaultBenchLatency;
+	int maxRollback = defaultMaxRollback;
+	uint32_t injectDesyncTick = UINT32_MAX;
+
+	for (int i = 0; i < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--ticks" && i + 1 < argc)
+			ticks = (uint32_t)std::stoul(argv[i + 1]);
+		else if (arg == "--latency" && i + 1 < argc)
+			latency = std::stoi(argv[i + 1]);
+		else if (arg == "--max-rollback" && i + 1 < argc)
+			maxRollback = std::stoi(argv[i + 1]);
+		else if (arg == "--inject-desync" && i + 1 < argc)
+			injectDesyncTick = (uint32_t)std::stoul(argv[i + 1]);
+		else
+		{
+			std::cout << "Usage: Pong_Tools rollback [--ticks <n>] [--latency <ticks>] [--max-rollback <ticks>] [--inject-desync <tick>]" << std::endl;
+			return 1;
+		}
+	}
+	if (maxRollback < latency + defaultInputDelay) // Otherwise it spends the whole run stalled.
+		maxRollback = latency + defaultInputDelay;
+
+	std::cout << std::fixed << std::setprecision(0);
+	double rawSteps = MeasureRawSteps(ticks * 10);
+	std::cout << "Raw SimStep: " << rawSteps << " ticks/s (" << rawSteps / simTickRate << " per 60Hz frame)" << std::endl;
+
+	std::mt19937 random(7);
+	std::uniform_int_distribution<int> inputChoice(0, 2);
+
+	BenchPeer peers[SIM_SIDES];
+	SimState initial = SimInit(42);
+	initial.playing = true;
+	for (int side = 0; side < SIM_SIDES; side++)
+		peers[side].session.Start(initial, side, defaultInputDelay, maxRollback);
+
+	int64_t start = ClockNowNanoseconds();
+	for (uint32_t frame = 0; peers[SIM_LEFT].session.GetTick() < ticks || peers[SIM_RIGHT].session.GetTick() < ticks; frame++)
+	{
+		for (int side = 0; side < SIM_SIDES; side++)
+		{
+			BenchPeer &peer = peers[side];
+			BenchPeer &other = peers[1 - side];
+
+			// Deliver whatever has arrived by now.
+			while (!peer.inbox.empty() && peer.inbox.front().arrival <= frame)
+			{
+				const BenchMessage &message = peer.inbox.front();
+				peer.session.AddRemoteInput(message.tick, message.input);
+				if (message.checksumTick != UINT32_MAX)
+					peer.session.AddRemoteChecksum(message.checksumTick, message.checksum);
+				peer.inbox.pop_front();
+			}
+
+			if (peer.session.GetTick() >= ticks || !peer.session.CanAdvance())
+				continue;
+
+			if (frame % 4 == 0)
+				peer.input = (uint8_t)inputChoice(random);
+
+			BenchMessage message;
+			message.arrival = frame + latency;
+			message.tick = peer.session.AddLocalInput(peer.input);
+			message.input = peer.input;
+			if (message.tick == injectDesyncTick && side == SIM_LEFT) // Stands in for a corrupted packet.
+				message.input ^= SIM_INPUT_UP;
+
+			uint32_t events;
+			peer.session.Advance(events);
+
+			message.checksumTick = peer.session.GetLatestChecksumTick();
+			if (message.checksumTick != UINT32_MAX)
+				peer.session.GetChecksum(message.checksumTick, message.checksum);
+			other.inbox.push_back(message);
+		}
+	}
+	double seconds = (ClockNowNanoseconds() - start) / 1e9;
+
+	// Results.
+	uint64_t totalSteps = 0, resimulated = 0, rollbacks = 0, stalls = 0;
+	int maxDepth = 0;
+	for (BenchPeer &peer : peers)
+	{
+		const RollbackStats &stats = peer.session.GetStats();
+		totalSteps += stats.ticks + stats.resimulatedTicks;
+		resimulated += stats.resimulatedTicks;
+		rollbacks += stats.rollbacks;
+		stalls += stats.stalls;
+		if (stats.maxRollbackDepth > maxDepth)
+			maxDepth = stats.maxRollbackDepth;
+	}
+
+	std::cout << "Two peers, " << ticks << " ticks each, inputs " << latency << " ticks late, input delay " << defaultInputDelay << ", max rollback " << maxRollback << std::endl;
+	std::cout << "  rollbacks:           " << rollbacks << ", " << std::setprecision(1) << (rollbacks ? (double)resimulated / rollbacks : 0.0) << " ticks deep on average, " << maxDepth << " max" << std::endl;
+	std::cout << std::setprecision(0);
+	std::cout << "  stalls:              " << stalls << std::endl;
+	std::cout << "  resimulated ticks/s: " << resimulated / seconds << std::endl;
+	std::cout << "  total sim ticks/s:   " << totalSteps / seconds << " (" << totalSteps / seconds / simTickRate << " per 60Hz frame)" << std::endl;
+	std::cout << std::setprecision(2);
+	std::cout << "  worst frame:         " << maxDepth + 1 << " ticks, ~" << (maxDepth + 1) * seconds / totalSteps * 1e6 << "us of a " << 1e6 / simTickRate << "us frame" << std::endl;
+
+	bool desynced = false;
+	for (int side = 0; side < SIM_SIDES; side++)
+	{
+		if (peers[side].session.HasDesynced())
+		{
+			std::cout << "  " << (side == SIM_LEFT ? "left" : "right") << " peer detected a desync at tick " << peers[side].session.GetDesyncTick() << std::endl;
+			desynced = true;
+		}
+	}
+	if (!desynced)
+		std::cout << "  checksums matched throughout" << std::endl;
+
+	return desynced == (injectDesyncTick != UINT32_MAX) ? 0 : 1; // A desync is only a failure if we didn't ask for it.
+}
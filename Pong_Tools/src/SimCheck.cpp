@@ -0,0 +1,108 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+#include "SimConformance.h"
+
+// Simulation conformance between builds:
+//   Pong_Tools simcheck record inputs.bin      make an input stream (two scripted players, so there are plenty of rallies)
+//   Pong.exe --sim-conformance inputs.bin client.txt
+//   Pong_Server.exe --sim-conformance inputs.bin server.txt
+//   Pong_Tools simcheck compare client.txt server.txt
+// Those two share a Pong_Sim, so against each other they always agree. Against another compiler or machine's hashes, or
+// the golden ones checked in, is what finds a difference:
+//   Pong_Tools simcheck golden [<file>] [--write]    (Pong.exe and Pong_Server.exe --sim-golden <file> do the same)
+
+constexpr uint32_t defaultCheckTicks = simTickRate * 60 * 5; // Five minutes of play.
+
+static int CompareHashes(const std::string &pathA, const std::string &pathB)
+{
+	std::vector<uint64_t> a, b;
+	if (!LoadSimHashes(pathA, a) || !LoadSimHashes(pathB, b))
+	{
+		std::cout << "Couldn't read the hash files" << std::endl;
+		return 1;
+	}
+
+	size_t count = a.size() < b.size() ? a.size() : b.size();
+	for (size_t tick = 0; tick < count; tick++)
+	{
+		if (a[tick] != b[tick])
+		{
+			std::cout << "Desync at tick " << tick << " of " << count << std::endl;
+			return 1;
+		}
+	}
+
+	if (a.size() != b.size())
+	{
+		std::cout << "Matched for " << count << " ticks but the lengths differ (" << a.size() << " vs " << b.size() << ")" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All " << count << " ticks match" << std::endl;
+	return 0;
+}
+
+static void PrintSimCheckUsage()
+{
+	std::cout << "Usage: Pong_Tools simcheck record <inputs> [--ticks <n>] [--seed <n>]" << std::endl;
+	std::cout << "       Pong_Tools simcheck hash <inputs> <hashes>" << std::endl;
+	std::cout << "       Pong_Tools simcheck compare <hashes> <hashes>" << std::endl;
+	std::cout << "       Pong_Tools simcheck golden [<golden hashes>] [--write]" << std::endl;
+}
+
+int RunSimCheck(int argc, char **argv)
+{
+	if (argc >= 1 && std::string(argv[0]) == "golden") // Run from the solution directory for the default path.
+	{
+		std::string path = defaultSimGoldenPath;
+		bool write = false;
+		for (int i = 1; i < argc; i++)
+		{
+			if (std::string(argv[i]) == "--write")
+				write = true;
+			else
+				path = argv[i];
+		}
+		return RunSimGoldenCheck(path, write);
+	}
+	if (argc < 2)
+	{
+		PrintSimCheckUsage();
+		return 1;
+	}
+
+	std::string command = argv[0];
+	if (command == "record")
+	{
+		uint32_t ticks = defaultCheckTicks;
+		uint64_t seed = 1;
+		for (int i = 2; i + 1 < argc; i += 2)
+		{
+			std::string arg = argv[i];
+			if (arg == "--ticks")
+				ticks = (uint32_t)std::stoul(argv[i + 1]);
+			else if (arg == "--seed")
+				seed = std::stoull(argv[i + 1]);
+		}
+
+		if (!SaveSimInputs(argv[1], SimRecordInputs(seed, ticks)))
+		{
+			std::cout << "Couldn't write " << argv[1] << std::endl;
+			return 1;
+		}
+		std::cout << "Recorded " << ticks << " ticks" << std::endl;
+		return 0;
+	}
+	if (command == "hash" && argc >= 3)
+		return RunSimConformance(argv[1], argv[2]);
+	if (command == "compare" && argc >= 3)
+		return CompareHashes(argv[1], argv[2]);
+
+	PrintSimCheckUsage();
+	return 1;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Entry points for each tool, argc/argv start after the tool's name.
+int RunLatencyBench(int argc, char **argv);
+int RunAssetPacker(int argc, char **argv);
+int RunSimCheck(int argc, char **argv);
+int RunRollbackBench(int argc, char **argv);
+int RunReplayPlayer(int argc, char **argv);
+int RunReplayScan(int argc, char **argv);
+int RunMatchmakerBench(int argc, char **argv);
+int RunLinkBench(int argc, char **argv);
+int RunUpgradeCheck(int argc, char **argv);
+int RunRelayBench(int argc, char **argv);
+int RunBotBench(int argc, char **argv);
+int RunLogBench(int argc, char **argv);
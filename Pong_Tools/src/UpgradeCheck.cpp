@@ -0,0 +1,216 @@
+#include "Tools.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstring>
+
+#include <BCNet/BCNetPacket.h>
+
+#include "shared.h"
+#include "Clock.h"
+#include "WorkerLink.h"
+
+// Synthetic load for checking a server upgrade doesn't reset anyone's match. Stands in for Pong_Gateway in front of one
+// worker: connects --clients players over the worker link, readies them all up and keeps their paddles moving, then
+// watches what each of them is sent. Partway through, start the new binary with the same --worker-port and --handoff.
+// A match counts as reset if a player is told the other one left, is counted down or started again once playing, or
+// sees a score go down. The first player also pings the worker constantly, the longest it went unanswered is how long
+// the handoff kept the worker away.
+
+constexpr int defaultUpgradeClients = 64;
+constexpr double defaultUpgradeSeconds = 30.0;
+constexpr double upgradeInputInterval = 0.25; // Seconds between each player's paddle changes.
+constexpr double upgradeProbeInterval = 0.005;
+constexpr double upgradeReportInterval = 1.0;
+
+struct UpgradeClient
+{
+	uint32 id = 0;
+	bool matched = false;
+	bool playing = false;
+	int scores[2] = { 0, 0 };
+	int resets = 0;
+};
+
+// One packet from one of our players, written the way the game writes them.
+template<typename... Fields>
+static void SendPacket(WorkerLink &link, uint16_t workerPort, uint32 clientId, const Fields &...fields)
+{
+	BCNet::Packet packet;
+	packet.Allocate(1024);
+	BCNet::PacketStreamWriter writer(packet);
+	(writer << ... << fields);
+	link.Send(workerPort, WORKER_CLIENT_PACKET, clientId, writer.GetPacket().Data, writer.GetPacket().Size);
+	packet.Release();
+}
+
+int RunUpgradeCheck(int argc, char **argv)
+{
+	uint16_t workerPort = 0;
+	int clientCount = defaultUpgradeClients;
+	double seconds = defaultUpgradeSeconds;
+	for (int i = 0; i < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--worker-port" && i + 1 < argc)
+			workerPort = (uint16_t)std::stoi(argv[i + 1]);
+		else if (arg == "--clients" && i + 1 < argc)
+			clientCount = std::stoi(argv[i + 1]);
+		else if (arg == "--seconds" && i + 1 < argc)
+			seconds = std::stod(argv[i + 1]);
+		else
+			workerPort = 0;
+	}
+	if (workerPort == 0 || clientCount < 2)
+	{
+		std::cout << "Usage: Pong_Tools upgrade --worker-port <port> [--clients <n>] [--seconds <s>]" << std::endl;
+		std::cout << "  Against 'Pong_Server --worker-port <port> --handoff <path>', restart it the same way while this runs." << std::endl;
+		return 1;
+	}
+
+	WorkerLink link;
+	if (!link.Open(0))
+	{
+		std::cout << "Couldn't open a loopback socket" << std::endl;
+		return 1;
+	}
+
+	std::vector<UpgradeClient> clients(clientCount);
+	for (int i = 0; i < clientCount; i++)
+	{
+		clients[i].id = (uint32)(i + 1);
+		uint32_t gatewayMatchId = (uint32_t)(i / 2 + 1); // Same as the gateway, two at a time.
+		link.Send(workerPort, WORKER_CLIENT_CONNECTED, clients[i].id, &gatewayMatchId, sizeof(gatewayMatchId));
+	}
+
+	std::mt19937 random(1234);
+
+	double start = ClockNowSeconds();
+	double nextInput = start, nextReport = start + upgradeReportInterval;
+	double lastProbeSent = 0.0, lastProbeAnswered = start, longestSilence = 0.0;
+	uint32 probeSequence = 0;
+
+	std::cout << std::fixed << std::setprecision(1);
+	WorkerMessage message;
+	while (true)
+	{
+		double now = ClockNowSeconds();
+		if (now - start >= seconds)
+			break;
+
+		if (now - lastProbeSent >= upgradeProbeInterval)
+		{
+			SendPacket(link, workerPort, clients.front().id, PongPackets::PONG_PING, ++probeSequence, now);
+			lastProbeSent = now;
+		}
+
+		if (now >= nextInput)
+		{
+			for (UpgradeClient &client : clients)
+			{
+				if (!client.playing)
+					continue;
+				int direction = (int)(random() % 3); // Up, down or still.
+				SendPacket(link, workerPort, client.id, PongPackets::PONG_PLAYER_MOVING_UP, direction == 0);
+				SendPacket(link, workerPort, client.id, PongPackets::PONG_PLAYER_MOVING_DOWN, direction == 1);
+			}
+			nextInput = now + upgradeInputInterval;
+		}
+
+		if (now >= nextReport)
+		{
+			int matched = 0, playing = 0, resets = 0;
+			for (UpgradeClient &client : clients)
+			{
+				matched += client.matched ? 1 : 0;
+				playing += client.playing ? 1 : 0;
+				resets += client.resets;
+			}
+			std::cout << std::setw(5) << now - start << "s: " << matched << " matched, " << playing << " playing, " << resets
+				<< " resets, longest silence " << longestSilence * 1000.0 << "ms" << std::endl;
+			nextReport = now + upgradeReportInterval;
+		}
+
+		if (!link.Receive(message, 0.001) || message.type != WORKER_CLIENT_PACKET || message.clientId == 0 || message.clientId > clients.size())
+			continue;
+
+		UpgradeClient &client = clients[message.clientId - 1];
+		BCNet::Packet received;
+		received.Allocate(message.size);
+		std::memcpy(received.Data, message.payload, message.size);
+		BCNet::PacketStreamReader reader(received);
+		int packetID;
+		reader >> packetID;
+
+		switch (packetID)
+		{
+			case (int)PongPackets::PONG_PING:
+			{
+				// The worker's RTT pings, answered so it queues us without waiting.
+				uint32 sequence;
+				double sentTime;
+				reader >> sequence >> sentTime;
+				SendPacket(link, workerPort, client.id, PongPackets::PONG_PONG, sequence, sentTime);
+			} break;
+			case (int)PongPackets::PONG_PONG:
+			{
+				double silence = now - lastProbeAnswered;
+				if (silence > longestSilence)
+					longestSilence = silence;
+				lastProbeAnswered = now;
+			} break;
+			case (int)PongPackets::PONG_PLAYER_CONNECTED:
+			{
+				uint32 connectedId;
+				reader >> connectedId;
+				if (connectedId != client.id || client.matched)
+					break;
+
+				client.matched = true;
+				SendPacket(link, workerPort, client.id, PongPackets::PONG_PLAYER_READY, true);
+			} break;
+			case (int)PongPackets::PONG_PLAYER_DISCONNECTED: // Nobody here ever leaves.
+			case (int)PongPackets::PONG_PLAYER_COUNTDOWN:
+			{
+				if (client.playing)
+					client.resets++;
+			} break;
+			case (int)PongPackets::PONG_GAME_STARTED:
+			{
+				if (client.playing)
+					client.resets++;
+				client.playing = true;
+			} break;
+			case (int)PongPackets::PONG_PLAYER_SCORE:
+			{
+				bool rightSide;
+				int score;
+				reader >> rightSide >> score;
+				int &known = client.scores[rightSide ? 1 : 0];
+				if (score < known)
+					client.resets++;
+				known = score;
+			} break;
+			default:
+				break;
+		}
+		received.Release();
+	}
+
+	for (UpgradeClient &client : clients)
+		link.Send(workerPort, WORKER_CLIENT_DISCONNECTED, client.id);
+
+	int playing = 0, resets = 0;
+	for (UpgradeClient &client : clients)
+	{
+		playing += client.playing ? 1 : 0;
+		resets += client.resets;
+	}
+	std::cout << playing << " of " << clientCount << " players got a game, " << resets << " saw their match reset, worker was silent for at most "
+		<< longestSilence * 1000.0 << "ms" << std::endl;
+	std::cout << std::defaultfloat;
+	return resets == 0 && playing > 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+
+#include "Tools.h"
+
+static void PrintUsage()
+{
+	std::cout << "Usage: Pong_Tools <tool> [options]" << std::endl;
+	std::cout << "  latency     Input-to-display latency benchmark, server and two headless clients over loopback." << std::endl;
+	std::cout << "  pack        Packs the sounds under ./assets into ./assets/assets.pak for the client." << std::endl;
+	std::cout << "  simcheck    Records simulation inputs and compares per-tick state hashes between builds." << std::endl;
+	std::cout << "  rollback    Rollback stress benchmark and desync detection between two in-process peers." << std::endl;
+	std::cout << "  replay      Inspects, seeks and verifies recorded match replays." << std::endl;
+	std::cout << "  scan        Aggregate rally, hit angle and ball speed stats over a folder of replays, in parallel." << std::endl;
+	std::cout << "  matchmaking Matchmaking queue throughput and per-tick cost with a deep queue." << std::endl;
+	std::cout << "  link        Gateway to worker transports compared, loopback UDP against shared memory." << std::endl;
+	std::cout << "  upgrade     Synthetic players against a worker, to check restarting it with --handoff resets no matches." << std::endl;
+	std::cout << "  relay       Spectator fan-out cost per frame and per send, and how many spectators a relay core keeps up with." << std::endl;
+	std::cout << "  bots        Bot against bot matches, what the server's bots cost against its match update. A repeatable load." << std::endl;
+	std::cout << "  log         What a log line costs the thread writing it, flushed to a stream against the background logger." << std::endl;
+}
+
+// ------------------------- Entry point.
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::string tool = argv[1];
+	if (tool == "latency")
+		return RunLatencyBench(argc - 2, argv + 2);
+	if (tool == "pack")
+		return RunAssetPacker(argc - 2, argv + 2);
+	if (tool == "simcheck")
+		return RunSimCheck(argc - 2, argv + 2);
+	if (tool == "rollback")
+		return RunRollbackBench(argc - 2, argv + 2);
+	if (tool == "replay")
+		return RunReplayPlayer(argc - 2, argv + 2);
+	if (tool == "scan")
+		return RunReplayScan(argc - 2, argv + 2);
+	if (tool == "matchmaking")
+		return RunMatchmakerBench(argc - 2, argv + 2);
+	if (tool == "link")
+		return RunLinkBench(argc - 2, argv + 2);
+	if (tool == "upgrade")
+		return RunUpgradeCheck(argc - 2, argv + 2);
+	if (tool == "relay")
+		return RunRelayBench(argc - 2, argv + 2);
+	if (tool == "bots")
+		return RunBotBench(argc - 2, argv + 2);
+	if (tool == "log")
+		return RunLogBench(argc - 2, argv + 2);
+
+	PrintUsage();
+	return 1;
+}
@@ -0,0 +1,109 @@
+#include "AssetArchive.h"
+
+#include <cstring>
+#include <fstream>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void AssetArchiveWriter::Add(const AssetArchiveEntry &entry, const void *data, uint64_t size)
+{
+	AssetArchiveEntry added = entry;
+	added.size = size;
+	m_entries.push_back(added);
+
+	const uint8_t *bytes = (const uint8_t *)data;
+	m_blobs.emplace_back(bytes, bytes + size);
+}
+
+bool AssetArchiveWriter::Write(const std::string &path) const
+{
+	std::vector<AssetArchiveEntry> entries = m_entries;
+
+	// Lay the blobs out after the table.
+	uint64_t offset = AlignUp(sizeof(AssetArchiveHeader) + sizeof(AssetArchiveEntry) * entries.size(), assetBlobAlignment);
+	for (AssetArchiveEntry &entry : entries)
+	{
+		entry.offset = offset;
+		offset = AlignUp(offset + entry.size, assetBlobAlignment);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	AssetArchiveHeader header;
+	header.version = assetArchiveVersion;
+	header.entryCount = (uint32_t)entries.size();
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)entries.data(), sizeof(AssetArchiveEntry) * entries.size());
+
+	static const char padding[assetBlobAlignment] = { };
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		uint64_t position = (uint64_t)file.tellp();
+		file.write(padding, (std::streamsize)(entries[i].offset - position));
+		file.write((const char *)m_blobs[i].data(), (std::streamsize)m_blobs[i].size());
+	}
+
+	return file.good();
+}
+
+bool AssetArchive::Open(const std::string &path)
+{
+	Close();
+
+	if (!m_file.Open(path))
+		return false;
+
+	const uint8_t *data = m_file.GetData();
+	size_t size = m_file.GetSize();
+
+	// Validate everything up front so lookups don't have to.
+	AssetArchiveHeader header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.magic, "PPAK", 4) != 0 || header.version != assetArchiveVersion ||
+		size < sizeof(header) + (uint64_t)header.entryCount * sizeof(AssetArchiveEntry))
+	{
+		Close();
+		return false;
+	}
+
+	const AssetArchiveEntry *entries = (const AssetArchiveEntry *)(data + sizeof(header));
+	for (uint32_t i = 0; i < header.entryCount; i++)
+	{
+		if (entries[i].offset > size || entries[i].size > size - entries[i].offset ||
+			entries[i].name[sizeof(entries[i].name) - 1] != '\0' || entries[i].fileType[sizeof(entries[i].fileType) - 1] != '\0')
+		{
+			Close();
+			return false;
+		}
+	}
+
+	m_entries = entries;
+	m_entryCount = header.entryCount;
+	return true;
+}
+
+void AssetArchive::Close()
+{
+	m_file.Close();
+	m_entries = nullptr;
+	m_entryCount = 0;
+}
+
+const AssetArchiveEntry *AssetArchive::Find(const std::string &name) const
+{
+	for (uint32_t i = 0; i < m_entryCount; i++) // Only a handful of assets, a linear search is fine.
+		if (name == m_entries[i].name)
+			return &m_entries[i];
+	return nullptr;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Packed asset archive, made offline by 'Pong_Tools pack' and memory mapped at runtime.
+// Layout: header, entry table, then each asset's blob aligned to BLOB_ALIGNMENT.
+// All integers are little endian.
+
+enum class eAssetFormat : uint32_t
+{
+	ENCODED = 0, // File as it was on disk, e.g. an .ogg, decoded when loaded.
+	PCM, // Already decoded samples, see the entry's audio fields.
+};
+
+struct AssetArchiveHeader
+{
+	char magic[4] = { 'P', 'P', 'A', 'K' };
+	uint32_t version = 1;
+	uint32_t entryCount = 0;
+	uint32_t reserved = 0;
+};
+
+struct AssetArchiveEntry
+{
+	char name[48] = ""; // Path relative to the assets folder, e.g. "sfx/pong/score.ogg".
+	char fileType[8] = ""; // Encoded only, e.g. ".ogg".
+
+	uint64_t offset = 0; // From the start of the archive.
+	uint64_t size = 0;
+
+	eAssetFormat format = eAssetFormat::ENCODED;
+	uint32_t sampleRate = 0; // PCM only.
+	uint32_t sampleSize = 0; // Bits.
+	uint32_t channels = 0;
+	uint32_t frameCount = 0;
+	uint32_t reserved = 0;
+};
+
+constexpr uint32_t assetArchiveVersion = 1;
+constexpr uint64_t assetBlobAlignment = 16;
+
+// Builds an archive in memory then writes it out in one go.
+class AssetArchiveWriter
+{
+public:
+	void Add(const AssetArchiveEntry &entry, const void *data, uint64_t size); // Offset and size are filled in.
+	bool Write(const std::string &path) const;
+
+private:
+	std::vector<AssetArchiveEntry> m_entries;
+	std::vector<std::vector<uint8_t>> m_blobs;
+
+};
+
+// Reads straight out of the mapped file, nothing is copied.
+class AssetArchive
+{
+public:
+	bool Open(const std::string &path);
+	void Close();
+
+	bool IsOpen() const { return m_entries != nullptr; }
+
+	const AssetArchiveEntry *Find(const std::string &name) const;
+	const uint8_t *GetData(const AssetArchiveEntry &entry) const { return m_file.GetData() + entry.offset; }
+
+	uint32_t GetEntryCount() const { return m_entryCount; }
+	const AssetArchiveEntry &GetEntry(uint32_t index) const { return m_entries[index]; }
+
+private:
+	MappedFile m_file;
+	const AssetArchiveEntry *m_entries = nullptr;
+	uint32_t m_entryCount = 0;
+
+};
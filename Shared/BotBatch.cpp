@@ -0,0 +1,168 @@
+// GCC's half of the /fp:fast the vcxprojs build this with. At plain O2 it won't vectorise Think()'s loop, it needs to
+// assume float compares don't trap and to weigh the loop's cost properly. Bots aren't part of the deterministic
+// simulation, so none of it changes anything that's hashed. Ahead of the includes, std::max and friends have to be built
+// the same way or they won't inline into the loop.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("no-trapping-math", "vect-cost-model=dynamic")
+#endif
+
+#include "BotBatch.h"
+
+#include <cmath>
+#include <algorithm>
+
+constexpr float botDeadZone = paddleVSpeed * simTickTime; // Closer than a tick's movement, moving would only overshoot.
+constexpr float botMinClosingSpeed = 1e-4f; // Keeps the time to reach them finite, it's thrown away if the ball isn't coming anyway.
+
+void BotBatch::SetReactionTime(float seconds)
+{
+	int ticks = (int)std::lround(seconds * simTickRate);
+	m_reactionTicks = std::clamp(ticks, 0, botMaxReactionTicks - 1);
+}
+
+void BotBatch::Add(uint32_t id, int side, uint64_t seed)
+{
+	size_t index = m_ids.size();
+	Resize(index + 1);
+
+	m_ids[index] = id;
+	m_paddleX[index] = SimToFloat(SimPaddleX(side));
+	m_facing[index] = side == SIM_RIGHT ? 1.0f : -1.0f;
+	m_seeds[index] = seed;
+	m_rallies[index] = 0;
+	m_aimOffset[index] = 0.0f;
+	m_approaching[index] = 0;
+
+	// Nothing seen yet, so a still ball in the middle until its history fills up.
+	BotObservation nothing;
+	for (int slot = 0; slot < botMaxReactionTicks; slot++)
+	{
+		m_ballX[slot][index] = nothing.ballX;
+		m_ballY[slot][index] = nothing.ballY;
+		m_ballXVelocity[slot][index] = nothing.ballXVelocity;
+		m_ballYVelocity[slot][index] = nothing.ballYVelocity;
+	}
+	m_paddleY[index] = nothing.paddleY;
+	m_playing[index] = nothing.playing;
+	m_inputs[index] = 0;
+}
+
+bool BotBatch::Remove(uint32_t id)
+{
+	auto it = std::find(m_ids.begin(), m_ids.end(), id);
+	if (it == m_ids.end())
+		return false;
+
+	// The last one takes its place in every array.
+	size_t index = it - m_ids.begin(), last = m_ids.size() - 1;
+	auto move = [&](auto &values) { values[index] = values[last]; };
+	move(m_ids);
+	move(m_paddleX);
+	move(m_facing);
+	move(m_seeds);
+	move(m_rallies);
+	move(m_aimOffset);
+	move(m_approaching);
+	move(m_paddleY);
+	move(m_playing);
+	move(m_inputs);
+	for (int slot = 0; slot < botMaxReactionTicks; slot++)
+	{
+		move(m_ballX[slot]);
+		move(m_ballY[slot]);
+		move(m_ballXVelocity[slot]);
+		move(m_ballYVelocity[slot]);
+	}
+
+	Resize(last);
+	return true;
+}
+
+void BotBatch::Observe(size_t index, const BotObservation &observation)
+{
+	int slot = m_tick % botMaxReactionTicks;
+	m_ballX[slot][index] = observation.ballX;
+	m_ballY[slot][index] = observation.ballY;
+	m_ballXVelocity[slot][index] = observation.ballXVelocity;
+	m_ballYVelocity[slot][index] = observation.ballYVelocity;
+	m_paddleY[index] = observation.paddleY;
+	m_playing[index] = observation.playing;
+}
+
+void BotBatch::Think()
+{
+	size_t count = m_ids.size();
+	int seen = (m_tick + botMaxReactionTicks - m_reactionTicks) % botMaxReactionTicks; // The same tick for everyone.
+	m_tick++;
+	if (count == 0)
+		return;
+
+	const float *ballX = m_ballX[seen].data();
+	const float *ballY = m_ballY[seen].data();
+	const float *ballXVelocity = m_ballXVelocity[seen].data();
+	const float *ballYVelocity = m_ballYVelocity[seen].data();
+	const float *paddleX = m_paddleX.data();
+	const float *facing = m_facing.data();
+	const float *paddleY = m_paddleY.data();
+	const uint32_t *playing = m_playing.data();
+	const float *aimOffset = m_aimOffset.data();
+	uint32_t *approaching = m_approaching.data();
+	uint32_t *inputs = m_inputs.data();
+
+	// Where the ball they saw will cross their paddle, bounces folded back into the court.
+	// Aim offsets are a rally behind here, the ones that just turned are drawn below and catch up next tick.
+	for (size_t i = 0; i < count; i++)
+	{
+		float closingSpeed = ballXVelocity[i] * facing[i];
+		float distance = (paddleX[i] - ballX[i]) * facing[i];
+		float time = std::max(distance, 0.0f) / std::max(closingSpeed, botMinClosingSpeed);
+
+		float y = (ballY[i] + ballYVelocity[i] * time) * 0.5f;
+		float truncated = (float)(int)y; // Floor without the library call, so the loop still vectorises.
+		float folded = 2.0f * (y - truncated + (truncated > y ? 1.0f : 0.0f)); // [0, 2), a bounce every 1.
+		float landing = 1.0f - std::fabs(1.0f - folded);
+
+		float aimed = landing + aimOffset[i];
+		uint32_t coming = (closingSpeed > 0.0f) & (playing[i] != 0);
+		float target = coming ? aimed : 0.5f; // Back to the middle while it's going away.
+		float difference = target - paddleY[i];
+
+		inputs[i] = (difference < -botDeadZone ? (uint32_t)SIM_INPUT_UP : 0u) | (difference > botDeadZone ? (uint32_t)SIM_INPUT_DOWN : 0u);
+		approaching[i] = coming | (approaching[i] << 1); // Bit 1 is last tick's.
+	}
+
+	// New rallies, only a handful a tick so this doesn't need to be fast.
+	for (size_t i = 0; i < count; i++)
+	{
+		if (approaching[i] != 1) // Only the ones coming now that weren't before.
+		{
+			approaching[i] &= 1;
+			continue;
+		}
+
+		uint32_t bits = (uint32_t)(SimRandom(m_seeds[i], m_rallies[i]++) >> 40);
+		float unit = bits * (1.0f / 16777216.0f); // [0, 1)
+		m_aimOffset[i] = (unit * 2.0f - 1.0f) * m_error;
+	}
+}
+
+void BotBatch::Resize(size_t count)
+{
+	m_ids.resize(count);
+	m_paddleX.resize(count);
+	m_facing.resize(count);
+	m_seeds.resize(count);
+	m_rallies.resize(count);
+	m_aimOffset.resize(count);
+	m_approaching.resize(count);
+	m_paddleY.resize(count);
+	m_playing.resize(count);
+	m_inputs.resize(count);
+	for (int slot = 0; slot < botMaxReactionTicks; slot++)
+	{
+		m_ballX[slot].resize(count);
+		m_ballY[slot].resize(count);
+		m_ballXVelocity[slot].resize(count);
+		m_ballYVelocity[slot].resize(count);
+	}
+}
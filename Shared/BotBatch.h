@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "Simulation.h"
+
+// Computer players, every one of them decided together in a single pass once a tick.
+// Each field is its own array, one entry per bot, and the pass over them has no branches so the compiler can vectorise
+// it. Bots see the ball a reaction time late and aim a random distance off where it's going to be, drawn once a rally
+// from their seed, so the same seeds and observations always give the same inputs. That makes them a repeatable load
+// source too, see 'Pong_Tools bots'.
+// Not thread safe, the server only touches it from the tick.
+
+constexpr float defaultBotReactionTime = 0.15f; // Seconds.
+constexpr float defaultBotError = 0.11f; // Furthest off they aim, as a fraction of the court's height.
+constexpr int botMaxReactionTicks = 32; // Ball history kept, longer reaction times are clamped to it.
+
+// What a bot sees of its match, once a tick.
+struct BotObservation
+{
+	float ballX = 0.5f;
+	float ballY = 0.5f;
+	float ballXVelocity = 0.0f;
+	float ballYVelocity = 0.0f;
+	float paddleY = 0.5f; // Its own, this one's never late.
+	bool playing = false;
+};
+
+class BotBatch
+{
+public:
+	void SetReactionTime(float seconds);
+	void SetError(float error) { m_error = error > 0.0f ? error : 0.0f; }
+	float GetReactionTime() const { return m_reactionTicks * simTickTime; }
+	float GetError() const { return m_error; }
+
+	void Add(uint32_t id, int side, uint64_t seed); // Seed's for its aim, give it the same one to get the same game.
+	bool Remove(uint32_t id);
+	size_t GetCount() const { return m_ids.size(); }
+	uint32_t GetId(size_t index) const { return m_ids[index]; } // Indexes move when a bot's removed.
+
+	void Observe(size_t index, const BotObservation &observation);
+	void Think(); // Every bot, from what they've observed up to now.
+	uint8_t GetInput(size_t index) const { return (uint8_t)m_inputs[index]; } // eSimInput flags, as of the last Think().
+
+private:
+	void Resize(size_t count);
+
+private:
+	int m_reactionTicks = (int)(defaultBotReactionTime * simTickRate);
+	float m_error = defaultBotError;
+	uint32_t m_tick = 0; // Think()s so far, picks the history slot.
+
+	std::vector<uint32_t> m_ids;
+	std::vector<float> m_paddleX; // Where the ball has to get to, from their side.
+	std::vector<float> m_facing; // +1 on the right, -1 on the left, so the ball's heading for them when its velocity's the same sign.
+	std::vector<uint64_t> m_seeds;
+	std::vector<uint32_t> m_rallies; // Times the ball's turned towards them, their aim's drawn from this.
+	std::vector<float> m_aimOffset;
+	std::vector<uint32_t> m_approaching; // As of the last Think(), to spot it turning.
+
+	std::vector<float> m_paddleY;
+	std::vector<uint32_t> m_playing;
+	std::vector<float> m_ballX[botMaxReactionTicks]; // Ring of what they've seen, indexed by tick then bot.
+	std::vector<float> m_ballY[botMaxReactionTicks];
+	std::vector<float> m_ballXVelocity[botMaxReactionTicks];
+	std::vector<float> m_ballYVelocity[botMaxReactionTicks];
+
+	std::vector<uint32_t> m_inputs; // The same width as everything else in Think(), so none of it has to be widened.
+
+};
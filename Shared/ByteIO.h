@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Plain values in and out of the binary formats: replays, match snapshots and handoffs.
+// Copied as they are in memory, so little endian, the only kind of machine any of it is read on.
+
+template<typename T>
+inline void BytesPut(std::vector<uint8_t> &buffer, T value)
+{
+	const uint8_t *bytes = (const uint8_t *)&value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+template<typename T>
+inline bool BytesGet(const uint8_t *&data, const uint8_t *end, T &value) // Moves data past it, false if it runs off the end.
+{
+	if ((size_t)(end - data) < sizeof(value))
+		return false;
+	std::memcpy(&value, data, sizeof(value));
+	data += sizeof(value);
+	return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Monotonic clock used for any timestamp that has to be compared between threads or sent over the network.
+// raylib's GetTime() only starts ticking once a window is open, so it can't be used by headless code.
+inline int64_t ClockNowNanoseconds()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline double ClockNowSeconds()
+{
+	return (double)ClockNowNanoseconds() / 1e9;
+}
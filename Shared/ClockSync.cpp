@@ -0,0 +1,68 @@
+#include "ClockSync.h"
+
+#include <cmath>
+
+void ClockSync::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_sampleCount = 0;
+	m_nextSample = 0;
+	m_offset = 0.0;
+	m_errorBound = 0.0;
+}
+
+void ClockSync::AddSample(double clientSendTime, double serverTime, double clientReceiveTime)
+{
+	double rtt = clientReceiveTime - clientSendTime;
+	if (rtt < 0.0)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Sample &sample = m_samples[m_nextSample];
+	sample.rtt = rtt;
+	sample.offset = serverTime - (clientSendTime + clientReceiveTime) / 2.0;
+	m_nextSample = (m_nextSample + 1) % SAMPLE_WINDOW;
+	if (m_sampleCount < SAMPLE_WINDOW)
+		m_sampleCount++;
+
+	// Best sample in the window.
+	const Sample *best = &m_samples[0];
+	for (unsigned int i = 1; i < m_sampleCount; i++)
+		if (m_samples[i].rtt < best->rtt)
+			best = &m_samples[i];
+
+	// Slew towards it rather than jumping, unless it's way off, e.g. the first few samples.
+	double difference = best->offset - m_offset;
+	if (m_sampleCount <= MIN_SAMPLES || std::abs(difference) > best->rtt)
+		m_offset = best->offset;
+	else
+		m_offset += difference * 0.25;
+
+	m_errorBound = best->rtt / 2.0;
+}
+
+bool ClockSync::IsSynced() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_sampleCount >= MIN_SAMPLES;
+}
+
+unsigned int ClockSync::GetSampleCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_sampleCount;
+}
+
+double ClockSync::GetOffset() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_offset;
+}
+
+double ClockSync::GetErrorBound() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_errorBound;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mutex>
+
+// NTP style estimate of the server's clock, from the client's pings.
+// Each pong carries the server's time when it answered, so offset = serverTime - midpoint of the round trip.
+// Only the lowest RTT sample out of the last few is trusted, queueing delay on either leg skews the others.
+class ClockSync
+{
+public:
+	void Reset();
+
+	void AddSample(double clientSendTime, double serverTime, double clientReceiveTime);
+
+	bool IsSynced() const; // Has at least MIN_SAMPLES.
+	unsigned int GetSampleCount() const;
+
+	double GetOffset() const; // Server clock minus client clock, seconds.
+	double GetErrorBound() const; // Worst case error of the offset, half the best RTT.
+
+	double ServerNow(double clientNow) const { return clientNow + GetOffset(); }
+
+public:
+	constexpr static unsigned int SAMPLE_WINDOW = 16;
+	constexpr static unsigned int MIN_SAMPLES = 4;
+	constexpr static double SYNC_PING_INTERVAL = 0.1; // Ping faster than usual until synced.
+
+private:
+	struct Sample
+	{
+		double rtt = 0.0;
+		double offset = 0.0;
+	};
+
+	mutable std::mutex m_mutex;
+
+	Sample m_samples[SAMPLE_WINDOW];
+	unsigned int m_sampleCount = 0;
+	unsigned int m_nextSample = 0;
+
+	double m_offset = 0.0;
+	double m_errorBound = 0.0;
+
+};
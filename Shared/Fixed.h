@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Q16.16 fixed point, for the simulation's deterministic mode (see PONG_FIXED_POINT_SIM in Simulation.h).
+// Everything is plain integer maths, so it gives the same bits on every compiler, flag and machine.
+// Converting from a float constant happens at compile time. Converting at runtime is exact too, just slower.
+struct Fixed
+{
+	static constexpr int FRACTION_BITS = 16;
+	static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+	int32_t raw = 0;
+
+	constexpr Fixed() = default;
+	constexpr Fixed(int value) : raw(value * ONE) { }
+	constexpr Fixed(float value) : raw((int32_t)(value * (float)ONE + (value >= 0.0f ? 0.5f : -0.5f))) { }
+
+	static constexpr Fixed FromRaw(int32_t raw) { Fixed fixed; fixed.raw = raw; return fixed; }
+	constexpr float ToFloat() const { return (float)raw / (float)ONE; }
+
+	constexpr Fixed operator-() const { return FromRaw(-raw); }
+
+	friend constexpr Fixed operator+(Fixed a, Fixed b) { return FromRaw(a.raw + b.raw); }
+	friend constexpr Fixed operator-(Fixed a, Fixed b) { return FromRaw(a.raw - b.raw); }
+	friend constexpr Fixed operator*(Fixed a, Fixed b) { return FromRaw((int32_t)(((int64_t)a.raw * b.raw) >> FRACTION_BITS)); }
+	friend constexpr Fixed operator/(Fixed a, Fixed b) { return FromRaw((int32_t)(((int64_t)a.raw << FRACTION_BITS) / b.raw)); }
+
+	constexpr Fixed &operator+=(Fixed other) { return *this = *this + other; }
+	constexpr Fixed &operator-=(Fixed other) { return *this = *this - other; }
+	constexpr Fixed &operator*=(Fixed other) { return *this = *this * other; }
+	constexpr Fixed &operator/=(Fixed other) { return *this = *this / other; }
+
+	friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+	friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+	friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+	friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+	friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+	friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+};
+
+constexpr Fixed FixedAbs(Fixed value) { return value.raw < 0 ? -value : value; }
+
+// Table based, radians in and out. Within about 0.00005 of the real thing.
+Fixed FixedSin(Fixed angle);
+Fixed FixedCos(Fixed angle);
@@ -0,0 +1,278 @@
+#include "Handoff.h"
+
+#include <cstring>
+
+#include "Clock.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+constexpr uint32_t handoffMagic = 0x46444E48; // "HNDF".
+constexpr uint32_t handoffVersion = 1;
+constexpr uint8_t handoffAck = 0x4B;
+
+struct HandoffHeader
+{
+	uint32_t magic = handoffMagic;
+	uint32_t version = handoffVersion;
+	uint64_t stateSize = 0;
+	uint32_t descriptorCount = 0; // Attached to this header's bytes.
+	uint32_t reserved = 0;
+};
+
+#ifdef _WIN32
+
+void HandoffCloseDescriptors(std::vector<int> &descriptors) { descriptors.clear(); }
+bool HandoffSocket::Listen(const std::string &path) { return false; }
+bool HandoffSocket::Accept(HandoffSocket &connection, double timeout) { return false; }
+bool HandoffSocket::Connect(const std::string &path) { return false; }
+void HandoffSocket::Close() { }
+bool HandoffSocket::Send(const std::vector<uint8_t> &state, const int *descriptors, int descriptorCount) { return false; }
+bool HandoffSocket::Receive(std::vector<uint8_t> &state, std::vector<int> &descriptors, double timeout) { return false; }
+bool HandoffSocket::SendAck() { return false; }
+bool HandoffSocket::ReceiveAck(double timeout) { return false; }
+bool HandoffSocket::WaitReadable(double timeout) { return false; }
+bool HandoffSocket::SendAll(const void *data, size_t size) { return false; }
+bool HandoffSocket::ReceiveAll(void *data, size_t size, double deadline) { return false; }
+
+#else
+
+static bool MakeAddress(const std::string &path, sockaddr_un &address)
+{
+	address = {};
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+		return false;
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+
+void HandoffCloseDescriptors(std::vector<int> &descriptors)
+{
+	for (int descriptor : descriptors)
+		close(descriptor);
+	descriptors.clear();
+}
+
+bool HandoffSocket::Listen(const std::string &path)
+{
+	Close();
+
+	sockaddr_un address;
+	if (!MakeAddress(path, address))
+		return false;
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (m_socket < 0)
+		return false;
+
+	unlink(path.c_str());
+	if (bind(m_socket, (const sockaddr *)&address, sizeof(address)) != 0 || listen(m_socket, 1) != 0)
+	{
+		Close();
+		return false;
+	}
+	m_listenPath = path;
+	return true;
+}
+
+bool HandoffSocket::Accept(HandoffSocket &connection, double timeout)
+{
+	if (m_socket < 0 || !WaitReadable(timeout))
+		return false;
+
+	int accepted = accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+	if (accepted < 0)
+		return false;
+
+	Close(); // Unlinks it, so the replacement can listen on the same path for the next upgrade.
+
+	connection.Close();
+	connection.m_socket = accepted;
+	return true;
+}
+
+bool HandoffSocket::Connect(const std::string &path)
+{
+	Close();
+
+	sockaddr_un address;
+	if (!MakeAddress(path, address))
+		return false;
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (m_socket < 0)
+		return false;
+
+	if (connect(m_socket, (const sockaddr *)&address, sizeof(address)) != 0) // Refused if the file's stale.
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void HandoffSocket::Close()
+{
+	if (m_socket >= 0)
+		close(m_socket);
+	m_socket = -1;
+
+	if (!m_listenPath.empty())
+		unlink(m_listenPath.c_str());
+	m_listenPath.clear();
+}
+
+bool HandoffSocket::Send(const std::vector<uint8_t> &state, const int *descriptors, int descriptorCount)
+{
+	if (m_socket < 0 || descriptorCount < 0 || descriptorCount > handoffMaxDescriptors)
+		return false;
+
+	HandoffHeader header;
+	header.stateSize = state.size();
+	header.descriptorCount = (uint32_t)descriptorCount;
+
+	iovec vector = { &header, sizeof(header) };
+	msghdr message = {};
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * handoffMaxDescriptors)] = {};
+	if (descriptorCount > 0)
+	{
+		message.msg_control = control;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * descriptorCount);
+
+		cmsghdr *rights = CMSG_FIRSTHDR(&message);
+		rights->cmsg_level = SOL_SOCKET;
+		rights->cmsg_type = SCM_RIGHTS;
+		rights->cmsg_len = CMSG_LEN(sizeof(int) * descriptorCount);
+		std::memcpy(CMSG_DATA(rights), descriptors, sizeof(int) * descriptorCount);
+	}
+
+	ssize_t sent;
+	do
+		sent = sendmsg(m_socket, &message, MSG_NOSIGNAL);
+	while (sent < 0 && errno == EINTR);
+	if (sent < 0)
+		return false;
+
+	// The rest of the header if it was cut short, the descriptors only ride along with the first byte.
+	return SendAll((const uint8_t *)&header + sent, sizeof(header) - (size_t)sent) && SendAll(state.data(), state.size());
+}
+
+bool HandoffSocket::Receive(std::vector<uint8_t> &state, std::vector<int> &descriptors, double timeout)
+{
+	descriptors.clear();
+	if (m_socket < 0)
+		return false;
+
+	double deadline = ClockNowSeconds() + timeout;
+	if (!WaitReadable(timeout))
+		return false;
+
+	HandoffHeader header;
+	iovec vector = { &header, sizeof(header) };
+	msghdr message = {};
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * handoffMaxDescriptors)] = {};
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	ssize_t received;
+	do
+		received = recvmsg(m_socket, &message, MSG_CMSG_CLOEXEC);
+	while (received < 0 && errno == EINTR);
+	if (received <= 0)
+		return false;
+
+	for (cmsghdr *rights = CMSG_FIRSTHDR(&message); rights; rights = CMSG_NXTHDR(&message, rights))
+	{
+		if (rights->cmsg_level != SOL_SOCKET || rights->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		size_t count = (rights->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (size_t i = 0; i < count; i++)
+		{
+			int descriptor;
+			std::memcpy(&descriptor, CMSG_DATA(rights) + i * sizeof(int), sizeof(int));
+			descriptors.push_back(descriptor);
+		}
+	}
+
+	bool ok = !(message.msg_flags & MSG_CTRUNC) &&
+		ReceiveAll((uint8_t *)&header + received, sizeof(header) - (size_t)received, deadline) &&
+		header.magic == handoffMagic && header.version == handoffVersion && header.descriptorCount == descriptors.size();
+	if (ok)
+	{
+		state.resize(header.stateSize);
+		ok = ReceiveAll(state.data(), state.size(), deadline);
+	}
+
+	if (!ok) // Whatever came with it is ours to close.
+		HandoffCloseDescriptors(descriptors);
+	return ok;
+}
+
+bool HandoffSocket::SendAck()
+{
+	return m_socket >= 0 && SendAll(&handoffAck, sizeof(handoffAck));
+}
+
+bool HandoffSocket::ReceiveAck(double timeout)
+{
+	uint8_t ack = 0;
+	return m_socket >= 0 && ReceiveAll(&ack, sizeof(ack), ClockNowSeconds() + timeout) && ack == handoffAck;
+}
+
+bool HandoffSocket::WaitReadable(double timeout)
+{
+	pollfd wait = { m_socket, POLLIN, 0 };
+	return poll(&wait, 1, (int)(timeout * 1000.0)) > 0;
+}
+
+bool HandoffSocket::SendAll(const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	while (size > 0)
+	{
+		ssize_t sent = send(m_socket, bytes, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+bool HandoffSocket::ReceiveAll(void *data, size_t size, double deadline)
+{
+	uint8_t *bytes = (uint8_t *)data;
+	while (size > 0)
+	{
+		double remaining = deadline - ClockNowSeconds();
+		if (remaining <= 0.0 || !WaitReadable(remaining))
+			return false;
+
+		ssize_t received = recv(m_socket, bytes, size, 0);
+		if (received < 0 && errno == EINTR)
+			continue;
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= (size_t)received;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Hands a running worker over to a freshly started binary without dropping anything, for upgrades.
+// The running server listens on a Unix socket. Its replacement connects, and is sent the server's state in one message
+// with the descriptors it needs to carry on (the worker link's socket or shared memory) attached as SCM_RIGHTS, so
+// nothing is ever closed or rebound. Once the replacement has everything running it answers, and the old one exits.
+// The old one only carries on if the state never got there, once it's sent the link is the replacement's, answer or not.
+// POSIX only, on Windows every call fails and the server starts fresh instead.
+
+constexpr int handoffMaxDescriptors = 4;
+constexpr double handoffAckTimeout = 5.0; // Seconds the old server waits for its replacement's answer before exiting anyway.
+
+void HandoffCloseDescriptors(std::vector<int> &descriptors); // Received ones that won't be used.
+
+class HandoffSocket
+{
+public:
+	HandoffSocket() = default;
+	~HandoffSocket() { Close(); }
+
+	HandoffSocket(const HandoffSocket &socket) = delete;
+	HandoffSocket &operator=(const HandoffSocket &socket) = delete;
+
+	bool Listen(const std::string &path); // Replaces a socket file left behind by a server that didn't shut down cleanly.
+	bool Accept(HandoffSocket &connection, double timeout); // Listening socket only. Unlinks the path, one handoff per listen.
+	bool Connect(const std::string &path); // False straight away if nothing is listening.
+	void Close();
+
+	bool IsOpen() const { return m_socket >= 0; }
+
+	// The descriptors stay open on this side too, they're duplicated into the other process.
+	bool Send(const std::vector<uint8_t> &state, const int *descriptors, int descriptorCount);
+	bool Receive(std::vector<uint8_t> &state, std::vector<int> &descriptors, double timeout);
+
+	bool SendAck();
+	bool ReceiveAck(double timeout);
+
+private:
+	bool WaitReadable(double timeout);
+	bool SendAll(const void *data, size_t size);
+	bool ReceiveAll(void *data, size_t size, double deadline);
+
+private:
+	int m_socket = -1;
+	std::string m_listenPath; // Unlinked when the handoff starts or the listener closes.
+
+};
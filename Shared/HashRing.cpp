@@ -0,0 +1,45 @@
+#include "HashRing.h"
+
+#include <algorithm>
+
+static uint64_t HashRingHash(uint64_t value)
+{
+	// SplitMix64's finalizer, consecutive keys and node IDs end up spread all over the ring.
+	value += 0x9E3779B97F4A7C15ull;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+void HashRing::AddNode(uint32_t node)
+{
+	if (HasNode(node))
+		return;
+
+	for (int i = 0; i < hashRingPointsPerNode; i++)
+		m_points.push_back({ HashRingHash(((uint64_t)node << 32) | (uint32_t)i), node });
+	std::sort(m_points.begin(), m_points.end());
+}
+
+void HashRing::RemoveNode(uint32_t node)
+{
+	m_points.erase(std::remove_if(m_points.begin(), m_points.end(), [node](const RingPoint &point) { return point.node == node; }), m_points.end());
+}
+
+bool HashRing::HasNode(uint32_t node) const
+{
+	return std::any_of(m_points.begin(), m_points.end(), [node](const RingPoint &point) { return point.node == node; });
+}
+
+bool HashRing::Lookup(uint64_t key, uint32_t &node) const
+{
+	if (m_points.empty())
+		return false;
+
+	RingPoint point = { HashRingHash(key), 0 };
+	auto it = std::lower_bound(m_points.begin(), m_points.end(), point);
+	if (it == m_points.end()) // Past the last point, round to the first.
+		it = m_points.begin();
+	node = it->node;
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Consistent hashing. Each node is put on the ring at several points, a key belongs to the first node point at or
+// after its own hash. Taking a node away only moves the keys that were on it, everyone else stays where they are.
+
+constexpr int hashRingPointsPerNode = 64; // More evens out the load between nodes, at the cost of a longer ring.
+
+class HashRing
+{
+public:
+	void AddNode(uint32_t node);
+	void RemoveNode(uint32_t node);
+	bool HasNode(uint32_t node) const;
+	size_t GetNodeCount() const { return m_points.size() / hashRingPointsPerNode; }
+
+	bool Lookup(uint64_t key, uint32_t &node) const; // False if there are no nodes.
+
+private:
+	struct RingPoint
+	{
+		uint64_t hash;
+		uint32_t node;
+
+		bool operator<(const RingPoint &other) const { return hash < other.hash || (hash == other.hash && node < other.node); }
+	};
+
+	std::vector<RingPoint> m_points; // Sorted by hash.
+
+};
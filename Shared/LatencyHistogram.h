@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <bit>
+
+// HDR-style log-linear histogram for latency samples, i.e. nanoseconds.
+// Every power of two is split into SUB_BUCKET_COUNT linear buckets, so any recorded value
+// is reported back within ~3% of its real value no matter how large it is, with fixed memory.
+class LatencyHistogram
+{
+public:
+	LatencyHistogram() { Reset(); }
+
+	void Record(int64_t value)
+	{
+		if (value < 0)
+			value = 0;
+
+		m_counts[BucketIndex((uint64_t)value)]++;
+		m_totalCount++;
+		m_sum += (double)value;
+
+		if (value < m_min) m_min = value;
+		if (value > m_max) m_max = value;
+	}
+
+	// Adds samples straight into a bucket, for merging counts that were kept somewhere else, e.g. the profiler's atomics.
+	void RecordBucket(unsigned int index, uint64_t count)
+	{
+		if (count == 0 || index >= BUCKET_COUNT)
+			return;
+
+		int64_t value = (int64_t)BucketUpperBound(index);
+		m_counts[index] += count;
+		m_totalCount += count;
+		m_sum += (double)value * (double)count;
+
+		if (value < m_min) m_min = value;
+		if (value > m_max) m_max = value;
+	}
+
+	void Merge(const LatencyHistogram &other)
+	{
+		for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+			m_counts[i] += other.m_counts[i];
+		m_totalCount += other.m_totalCount;
+		m_sum += other.m_sum;
+
+		if (other.m_min < m_min) m_min = other.m_min;
+		if (other.m_max > m_max) m_max = other.m_max;
+	}
+
+	void Reset()
+	{
+		std::memset(m_counts, 0, sizeof(m_counts));
+		m_totalCount = 0;
+		m_sum = 0.0;
+		m_min = INT64_MAX;
+		m_max = 0;
+	}
+
+	// Percentile is 0-100, e.g. 99.9 for p999.
+	int64_t Percentile(double percentile) const
+	{
+		if (m_totalCount == 0)
+			return 0;
+
+		uint64_t target = (uint64_t)((percentile / 100.0) * (double)m_totalCount + 0.5);
+		if (target < 1) target = 1;
+		if (target > m_totalCount) target = m_totalCount;
+
+		uint64_t seen = 0;
+		for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+		{
+			seen += m_counts[i];
+			if (seen >= target)
+			{
+				int64_t value = (int64_t)BucketUpperBound(i);
+				return value < m_max ? value : m_max; // Never report more than was actually seen.
+			}
+		}
+		return m_max;
+	}
+
+	uint64_t Count() const { return m_totalCount; }
+	int64_t Min() const { return m_totalCount ? m_min : 0; }
+	int64_t Max() const { return m_max; }
+	double Mean() const { return m_totalCount ? m_sum / (double)m_totalCount : 0.0; }
+
+public:
+	constexpr static unsigned int SUB_BUCKET_BITS = 5;
+	constexpr static unsigned int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	constexpr static unsigned int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	static unsigned int BucketIndex(uint64_t value)
+	{
+		if (value < SUB_BUCKET_COUNT) // Small values map 1:1.
+			return (unsigned int)value;
+
+		unsigned int msb = 63 - (unsigned int)std::countl_zero(value);
+		unsigned int shift = msb - SUB_BUCKET_BITS;
+		return (shift + 1) * SUB_BUCKET_COUNT + (unsigned int)((value >> shift) - SUB_BUCKET_COUNT);
+	}
+
+	static uint64_t BucketUpperBound(unsigned int index)
+	{
+		unsigned int bucket = index / SUB_BUCKET_COUNT;
+		uint64_t sub = index % SUB_BUCKET_COUNT;
+		if (bucket == 0)
+			return sub;
+
+		unsigned int shift = bucket - 1;
+		return ((sub + SUB_BUCKET_COUNT + 1) << shift) - 1;
+	}
+
+private:
+	uint64_t m_counts[BUCKET_COUNT];
+	uint64_t m_totalCount = 0;
+	double m_sum = 0.0;
+	int64_t m_min = INT64_MAX;
+	int64_t m_max = 0;
+
+};
@@ -0,0 +1,385 @@
+#include "Logger.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+#include "ByteIO.h"
+#include "Trace.h"
+
+static const char *s_formats[(int)eLogFormat::FORMATS_MAX] = {
+	"{}",
+
+	"Shutting down",
+	"Stats written to {}",
+	"Couldn't open worker port {}",
+	"Couldn't listen for handoffs on {}",
+	"--handoff only works with --worker-port, ignoring it",
+	"Bots can't play rollback matches, ignoring --bot-fill and --bot-matches",
+	"Match {} didn't restore from its snapshot",
+	"Replacement connected, draining",
+	"Handed {} matches over to the new server",
+	"Handoff failed, carrying on",
+	"Replacement didn't confirm it took {} matches over, it may have, stopping",
+	"Taking over from the running server",
+	"Didn't get the running server's state",
+	"Couldn't restore the running server's state",
+	"Resumed {} matches, {} players waiting",
+	"Match {} counting down, {}",
+	"Match {} resumed after {}s",
+	"Couldn't start recording {}",
+
+	"{} {}:{}",
+	"{}",
+	"Countdown, {}",
+	"Desync with peer at tick {}",
+	"Lost connection, reconnecting",
+	"Couldn't reconnect in time",
+	"Match didn't wait for us",
+	"Back in the match {}ms after reconnecting, {}s after dropping",
+	"Queued for a match, {} waiting",
+	"First frame after {}ms",
+};
+
+const char *LogFormatText(eLogFormat format)
+{
+	return (int)format < (int)eLogFormat::FORMATS_MAX ? s_formats[(int)format] : "{}";
+}
+
+// One per thread, a single producer single consumer ring.
+// Positions only ever go up, the ring index is the position masked, so full and empty can't be mistaken for each other.
+struct ThreadLog
+{
+	uint8_t ring[logRingSize];
+	std::atomic<uint64_t> head = 0; // Bytes ever written, only its own thread moves it.
+	std::atomic<uint64_t> tail = 0; // Bytes ever read, only the writer thread moves it.
+	std::atomic<uint64_t> dropped = 0;
+};
+
+// Token bucket per format, only the writer thread touches them.
+struct LogFormatLimit
+{
+	double tokens = 0.0;
+	int64_t lastTime = 0; // Nanoseconds, of the last line it let through or held back.
+	uint64_t suppressed = 0; // Since the last time it was reported.
+	int64_t lastReport = 0;
+};
+
+static std::mutex s_registryMutex; // Only taken when a thread logs for the first time, and by the writer to find the rings.
+static std::vector<std::unique_ptr<ThreadLog>> s_threadLogs; // Kept after their thread exits so their lines aren't lost.
+
+static thread_local ThreadLog *t_threadLog = nullptr;
+
+static std::atomic<bool> s_running = false;
+static std::thread s_writer;
+static std::ofstream s_file;
+static std::ostream *s_output = &std::cout;
+
+static double s_rate = defaultLogRate;
+static double s_burst = defaultLogBurst;
+static LogFormatLimit s_limits[(int)eLogFormat::FORMATS_MAX];
+static uint64_t s_reportedDropped = 0;
+
+static std::atomic<uint64_t> s_written = 0;
+static std::atomic<uint64_t> s_suppressed = 0;
+
+static const int64_t s_epoch = ClockNowNanoseconds(); // Lines are timed from when the process started.
+
+static ThreadLog *GetThreadLog()
+{
+	if (t_threadLog == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(s_registryMutex);
+		s_threadLogs.push_back(std::make_unique<ThreadLog>());
+		t_threadLog = s_threadLogs.back().get();
+	}
+	return t_threadLog;
+}
+
+static void RingWrite(uint8_t *ring, uint64_t position, const uint8_t *data, size_t size)
+{
+	size_t offset = position & (logRingSize - 1), first = std::min(size, logRingSize - offset);
+	std::memcpy(ring + offset, data, first);
+	std::memcpy(ring, data + first, size - first); // Wrapped around.
+}
+
+static void RingRead(const uint8_t *ring, uint64_t position, uint8_t *data, size_t size)
+{
+	size_t offset = position & (logRingSize - 1), first = std::min(size, logRingSize - offset);
+	std::memcpy(data, ring + offset, first);
+	std::memcpy(data + first, ring, size - first);
+}
+
+void Logger::Push(LogEntry &entry)
+{
+	ThreadLog *log = GetThreadLog();
+
+	uint16_t size = (uint16_t)entry.size;
+	std::memcpy(entry.data, &size, sizeof(size));
+
+	uint64_t head = log->head.load(std::memory_order_relaxed);
+	if (head + size - log->tail.load(std::memory_order_acquire) > logRingSize) // The writer's behind, losing the line beats waiting for it.
+	{
+		log->dropped.store(log->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // Single writer, no need for a locked add.
+		return;
+	}
+
+	RingWrite(log->ring, head, entry.data, size);
+	log->head.store(head + size, std::memory_order_release);
+}
+
+static void AppendTime(std::string &text, int64_t time)
+{
+	char stamp[32];
+	std::snprintf(stamp, sizeof(stamp), "[%10.3f] ", (time - s_epoch) / 1e9);
+	text += stamp;
+}
+
+static void AppendArgument(std::string &text, const uint8_t *&data, const uint8_t *end)
+{
+	uint8_t type;
+	if (!BytesGet(data, end, type))
+	{
+		text += "{}"; // Ran out, it was logged with fewer than the format has.
+		return;
+	}
+
+	char number[32];
+	switch (type)
+	{
+		case LOG_ARGUMENT_INT:
+		{
+			int64_t value = 0;
+			BytesGet(data, end, value);
+			std::snprintf(number, sizeof(number), "%lld", (long long)value);
+			text += number;
+		} break;
+		case LOG_ARGUMENT_UINT:
+		{
+			uint64_t value = 0;
+			BytesGet(data, end, value);
+			std::snprintf(number, sizeof(number), "%llu", (unsigned long long)value);
+			text += number;
+		} break;
+		case LOG_ARGUMENT_FLOAT:
+		{
+			double value = 0.0;
+			BytesGet(data, end, value);
+			std::snprintf(number, sizeof(number), "%g", value);
+			text += number;
+		} break;
+		case LOG_ARGUMENT_STRING:
+		{
+			uint8_t length = 0;
+			BytesGet(data, end, length);
+			length = (uint8_t)std::min((size_t)length, (size_t)(end - data));
+			text.append((const char *)data, length);
+			data += length;
+		} break;
+		default:
+			data = end;
+			break;
+	}
+}
+
+static void AppendEntry(std::string &text, const uint8_t *entry)
+{
+	uint16_t size, format;
+	int64_t time;
+	std::memcpy(&size, entry, sizeof(size));
+	std::memcpy(&format, entry + sizeof(uint16_t), sizeof(format));
+	std::memcpy(&time, entry + sizeof(uint16_t) * 2, sizeof(time));
+
+	AppendTime(text, time);
+	const uint8_t *data = entry + LogEntry::HEADER_SIZE, *end = entry + size;
+	for (const char *c = LogFormatText((eLogFormat)format); *c != '\0'; c++)
+	{
+		if (c[0] == '{' && c[1] == '}')
+		{
+			AppendArgument(text, data, end);
+			c++;
+		}
+		else
+			text += *c;
+	}
+	text += '\n';
+}
+
+static bool AllowLine(eLogFormat format, int64_t time)
+{
+	if (s_rate <= 0.0)
+		return true;
+
+	// Entries from different threads can land a pass apart, so time only counts forwards.
+	LogFormatLimit &limit = s_limits[(int)format];
+	if (time > limit.lastTime)
+	{
+		limit.tokens = std::min(s_burst, limit.tokens + (time - limit.lastTime) / 1e9 * s_rate);
+		limit.lastTime = time;
+	}
+
+	if (limit.tokens < 1.0)
+	{
+		limit.suppressed++;
+		s_suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	limit.tokens -= 1.0;
+	return true;
+}
+
+// Everything in every ring as of now, in time order, then one write and one flush for all of it.
+static void WritePass(bool last, std::vector<uint8_t> &entries, std::vector<size_t> &offsets, std::string &text)
+{
+	std::vector<ThreadLog *> logs;
+	{
+		std::lock_guard<std::mutex> lock(s_registryMutex); // Not held while formatting, a thread logging for the first time would wait on it.
+		for (const std::unique_ptr<ThreadLog> &log : s_threadLogs)
+			logs.push_back(log.get());
+	}
+
+	entries.clear();
+	offsets.clear();
+	uint64_t dropped = 0;
+	for (ThreadLog *log : logs)
+	{
+		uint64_t tail = log->tail.load(std::memory_order_relaxed), head = log->head.load(std::memory_order_acquire);
+		size_t start = entries.size();
+		entries.resize(start + (size_t)(head - tail));
+		RingRead(log->ring, tail, entries.data() + start, (size_t)(head - tail));
+		log->tail.store(head, std::memory_order_release); // Copied out, its thread can have the space back.
+		dropped += log->dropped.load(std::memory_order_relaxed);
+
+		for (size_t offset = start; offset < entries.size();)
+		{
+			uint16_t size;
+			std::memcpy(&size, entries.data() + offset, sizeof(size));
+			offsets.push_back(offset);
+			offset += size;
+		}
+	}
+
+	// Each ring's already in order, this interleaves the threads.
+	auto timeOf = [&](size_t offset)
+	{
+		int64_t time;
+		std::memcpy(&time, entries.data() + offset + sizeof(uint16_t) * 2, sizeof(time));
+		return time;
+	};
+	std::stable_sort(offsets.begin(), offsets.end(), [&](size_t a, size_t b) { return timeOf(a) < timeOf(b); });
+
+	text.clear();
+	int64_t now = ClockNowNanoseconds();
+	uint64_t written = 0;
+	for (size_t offset : offsets)
+	{
+		uint16_t format;
+		std::memcpy(&format, entries.data() + offset + sizeof(uint16_t), sizeof(format));
+		if (format >= (uint16_t)eLogFormat::FORMATS_MAX || !AllowLine((eLogFormat)format, timeOf(offset)))
+			continue;
+
+		AppendEntry(text, entries.data() + offset);
+		written++;
+	}
+
+	if (dropped > s_reportedDropped)
+	{
+		AppendTime(text, now);
+		text += std::to_string(dropped - s_reportedDropped) + " lines dropped, logged faster than they could be written\n";
+		s_reportedDropped = dropped;
+	}
+
+	// What the limits held back, at most once a second per format so the reports aren't noise of their own.
+	for (int format = 0; format < (int)eLogFormat::FORMATS_MAX; format++)
+	{
+		LogFormatLimit &limit = s_limits[format];
+		if (limit.suppressed == 0 || (!last && now - limit.lastReport < 1000000000))
+			continue;
+
+		AppendTime(text, now);
+		text += std::to_string(limit.suppressed) + " more \"" + s_formats[format] + "\" lines held back\n";
+		limit.suppressed = 0;
+		limit.lastReport = now;
+	}
+
+	if (text.empty())
+		return;
+	s_output->write(text.data(), text.size());
+	s_output->flush();
+	s_written.fetch_add(written, std::memory_order_relaxed);
+}
+
+void Logger::SetRateLimit(double linesPerSecond, double burst)
+{
+	if (s_running.load(std::memory_order_acquire))
+		return;
+	s_rate = linesPerSecond > 0.0 ? linesPerSecond : 0.0;
+	s_burst = burst > 1.0 ? burst : 1.0;
+}
+
+bool Logger::Start(const std::string &path)
+{
+	if (s_running.load(std::memory_order_acquire))
+		return false;
+
+	if (!path.empty())
+	{
+		s_file.open(path, std::ios::app);
+		if (!s_file.is_open())
+			return false;
+		s_output = &s_file;
+	}
+
+	for (LogFormatLimit &limit : s_limits)
+		limit = { s_burst, ClockNowNanoseconds(), 0, 0 };
+
+	s_running.store(true, std::memory_order_release);
+	s_writer = std::thread([]()
+	{
+		PONG_TRACE_THREAD_NAME("log writer");
+
+		std::vector<uint8_t> entries;
+		std::vector<size_t> offsets;
+		std::string text;
+		while (s_running.load(std::memory_order_acquire))
+		{
+			WritePass(false, entries, offsets, text);
+			std::this_thread::sleep_for(std::chrono::duration<double>(logFlushInterval));
+		}
+		WritePass(true, entries, offsets, text);
+	});
+	return true;
+}
+
+void Logger::Stop()
+{
+	if (!s_running.exchange(false))
+		return;
+	s_writer.join();
+
+	if (s_file.is_open())
+		s_file.close();
+	s_output = &std::cout;
+}
+
+bool Logger::IsRunning()
+{
+	return s_running.load(std::memory_order_acquire);
+}
+
+LoggerStats Logger::GetStats()
+{
+	LoggerStats stats;
+	stats.written = s_written.load(std::memory_order_relaxed);
+	stats.suppressed = s_suppressed.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(s_registryMutex);
+	for (const std::unique_ptr<ThreadLog> &log : s_threadLogs)
+		stats.dropped += log->dropped.load(std::memory_order_relaxed);
+	return stats;
+}
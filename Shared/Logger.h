@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "Clock.h"
+
+// Log lines that cost the thread writing them a copy into its own buffer and nothing more.
+// An entry is a format's ID and its arguments as they are, no text. Every thread has its own ring of them so writing
+// takes no locks, and a background thread turns them into text, in time order, and writes them out a batch at a time.
+// A full ring drops the entry rather than wait for the writer, and each format is rate limited on its own so one noisy
+// line can't bury the rest. How many were dropped or held back is logged in their place.
+
+constexpr size_t logRingSize = 1 << 16; // Bytes per thread, a power of two.
+constexpr size_t logMaxEntrySize = 256; // Longer strings are cut short to fit.
+constexpr double logFlushInterval = 0.02; // Seconds between the writer's passes.
+constexpr double defaultLogRate = 20.0; // Lines a second, per format. 0 for no limit.
+constexpr double defaultLogBurst = 100.0; // Lines a format can write at once before the rate applies.
+
+// Everything that can be logged, their text is in Logger.cpp. Each {} is replaced by the next argument.
+enum class eLogFormat : uint16_t
+{
+	TEXT = 0, // Already a string, for anything that's only logged once.
+
+	// Server.
+	SERVER_SHUTTING_DOWN,
+	SERVER_STATS_WRITTEN,
+	SERVER_WORKER_PORT_FAILED,
+	SERVER_HANDOFF_LISTEN_FAILED,
+	SERVER_HANDOFF_NEEDS_WORKER,
+	SERVER_BOTS_NEED_SIMULATION,
+	SERVER_MIGRATION_FAILED,
+	SERVER_HANDOFF_DRAINING,
+	SERVER_HANDOFF_DONE,
+	SERVER_HANDOFF_FAILED,
+	SERVER_HANDOFF_UNCONFIRMED,
+	SERVER_TAKING_OVER,
+	SERVER_TAKE_OVER_NO_STATE,
+	SERVER_TAKE_OVER_FAILED,
+	SERVER_TAKEN_OVER,
+	MATCH_COUNTDOWN,
+	MATCH_RESUMED,
+	MATCH_RECORDING_FAILED,
+
+	// Client.
+	CLIENT_CONNECTING,
+	CLIENT_SERVER_MESSAGE,
+	CLIENT_COUNTDOWN,
+	CLIENT_DESYNC,
+	CLIENT_DROPPED,
+	CLIENT_RECONNECT_EXPIRED,
+	CLIENT_MATCH_GONE,
+	CLIENT_RESUMED,
+	CLIENT_QUEUED,
+	CLIENT_FIRST_FRAME,
+
+	FORMATS_MAX
+};
+
+const char *LogFormatText(eLogFormat format);
+
+enum eLogArgument : uint8_t
+{
+	LOG_ARGUMENT_INT = 0,
+	LOG_ARGUMENT_UINT,
+	LOG_ARGUMENT_FLOAT,
+	LOG_ARGUMENT_STRING, // uint8_t length then the characters.
+};
+
+// One entry as it's built up on the logging thread's stack, before it's copied into the ring.
+// Laid out as uint16_t size, uint16_t format, int64_t nanoseconds then each argument's eLogArgument and value.
+struct LogEntry
+{
+	constexpr static size_t HEADER_SIZE = sizeof(uint16_t) * 2 + sizeof(int64_t);
+
+	uint8_t data[logMaxEntrySize];
+	size_t size = HEADER_SIZE;
+
+	LogEntry(eLogFormat format)
+	{
+		uint16_t id = (uint16_t)format;
+		int64_t time = ClockNowNanoseconds();
+		std::memcpy(data + sizeof(uint16_t), &id, sizeof(id));
+		std::memcpy(data + sizeof(uint16_t) * 2, &time, sizeof(time));
+	}
+
+	template<typename T>
+	void Add(const T &value)
+	{
+		if constexpr (std::is_enum_v<T>)
+			Add((std::underlying_type_t<T>)value);
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+			Put(LOG_ARGUMENT_INT, (int64_t)value);
+		else if constexpr (std::is_integral_v<T>)
+			Put(LOG_ARGUMENT_UINT, (uint64_t)value);
+		else if constexpr (std::is_floating_point_v<T>)
+			Put(LOG_ARGUMENT_FLOAT, (double)value);
+		else
+			PutString(std::string_view(value));
+	}
+
+private:
+	template<typename T>
+	void Put(eLogArgument type, T value)
+	{
+		if (size + 1 + sizeof(value) > logMaxEntrySize)
+			return;
+		data[size++] = type;
+		std::memcpy(data + size, &value, sizeof(value));
+		size += sizeof(value);
+	}
+
+	void PutString(std::string_view text)
+	{
+		if (size + 2 > logMaxEntrySize)
+			return;
+		size_t length = std::min(text.size(), std::min(logMaxEntrySize - size - 2, (size_t)UINT8_MAX));
+		data[size++] = LOG_ARGUMENT_STRING;
+		data[size++] = (uint8_t)length;
+		std::memcpy(data + size, text.data(), length);
+		size += length;
+	}
+
+};
+
+struct LoggerStats
+{
+	uint64_t written = 0; // Lines.
+	uint64_t dropped = 0; // Entries a full ring turned away.
+	uint64_t suppressed = 0; // Lines over their format's rate.
+};
+
+class Logger
+{
+public:
+	static void SetRateLimit(double linesPerSecond, double burst = defaultLogBurst); // Before Start().
+
+	static bool Start(const std::string &path = ""); // Writes to the console if there's no path.
+	static void Stop(); // Writes out whatever's left first.
+	static bool IsRunning();
+
+	// Never waits on the writer, a thread's first line only takes a lock to set its ring up. Lines before Start() wait for it.
+	template<typename... Args>
+	static void Write(eLogFormat format, const Args &...args)
+	{
+		LogEntry entry(format);
+		(entry.Add(args), ...);
+		Push(entry);
+	}
+
+	static LoggerStats GetStats();
+
+private:
+	static void Push(LogEntry &entry);
+
+};
+
+#define PONG_LOG(format, ...) Logger::Write(eLogFormat::format, ##__VA_ARGS__)
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Read only memory mapped file. Kept away from raylib.h on purpose, windows.h and raylib don't get along.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile &file) = delete;
+	MappedFile &operator=(const MappedFile &file) = delete;
+
+	bool Open(const std::string &path);
+	void Close();
+
+	bool IsOpen() const { return m_data != nullptr || m_isEmpty; }
+
+	const uint8_t *GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	const uint8_t *m_data = nullptr;
+	size_t m_size = 0;
+	bool m_isEmpty = false; // Empty files can't be mapped but are still open.
+
+#ifdef _WIN32
+	void *m_fileHandle = nullptr;
+	void *m_mappingHandle = nullptr;
+#else
+	int m_fileDescriptor = -1;
+#endif
+
+};
@@ -0,0 +1,169 @@
+#include "Matchmaker.h"
+
+#include <algorithm>
+
+bool Matchmaker::Enqueue(const MatchmakingTicket &ticket, double now)
+{
+	if (m_tickets.count(ticket.playerId))
+		return false;
+
+	QueuedTicket &queued = m_tickets[ticket.playerId];
+	queued.ticket = ticket;
+	queued.ticket.queuedTime = now;
+	queued.generation = m_nextGeneration++;
+
+	m_buckets[BucketOf(ticket)].push_back({ ticket.playerId, queued.generation });
+	return true;
+}
+
+bool Matchmaker::Remove(uint32_t playerId)
+{
+	return m_tickets.erase(playerId) != 0; // Its queue entry is skipped when it comes up.
+}
+
+void Matchmaker::GetQueued(std::vector<MatchmakingTicket> &tickets) const
+{
+	tickets.clear();
+	for (auto &[id, queued] : m_tickets)
+		tickets.push_back(queued.ticket);
+	std::sort(tickets.begin(), tickets.end(), [](const MatchmakingTicket &a, const MatchmakingTicket &b) { return a.queuedTime < b.queuedTime; });
+}
+
+size_t Matchmaker::Pair(double now, std::vector<MatchmakingPair> &pairs, size_t maxPairs)
+{
+	size_t made = 0;
+
+	// Oldest first within each bucket.
+	for (int bucket = 0; bucket < matchmakingBucketCount && made < maxPairs; bucket++)
+	{
+		MatchmakingPair pair;
+		while (made < maxPairs && PopLive(bucket, pair.players[0]))
+		{
+			if (!PopLive(bucket, pair.players[1]))
+			{
+				// Nobody to go with them, back to the front of the line.
+				const QueuedTicket &queued = m_tickets[pair.players[0].playerId] = { pair.players[0], m_nextGeneration++ };
+				m_buckets[bucket].push_front({ pair.players[0].playerId, queued.generation });
+				break;
+			}
+
+			OnPaired(pair.players[0], now);
+			OnPaired(pair.players[1], now);
+			pairs.push_back(pair);
+			m_stats.pairsMade++;
+			made++;
+		}
+	}
+
+	// Everyone left is alone in their bucket, the longer they've waited the further away they'll look.
+	for (int bucket = 0; bucket < matchmakingBucketCount && made < maxPairs; bucket++)
+	{
+		MatchmakingTicket waiting;
+		if (!PeekLive(bucket, waiting))
+			continue;
+
+		int reach = (int)((now - waiting.queuedTime) / matchmakingWidenTime);
+		int other = -1;
+		for (int distance = 1; distance <= reach && other < 0; distance++)
+		{
+			MatchmakingTicket candidate;
+			if (bucket - distance >= 0 && PeekLive(bucket - distance, candidate))
+				other = bucket - distance;
+			else if (bucket + distance < matchmakingBucketCount && PeekLive(bucket + distance, candidate))
+				other = bucket + distance;
+		}
+
+		if (other >= 0)
+		{
+			MatchmakingPair pair;
+			PopLive(bucket, pair.players[0]);
+			PopLive(other, pair.players[1]);
+			OnPaired(pair.players[0], now);
+			OnPaired(pair.players[1], now);
+			pairs.push_back(pair);
+			m_stats.pairsMade++;
+			made++;
+		}
+	}
+
+	return made;
+}
+
+bool Matchmaker::TakeClosest(const MatchmakingTicket &to, double now, MatchmakingTicket &taken)
+{
+	int bucket = BucketOf(to);
+	for (int distance = 0; distance < matchmakingBucketCount; distance++)
+	{
+		if ((bucket - distance >= 0 && PopLive(bucket - distance, taken)) ||
+			(bucket + distance < matchmakingBucketCount && PopLive(bucket + distance, taken)))
+		{
+			OnPaired(taken, now);
+			m_stats.backfills++;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t Matchmaker::TakeWaiting(double wait, double now, std::vector<MatchmakingTicket> &taken)
+{
+	// Oldest first in every bucket, so each one stops at the first who hasn't waited long enough.
+	size_t made = 0;
+	for (int bucket = 0; bucket < matchmakingBucketCount; bucket++)
+	{
+		MatchmakingTicket ticket;
+		while (PeekLive(bucket, ticket) && now - ticket.queuedTime >= wait)
+		{
+			PopLive(bucket, ticket);
+			OnPaired(ticket, now);
+			m_stats.botFills++;
+			taken.push_back(ticket);
+			made++;
+		}
+	}
+	return made;
+}
+
+int Matchmaker::BucketOf(const MatchmakingTicket &ticket) const
+{
+	int bucket = 0;
+	if (m_bucketing == MATCHMAKING_BY_RTT)
+		bucket = (int)(ticket.rtt / matchmakingRttBucketSize);
+	else if (m_bucketing == MATCHMAKING_BY_SKILL)
+		bucket = ticket.skill / matchmakingSkillBucketSize;
+	return bucket < 0 ? 0 : (bucket >= matchmakingBucketCount ? matchmakingBucketCount - 1 : bucket);
+}
+
+bool Matchmaker::PopLive(int bucket, MatchmakingTicket &ticket)
+{
+	if (!PeekLive(bucket, ticket))
+		return false;
+
+	m_tickets.erase(m_buckets[bucket].front().playerId);
+	m_buckets[bucket].pop_front();
+	return true;
+}
+
+bool Matchmaker::PeekLive(int bucket, MatchmakingTicket &ticket)
+{
+	std::deque<QueueEntry> &queue = m_buckets[bucket];
+	while (!queue.empty())
+	{
+		auto it = m_tickets.find(queue.front().playerId);
+		if (it != m_tickets.end() && it->second.generation == queue.front().generation)
+		{
+			ticket = it->second.ticket;
+			return true;
+		}
+		queue.pop_front(); // Left, or queued again since.
+	}
+	return false;
+}
+
+void Matchmaker::OnPaired(const MatchmakingTicket &ticket, double now)
+{
+	double wait = now - ticket.queuedTime;
+	m_stats.totalWait += wait;
+	if (wait > m_stats.longestWait)
+		m_stats.longestWait = wait;
+}
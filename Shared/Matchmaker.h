@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+// Matchmaking queue. Players wait in buckets of similar RTT or skill and are paired oldest first within a bucket.
+// Anyone left on their own long enough is paired with the nearest bucket over instead.
+// Not thread safe, the server only touches it from the tick.
+
+enum eMatchmakingBucketing
+{
+	MATCHMAKING_BY_NOTHING = 0, // One queue, first come first served.
+	MATCHMAKING_BY_RTT,
+	MATCHMAKING_BY_SKILL,
+};
+
+constexpr int matchmakingBucketCount = 16; // The last bucket takes everyone past it.
+constexpr double matchmakingRttBucketSize = 0.025; // Seconds.
+constexpr int matchmakingSkillBucketSize = 100;
+constexpr double matchmakingWidenTime = 5.0; // Seconds alone in a bucket before neighbouring buckets are tried.
+
+struct MatchmakingTicket
+{
+	uint32_t playerId = 0;
+	double rtt = 0.0; // Seconds, zero if it hasn't been measured.
+	int skill = 0;
+	double queuedTime = 0.0; // Filled in by Enqueue.
+};
+
+struct MatchmakingPair
+{
+	MatchmakingTicket players[2];
+};
+
+struct MatchmakingStats
+{
+	uint64_t pairsMade = 0;
+	uint64_t backfills = 0; // Single players handed to a match that lost one.
+	uint64_t botFills = 0; // Waited too long with nobody to pair with, given a server bot instead.
+	double totalWait = 0.0; // Seconds, over everyone paired.
+	double longestWait = 0.0;
+};
+
+class Matchmaker
+{
+public:
+	void SetBucketing(eMatchmakingBucketing bucketing) { m_bucketing = bucketing; }
+	void Reserve(size_t players) { m_tickets.reserve(players); } // So the queue never rehashes mid tick.
+
+	bool Enqueue(const MatchmakingTicket &ticket, double now); // False if they're already queued.
+	bool Remove(uint32_t playerId); // Left before being paired.
+	bool IsQueued(uint32_t playerId) const { return m_tickets.count(playerId) != 0; }
+	size_t GetQueuedCount() const { return m_tickets.size(); }
+	void GetQueued(std::vector<MatchmakingTicket> &tickets) const; // Oldest first, so they can be queued again elsewhere in order.
+
+	size_t Pair(double now, std::vector<MatchmakingPair> &pairs, size_t maxPairs = SIZE_MAX); // Appends, returns how many.
+	bool TakeClosest(const MatchmakingTicket &to, double now, MatchmakingTicket &taken); // One player for a half empty match.
+	size_t TakeWaiting(double wait, double now, std::vector<MatchmakingTicket> &taken); // Everyone queued at least this long, appends.
+
+	const MatchmakingStats &GetStats() const { return m_stats; }
+
+private:
+	struct QueueEntry
+	{
+		uint32_t playerId;
+		uint32_t generation; // Removed or requeued players are skipped lazily, see m_tickets.
+	};
+
+	struct QueuedTicket
+	{
+		MatchmakingTicket ticket;
+		uint32_t generation;
+	};
+
+	int BucketOf(const MatchmakingTicket &ticket) const;
+	bool PopLive(int bucket, MatchmakingTicket &ticket); // Oldest still queued in the bucket.
+	bool PeekLive(int bucket, MatchmakingTicket &ticket);
+	void OnPaired(const MatchmakingTicket &ticket, double now);
+
+private:
+	eMatchmakingBucketing m_bucketing = MATCHMAKING_BY_RTT;
+
+	std::deque<QueueEntry> m_buckets[matchmakingBucketCount];
+	std::unordered_map<uint32_t, QueuedTicket> m_tickets; // Everyone still waiting.
+	uint32_t m_nextGeneration = 0;
+
+	MatchmakingStats m_stats;
+
+};
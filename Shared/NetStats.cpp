@@ -0,0 +1,161 @@
+#include "NetStats.h"
+
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+std::string LinkStats::ToString() const
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(1);
+	if (hasRtt)
+		stream << "rtt " << smoothedRtt * 1000.0 << "ms (+/-" << rttDeviation * 1000.0 << ", min " << minRtt * 1000.0 << ") jitter " << jitter * 1000.0 << "ms";
+	else
+		stream << "rtt -";
+	stream << " loss " << lossRate * 100.0 << "% in " << bytesInPerSecond / 1024.0 << "KB/s out " << bytesOutPerSecond / 1024.0 << "KB/s";
+	return stream.str();
+}
+
+void ConnectionStats::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_stats = LinkStats();
+	m_nextSequence = 0;
+	m_lastPingTime = -1.0;
+	std::fill(std::begin(m_sentTimes), std::end(m_sentTimes), 0.0);
+	m_highestAcked = 0;
+	m_ackedMask = 0;
+	m_anyAcked = false;
+	m_bytesIn = 0;
+	m_bytesOut = 0;
+	m_windowStart = -1.0;
+}
+
+uint32_t ConnectionStats::OnPingSent(double now)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_lastPingTime = now;
+	m_sentTimes[m_nextSequence % LOSS_WINDOW] = now;
+	m_stats.pingsSent++;
+	return m_nextSequence++;
+}
+
+void ConnectionStats::OnPongReceived(uint32_t sequence, double sentTime, double now)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (sequence >= m_nextSequence) // Never sent, ignore.
+		return;
+
+	// Loss from sequence gaps, a late pong still fills its gap as long as it's within the window.
+	if (!m_anyAcked || sequence > m_highestAcked)
+	{
+		uint32_t shift = m_anyAcked ? sequence - m_highestAcked : 0;
+		m_ackedMask = shift >= 64 ? 0 : (m_ackedMask << shift);
+		m_ackedMask |= 1;
+		m_highestAcked = sequence;
+		m_anyAcked = true;
+	}
+	else if (m_highestAcked - sequence < 64)
+	{
+		uint64_t bit = 1ULL << (m_highestAcked - sequence);
+		if (m_ackedMask & bit) // Duplicate.
+			return;
+		m_ackedMask |= bit;
+	}
+
+	m_stats.pongsReceived++;
+	UpdateLossRate(now);
+
+	// RTT, smoothed the same way as TCP (RFC 6298).
+	double rtt = now - sentTime;
+	if (rtt < 0.0)
+		return;
+
+	if (!m_stats.hasRtt)
+	{
+		m_stats.smoothedRtt = rtt;
+		m_stats.rttDeviation = rtt / 2.0;
+		m_stats.minRtt = rtt;
+		m_stats.jitter = 0.0;
+		m_stats.hasRtt = true;
+	}
+	else
+	{
+		double deviation = std::abs(m_stats.smoothedRtt - rtt);
+		m_stats.rttDeviation = 0.75 * m_stats.rttDeviation + 0.25 * deviation;
+		m_stats.smoothedRtt = 0.875 * m_stats.smoothedRtt + 0.125 * rtt;
+
+		m_stats.jitter += (std::abs(rtt - m_stats.lastRtt) - m_stats.jitter) / 16.0; // RFC 3550 style.
+		if (rtt < m_stats.minRtt)
+			m_stats.minRtt = rtt;
+	}
+	m_stats.lastRtt = rtt;
+}
+
+void ConnectionStats::OnBytesSent(uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bytesOut += bytes;
+}
+
+void ConnectionStats::OnBytesReceived(uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bytesIn += bytes;
+}
+
+bool ConnectionStats::ShouldPing(double now, double interval) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_lastPingTime < 0.0 || now - m_lastPingTime >= interval;
+}
+
+void ConnectionStats::Update(double now)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	UpdateLossRate(now); // Pongs stop coming when the link dies, so this can't wait for the next one.
+
+	if (m_windowStart < 0.0)
+	{
+		m_windowStart = now;
+		return;
+	}
+
+	double elapsed = now - m_windowStart;
+	if (elapsed < BANDWIDTH_WINDOW)
+		return;
+
+	m_stats.bytesInPerSecond = (double)m_bytesIn / elapsed;
+	m_stats.bytesOutPerSecond = (double)m_bytesOut / elapsed;
+	m_bytesIn = 0;
+	m_bytesOut = 0;
+	m_windowStart = now;
+}
+
+void ConnectionStats::UpdateLossRate(double now)
+{
+	// Over the last LOSS_WINDOW pings sent, leaving out the ones whose pong could still be on its way.
+	uint32_t first = m_nextSequence > LOSS_WINDOW ? m_nextSequence - LOSS_WINDOW : 0;
+	uint32_t expected = 0, received = 0;
+	for (uint32_t sequence = first; sequence < m_nextSequence; sequence++)
+	{
+		bool acked = m_anyAcked && sequence <= m_highestAcked && (m_ackedMask & (1ULL << (m_highestAcked - sequence))) != 0;
+		if (!acked && now - m_sentTimes[sequence % LOSS_WINDOW] < pingLossTimeout)
+			continue;
+		expected++;
+		received += acked;
+	}
+	m_stats.lossRate = expected > 0 ? 1.0 - (double)received / (double)expected : 0.0;
+}
+
+LinkStats ConnectionStats::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+
+constexpr double pingInterval = 0.5; // Seconds between pings, each end pings the other.
+constexpr double pingLossTimeout = 2.0; // Seconds without its pong before a ping counts as lost, a later pong still counts.
+
+// Snapshot of one connection's link quality. Times are in seconds.
+struct LinkStats
+{
+	bool hasRtt = false; // False until the first pong comes back.
+
+	double smoothedRtt = 0.0;
+	double rttDeviation = 0.0; // Mean deviation, RFC 6298's RTTVAR. Seconds like the rest, not squared.
+	double minRtt = 0.0;
+	double lastRtt = 0.0;
+	double jitter = 0.0; // Mean deviation between consecutive RTT samples.
+
+	double lossRate = 0.0; // 0-1, over the last LOSS_WINDOW pings.
+
+	double bytesInPerSecond = 0.0;
+	double bytesOutPerSecond = 0.0;
+
+	uint64_t pingsSent = 0;
+	uint64_t pongsReceived = 0;
+
+	std::string ToString() const;
+};
+
+// Per connection tracker, fed by ping/pong and by every packet sent and received.
+// Safe to use from the network thread and the game thread at the same time.
+class ConnectionStats
+{
+public:
+	ConnectionStats() = default;
+	ConnectionStats(const ConnectionStats &stats) = delete;
+
+	void Reset();
+
+	uint32_t OnPingSent(double now); // Returns the sequence to put in the ping.
+	void OnPongReceived(uint32_t sequence, double sentTime, double now);
+
+	void OnBytesSent(uint64_t bytes);
+	void OnBytesReceived(uint64_t bytes);
+
+	bool ShouldPing(double now, double interval = pingInterval) const; // Has the interval passed since the last ping?
+	void Update(double now); // Rolls the bandwidth window over and counts pings that have timed out as lost.
+
+	LinkStats GetStats() const;
+
+private:
+	void UpdateLossRate(double now); // With m_mutex held.
+
+public:
+	constexpr static unsigned int LOSS_WINDOW = 64;
+	constexpr static double BANDWIDTH_WINDOW = 1.0;
+
+private:
+	mutable std::mutex m_mutex;
+
+	LinkStats m_stats;
+
+	uint32_t m_nextSequence = 0;
+	double m_lastPingTime = -1.0;
+	double m_sentTimes[LOSS_WINDOW] = {}; // By sequence, for the ones in the loss window.
+
+	uint32_t m_highestAcked = 0;
+	uint64_t m_ackedMask = 0; // Bit n set means m_highestAcked - n was acknowledged.
+	bool m_anyAcked = false;
+
+	uint64_t m_bytesIn = 0; // Current window.
+	uint64_t m_bytesOut = 0;
+	double m_windowStart = -1.0;
+
+};
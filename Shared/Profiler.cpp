@@ -0,0 +1,120 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+
+static const char *s_phaseNames[(int)eProfilePhase::PHASES_MAX] = {
+	"tick",
+	"event drain",
+	"sim step",
+	"paddle update",
+	"collision",
+	"scoring",
+	"sim events",
+	"network send",
+	"countdown",
+	"matchmaking",
+	"bots",
+};
+
+const char *ProfilePhaseName(eProfilePhase phase)
+{
+	return s_phaseNames[(int)phase];
+}
+
+// One per thread, only ever written by its own thread.
+// Relaxed atomics so other threads can merge while it's being written to without a data race.
+struct ThreadProfile
+{
+	std::atomic<uint64_t> counts[(int)eProfilePhase::PHASES_MAX][LatencyHistogram::BUCKET_COUNT] = { };
+};
+
+static std::atomic<bool> s_enabled = (PONG_PROFILING != 0);
+
+static std::mutex s_registryMutex; // Only taken when a thread records for the first time, and when merging.
+static std::vector<std::unique_ptr<ThreadProfile>> s_threadProfiles; // Kept after their thread exits so their samples aren't lost.
+
+static thread_local ThreadProfile *t_threadProfile = nullptr;
+
+static ThreadProfile *GetThreadProfile()
+{
+	if (t_threadProfile == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(s_registryMutex);
+		s_threadProfiles.push_back(std::make_unique<ThreadProfile>());
+		t_threadProfile = s_threadProfiles.back().get();
+	}
+	return t_threadProfile;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	s_enabled.store(enabled && PONG_PROFILING, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return s_enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::Record(eProfilePhase phase, int64_t nanoseconds)
+{
+	if (nanoseconds < 0)
+		nanoseconds = 0;
+
+	std::atomic<uint64_t> &count = GetThreadProfile()->counts[(int)phase][LatencyHistogram::BucketIndex((uint64_t)nanoseconds)];
+	count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // Single writer, no need for a locked add.
+}
+
+void Profiler::Merge(LatencyHistogram (&histograms)[(int)eProfilePhase::PHASES_MAX])
+{
+	for (LatencyHistogram &histogram : histograms)
+		histogram.Reset();
+
+	std::lock_guard<std::mutex> lock(s_registryMutex);
+	for (const std::unique_ptr<ThreadProfile> &profile : s_threadProfiles)
+		for (int phase = 0; phase < (int)eProfilePhase::PHASES_MAX; phase++)
+			for (unsigned int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++)
+				histograms[phase].RecordBucket(i, profile->counts[phase][i].load(std::memory_order_relaxed));
+}
+
+std::string Profiler::Report()
+{
+	LatencyHistogram histograms[(int)eProfilePhase::PHASES_MAX];
+	Merge(histograms);
+
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(1);
+	stream << std::left << std::setw(16) << "phase (us)" << std::right
+		<< std::setw(12) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50"
+		<< std::setw(10) << "p99" << std::setw(10) << "p999" << std::setw(10) << "max" << "\n";
+
+	for (int phase = 0; phase < (int)eProfilePhase::PHASES_MAX; phase++)
+	{
+		const LatencyHistogram &histogram = histograms[phase];
+		stream << std::left << std::setw(16) << s_phaseNames[phase] << std::right
+			<< std::setw(12) << histogram.Count()
+			<< std::setw(10) << histogram.Mean() / 1000.0
+			<< std::setw(10) << histogram.Percentile(50.0) / 1000.0
+			<< std::setw(10) << histogram.Percentile(99.0) / 1000.0
+			<< std::setw(10) << histogram.Percentile(99.9) / 1000.0
+			<< std::setw(10) << histogram.Max() / 1000.0 << "\n";
+	}
+
+	return stream.str();
+}
+
+bool Profiler::DumpToFile(const std::string &path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file << Report();
+	return true;
+}
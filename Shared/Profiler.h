@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
+
+// Compile time switch, build with PONG_PROFILING=0 and every PONG_PROFILE_SCOPE compiles to nothing.
+#ifndef PONG_PROFILING
+#define PONG_PROFILING 1
+#endif
+
+// Phases of the server tick that get timed.
+enum class eProfilePhase
+{
+	TICK = 0, // The whole of Update.
+	EVENT_DRAIN, // Handling packets, connects and disconnects from the network thread.
+	SIM_STEP, // Fixed simulation steps, the three below and moving the ball.
+	PADDLE_UPDATE, // Moving and clamping paddles, timed inside SimStep, see SimPhaseHook.
+	COLLISION, // Ball vs paddles and bounds.
+	SCORING, // Goals and ball resets.
+	SIM_EVENTS, // Turning what happened during the steps into packets.
+	NETWORK_SEND, // Flushing the tick's queued packets.
+	COUNTDOWN, // Lobby countdown.
+	MATCHMAKING, // Queueing, pairing and placing players in matches.
+	BOTS, // Every server bot deciding its input, see BotBatch.
+	PHASES_MAX
+};
+
+const char *ProfilePhaseName(eProfilePhase phase);
+
+// Each thread records into its own histograms, no locks and no contention on the hot path.
+// Merging reads every thread's counters and can happen at any time from any thread.
+class Profiler
+{
+public:
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	static void Record(eProfilePhase phase, int64_t nanoseconds);
+
+	// Merge all threads into one histogram per phase.
+	static void Merge(LatencyHistogram (&histograms)[(int)eProfilePhase::PHASES_MAX]);
+
+	static std::string Report(); // Human readable table, in microseconds.
+	static bool DumpToFile(const std::string &path);
+
+};
+
+// Also shows up on the timeline when a trace is being recorded.
+class ProfileScope
+{
+public:
+	ProfileScope(eProfilePhase phase) : m_phase(phase), m_start(Profiler::IsEnabled() ? ClockNowNanoseconds() : 0)
+	{
+#if PONG_TRACING
+		m_traced = Tracer::IsRecording();
+		if (m_traced)
+			Tracer::Begin(ProfilePhaseName(m_phase));
+#endif
+	}
+	~ProfileScope()
+	{
+		if (m_start != 0)
+			Profiler::Record(m_phase, ClockNowNanoseconds() - m_start);
+#if PONG_TRACING
+		if (m_traced)
+			Tracer::End(ProfilePhaseName(m_phase));
+#endif
+	}
+
+private:
+	ProfileScope(const ProfileScope &scope) = delete;
+
+	eProfilePhase m_phase;
+	int64_t m_start;
+	bool m_traced = false;
+
+};
+
+#define PONG_PROFILE_CONCAT_INNER(a, b) a##b
+#define PONG_PROFILE_CONCAT(a, b) PONG_PROFILE_CONCAT_INNER(a, b)
+
+#if PONG_PROFILING
+#define PONG_PROFILE_SCOPE(phase) ProfileScope PONG_PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#else
+#define PONG_PROFILE_SCOPE(phase)
+#endif
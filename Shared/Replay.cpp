@@ -0,0 +1,457 @@
+#include "Replay.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "ByteIO.h"
+
+// Input runs, one byte each: low four bits are both paddles' eSimInput flags, high four the run's length less one.
+// Fifteen there means a longer run, with the rest of its length after it as a varint.
+constexpr uint32_t replayShortRunLimit = 15;
+
+static void PutVarint(std::vector<uint8_t> &buffer, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+static bool GetVarint(const uint8_t *&data, const uint8_t *end, uint32_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 32; shift += 7)
+	{
+		if (data == end)
+			return false;
+		uint8_t byte = *data++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+void ReplayPutState(std::vector<uint8_t> &buffer, const SimState &state)
+{
+	// Field by field, same as SimHash, so padding and the struct's layout never end up in the file.
+	BytesPut(buffer, state.tick);
+	BytesPut(buffer, (uint8_t)state.playing);
+	BytesPut(buffer, state.rngSeed);
+	BytesPut(buffer, state.rngCounter);
+	BytesPut(buffer, state.ball.xPosition);
+	BytesPut(buffer, state.ball.yPosition);
+	BytesPut(buffer, state.ball.xVelocity);
+	BytesPut(buffer, state.ball.yVelocity);
+	BytesPut(buffer, state.ball.currentHSpeed);
+	BytesPut(buffer, state.ball.currentVSpeed);
+	for (const SimPaddle &paddle : state.paddles)
+	{
+		BytesPut(buffer, paddle.yPosition);
+		BytesPut(buffer, paddle.score);
+	}
+}
+
+bool ReplayGetState(const uint8_t *&data, const uint8_t *end, SimState &state)
+{
+	uint8_t playing = 0;
+	bool ok = BytesGet(data, end, state.tick) && BytesGet(data, end, playing) && BytesGet(data, end, state.rngSeed) && BytesGet(data, end, state.rngCounter) &&
+		BytesGet(data, end, state.ball.xPosition) && BytesGet(data, end, state.ball.yPosition) &&
+		BytesGet(data, end, state.ball.xVelocity) && BytesGet(data, end, state.ball.yVelocity) &&
+		BytesGet(data, end, state.ball.currentHSpeed) && BytesGet(data, end, state.ball.currentVSpeed);
+	for (SimPaddle &paddle : state.paddles)
+		ok = ok && BytesGet(data, end, paddle.yPosition) && BytesGet(data, end, paddle.score);
+	state.playing = playing != 0;
+	return ok;
+}
+
+static uint8_t PackInputs(const SimInputs &inputs)
+{
+	return (uint8_t)((inputs.paddles[SIM_LEFT] & 3) | ((inputs.paddles[SIM_RIGHT] & 3) << 2));
+}
+
+static SimInputs UnpackInputs(uint8_t packed)
+{
+	SimInputs inputs;
+	inputs.paddles[SIM_LEFT] = packed & 3;
+	inputs.paddles[SIM_RIGHT] = (packed >> 2) & 3;
+	return inputs;
+}
+
+uint32_t ReplayCrc32(const void *data, size_t size)
+{
+	// The usual zlib one, table built the first time it's needed.
+	static const std::vector<uint32_t> table = []()
+	{
+		std::vector<uint32_t> values(256);
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++)
+				value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+			values[i] = value;
+		}
+		return values;
+	}();
+
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+// ------------------------- Writer.
+bool ReplayWriter::Start(const std::string &path, const SimState &initial)
+{
+	Stop();
+
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ReplayHeader header;
+	header.version = replayVersion;
+	header.seed = initial.rngSeed;
+	header.flags = PONG_FIXED_POINT_SIM ? REPLAY_FIXED_POINT : 0;
+
+	m_queue.clear();
+	m_queue.emplace_back((const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+	m_fileOffset = sizeof(header);
+
+	m_index.clear();
+	m_keyframeCount = 0;
+	QueueKeyframe(initial);
+
+	m_runs.clear();
+	m_runLength = 0;
+	m_inputsFirstTick = initial.tick;
+	m_inputsCount = 0;
+	m_lastTick = initial.tick;
+
+	m_stopping = false;
+	m_recording = true;
+	m_thread = std::thread(&ReplayWriter::WriterThread, this, file);
+	return true;
+}
+
+void ReplayWriter::RecordTick(const SimInputs &inputs, const SimState &after)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_recording)
+		return;
+
+	uint8_t packed = PackInputs(inputs);
+	if (m_runLength > 0 && packed == m_runInput)
+		m_runLength++;
+	else
+	{
+		FlushRun();
+		m_runInput = packed;
+		m_runLength = 1;
+	}
+	m_inputsCount++;
+	m_lastTick = after.tick;
+
+	if (after.tick % replayKeyframeInterval == 0)
+	{
+		FlushInputs();
+		QueueKeyframe(after);
+	}
+}
+
+void ReplayWriter::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_recording)
+			return;
+
+		FlushInputs();
+
+		// The index, then the trailer so a reader can find it without walking the file.
+		ReplayTrailer trailer;
+		trailer.indexOffset = m_fileOffset;
+
+		std::vector<uint8_t> payload;
+		payload.reserve(sizeof(uint32_t) * 2 + m_index.size());
+		BytesPut(payload, m_lastTick);
+		BytesPut(payload, m_keyframeCount);
+		payload.insert(payload.end(), m_index.begin(), m_index.end());
+		QueueBlock(REPLAY_BLOCK_INDEX, payload);
+
+		m_queue.emplace_back((const uint8_t *)&trailer, (const uint8_t *)&trailer + sizeof(trailer));
+
+		m_recording = false;
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void ReplayWriter::WriterThread(FILE *file)
+{
+	std::vector<std::vector<uint8_t>> writing;
+	while (true)
+	{
+		bool stopping;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return !m_queue.empty() || m_stopping; });
+			writing.swap(m_queue);
+			stopping = m_stopping;
+		}
+
+		for (const std::vector<uint8_t> &block : writing)
+			fwrite(block.data(), 1, block.size(), file);
+		fflush(file); // Whole blocks only, so a crash leaves something that can be recovered.
+		writing.clear();
+
+		if (stopping)
+			break;
+	}
+
+	fclose(file);
+}
+
+void ReplayWriter::QueueBlock(uint32_t type, std::vector<uint8_t> &payload)
+{
+	ReplayBlockHeader header;
+	header.type = type;
+	header.size = (uint32_t)payload.size();
+	uint32_t crc = ReplayCrc32(payload.data(), payload.size());
+
+	std::vector<uint8_t> block;
+	block.reserve(sizeof(header) + payload.size() + sizeof(crc));
+	BytesPut(block, header);
+	block.insert(block.end(), payload.begin(), payload.end());
+	BytesPut(block, crc);
+
+	m_fileOffset += block.size();
+	m_queue.push_back(std::move(block));
+	m_wake.notify_one();
+}
+
+void ReplayWriter::QueueKeyframe(const SimState &state)
+{
+	BytesPut(m_index, state.tick);
+	BytesPut(m_index, m_fileOffset);
+	m_keyframeCount++;
+
+	std::vector<uint8_t> payload;
+	ReplayPutState(payload, state);
+	QueueBlock(REPLAY_BLOCK_KEYFRAME, payload);
+}
+
+void ReplayWriter::FlushRun()
+{
+	if (m_runLength == 0)
+		return;
+
+	if (m_runLength <= replayShortRunLimit)
+		m_runs.push_back((uint8_t)(m_runInput | ((m_runLength - 1) << 4)));
+	else
+	{
+		m_runs.push_back((uint8_t)(m_runInput | (replayShortRunLimit << 4)));
+		PutVarint(m_runs, m_runLength - replayShortRunLimit - 1);
+	}
+	m_runLength = 0;
+}
+
+void ReplayWriter::FlushInputs()
+{
+	FlushRun();
+	if (m_inputsCount == 0)
+		return;
+
+	std::vector<uint8_t> payload;
+	payload.reserve(sizeof(uint32_t) * 2 + m_runs.size());
+	BytesPut(payload, m_inputsFirstTick);
+	BytesPut(payload, m_inputsCount);
+	payload.insert(payload.end(), m_runs.begin(), m_runs.end());
+	QueueBlock(REPLAY_BLOCK_INPUTS, payload);
+
+	m_runs.clear();
+	m_inputsFirstTick += m_inputsCount;
+	m_inputsCount = 0;
+}
+
+// ------------------------- Reader.
+bool ReplayReader::Open(const uint8_t *data, size_t size)
+{
+	m_data = data;
+	m_size = size;
+	m_keyframes.clear();
+	m_lastTick = 0;
+	m_recovered = false;
+
+	if (size < sizeof(m_header))
+		return false;
+	std::memcpy(&m_header, data, sizeof(m_header));
+
+	uint32_t expectedFlags = PONG_FIXED_POINT_SIM ? REPLAY_FIXED_POINT : 0;
+	if (std::memcmp(m_header.magic, "PRPL", 4) != 0 || m_header.version != replayVersion ||
+		m_header.tickRate != simTickRate || (m_header.flags & REPLAY_FIXED_POINT) != expectedFlags)
+		return false;
+
+	if (!ReadIndex())
+		Recover();
+	return !m_keyframes.empty();
+}
+
+bool ReplayReader::ReadBlock(uint64_t offset, ReplayBlockHeader &block, const uint8_t *&payload) const
+{
+	if (offset > m_size || m_size - offset < sizeof(block))
+		return false;
+	std::memcpy(&block, m_data + offset, sizeof(block));
+
+	uint64_t payloadOffset = offset + sizeof(block);
+	if (m_size - payloadOffset < (uint64_t)block.size + sizeof(uint32_t))
+		return false;
+
+	payload = m_data + payloadOffset;
+	uint32_t crc;
+	std::memcpy(&crc, payload + block.size, sizeof(crc));
+	return crc == ReplayCrc32(payload, block.size);
+}
+
+bool ReplayReader::ReadIndex()
+{
+	ReplayTrailer trailer;
+	if (m_size < sizeof(m_header) + sizeof(trailer))
+		return false;
+	std::memcpy(&trailer, m_data + m_size - sizeof(trailer), sizeof(trailer));
+	if (std::memcmp(trailer.magic, "PEND", 4) != 0)
+		return false;
+
+	ReplayBlockHeader block;
+	const uint8_t *payload;
+	if (!ReadBlock(trailer.indexOffset, block, payload) || block.type != REPLAY_BLOCK_INDEX)
+		return false;
+
+	const uint8_t *end = payload + block.size;
+	uint32_t count;
+	if (!BytesGet(payload, end, m_lastTick) || !BytesGet(payload, end, count))
+		return false;
+
+	m_keyframes.resize(count);
+	for (Keyframe &keyframe : m_keyframes)
+	{
+		if (!BytesGet(payload, end, keyframe.tick) || !BytesGet(payload, end, keyframe.offset))
+		{
+			m_keyframes.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+void ReplayReader::Recover()
+{
+	// No index, walk the blocks and keep everything up to the first that's cut short or corrupt.
+	m_recovered = true;
+	m_keyframes.clear();
+
+	uint64_t offset = sizeof(m_header);
+	ReplayBlockHeader block;
+	const uint8_t *payload;
+	while (ReadBlock(offset, block, payload))
+	{
+		const uint8_t *end = payload + block.size;
+		uint32_t tick, count;
+		if (block.type == REPLAY_BLOCK_KEYFRAME && BytesGet(payload, end, tick))
+		{
+			m_keyframes.push_back({ tick, offset });
+			m_lastTick = tick;
+		}
+		else if (block.type == REPLAY_BLOCK_INPUTS && BytesGet(payload, end, tick) && BytesGet(payload, end, count))
+			m_lastTick = tick + count;
+
+		offset += sizeof(block) + block.size + sizeof(uint32_t);
+	}
+}
+
+bool ReplayReader::ReadKeyframe(size_t index, SimState &state) const
+{
+	ReplayBlockHeader block;
+	const uint8_t *payload;
+	if (index >= m_keyframes.size() || !ReadBlock(m_keyframes[index].offset, block, payload) || block.type != REPLAY_BLOCK_KEYFRAME)
+		return false;
+	return ReplayGetState(payload, payload + block.size, state);
+}
+
+size_t ReplayReader::FindKeyframe(uint32_t tick) const
+{
+	auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), tick, [](uint32_t value, const Keyframe &keyframe) { return value < keyframe.tick; });
+	return it == m_keyframes.begin() ? 0 : (size_t)(it - m_keyframes.begin()) - 1;
+}
+
+bool ReplayReader::Simulate(size_t keyframe, uint32_t tick, SimState &state) const
+{
+	return PlaySpan(keyframe, tick, state, nullptr);
+}
+
+bool ReplayReader::Play(const ReplayTickCallback &onTick) const
+{
+	SimState state;
+	for (size_t i = 0; i < m_keyframes.size(); i++)
+	{
+		uint32_t spanEnd = i + 1 < m_keyframes.size() ? m_keyframes[i + 1].tick : m_lastTick;
+		if (!PlaySpan(i, spanEnd, state, &onTick))
+			return false;
+	}
+	return true;
+}
+
+bool ReplayReader::PlaySpan(size_t keyframe, uint32_t tick, SimState &state, const ReplayTickCallback *onTick) const
+{
+	if (tick > m_lastTick || !ReadKeyframe(keyframe, state) || tick < state.tick)
+		return false;
+	if (tick == state.tick)
+		return true;
+
+	// The keyframe's inputs come straight after it.
+	ReplayBlockHeader block;
+	const uint8_t *payload;
+	const ReplayBlockHeader *keyframeBlock = (const ReplayBlockHeader *)(m_data + m_keyframes[keyframe].offset);
+	uint64_t inputsOffset = m_keyframes[keyframe].offset + sizeof(block) + keyframeBlock->size + sizeof(uint32_t);
+	if (!ReadBlock(inputsOffset, block, payload) || block.type != REPLAY_BLOCK_INPUTS)
+		return false;
+
+	const uint8_t *end = payload + block.size;
+	uint32_t firstTick, count;
+	if (!BytesGet(payload, end, firstTick) || !BytesGet(payload, end, count) || firstTick != state.tick || tick - firstTick > count)
+		return false;
+
+	while (state.tick < tick)
+	{
+		if (payload == end)
+			return false;
+		uint8_t run = *payload++;
+		uint32_t length = (run >> 4) + 1;
+		if (length > replayShortRunLimit)
+		{
+			uint32_t extra;
+			if (!GetVarint(payload, end, extra))
+				return false;
+			length += extra;
+		}
+
+		SimInputs inputs = UnpackInputs(run & 0x0F);
+		for (uint32_t i = 0; i < length && state.tick < tick; i++)
+		{
+			uint32_t events;
+			SimState next = SimStep(state, inputs, simTickTime, events);
+			if (onTick)
+				(*onTick)(state, inputs, next, events);
+			state = next;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+#include "Simulation.h"
+
+// Match replays, recorded by the server and played back by 'Pong_Tools replay'.
+// Layout: header, then blocks, each a ReplayBlockHeader, its payload and a CRC32 of the payload.
+// The first block is a keyframe, after that every keyframe is followed by the inputs up to the next one.
+// A finished replay ends with an index block and a ReplayTrailer pointing at it, a replay cut off by a crash
+// has neither and is recovered by walking the blocks up to the first bad one.
+// All integers are little endian.
+
+enum eReplayBlock
+{
+	REPLAY_BLOCK_KEYFRAME = 1, // Tick, then the whole SimState.
+	REPLAY_BLOCK_INPUTS, // First tick, tick count, then the input runs.
+	REPLAY_BLOCK_INDEX, // Last tick, keyframe count, then each keyframe's tick and block offset.
+};
+
+enum eReplayFlags
+{
+	REPLAY_FIXED_POINT = 1 << 0, // Recorded with PONG_FIXED_POINT_SIM, only plays back in a build with it.
+};
+
+struct ReplayHeader
+{
+	char magic[4] = { 'P', 'R', 'P', 'L' };
+	uint32_t version = 1;
+	uint64_t seed = 0;
+	uint32_t tickRate = simTickRate;
+	uint32_t flags = 0; // eReplayFlags.
+};
+
+struct ReplayBlockHeader
+{
+	uint32_t type = 0; // eReplayBlock.
+	uint32_t size = 0; // Payload only.
+};
+
+struct ReplayTrailer
+{
+	uint64_t indexOffset = 0; // From the start of the file.
+	char magic[4] = { 'P', 'E', 'N', 'D' };
+	uint32_t reserved = 0;
+};
+
+constexpr uint32_t replayVersion = 1;
+constexpr uint32_t replayKeyframeInterval = simTickRate * 10; // Ticks, the most a seek ever has to simulate.
+
+uint32_t ReplayCrc32(const void *data, size_t size);
+
+// SimState field by field, the way keyframes hold it. Reading moves data past it, false if it runs off the end.
+void ReplayPutState(std::vector<uint8_t> &buffer, const SimState &state);
+bool ReplayGetState(const uint8_t *&data, const uint8_t *end, SimState &state);
+
+// Called for every tick played, with the eSimEvent flags the step produced.
+typedef std::function<void(const SimState &before, const SimInputs &inputs, const SimState &after, uint32_t events)> ReplayTickCallback;
+
+// Records on the simulation thread, everything slow happens on its own thread. The simulation thread only appends to
+// a small buffer each tick and hands over a finished block every keyframe.
+class ReplayWriter
+{
+public:
+	ReplayWriter() = default;
+	~ReplayWriter() { Stop(); }
+
+	ReplayWriter(const ReplayWriter &writer) = delete;
+	ReplayWriter &operator=(const ReplayWriter &writer) = delete;
+
+	bool Start(const std::string &path, const SimState &initial);
+	void RecordTick(const SimInputs &inputs, const SimState &after); // The inputs that were stepped and the state they gave.
+	void Stop(); // Writes the index and waits for everything to reach the file.
+
+	bool IsRecording() const { return m_recording; }
+
+private:
+	void WriterThread(FILE *file);
+
+	void QueueBlock(uint32_t type, std::vector<uint8_t> &payload);
+	void QueueKeyframe(const SimState &state);
+	void FlushRun();
+	void FlushInputs();
+
+private:
+	std::atomic<bool> m_recording = false;
+	std::mutex m_mutex; // Recording can be stopped from the network thread when a player leaves.
+
+	// Simulation thread side.
+	uint64_t m_fileOffset = 0; // Where the next block will land.
+	uint32_t m_inputsFirstTick = 0;
+	uint32_t m_inputsCount = 0;
+	std::vector<uint8_t> m_runs;
+	uint8_t m_runInput = 0;
+	uint32_t m_runLength = 0;
+	uint32_t m_lastTick = 0;
+	std::vector<uint8_t> m_index;
+	uint32_t m_keyframeCount = 0;
+
+	// Shared with the writer thread.
+	std::vector<std::vector<uint8_t>> m_queue;
+	bool m_stopping = false;
+	std::condition_variable m_wake;
+	std::thread m_thread;
+
+};
+
+// Reads straight out of a mapped replay, only the block being played is decoded.
+class ReplayReader
+{
+public:
+	bool Open(const uint8_t *data, size_t size);
+
+	const ReplayHeader &GetHeader() const { return m_header; }
+	bool WasRecovered() const { return m_recovered; } // No index, the replay was cut short and rebuilt by walking it.
+
+	uint32_t GetFirstTick() const { return m_keyframes.empty() ? 0 : m_keyframes.front().tick; }
+	uint32_t GetLastTick() const { return m_lastTick; }
+
+	size_t GetKeyframeCount() const { return m_keyframes.size(); }
+	uint32_t GetKeyframeTick(size_t index) const { return m_keyframes[index].tick; }
+	bool ReadKeyframe(size_t index, SimState &state) const;
+
+	size_t FindKeyframe(uint32_t tick) const; // Latest keyframe at or before the tick, binary search.
+	bool Simulate(size_t keyframe, uint32_t tick, SimState &state) const; // From a keyframe forward to the tick.
+	bool Seek(uint32_t tick, SimState &state) const { return tick >= GetFirstTick() && Simulate(FindKeyframe(tick), tick, state); }
+
+	bool Play(const ReplayTickCallback &onTick) const; // Start to end, streamed a run at a time so nothing is allocated.
+
+private:
+	struct Keyframe
+	{
+		uint32_t tick;
+		uint64_t offset;
+	};
+
+	bool ReadBlock(uint64_t offset, ReplayBlockHeader &block, const uint8_t *&payload) const; // Checks the CRC too.
+	bool PlaySpan(size_t keyframe, uint32_t tick, SimState &state, const ReplayTickCallback *onTick) const;
+	bool ReadIndex();
+	void Recover();
+
+private:
+	const uint8_t *m_data = nullptr;
+	size_t m_size = 0;
+
+	ReplayHeader m_header;
+	std::vector<Keyframe> m_keyframes;
+	uint32_t m_lastTick = 0;
+	bool m_recovered = false;
+
+};
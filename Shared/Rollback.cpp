@@ -0,0 +1,211 @@
+#include "Rollback.h"
+
+#include <algorithm>
+
+void RollbackSession::Start(const SimState &initial, int localSide, int inputDelay, int maxRollback)
+{
+	m_active = true;
+	m_localSide = localSide;
+	m_inputDelay = inputDelay;
+	m_maxRollback = std::min(maxRollback, rollbackHistorySize / 2);
+
+	m_state = initial;
+	m_tick = 0;
+	m_nextLocalTick = 0;
+
+	m_remoteConfirmed = 0;
+	m_lastRemoteInput = 0;
+	m_lastRemoteTick = 0;
+	m_rollbackFrom = UINT32_MAX;
+
+	m_frames.assign(rollbackHistorySize, Frame());
+	m_remoteChecksums.clear();
+	m_desynced = false;
+	m_desyncTick = 0;
+
+	m_stats = RollbackStats();
+
+	// Nobody has input for the first few ticks, they're just empty on both sides. Both peers need the same delay.
+	for (int i = 0; i < m_inputDelay; i++)
+	{
+		AddLocalInput(0);
+		AddRemoteInput(i, 0);
+	}
+}
+
+uint32_t RollbackSession::AddLocalInput(uint8_t input)
+{
+	uint32_t tick = m_nextLocalTick++;
+	GetFrame(tick).localInput = input;
+	return tick;
+}
+
+void RollbackSession::AddRemoteInput(uint32_t tick, uint8_t input)
+{
+	if (tick < m_remoteConfirmed || tick >= m_remoteConfirmed + rollbackHistorySize) // Already have it, or nonsense.
+		return;
+
+	Frame &frame = GetFrame(tick);
+	if (frame.remoteKnown)
+		return;
+
+	frame.remoteInput = input;
+	frame.remoteKnown = true;
+
+	if (tick >= m_lastRemoteTick)
+	{
+		m_lastRemoteTick = tick;
+		m_lastRemoteInput = input;
+	}
+
+	// Already simulated it with a guess, and the guess was wrong.
+	if (tick < m_tick && frame.remoteUsed != input)
+		m_rollbackFrom = std::min(m_rollbackFrom, tick);
+
+	// Inputs can arrive out of order, confirmed only moves past an unbroken run.
+	while (m_remoteConfirmed < m_lastRemoteTick + 1)
+	{
+		const Frame *next = FindFrame(m_remoteConfirmed);
+		if (!next || !next->remoteKnown)
+			break;
+		m_remoteConfirmed++;
+	}
+}
+
+uint8_t RollbackSession::GetLocalInput(uint32_t tick) const
+{
+	const Frame *frame = FindFrame(tick);
+	return frame ? frame->localInput : 0;
+}
+
+bool RollbackSession::CanAdvance()
+{
+	if (m_tick < m_remoteConfirmed + m_maxRollback)
+		return true;
+
+	m_stats.stalls++;
+	return false;
+}
+
+int RollbackSession::Advance(uint32_t &events)
+{
+	int resimulated = 0;
+	uint32_t corrected = 0;
+
+	if (m_rollbackFrom < m_tick)
+	{
+		// Back to the snapshot from before the mispredicted tick, then forward again with what we know now.
+		// Events are compared over the whole run rather than tick by tick, so a hit that only moved a tick isn't heard twice.
+		uint32_t before = 0, after = 0;
+		m_state = GetFrame(m_rollbackFrom).state;
+		for (uint32_t tick = m_rollbackFrom; tick < m_tick; tick++)
+		{
+			before |= GetFrame(tick).events;
+
+			uint32_t resimulatedEvents;
+			SimulateTick(tick, resimulatedEvents);
+			after |= resimulatedEvents;
+			resimulated++;
+		}
+		corrected = after & ~before; // Didn't happen the first time round, so nobody's heard it yet.
+
+		m_stats.rollbacks++;
+		m_stats.resimulatedTicks += resimulated;
+		m_stats.maxRollbackDepth = std::max(m_stats.maxRollbackDepth, resimulated);
+	}
+	m_rollbackFrom = UINT32_MAX;
+
+	SimulateTick(m_tick, events);
+	events |= corrected;
+	m_tick++;
+	m_stats.ticks++;
+
+	CheckRemoteChecksums();
+	return resimulated;
+}
+
+bool RollbackSession::GetChecksum(uint32_t tick, uint32_t &checksum) const
+{
+	if (tick >= m_remoteConfirmed || tick >= m_tick || tick >= m_rollbackFrom) // Not final yet.
+		return false;
+
+	const Frame *frame = FindFrame(tick);
+	if (!frame)
+		return false;
+
+	checksum = frame->checksum;
+	return true;
+}
+
+uint32_t RollbackSession::GetLatestChecksumTick() const
+{
+	uint32_t end = std::min(std::min(m_remoteConfirmed, m_tick), m_rollbackFrom);
+	return end == 0 ? UINT32_MAX : end - 1;
+}
+
+void RollbackSession::AddRemoteChecksum(uint32_t tick, uint32_t checksum)
+{
+	m_remoteChecksums.emplace_back(tick, checksum);
+	CheckRemoteChecksums();
+}
+
+RollbackSession::Frame &RollbackSession::GetFrame(uint32_t tick)
+{
+	Frame &frame = m_frames[tick % rollbackHistorySize];
+	if (frame.tick != tick)
+	{
+		frame = Frame{};
+		frame.tick = tick;
+	}
+	return frame;
+}
+
+const RollbackSession::Frame *RollbackSession::FindFrame(uint32_t tick) const
+{
+	const Frame &frame = m_frames[tick % rollbackHistorySize];
+	return frame.tick == tick ? &frame : nullptr;
+}
+
+void RollbackSession::SimulateTick(uint32_t tick, uint32_t &events)
+{
+	Frame &frame = GetFrame(tick);
+	frame.state = m_state;
+	frame.remoteUsed = frame.remoteKnown ? frame.remoteInput : m_lastRemoteInput;
+
+	SimInputs inputs;
+	inputs.paddles[m_localSide] = frame.localInput;
+	inputs.paddles[m_localSide == SIM_LEFT ? SIM_RIGHT : SIM_LEFT] = frame.remoteUsed;
+
+	m_state = SimStep(m_state, inputs, simTickTime, events);
+	frame.checksum = SimChecksum(m_state);
+	frame.events = events;
+}
+
+void RollbackSession::CheckRemoteChecksums()
+{
+	for (auto it = m_remoteChecksums.begin(); it != m_remoteChecksums.end();)
+	{
+		uint32_t checksum;
+		if (!GetChecksum(it->first, checksum))
+		{
+			if (it->first + rollbackHistorySize < m_tick) // Fell out of history before we could check it.
+				it = m_remoteChecksums.erase(it);
+			else
+				++it;
+			continue;
+		}
+
+		if (checksum != it->second && !m_desynced)
+		{
+			m_desynced = true;
+			m_desyncTick = it->first;
+		}
+		it = m_remoteChecksums.erase(it);
+	}
+}
+
+uint32_t SimChecksum(const SimState &state)
+{
+	uint64_t hash = SimHash(state);
+	return (uint32_t)(hash ^ (hash >> 32));
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulation.h"
+
+// GGPO style rollback over the shared simulation. Both peers simulate both paddles, the local input is delayed by a
+// few ticks to hide some latency and the remote input is predicted (it repeats the last one received). When a remote
+// input turns up that doesn't match what was predicted, the state is restored from the snapshot ring and every tick
+// since is simulated again, all before the next frame is drawn.
+
+constexpr int rollbackHistorySize = 128; // Ticks of snapshots kept, has to be more than the max rollback.
+constexpr int defaultInputDelay = 2;
+constexpr int defaultMaxRollback = 8; // How far ahead of the remote's inputs we're allowed to predict before waiting.
+constexpr int rollbackInputRedundancy = 8; // Inputs resent in every packet, so one lost packet doesn't stall anyone.
+
+struct RollbackStats
+{
+	uint64_t ticks = 0; // New ticks simulated.
+	uint64_t rollbacks = 0;
+	uint64_t resimulatedTicks = 0;
+	int maxRollbackDepth = 0;
+	uint64_t stalls = 0; // Times Advance was refused because the remote had fallen too far behind.
+};
+
+class RollbackSession
+{
+public:
+	RollbackSession() = default;
+	~RollbackSession() = default;
+
+	void Start(const SimState &initial, int localSide, int inputDelay = defaultInputDelay, int maxRollback = defaultMaxRollback);
+	bool IsActive() const { return m_active; }
+	void Stop() { m_active = false; }
+
+	uint32_t GetTick() const { return m_tick; } // Next tick to simulate.
+	const SimState &GetState() const { return m_state; } // Includes predictions.
+	int GetLocalSide() const { return m_localSide; }
+
+	uint32_t AddLocalInput(uint8_t input); // Sampled now, used for the tick inputDelay ahead. Returns that tick.
+	void AddRemoteInput(uint32_t tick, uint8_t input); // In any order, repeats are ignored.
+	uint8_t GetLocalInput(uint32_t tick) const; // For resending.
+
+	bool CanAdvance(); // False while too far ahead of the remote, counts a stall.
+	// Rolls back if needed then simulates one new tick. Returns ticks resimulated.
+	// Events are the new tick's, plus any the rollback turned up that the first pass over those ticks didn't have.
+	int Advance(uint32_t &events);
+
+	// Desync detection. A checksum is final once both inputs for the tick are known and it's been simulated with them.
+	uint32_t GetConfirmedTick() const { return m_remoteConfirmed; } // Every input before this is known.
+	bool GetChecksum(uint32_t tick, uint32_t &checksum) const;
+	uint32_t GetLatestChecksumTick() const; // Newest tick with a final checksum, or UINT32_MAX if none yet.
+	void AddRemoteChecksum(uint32_t tick, uint32_t checksum);
+	bool HasDesynced() const { return m_desynced; }
+	uint32_t GetDesyncTick() const { return m_desyncTick; }
+
+	const RollbackStats &GetStats() const { return m_stats; }
+
+private:
+	struct Frame
+	{
+		uint32_t tick = UINT32_MAX; // Which tick this slot currently holds.
+		SimState state; // At the start of the tick.
+
+		uint8_t localInput = 0;
+		uint8_t remoteInput = 0;
+		uint8_t remoteUsed = 0; // What it was last simulated with, the real input or a prediction.
+		bool remoteKnown = false;
+
+		uint32_t checksum = 0; // Of the state after the tick.
+		uint32_t events = 0; // From the last time it was simulated.
+	};
+
+	Frame &GetFrame(uint32_t tick); // Claims the slot for the tick if something older still has it.
+	const Frame *FindFrame(uint32_t tick) const;
+	void SimulateTick(uint32_t tick, uint32_t &events);
+	void CheckRemoteChecksums();
+
+private:
+	bool m_active = false;
+	int m_localSide = SIM_LEFT;
+	int m_inputDelay = defaultInputDelay;
+	int m_maxRollback = defaultMaxRollback;
+
+	SimState m_state;
+	uint32_t m_tick = 0;
+	uint32_t m_nextLocalTick = 0; // Next tick AddLocalInput will fill.
+
+	uint32_t m_remoteConfirmed = 0;
+	uint8_t m_lastRemoteInput = 0; // Newest remote input received, the prediction for anything after it.
+	uint32_t m_lastRemoteTick = 0;
+	uint32_t m_rollbackFrom = UINT32_MAX; // Earliest tick simulated with a wrong prediction.
+
+	std::vector<Frame> m_frames; // Ring, rollbackHistorySize long.
+	std::vector<std::pair<uint32_t, uint32_t>> m_remoteChecksums; // Waiting for ours to be final.
+	bool m_desynced = false;
+	uint32_t m_desyncTick = 0;
+
+	RollbackStats m_stats;
+
+};
+
+uint32_t SimChecksum(const SimState &state); // Folded SimHash, what goes over the wire.
@@ -0,0 +1,369 @@
+#include "ShmLink.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "Clock.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+constexpr uint32_t shmLinkMagic = 0x4B4E4C50; // "PLNK", written last once the worker has set the region up.
+constexpr size_t shmRecordAlignment = 16; // Also the header's size, so there's always room for a skip record at the end.
+
+struct ShmRecordHeader
+{
+	uint32_t size; // Payload bytes.
+	uint8_t type; // Zero means skip to the start of the ring, the next record didn't fit before the end.
+	uint8_t padding[3];
+	uint32_t clientId;
+	uint32_t reserved;
+};
+static_assert(sizeof(ShmRecordHeader) == shmRecordAlignment);
+
+struct ShmRing
+{
+	alignas(64) std::atomic<uint64_t> head; // Bytes ever written, only the sender moves it.
+	alignas(64) std::atomic<uint64_t> tail; // Bytes ever read, only the receiver moves it.
+	alignas(64) std::atomic<uint32_t> wakeSequence; // What the receiver sleeps on.
+	std::atomic<uint32_t> sleeping;
+	alignas(64) uint8_t data[shmLinkRingSize];
+};
+
+struct ShmRegion
+{
+	std::atomic<uint32_t> magic;
+	ShmRing rings[2]; // To the worker, then to the gateway.
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The rings are shared between processes, they can't have locks.");
+
+static size_t RecordLength(size_t payload)
+{
+	return (sizeof(ShmRecordHeader) + payload + shmRecordAlignment - 1) & ~(shmRecordAlignment - 1);
+}
+
+#ifndef _WIN32
+static std::string RegionName(uint16_t port)
+{
+	return "/pong_link_" + std::to_string(port);
+}
+#endif
+
+bool ShmLink::Open(uint16_t port, eShmLinkSide side)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	size_t size = sizeof(ShmRegion);
+	bool creating = side == SHM_LINK_WORKER;
+	void *memory = nullptr;
+
+#ifdef _WIN32
+	std::string name = "Local\\pong_link_" + std::to_string(port);
+	HANDLE mapping = creating
+		? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, name.c_str())
+		: OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+	if (mapping == nullptr)
+		return false;
+
+	memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (memory == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	m_mappingHandle = mapping;
+
+	for (int i = 0; i < 2; i++)
+		m_events[i] = CreateEventA(nullptr, FALSE, FALSE, (name + "_" + std::to_string(i)).c_str()); // Opens it if the other side got there first.
+#else
+	std::string name = RegionName(port);
+	if (creating)
+		shm_unlink(name.c_str()); // Left behind by a worker that didn't shut down cleanly.
+
+	int descriptor = shm_open(name.c_str(), creating ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+	if (descriptor < 0)
+		return false;
+
+	struct stat status;
+	if ((creating && ftruncate(descriptor, (off_t)size) != 0) || fstat(descriptor, &status) != 0 || (size_t)status.st_size < size)
+	{
+		close(descriptor);
+		if (creating)
+			shm_unlink(name.c_str());
+		return false;
+	}
+
+	memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (memory == MAP_FAILED)
+	{
+		close(descriptor);
+		if (creating)
+			shm_unlink(name.c_str());
+		return false;
+	}
+	m_descriptor = descriptor;
+	m_name = name;
+#endif
+
+	m_region = (ShmRegion *)memory;
+	m_regionSize = size;
+	m_side = side;
+
+	if (!creating && m_region->magic.load(std::memory_order_acquire) != shmLinkMagic) // Worker's still setting it up.
+	{
+		CloseRegion();
+		return false;
+	}
+
+	m_port = port;
+
+	if (creating)
+	{
+		// Fresh memory is zeroed, which is already an empty ring, this just makes the atomics official.
+		new (&m_region->magic) std::atomic<uint32_t>(0);
+		for (ShmRing &ring : m_region->rings)
+		{
+			new (&ring.head) std::atomic<uint64_t>(0);
+			new (&ring.tail) std::atomic<uint64_t>(0);
+			new (&ring.wakeSequence) std::atomic<uint32_t>(0);
+			new (&ring.sleeping) std::atomic<uint32_t>(0);
+		}
+		m_region->magic.store(shmLinkMagic, std::memory_order_release);
+	}
+
+	m_sendIndex = side == SHM_LINK_WORKER ? 1 : 0;
+	m_receiveIndex = 1 - m_sendIndex;
+	m_sendRing = &m_region->rings[m_sendIndex];
+	m_receiveRing = &m_region->rings[m_receiveIndex];
+	m_pendingRelease = 0;
+	return true;
+}
+
+void ShmLink::Close()
+{
+	if (m_region)
+		ReleaseReceived();
+
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	CloseRegion();
+}
+
+int ShmLink::GetDescriptor() const
+{
+#ifdef _WIN32
+	return -1;
+#else
+	return m_region ? m_descriptor : -1;
+#endif
+}
+
+bool ShmLink::Adopt(int descriptor, uint16_t port)
+{
+	Close();
+
+#ifdef _WIN32
+	return false;
+#else
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	size_t size = sizeof(ShmRegion);
+
+	struct stat status;
+	void *memory = MAP_FAILED;
+	if (fstat(descriptor, &status) == 0 && (size_t)status.st_size >= size)
+		memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (memory == MAP_FAILED)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	m_region = (ShmRegion *)memory;
+	m_regionSize = size;
+	m_side = SHM_LINK_WORKER;
+	m_descriptor = descriptor;
+	m_name = RegionName(port);
+	if (m_region->magic.load(std::memory_order_acquire) != shmLinkMagic)
+	{
+		CloseRegion(false); // Not ours to remove, whatever it is.
+		return false;
+	}
+
+	// Nothing's reset, the gateway never notices the rings changed hands.
+	m_port = port;
+	m_sendIndex = 1;
+	m_receiveIndex = 0;
+	m_sendRing = &m_region->rings[m_sendIndex];
+	m_receiveRing = &m_region->rings[m_receiveIndex];
+	m_pendingRelease = 0;
+	return true;
+#endif
+}
+
+void ShmLink::Detach()
+{
+	// The rings are someone else's by now, anything we hadn't released stays theirs to read.
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	m_pendingRelease = 0;
+	CloseRegion(false);
+}
+
+void ShmLink::CloseRegion(bool remove)
+{
+	if (!m_region)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_region);
+	CloseHandle(m_mappingHandle);
+	m_mappingHandle = nullptr;
+	for (void *&event : m_events)
+	{
+		if (event)
+			CloseHandle(event);
+		event = nullptr;
+	}
+#else
+	munmap(m_region, m_regionSize);
+	close(m_descriptor);
+	m_descriptor = -1;
+	if (m_side == SHM_LINK_WORKER && remove) // The gateway keeps its mapping until it notices we're gone.
+		shm_unlink(m_name.c_str());
+#endif
+
+	m_region = nullptr;
+	m_sendRing = nullptr;
+	m_receiveRing = nullptr;
+	m_port = 0;
+}
+
+bool ShmLink::Send(uint8_t type, uint32_t clientId, const void *payload, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	if (!m_region || size > workerMessageMaxPayload)
+		return false;
+
+	ShmRing &ring = *m_sendRing;
+	uint64_t head = ring.head.load(std::memory_order_relaxed);
+	uint64_t tail = ring.tail.load(std::memory_order_acquire);
+
+	size_t length = RecordLength(size);
+	size_t offset = (size_t)(head & (shmLinkRingSize - 1));
+	size_t toEnd = shmLinkRingSize - offset;
+	size_t skip = toEnd < length ? toEnd : 0; // Records never wrap, the rest of the ring is skipped instead.
+	if (shmLinkRingSize - (head - tail) < skip + length)
+		return false;
+
+	if (skip > 0)
+	{
+		ShmRecordHeader header = {};
+		std::memcpy(ring.data + offset, &header, sizeof(header));
+		head += skip;
+		offset = 0;
+	}
+
+	ShmRecordHeader header = { (uint32_t)size, type, {}, clientId, 0 };
+	std::memcpy(ring.data + offset, &header, sizeof(header));
+	if (size > 0)
+		std::memcpy(ring.data + offset + sizeof(header), payload, size);
+
+	// Publish, then check whether the receiver went to sleep before it could see it. Both sides use seq_cst here so one
+	// of them always sees the other.
+	ring.head.store(head + length, std::memory_order_seq_cst);
+	if (ring.sleeping.load(std::memory_order_seq_cst))
+		Wake(ring, m_sendIndex);
+	return true;
+}
+
+bool ShmLink::Receive(WorkerMessage &message, double timeout)
+{
+	if (!m_region)
+		return false;
+
+	ReleaseReceived(); // Done with the last one, the sender can have its space back.
+
+	ShmRing &ring = *m_receiveRing;
+	double deadline = ClockNowSeconds() + timeout;
+	while (true)
+	{
+		uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+		uint64_t head = ring.head.load(std::memory_order_acquire);
+
+		if (head != tail)
+		{
+			size_t offset = (size_t)(tail & (shmLinkRingSize - 1));
+			ShmRecordHeader header;
+			std::memcpy(&header, ring.data + offset, sizeof(header));
+
+			if (header.type == 0)
+			{
+				ring.tail.store(tail + (shmLinkRingSize - offset), std::memory_order_release);
+				continue;
+			}
+
+			message.fromPort = m_port;
+			message.type = header.type;
+			message.clientId = header.clientId;
+			message.payload = ring.data + offset + sizeof(header);
+			message.size = header.size;
+			m_pendingRelease = RecordLength(header.size);
+			return true;
+		}
+
+		double remaining = deadline - ClockNowSeconds();
+		if (remaining <= 0.0)
+			return false;
+
+		uint32_t sequence = ring.wakeSequence.load(std::memory_order_seq_cst);
+		ring.sleeping.store(1, std::memory_order_seq_cst);
+		if (ring.head.load(std::memory_order_seq_cst) == tail) // Still nothing now we've said we're sleeping.
+			Wait(ring, m_receiveIndex, sequence, remaining);
+		ring.sleeping.store(0, std::memory_order_relaxed);
+	}
+}
+
+void ShmLink::ReleaseReceived()
+{
+	if (m_pendingRelease == 0)
+		return;
+
+	ShmRing &ring = *m_receiveRing;
+	ring.tail.store(ring.tail.load(std::memory_order_relaxed) + m_pendingRelease, std::memory_order_release);
+	m_pendingRelease = 0;
+}
+
+void ShmLink::Wake(ShmRing &ring, [[maybe_unused]] int index) // Which event, only Windows has them.
+{
+	ring.wakeSequence.fetch_add(1, std::memory_order_seq_cst);
+#ifdef _WIN32
+	SetEvent(m_events[index]);
+#else
+	syscall(SYS_futex, (uint32_t *)&ring.wakeSequence, FUTEX_WAKE, 1, nullptr, nullptr, 0); // Not FUTEX_PRIVATE, it's shared between processes.
+#endif
+}
+
+void ShmLink::Wait(ShmRing &ring, [[maybe_unused]] int index, uint32_t sequence, double timeout)
+{
+#ifdef _WIN32
+	if (ring.wakeSequence.load(std::memory_order_seq_cst) == sequence)
+		WaitForSingleObject(m_events[index], (DWORD)(timeout * 1000.0) + 1);
+#else
+	timespec wait;
+	wait.tv_sec = (time_t)timeout;
+	wait.tv_nsec = (long)((timeout - (double)wait.tv_sec) * 1e9);
+	syscall(SYS_futex, (uint32_t *)&ring.wakeSequence, FUTEX_WAIT, sequence, &wait, nullptr, 0); // Returns straight away if it's moved on.
+#endif
+}
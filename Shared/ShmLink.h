@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <mutex>
+
+#include "WorkerLink.h"
+
+// Shared memory alternative to WorkerLink for a gateway and a worker on the same host.
+// One region per worker holds two single producer, single consumer rings, one each way. Messages are framed in place:
+// senders copy straight into the ring and receivers read straight out of it, nothing goes through the kernel unless the
+// receiver is asleep and has to be woken (a futex on Linux, a named event on Windows).
+// The worker creates the region, named after its --worker-port, and the gateway opens it.
+// Kept away from raylib.h on purpose, windows.h and raylib don't get along.
+
+constexpr size_t shmLinkRingSize = 1 << 20; // Bytes each way, a power of two.
+
+enum eShmLinkSide
+{
+	SHM_LINK_WORKER = 0, // Creates the region, sends on the to-gateway ring.
+	SHM_LINK_GATEWAY,
+};
+
+struct ShmRing;
+struct ShmRegion;
+
+class ShmLink
+{
+public:
+	ShmLink() = default;
+	~ShmLink() { Close(); }
+
+	ShmLink(const ShmLink &link) = delete;
+	ShmLink &operator=(const ShmLink &link) = delete;
+
+	bool Open(uint16_t port, eShmLinkSide side); // The gateway's open fails until the worker has created it.
+	void Close();
+
+	// For handing the region to the worker replacing this one, see Handoff.h. POSIX only.
+	int GetDescriptor() const;
+	bool Adopt(int descriptor, uint16_t port); // Worker side, takes ownership and carries on the rings where they are.
+	void Detach(); // Unmaps without removing the region or touching its rings, the worker it was handed to has them now.
+
+	bool IsOpen() const { return m_region != nullptr; }
+	uint16_t GetPort() const { return m_port; }
+
+	// Safe from any thread, senders take turns. False if the ring is full, the receiver has fallen too far behind.
+	bool Send(uint8_t type, uint32_t clientId, const void *payload = nullptr, size_t size = 0);
+	// One thread only. The message stays in the ring until the next Receive(), so its payload is never copied.
+	bool Receive(WorkerMessage &message, double timeout);
+	// The receiving thread, once it's stopped. Hands the last message's space back, before the region's handed over.
+	void ReleaseReceived();
+
+private:
+	void CloseRegion(bool remove = true); // With the send lock held. Only the worker ever removes it.
+	void Wake(ShmRing &ring, int index);
+	void Wait(ShmRing &ring, int index, uint32_t sequence, double timeout);
+
+private:
+	ShmRegion *m_region = nullptr;
+	size_t m_regionSize = 0;
+	uint16_t m_port = 0;
+	eShmLinkSide m_side = SHM_LINK_WORKER;
+
+	ShmRing *m_sendRing = nullptr;
+	ShmRing *m_receiveRing = nullptr;
+	int m_sendIndex = 0; // Which of the region's rings, for the wake events.
+	int m_receiveIndex = 0;
+	uint64_t m_pendingRelease = 0; // Bytes of the last received message, handed back on the next Receive().
+
+	std::mutex m_sendMutex;
+
+#ifdef _WIN32
+	void *m_mappingHandle = nullptr;
+	void *m_events[2] = {};
+#else
+	int m_descriptor = -1;
+	std::string m_name;
+#endif
+
+};
@@ -0,0 +1,202 @@
+#include "SimConformance.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+constexpr char simInputsMagic[4] = { 'P', 'S', 'I', 'N' };
+
+bool SaveSimInputs(const std::string &path, const SimInputLog &log)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	uint32_t count = (uint32_t)log.ticks.size();
+	file.write(simInputsMagic, sizeof(simInputsMagic));
+	file.write((const char *)&log.seed, sizeof(log.seed));
+	file.write((const char *)&count, sizeof(count));
+	for (const SimInputs &inputs : log.ticks)
+		file.write((const char *)inputs.paddles, sizeof(inputs.paddles));
+	return file.good();
+}
+
+bool LoadSimInputs(const std::string &path, SimInputLog &log)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	char magic[4];
+	uint32_t count = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char *)&log.seed, sizeof(log.seed));
+	file.read((char *)&count, sizeof(count));
+	if (!file.good() || std::memcmp(magic, simInputsMagic, sizeof(magic)) != 0)
+		return false;
+
+	log.ticks.resize(count);
+	for (SimInputs &inputs : log.ticks)
+		file.read((char *)inputs.paddles, sizeof(inputs.paddles));
+	return file.good();
+}
+
+SimInputLog SimRecordInputs(uint64_t seed, uint32_t ticks)
+{
+	SimInputLog log;
+	log.seed = seed;
+	log.ticks.reserve(ticks);
+
+	float aim[SIM_SIDES] = { 0.0f, 0.0f };
+	uint64_t draws = 0;
+
+	SimState state = SimInit(seed);
+	state.playing = true;
+	for (uint32_t tick = 0; tick < ticks; tick++)
+	{
+		// Chase the ball, aiming for a different part of the paddle every so often so the angles vary, and miss sometimes.
+		SimInputs inputs;
+		for (int side = 0; side < SIM_SIDES; side++)
+		{
+			if (tick % 30 == 0)
+			{
+				float unit = (uint32_t)(SimRandom(seed, draws++) >> 40) * (1.0f / 16777216.0f); // [0, 1)
+				aim[side] = (unit * 2.0f - 1.0f) * paddleHeight * 0.6f;
+			}
+
+			float target = SimToFloat(state.ball.yPosition) + aim[side];
+			float paddle = SimToFloat(state.paddles[side].yPosition);
+			if (target < paddle - paddleHeight * 0.1f)
+				inputs.paddles[side] = SIM_INPUT_UP;
+			else if (target > paddle + paddleHeight * 0.1f)
+				inputs.paddles[side] = SIM_INPUT_DOWN;
+		}
+
+		log.ticks.push_back(inputs);
+
+		uint32_t events;
+		state = SimStep(state, inputs, simTickTime, events);
+	}
+	return log;
+}
+
+std::vector<uint64_t> SimReplayHashes(const SimInputLog &log)
+{
+	std::vector<uint64_t> hashes;
+	hashes.reserve(log.ticks.size());
+
+	SimState state = SimInit(log.seed);
+	state.playing = true;
+	for (const SimInputs &inputs : log.ticks)
+	{
+		uint32_t events;
+		state = SimStep(state, inputs, simTickTime, events);
+		hashes.push_back(SimHash(state));
+	}
+	return hashes;
+}
+
+std::vector<uint64_t> SimGoldenHashes()
+{
+	std::vector<uint64_t> hashes = SimReplayHashes(SimRecordInputs(simGoldenSeed, simGoldenTicks));
+
+	std::vector<uint64_t> kept;
+	for (size_t tick = simGoldenInterval - 1; tick < hashes.size(); tick += simGoldenInterval)
+		kept.push_back(hashes[tick]);
+	return kept;
+}
+
+bool SaveSimHashes(const std::string &path, const std::vector<uint64_t> &hashes)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	char line[32];
+	for (uint64_t hash : hashes)
+	{
+		std::snprintf(line, sizeof(line), "%016" PRIx64 "\n", hash);
+		file << line;
+	}
+	return file.good();
+}
+
+bool LoadSimHashes(const std::string &path, std::vector<uint64_t> &hashes)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+		return false;
+
+	hashes.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty())
+			continue;
+		hashes.push_back(std::strtoull(line.c_str(), nullptr, 16));
+	}
+	return true;
+}
+
+int RunSimConformance(const std::string &inputsPath, const std::string &hashesPath)
+{
+	SimInputLog log;
+	if (!LoadSimInputs(inputsPath, log))
+	{
+		std::cout << "Couldn't read inputs from " << inputsPath << std::endl;
+		return 1;
+	}
+
+	std::vector<uint64_t> hashes = SimReplayHashes(log);
+	if (!SaveSimHashes(hashesPath, hashes))
+	{
+		std::cout << "Couldn't write hashes to " << hashesPath << std::endl;
+		return 1;
+	}
+
+	std::cout << "Replayed " << hashes.size() << " ticks, hashes written to " << hashesPath << std::endl;
+	return 0;
+}
+
+int RunSimGoldenCheck(const std::string &goldenPath, bool write)
+{
+	std::vector<uint64_t> hashes = SimGoldenHashes();
+	if (write)
+	{
+		if (!SaveSimHashes(goldenPath, hashes))
+		{
+			std::cout << "Couldn't write " << goldenPath << std::endl;
+			return 1;
+		}
+		std::cout << "Wrote " << hashes.size() << " golden hashes to " << goldenPath << std::endl;
+		return 0;
+	}
+
+	std::vector<uint64_t> golden;
+	if (!LoadSimHashes(goldenPath, golden) || golden.empty())
+	{
+		std::cout << "Couldn't read golden hashes from " << goldenPath << std::endl;
+		return 1;
+	}
+
+	for (size_t i = 0; i < hashes.size() && i < golden.size(); i++)
+	{
+		if (hashes[i] != golden[i])
+		{
+			std::cout << "Differs from " << goldenPath << " between ticks " << i * simGoldenInterval << " and " << (i + 1) * simGoldenInterval - 1
+				<< ", 'simcheck record' with --seed " << simGoldenSeed << " and 'simcheck compare' against a reference build find the tick" << std::endl;
+			return 1;
+		}
+	}
+	if (hashes.size() != golden.size())
+	{
+		std::cout << "Matched " << goldenPath << " as far as it goes, but it has " << golden.size() << " hashes against " << hashes.size() << std::endl;
+		return 1;
+	}
+
+	std::cout << "Matches " << goldenPath << " for all " << simGoldenTicks << " ticks" << std::endl;
+	return 0;
+}
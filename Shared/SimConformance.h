@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+
+// Replays a recorded input stream through the simulation and hashes the state after every tick.
+// Each build runs it with '--sim-conformance <inputs> <hashes>' (client and server) or 'Pong_Tools simcheck hash',
+// then 'Pong_Tools simcheck compare' finds the first tick the builds disagree on.
+// The client and server link the same Pong_Sim, so comparing them only shows they agree with each other. What catches a
+// compiler or flag change is the golden check: a fixed input stream, and the hashes a reference build got from it
+// checked in under Pong_Sim/golden, that any build checks itself against with '--sim-golden <file>' or
+// 'Pong_Tools simcheck golden'. Only rewrite them ('simcheck golden --write') when the simulation is changed on purpose.
+
+constexpr uint64_t simGoldenSeed = 1;
+constexpr uint32_t simGoldenTicks = simTickRate * 60 * 2; // Two minutes of play.
+constexpr uint32_t simGoldenInterval = simTickRate; // Ticks between the hashes kept, 'simcheck compare' narrows it down from there.
+#if PONG_FIXED_POINT_SIM
+constexpr const char *defaultSimGoldenPath = "Pong_Sim/golden/fixed.txt";
+#else
+constexpr const char *defaultSimGoldenPath = "Pong_Sim/golden/float.txt"; // Not promised to match between compilers, that's what fixed point is for.
+#endif
+
+struct SimInputLog
+{
+	uint64_t seed = 0;
+	std::vector<SimInputs> ticks; // One per tick, the ball's in play from the first.
+};
+
+bool SaveSimInputs(const std::string &path, const SimInputLog &log);
+bool LoadSimInputs(const std::string &path, SimInputLog &log);
+
+SimInputLog SimRecordInputs(uint64_t seed, uint32_t ticks); // Two scripted players, drawn with SimRandom so it's the same stream everywhere.
+std::vector<uint64_t> SimReplayHashes(const SimInputLog &log); // Hash after each tick.
+std::vector<uint64_t> SimGoldenHashes(); // This build's, after every simGoldenInterval ticks of the golden inputs.
+
+bool SaveSimHashes(const std::string &path, const std::vector<uint64_t> &hashes); // Text, one per line.
+bool LoadSimHashes(const std::string &path, std::vector<uint64_t> &hashes);
+
+int RunSimConformance(const std::string &inputsPath, const std::string &hashesPath); // Returns an exit code.
+int RunSimGoldenCheck(const std::string &goldenPath, bool write = false); // Returns an exit code, non-zero if this build differs.
@@ -0,0 +1,243 @@
+#include "Simulation.h"
+
+#include <cmath>
+
+// The constants as the simulation's scalar, worked out at compile time in fixed point mode.
+constexpr SimScalar simPaddleHalfWidth = paddleWidth / 2.0f;
+constexpr SimScalar simPaddleHalfHeight = paddleHeight / 2.0f;
+constexpr SimScalar simPaddleXOffset = paddleXOffset;
+constexpr SimScalar simPaddleVSpeed = paddleVSpeed;
+constexpr SimScalar simBallHalfWidth = ballWidth / 2.0f;
+constexpr SimScalar simBallHalfHeight = ballHeight / 2.0f;
+constexpr SimScalar simBallHSpeed = ballHSpeed;
+constexpr SimScalar simBallVSpeed = ballVSpeed;
+constexpr SimScalar simMaxBounceAngle = 45 * simDegToRad;
+constexpr SimScalar simZero = 0.0f;
+constexpr SimScalar simHalf = 0.5f;
+constexpr SimScalar simOne = 1.0f;
+
+#if PONG_FIXED_POINT_SIM
+static SimScalar SimSin(SimScalar angle) { return FixedSin(angle); }
+static SimScalar SimCos(SimScalar angle) { return FixedCos(angle); }
+static SimScalar SimAbs(SimScalar value) { return FixedAbs(value); }
+#else
+static SimScalar SimSin(SimScalar angle) { return sinf(angle); }
+static SimScalar SimCos(SimScalar angle) { return cosf(angle); }
+static SimScalar SimAbs(SimScalar value) { return fabsf(value); }
+#endif
+
+uint64_t SimRandom(uint64_t seed, uint64_t counter)
+{
+	// SplitMix64's finaliser over the seed stepped on by the counter, so any draw can be made without the ones before it.
+	uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static uint32_t SimNextRandom(SimState &state)
+{
+	return (uint32_t)(SimRandom(state.rngSeed, state.rngCounter++) >> 32);
+}
+
+static SimScalar SimUnitFromBits(uint32_t bits)
+{
+	// [0, 1) made straight from the bits, no rounding so both modes are the same on every machine.
+#if PONG_FIXED_POINT_SIM
+	return Fixed::FromRaw((int32_t)(bits >> 16));
+#else
+	return (float)(bits >> 8) * (1.0f / 16777216.0f);
+#endif
+}
+
+static SimScalar SimRandomAngle(SimState &state)
+{
+	// Any angle in one of the four quadrants, kept away from the axes so the ball never goes straight across or straight up.
+	constexpr SimScalar minAxisAngle = simLaunchAxisMargin * simDegToRad;
+	constexpr SimScalar launchSpread = (90 - 2 * simLaunchAxisMargin) * simDegToRad;
+	constexpr SimScalar quarterTurn = 90 * simDegToRad;
+
+	uint32_t bits = SimNextRandom(state);
+	SimScalar quadrant = SimScalar((int)(bits & 3));
+	return quadrant * quarterTurn + minAxisAngle + SimUnitFromBits(bits & ~3u) * launchSpread;
+}
+
+SimState SimInit(uint64_t seed)
+{
+	SimState state;
+	state.rngSeed = seed;
+	state.rngCounter = 0;
+	SimResetBall(state);
+	return state;
+}
+
+void SimResetBall(SimState &state)
+{
+	state.ball.xPosition = simHalf;
+	state.ball.yPosition = simHalf;
+	state.ball.currentHSpeed = simBallHSpeed;
+	state.ball.currentVSpeed = simBallVSpeed;
+
+	SimScalar angle = SimRandomAngle(state);
+	state.ball.xVelocity = simBallHSpeed * SimCos(angle);
+	state.ball.yVelocity = simBallVSpeed * SimSin(angle);
+}
+
+#if PONG_SIM_PHASE_HOOK
+#define SIM_PHASE(phase, begin) if (hook) hook(phase, begin)
+#else
+#define SIM_PHASE(phase, begin)
+#endif
+
+SimState SimStep(const SimState &state, const SimInputs &inputs, SimScalar dt, uint32_t &events, [[maybe_unused]] SimPhaseHook hook)
+{
+	SimState next = state;
+	next.tick++;
+	events = 0;
+
+	if (next.playing)
+	{
+		SimBall &ball = next.ball;
+
+		SIM_PHASE(SIM_PHASE_COLLISION, true);
+
+		// Check ball collision.
+		for (int side = 0; side < SIM_SIDES; side++)
+		{
+			if (!SimBallHitsPaddle(ball, side, next.paddles[side].yPosition))
+				continue;
+
+			bool movingTowards = side == SIM_RIGHT ? ball.xVelocity > simZero : ball.xVelocity < simZero;
+			if (!movingTowards) // Already bounced off, it's just still overlapping.
+				continue;
+
+			// Calculate bounce angle
+			SimScalar intersectY = next.paddles[side].yPosition - ball.yPosition; // How far from the middle of the paddle did the ball hit?
+			SimScalar normalizedIntersect = intersectY / simPaddleHalfHeight; // -1 <-> 1
+			SimScalar bounceAngle = normalizedIntersect * simMaxBounceAngle;
+			ball.currentHSpeed = simBallHSpeed + SimAbs(normalizedIntersect) * simBallHSpeed;
+			ball.currentVSpeed = simBallVSpeed + SimAbs(normalizedIntersect) * simBallVSpeed;
+
+			// Set balls new velocity based on new angle and which direction they've been hit from.
+			if (side == SIM_LEFT)
+			{
+				ball.xVelocity = ball.currentHSpeed * SimCos(bounceAngle);
+				ball.yVelocity = ball.currentVSpeed * -SimSin(bounceAngle);
+			}
+			else
+			{
+				ball.xVelocity = ball.currentHSpeed * -SimCos(bounceAngle);
+				ball.yVelocity = ball.currentVSpeed * SimSin(bounceAngle);
+			}
+
+			events |= side == SIM_LEFT ? SIM_EVENT_HIT_LEFT : SIM_EVENT_HIT_RIGHT;
+		}
+
+		// Check if ball hits vertical bounds, flip y direction if it's heading out of them.
+		if ((ball.yPosition < simZero && ball.yVelocity < simZero) || (ball.yPosition > simOne && ball.yVelocity > simZero))
+		{
+			ball.yVelocity = -ball.yVelocity; // Bounce.
+			events |= SIM_EVENT_BOUNCE;
+		}
+
+		SIM_PHASE(SIM_PHASE_COLLISION, false);
+		SIM_PHASE(SIM_PHASE_SCORING, true);
+
+		// Check if ball goes out of bounds, i.e. goal.
+		if (ball.xPosition > simOne || ball.xPosition < simZero)
+		{
+			int scorer = ball.xPosition > simOne ? SIM_LEFT : SIM_RIGHT;
+			next.paddles[scorer].score += 1;
+			events |= scorer == SIM_LEFT ? SIM_EVENT_GOAL_LEFT : SIM_EVENT_GOAL_RIGHT;
+
+			SimResetBall(next);
+		}
+
+		SIM_PHASE(SIM_PHASE_SCORING, false);
+
+		// Update ball.
+		ball.xPosition += ball.xVelocity * dt;
+		ball.yPosition += ball.yVelocity * dt;
+	}
+
+	SIM_PHASE(SIM_PHASE_PADDLES, true);
+
+	// Update paddles.
+	for (int side = 0; side < SIM_SIDES; side++)
+	{
+		SimPaddle &paddle = next.paddles[side];
+
+		int input = (int)((inputs.paddles[side] & SIM_INPUT_UP) != 0) - (int)((inputs.paddles[side] & SIM_INPUT_DOWN) != 0);
+		SimScalar move = SimScalar(input) * simPaddleVSpeed * dt;
+
+		paddle.yPosition -= move; // Move the paddle.
+
+		// Clamp to bounds.
+		if (paddle.yPosition - simPaddleHalfHeight < simZero)
+			paddle.yPosition = simPaddleHalfHeight;
+		if (paddle.yPosition + simPaddleHalfHeight > simOne)
+			paddle.yPosition = simOne - simPaddleHalfHeight;
+	}
+
+	SIM_PHASE(SIM_PHASE_PADDLES, false);
+
+	return next;
+}
+
+#undef SIM_PHASE
+
+static void HashBytes(uint64_t &hash, const void *data, size_t size)
+{
+	// FNV-1a.
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+}
+
+template<typename T>
+static void HashValue(uint64_t &hash, T value)
+{
+	HashBytes(hash, &value, sizeof(value));
+}
+
+uint64_t SimHash(const SimState &state)
+{
+	// Field by field so struct padding never gets hashed.
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	HashValue(hash, state.tick);
+	HashValue(hash, (uint8_t)state.playing);
+	HashValue(hash, state.rngSeed);
+	HashValue(hash, state.rngCounter);
+	HashValue(hash, state.ball.xPosition);
+	HashValue(hash, state.ball.yPosition);
+	HashValue(hash, state.ball.xVelocity);
+	HashValue(hash, state.ball.yVelocity);
+	HashValue(hash, state.ball.currentHSpeed);
+	HashValue(hash, state.ball.currentVSpeed);
+	for (const SimPaddle &paddle : state.paddles)
+	{
+		HashValue(hash, paddle.yPosition);
+		HashValue(hash, paddle.score);
+	}
+	return hash;
+}
+
+SimScalar SimPaddleX(int side)
+{
+	return side == SIM_RIGHT ? simOne - simPaddleXOffset : simPaddleXOffset;
+}
+
+bool SimBallHitsPaddle(const SimBall &ball, int side, SimScalar paddleY)
+{
+	SimScalar paddleXPos = SimPaddleX(side);
+
+	bool collX = ball.xPosition - simBallHalfWidth <= paddleXPos + simPaddleHalfWidth && // Ball intersects paddle on X axis.
+		ball.xPosition + simBallHalfWidth >= paddleXPos - simPaddleHalfWidth;
+	bool collY = ball.yPosition - simBallHalfHeight <= paddleY + simPaddleHalfHeight && // Ball intersects paddle on Y axis.
+		ball.yPosition + simBallHalfHeight >= paddleY - simPaddleHalfHeight;
+
+	return collX && collY;
+}
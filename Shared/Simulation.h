@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+
+// Deterministic Pong simulation, shared by the client, the server and the tools.
+// Nothing in here touches raylib, the clock or any global state, so the same state, inputs and dt always give
+// the same result bit for bit, as long as it's built with the same floating point settings (see Pong_Sim.vcxproj).
+
+// Compile time switch, build every project with PONG_FIXED_POINT_SIM=1 and the simulation runs in Q16.16 fixed point
+// with table trig instead, which is identical on any compiler, flags or machine. It changes the state's layout, so
+// everything that links Pong_Sim has to agree on it.
+#ifndef PONG_FIXED_POINT_SIM
+#define PONG_FIXED_POINT_SIM 0
+#endif
+
+// Compile time switch, build Pong_Sim with PONG_SIM_PHASE_HOOK=0 and SimStep's phase hook calls compile to nothing.
+#ifndef PONG_SIM_PHASE_HOOK
+#define PONG_SIM_PHASE_HOOK 1
+#endif
+
+#if PONG_FIXED_POINT_SIM
+#include "Fixed.h"
+typedef Fixed SimScalar;
+#else
+typedef float SimScalar;
+#endif
+
+// Simulation Constants.
+constexpr unsigned int defaultClientWidth = 800; // Basis resolution.
+constexpr unsigned int defaultClientHeight = 600;
+
+constexpr float paddleWidth = (12.0f / defaultClientWidth); // Remap 0-1 for resolution independency
+constexpr float paddleHeight = (96.0f / defaultClientHeight);
+constexpr float paddleXOffset = (64.0f / defaultClientWidth);
+constexpr float paddleVSpeed = (256.0f / defaultClientHeight);
+
+constexpr float ballWidth = (10.0f / defaultClientWidth);
+constexpr float ballHeight = (10.0f / defaultClientHeight);
+constexpr float ballHSpeed = (256.0f / defaultClientWidth);
+constexpr float ballVSpeed = (256.0f / defaultClientHeight);
+
+constexpr unsigned int simTickRate = 60; // Fixed timestep, the client and server both step at this rate.
+constexpr float simTickTime = 1.0f / simTickRate;
+constexpr int maxSimStepsPerFrame = 8; // After a long hitch the leftover time is dropped rather than spiralling.
+
+constexpr float simDegToRad = 3.14159265358979323846f / 180.0f;
+constexpr float simLaunchAxisMargin = 15.0f; // Degrees, launch angles stay at least this far off the axes.
+
+// Rendering and the network still work in floats.
+#if PONG_FIXED_POINT_SIM
+inline float SimToFloat(SimScalar value) { return value.ToFloat(); }
+inline SimScalar SimFromFloat(float value) { return SimScalar(value); }
+#else
+inline float SimToFloat(SimScalar value) { return value; }
+inline SimScalar SimFromFloat(float value) { return value; }
+#endif
+
+enum eSimSide
+{
+	SIM_LEFT = 0,
+	SIM_RIGHT,
+	SIM_SIDES
+};
+
+enum eSimInput : uint8_t
+{
+	SIM_INPUT_UP = 1 << 0,
+	SIM_INPUT_DOWN = 1 << 1,
+};
+
+enum eSimEvent : uint32_t
+{
+	SIM_EVENT_HIT_LEFT = 1 << 0, // Left paddle hit the ball.
+	SIM_EVENT_HIT_RIGHT = 1 << 1,
+	SIM_EVENT_BOUNCE = 1 << 2, // Ball bounced off the top or bottom.
+	SIM_EVENT_GOAL_LEFT = 1 << 3, // Left player scored, the ball has been reset.
+	SIM_EVENT_GOAL_RIGHT = 1 << 4,
+};
+
+// Parts of a step, for timing them. The hook is only told where each one starts and ends, the simulation itself never
+// reads the clock.
+enum eSimPhase
+{
+	SIM_PHASE_COLLISION = 0, // Ball vs paddles and bounds.
+	SIM_PHASE_SCORING, // Goals and ball resets.
+	SIM_PHASE_PADDLES, // Moving and clamping paddles.
+	SIM_PHASES_MAX
+};
+
+typedef void (*SimPhaseHook)(eSimPhase phase, bool begin);
+
+// Game Objects.
+struct SimBall
+{
+	SimScalar xPosition = 0.5f;
+	SimScalar yPosition = 0.5f;
+	SimScalar xVelocity = -1.0f;
+	SimScalar yVelocity = -1.0f;
+	SimScalar currentHSpeed = ballHSpeed;
+	SimScalar currentVSpeed = ballVSpeed;
+};
+
+struct SimPaddle
+{
+	SimScalar yPosition = 0.5f;
+	uint32_t score = 0;
+};
+
+struct SimState
+{
+	uint32_t tick = 0;
+	bool playing = false; // The ball only moves once the game has started, paddles always can.
+	uint64_t rngSeed = 0; // Per match, ball launch angles come from this and the counter so they can be predicted and replayed.
+	uint32_t rngCounter = 0; // Draws made so far.
+
+	SimBall ball;
+	SimPaddle paddles[SIM_SIDES]; // Indexed by eSimSide.
+};
+
+struct SimInputs
+{
+	uint8_t paddles[SIM_SIDES] = { }; // eSimInput flags, indexed by eSimSide.
+};
+
+SimState SimInit(uint64_t seed); // Paddles centred, scores zeroed and the ball ready to launch.
+uint64_t SimRandom(uint64_t seed, uint64_t counter); // Counter-based, the same draw for the same seed and counter on every thread and machine.
+void SimResetBall(SimState &state); // Back to the centre with a new random launch angle.
+
+// Advances one tick. Events are the eSimEvent flags for anything that happened during it.
+// The hook, if there is one, is called either side of each eSimPhase. It can't change the result.
+SimState SimStep(const SimState &state, const SimInputs &inputs, SimScalar dt, uint32_t &events, SimPhaseHook hook = nullptr);
+
+uint64_t SimHash(const SimState &state); // For comparing states across builds and machines.
+
+SimScalar SimPaddleX(int side);
+bool SimBallHitsPaddle(const SimBall &ball, int side, SimScalar paddleY); // Ball-Paddle collision detection.
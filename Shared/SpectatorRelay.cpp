@@ -0,0 +1,103 @@
+#include "SpectatorRelay.h"
+
+#include <algorithm>
+
+#include "Clock.h"
+
+void SpectatorRelay::Push(const uint8_t *data, size_t size, double now)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_frames.size() >= maxBufferedFrames) // Nobody's flushing, don't grow forever.
+	{
+		m_spareBuffers.push_back(std::move(m_frames.front().data));
+		m_frames.pop_front();
+		m_stats.framesDropped++;
+	}
+
+	Frame frame;
+	frame.dueTime = now + m_delay;
+	if (!m_spareBuffers.empty())
+	{
+		frame.data = std::move(m_spareBuffers.back());
+		m_spareBuffers.pop_back();
+	}
+	frame.data.assign(data, data + size);
+	m_frames.push_back(std::move(frame));
+	m_stats.framesIn++;
+}
+
+void SpectatorRelay::Subscribe(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (std::find(m_subscribers.begin(), m_subscribers.end(), id) == m_subscribers.end())
+		m_subscribers.push_back(id);
+}
+
+void SpectatorRelay::Unsubscribe(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = std::find(m_subscribers.begin(), m_subscribers.end(), id);
+	if (it == m_subscribers.end())
+		return;
+
+	*it = m_subscribers.back(); // Order doesn't matter.
+	m_subscribers.pop_back();
+}
+
+size_t SpectatorRelay::Flush(double now, const FanOutFunction &fanOut)
+{
+	// Take what's due and who to send it to, then send without the lock so pushes and joins aren't held up.
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while (!m_frames.empty() && m_frames.front().dueTime <= now)
+		{
+			m_due.push_back(std::move(m_frames.front()));
+			m_frames.pop_front();
+		}
+		m_sendTo = m_subscribers;
+	}
+	if (m_due.empty())
+		return 0;
+
+	size_t frames = m_due.size();
+	uint64_t bytes = 0;
+	for (Frame &frame : m_due)
+	{
+		int64_t start = ClockNowNanoseconds();
+		if (!m_sendTo.empty())
+			fanOut(frame.data.data(), frame.data.size(), m_sendTo);
+		int64_t end = ClockNowNanoseconds();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.fanOut.Record(end - start);
+		m_stats.lateness.Record(start - (int64_t)(frame.dueTime * 1e9)); // Same clock.
+		bytes += frame.data.size() * m_sendTo.size();
+		m_spareBuffers.push_back(std::move(frame.data));
+	}
+	m_due.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.framesOut += frames;
+	m_stats.sends += frames * m_sendTo.size();
+	m_stats.bytesOut += bytes;
+	return frames;
+}
+
+size_t SpectatorRelay::GetSubscriberCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_subscribers.size();
+}
+
+size_t SpectatorRelay::GetBufferedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_frames.size();
+}
+
+SpectatorRelayStats SpectatorRelay::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
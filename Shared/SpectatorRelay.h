@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+#include "LatencyHistogram.h"
+
+// Holds a stream of encoded frames back by a fixed delay, then fans each one out to every subscriber.
+// Frames are copied in once and handed out as is, so the cost per spectator is only the send. Every frame the server
+// streams is a whole PONG_MATCH_SNAPSHOT, so anyone subscribing partway through is right from the next one out.
+// Push, Subscribe and Unsubscribe are safe from any thread, Flush from one at a time.
+
+constexpr double defaultSpectatorDelay = 2.0; // Seconds.
+
+struct SpectatorRelayStats
+{
+	uint64_t framesIn = 0;
+	uint64_t framesOut = 0;
+	uint64_t framesDropped = 0; // Past maxBufferedFrames, the oldest go first.
+	uint64_t sends = 0; // Frames times the subscribers they went to.
+	uint64_t bytesOut = 0;
+	LatencyHistogram fanOut; // Nanoseconds to send one frame to everyone.
+	LatencyHistogram lateness; // Nanoseconds a frame went out after it was due.
+};
+
+class SpectatorRelay
+{
+public:
+	// Given each due frame once, with who to send it to.
+	using FanOutFunction = std::function<void(const uint8_t *data, size_t size, const std::vector<uint32_t> &subscribers)>;
+
+	static constexpr size_t maxBufferedFrames = 60 * 60; // A minute of frames at the server's tick rate.
+
+	void SetDelay(double seconds) { m_delay = seconds > 0.0 ? seconds : 0.0; }
+	double GetDelay() const { return m_delay; }
+
+	void Push(const uint8_t *data, size_t size, double now); // Copied, out again at now plus the delay.
+	void Subscribe(uint32_t id);
+	void Unsubscribe(uint32_t id);
+
+	size_t Flush(double now, const FanOutFunction &fanOut); // Everything that's due, oldest first. Returns how many frames.
+
+	size_t GetSubscriberCount();
+	size_t GetBufferedCount();
+	SpectatorRelayStats GetStats();
+
+private:
+	struct Frame
+	{
+		double dueTime = 0.0;
+		std::vector<uint8_t> data;
+	};
+
+	std::mutex m_mutex; // Frames and subscribers, Flush only holds it to take what's due.
+	double m_delay = defaultSpectatorDelay;
+	std::deque<Frame> m_frames;
+	std::vector<std::vector<uint8_t>> m_spareBuffers; // Sent frames' buffers, reused so a steady stream doesn't allocate.
+	std::vector<uint32_t> m_subscribers;
+	SpectatorRelayStats m_stats;
+
+	std::vector<Frame> m_due; // Flush's, reused.
+	std::vector<uint32_t> m_sendTo;
+
+};
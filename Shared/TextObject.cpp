@@ -0,0 +1,141 @@
+#include "TextObject.h"
+
+#include <cstring>
+
+void TextObject::Init(std::string_view text, float x, float y, float lifeTime, int fontSize, Color color)
+{
+	size_t length = text.size() < MAX_TEXT - 1 ? text.size() : MAX_TEXT - 1;
+	std::memcpy(this->text, text.data(), length);
+	this->text[length] = '\0';
+
+	this->xPosition = x;
+	this->yPosition = y;
+	this->lifeTime = lifeTime;
+	this->fontSize = fontSize;
+	this->color = color;
+
+	startingLife = lifeTime;
+}
+
+void TextObject::Animate(double deltaTime)
+{
+	if (!InUse())
+		return;
+
+	color.a = (unsigned char)((lifeTime / startingLife) * 255.0f); // Set alpha over life time.
+
+	lifeTime -= (float)deltaTime; // Decrease life.
+	if (lifeTime < 0.0f)
+		lifeTime = 0.0f;
+}
+
+void TextObject::Draw() const
+{
+	if (!InUse())
+		return;
+
+	DrawText(text, (int)xPosition, (int)yPosition, fontSize, color);
+}
+
+TextObjectPool::TextObjectPool(unsigned int capacity, unsigned int maxCapacity)
+	: m_maxCapacity(maxCapacity)
+{
+	Reserve(capacity);
+}
+
+void TextObjectPool::Reserve(unsigned int capacity)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Grow(capacity);
+}
+
+void TextObjectPool::Grow(unsigned int capacity)
+{
+	if (capacity > m_maxCapacity)
+		capacity = m_maxCapacity;
+
+	unsigned int oldCapacity = (unsigned int)m_objects.size();
+	if (capacity <= oldCapacity)
+		return;
+
+	m_objects.resize(capacity);
+	m_freeSlots.reserve(capacity);
+	m_live.reserve(capacity);
+
+	for (unsigned int slot = capacity; slot > oldCapacity; slot--) // Lowest slots get used first.
+		m_freeSlots.push_back(slot - 1);
+}
+
+bool TextObjectPool::Init(std::string_view text, float x, float y, float lifeTime, int fontSize, Color color)
+{
+	if (lifeTime <= 0.0f) // Would never be seen.
+		return true;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_freeSlots.empty())
+	{
+		Grow(m_objects.size() * 2 > 0 ? (unsigned int)m_objects.size() * 2 : DEFAULT_CAPACITY);
+		if (m_freeSlots.empty())
+		{
+			m_overflowCount++;
+			return false;
+		}
+	}
+
+	uint32_t slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+
+	m_objects[slot].Init(text, x, y, lifeTime, fontSize, color);
+	m_live.push_back(slot);
+	return true;
+}
+
+void TextObjectPool::Animate(double deltaTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_live.size();)
+	{
+		uint32_t slot = m_live[i];
+
+		TextObject &object = m_objects[slot];
+		object.Animate(deltaTime);
+
+		if (object.InUse())
+		{
+			i++;
+			continue;
+		}
+
+		// Expired, give the slot back and keep the live list packed.
+		m_freeSlots.push_back(slot);
+		m_live[i] = m_live.back();
+		m_live.pop_back();
+	}
+}
+
+void TextObjectPool::Draw()
+{
+	// All in one pass. Every size uses raylib's default font, one texture, so rlgl already puts consecutive text into
+	// a single draw call and grouping by size wouldn't save any.
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (uint32_t slot : m_live)
+		m_objects[slot].Draw();
+}
+
+unsigned int TextObjectPool::GetLiveCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (unsigned int)m_live.size();
+}
+
+unsigned int TextObjectPool::GetCapacity() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (unsigned int)m_objects.size();
+}
+
+uint64_t TextObjectPool::GetOverflowCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_overflowCount;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <mutex>
+
+#include <raylib.h>
+
+struct TextObject
+{
+	constexpr static unsigned int MAX_TEXT = 32; // Including the null terminator, longer text is cut off.
+
+	char text[MAX_TEXT] = "";
+	Color color = WHITE;
+	int fontSize = 24;
+
+	float xPosition = 0.5f;
+	float yPosition = 0.5f;
+	float lifeTime = 0.0f;
+
+	float startingLife = 0.0f;
+
+	inline bool InUse() const { return lifeTime > 0.0f; }
+
+	void Init(std::string_view text, float x, float y, float lifeTime, int fontSize, Color color);
+	void Animate(double deltaTime);
+	void Draw() const;
+};
+
+// Fixed slots with a free list, so spawning and expiring text never allocates once the pool is big enough.
+// Live objects are kept packed together, Animate and Draw only touch those.
+// Safe from any thread. Text is spawned from network and shard threads while the main thread animates and draws it, and
+// spawning can grow the slots under it.
+class TextObjectPool
+{
+public:
+	TextObjectPool(unsigned int capacity = DEFAULT_CAPACITY, unsigned int maxCapacity = MAX_CAPACITY);
+	~TextObjectPool() = default;
+
+	bool Init(std::string_view text, float x, float y, float lifeTime, int fontSize = 24, Color color = WHITE); // False if the pool is full and can't grow.
+	void Animate(double deltaTime);
+	void Draw();
+
+	void Reserve(unsigned int capacity); // Grows up front, up to the max capacity.
+
+	unsigned int GetLiveCount() const;
+	unsigned int GetCapacity() const;
+	uint64_t GetOverflowCount() const; // Text dropped because the pool was full.
+
+public:
+	constexpr static unsigned int DEFAULT_CAPACITY = 8;
+	constexpr static unsigned int MAX_CAPACITY = 256;
+
+private:
+	void Grow(unsigned int capacity); // m_mutex must be held.
+
+private:
+	mutable std::mutex m_mutex; // Everything below.
+	std::vector<TextObject> m_objects; // Slots.
+	std::vector<uint32_t> m_freeSlots; // Stack of unused slots.
+	std::vector<uint32_t> m_live; // Slots in use, packed.
+
+	unsigned int m_maxCapacity = MAX_CAPACITY;
+	uint64_t m_overflowCount = 0;
+
+};
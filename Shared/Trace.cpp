@@ -0,0 +1,169 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+struct TraceEvent
+{
+	const char *name = nullptr;
+	int64_t timestamp = 0; // Nanoseconds.
+	double value = 0.0; // Counters only.
+	uint32_t generation = 0; // Which Start() it was recorded under.
+	char phase = 0; // Chrome trace phase, B/E/i/C.
+};
+
+// One per thread. Only its own thread ever writes to it, not even Start() touches it. Stop() reads it back while a late
+// event can still be going in, so it copies up to the count it saw and then throws away whatever was overwritten meanwhile.
+struct TraceBuffer
+{
+	constexpr static unsigned int CAPACITY = 1 << 16; // Power of two, most recent events win.
+
+	std::vector<TraceEvent> events; // Allocated when the thread registers and never resized, so Stop() can read it.
+	std::atomic<uint64_t> writeCount = 0; // Only ever goes up.
+
+	std::atomic<const char *> threadName = nullptr;
+	unsigned int threadID = 0;
+};
+
+static std::atomic<bool> s_recording = false;
+static std::atomic<uint32_t> s_generation = 0; // Bumped by every Start(), events from earlier ones are left out.
+static int64_t s_startTime = 0; // Under s_registryMutex.
+
+static std::mutex s_registryMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> s_traceBuffers;
+
+static thread_local TraceBuffer *t_traceBuffer = nullptr;
+
+static TraceBuffer *GetTraceBuffer()
+{
+	if (t_traceBuffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(s_registryMutex);
+		s_traceBuffers.push_back(std::make_unique<TraceBuffer>());
+		t_traceBuffer = s_traceBuffers.back().get();
+		t_traceBuffer->events.resize(TraceBuffer::CAPACITY);
+		t_traceBuffer->threadID = (unsigned int)s_traceBuffers.size();
+	}
+	return t_traceBuffer;
+}
+
+static void PushEvent(const char *name, char phase, double value = 0.0)
+{
+	TraceBuffer *buffer = GetTraceBuffer();
+	uint64_t index = buffer->writeCount.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release); // The last count is out before this slot starts changing.
+
+	TraceEvent &event = buffer->events[index & (TraceBuffer::CAPACITY - 1)];
+	event.name = name;
+	event.timestamp = ClockNowNanoseconds();
+	event.value = value;
+	event.generation = s_generation.load(std::memory_order_relaxed);
+	event.phase = phase;
+
+	buffer->writeCount.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::Start()
+{
+	std::lock_guard<std::mutex> lock(s_registryMutex);
+	s_generation.fetch_add(1, std::memory_order_relaxed);
+	s_startTime = ClockNowNanoseconds();
+	s_recording.store(true, std::memory_order_release);
+}
+
+bool Tracer::Stop(const std::string &path)
+{
+	if (!s_recording.exchange(false))
+		return false;
+
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	auto separator = [&]() -> std::ofstream & { if (!first) file << ",\n"; first = false; return file; };
+
+	std::lock_guard<std::mutex> lock(s_registryMutex);
+	uint32_t generation = s_generation.load(std::memory_order_relaxed);
+	std::vector<TraceEvent> events;
+	events.reserve(TraceBuffer::CAPACITY);
+	for (std::unique_ptr<TraceBuffer> &buffer : s_traceBuffers)
+	{
+		const char *threadName = buffer->threadName.load(std::memory_order_acquire);
+		separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadID
+			<< ",\"args\":{\"name\":\"" << (threadName ? threadName : "thread") << "\"}}";
+
+		// Everything below the acquired count is written. Whatever the thread writes after it lands on the oldest slots,
+		// so once they're copied those are dropped again, along with the one it could be halfway through.
+		uint64_t count = buffer->writeCount.load(std::memory_order_acquire);
+		uint64_t oldest = count > TraceBuffer::CAPACITY ? count - TraceBuffer::CAPACITY : 0;
+		events.clear();
+		for (uint64_t i = oldest; i < count; i++)
+			events.push_back(buffer->events[i & (TraceBuffer::CAPACITY - 1)]);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t written = buffer->writeCount.load(std::memory_order_relaxed) + 1;
+		uint64_t overwritten = written > TraceBuffer::CAPACITY ? written - TraceBuffer::CAPACITY : 0;
+		size_t first = overwritten > oldest ? (size_t)std::min(overwritten - oldest, (uint64_t)events.size()) : 0;
+
+		for (size_t i = first; i < events.size(); i++)
+		{
+			const TraceEvent &event = events[i];
+			if (event.generation != generation) // Left over from before Start().
+				continue;
+
+			double timestamp = (double)(event.timestamp - s_startTime) / 1000.0; // Microseconds.
+			separator() << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+				<< "\",\"ts\":" << timestamp << ",\"pid\":1,\"tid\":" << buffer->threadID;
+
+			if (event.phase == 'C')
+				file << ",\"args\":{\"value\":" << event.value << "}";
+			else if (event.phase == 'i')
+				file << ",\"s\":\"t\"";
+			file << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	return true;
+}
+
+bool Tracer::IsRecording()
+{
+	return s_recording.load(std::memory_order_relaxed);
+}
+
+void Tracer::SetThreadName(const char *name)
+{
+	TraceBuffer *buffer = GetTraceBuffer();
+	if (buffer->threadName.load(std::memory_order_relaxed) == nullptr)
+		buffer->threadName.store(name, std::memory_order_release);
+}
+
+void Tracer::Begin(const char *name)
+{
+	PushEvent(name, 'B');
+}
+
+void Tracer::End(const char *name)
+{
+	PushEvent(name, 'E');
+}
+
+void Tracer::Instant(const char *name)
+{
+	PushEvent(name, 'i');
+}
+
+void Tracer::Counter(const char *name, double value)
+{
+	PushEvent(name, 'C', value);
+}
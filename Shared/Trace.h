@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Clock.h"
+
+// Compile time switch, build with PONG_TRACING=0 and every PONG_TRACE_* compiles to nothing.
+#ifndef PONG_TRACING
+#define PONG_TRACING 1
+#endif
+
+// Timeline recording, written out as Chrome Trace Event JSON which chrome://tracing and ui.perfetto.dev both open.
+// Every thread writes to its own ring buffer, so a long session only keeps the most recent events per thread.
+// Event names aren't copied, they have to be string literals or otherwise outlive the trace.
+class Tracer
+{
+public:
+	static void Start();
+	static bool Stop(const std::string &path); // Stops recording and writes what's buffered.
+	static bool IsRecording();
+
+	static void SetThreadName(const char *name); // Shows up as the track's name.
+
+	static void Begin(const char *name);
+	static void End(const char *name);
+	static void Instant(const char *name);
+	static void Counter(const char *name, double value);
+
+};
+
+class TraceScope
+{
+public:
+	TraceScope(const char *name) : m_name(Tracer::IsRecording() ? name : nullptr)
+	{
+		if (m_name)
+			Tracer::Begin(m_name);
+	}
+	~TraceScope()
+	{
+		if (m_name)
+			Tracer::End(m_name);
+	}
+
+private:
+	TraceScope(const TraceScope &scope) = delete;
+
+	const char *m_name;
+
+};
+
+#define PONG_TRACE_CONCAT_INNER(a, b) a##b
+#define PONG_TRACE_CONCAT(a, b) PONG_TRACE_CONCAT_INNER(a, b)
+
+#if PONG_TRACING
+#define PONG_TRACE_SCOPE(name) TraceScope PONG_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define PONG_TRACE_INSTANT(name) do { if (Tracer::IsRecording()) Tracer::Instant(name); } while (0)
+#define PONG_TRACE_COUNTER(name, value) do { if (Tracer::IsRecording()) Tracer::Counter(name, (double)(value)); } while (0)
+#define PONG_TRACE_THREAD_NAME(name) Tracer::SetThreadName(name)
+#else
+#define PONG_TRACE_SCOPE(name)
+#define PONG_TRACE_INSTANT(name)
+#define PONG_TRACE_COUNTER(name, value)
+#define PONG_TRACE_THREAD_NAME(name)
+#endif
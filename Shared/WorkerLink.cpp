@@ -0,0 +1,170 @@
+#include "WorkerLink.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+struct WorkerMessageHeader
+{
+	uint8_t type;
+	uint8_t padding[3];
+	uint32_t clientId;
+};
+
+static sockaddr_in LoopbackAddress(uint16_t port)
+{
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	return address;
+}
+
+bool WorkerLink::Open(uint16_t port)
+{
+	Close();
+
+#ifdef _WIN32
+	static bool s_started = false; // BCNet will have done this already in most cases, it's reference counted either way.
+	if (!s_started)
+	{
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+			return false;
+		s_started = true;
+	}
+	SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == INVALID_SOCKET)
+		return false;
+	m_socket = (uint64_t)handle;
+#else
+	m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (m_socket < 0)
+	{
+		m_socket = invalidSocket;
+		return false;
+	}
+#endif
+
+	// Bigger buffers so a burst of packets for a busy worker isn't dropped before it gets to them.
+	int bufferSize = 1 << 20;
+	setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, (const char *)&bufferSize, sizeof(bufferSize));
+	setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, (const char *)&bufferSize, sizeof(bufferSize));
+
+	sockaddr_in address = LoopbackAddress(port);
+	if (bind(m_socket, (const sockaddr *)&address, sizeof(address)) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	socklen_t length = sizeof(address);
+	getsockname(m_socket, (sockaddr *)&address, &length);
+	m_port = ntohs(address.sin_port);
+	return true;
+}
+
+int WorkerLink::GetDescriptor() const
+{
+#ifdef _WIN32
+	return -1;
+#else
+	return m_socket;
+#endif
+}
+
+bool WorkerLink::Adopt(int descriptor)
+{
+	Close();
+
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_in address = {};
+	socklen_t length = sizeof(address);
+	if (getsockname(descriptor, (sockaddr *)&address, &length) != 0 || address.sin_family != AF_INET)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	m_socket = descriptor;
+	m_port = ntohs(address.sin_port);
+	return true;
+#endif
+}
+
+void WorkerLink::Close()
+{
+	if (m_socket == invalidSocket)
+		return;
+
+#ifdef _WIN32
+	closesocket((SOCKET)m_socket);
+#else
+	close(m_socket);
+#endif
+	m_socket = invalidSocket;
+	m_port = 0;
+}
+
+bool WorkerLink::Send(uint16_t toPort, uint8_t type, uint32_t clientId, const void *payload, size_t size)
+{
+	if (m_socket == invalidSocket || size > workerMessageMaxPayload)
+		return false;
+
+	uint8_t buffer[sizeof(WorkerMessageHeader) + workerMessageMaxPayload];
+	WorkerMessageHeader header = { type, {}, clientId };
+	std::memcpy(buffer, &header, sizeof(header));
+	if (size > 0)
+		std::memcpy(buffer + sizeof(header), payload, size);
+
+	sockaddr_in address = LoopbackAddress(toPort);
+	int sent = (int)sendto(m_socket, (const char *)buffer, (int)(sizeof(header) + size), 0, (const sockaddr *)&address, sizeof(address));
+	return sent == (int)(sizeof(header) + size);
+}
+
+bool WorkerLink::Receive(WorkerMessage &message, double timeout)
+{
+	if (m_socket == invalidSocket)
+		return false;
+
+	// Waits with a timeout so the thread calling this can notice it's being stopped.
+#ifdef _WIN32
+	WSAPOLLFD poll = { (SOCKET)m_socket, POLLRDNORM, 0 };
+	if (WSAPoll(&poll, 1, (int)(timeout * 1000.0)) <= 0)
+		return false;
+#else
+	pollfd wait = { m_socket, POLLIN, 0 };
+	if (poll(&wait, 1, (int)(timeout * 1000.0)) <= 0)
+		return false;
+#endif
+
+	sockaddr_in from = {};
+	socklen_t fromLength = sizeof(from);
+	int received = (int)recvfrom(m_socket, (char *)m_receiveBuffer, (int)sizeof(m_receiveBuffer), 0, (sockaddr *)&from, &fromLength);
+	if (received < (int)sizeof(WorkerMessageHeader))
+		return false;
+
+	WorkerMessageHeader header;
+	std::memcpy(&header, m_receiveBuffer, sizeof(header));
+
+	message.fromPort = ntohs(from.sin_port);
+	message.type = header.type;
+	message.clientId = header.clientId;
+	message.payload = m_receiveBuffer + sizeof(header);
+	message.size = received - sizeof(header);
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Datagrams between Pong_Gateway and the Pong_Server workers behind it, all on the same host so it's loopback only.
+// Every message is a header and a payload, clients are only ever known by the ID the gateway's BCNet server gave them.
+// Kept away from raylib.h on purpose, the socket headers and raylib don't get along.
+
+enum eWorkerMessage : uint8_t
+{
+	WORKER_CLIENT_CONNECTED = 1, // Gateway -> worker. Payload is the gateway's match ID for them.
+	WORKER_CLIENT_DISCONNECTED, // Gateway -> worker. No payload.
+	WORKER_CLIENT_PACKET, // Either way. Payload is the BCNet packet as is.
+	WORKER_HEALTH_PING, // Gateway -> worker. WorkerHealthPing.
+	WORKER_HEALTH_PONG, // Worker -> gateway. WorkerHealthPong.
+	WORKER_SESSION_HELD, // Worker -> gateway. WorkerSessionHeld, a dropped client's slot is being held here.
+	WORKER_SESSION_FORWARD, // Worker -> gateway. The uint64_t token a client asked to resume with, nothing's held under it here.
+	WORKER_SESSION_REFUSED, // Gateway -> worker. Nothing's held under the token it forwarded either. No payload.
+	WORKER_CLIENT_RESUMING, // Gateway -> worker. Connected like WORKER_CLIENT_CONNECTED, to take back the slot held under the uint64_t token.
+};
+
+constexpr size_t workerMessageMaxPayload = 8192; // BCNet packets are 1 KiB, this leaves plenty of room.
+
+struct WorkerHealthPing
+{
+	uint32_t sequence = 0;
+	int64_t sentTime = 0; // Gateway's ClockNowNanoseconds(), the same clock the workers have.
+};
+
+struct WorkerHealthPong
+{
+	uint32_t sequence = 0;
+	int64_t sentTime = 0; // Echoed.
+	uint32_t players = 0;
+	uint32_t matches = 0;
+};
+
+struct WorkerSessionHeld
+{
+	uint64_t token = 0;
+	double grace = 0.0; // Seconds it's held for.
+};
+
+struct WorkerMessage
+{
+	uint16_t fromPort = 0; // Who sent it, reply to this.
+	uint8_t type = 0;
+	uint32_t clientId = 0;
+	const uint8_t *payload = nullptr; // Only valid until the next Receive().
+	size_t size = 0;
+};
+
+// One UDP socket bound to 127.0.0.1. Send is safe from any thread, Receive from one at a time.
+class WorkerLink
+{
+public:
+	WorkerLink() = default;
+	~WorkerLink() { Close(); }
+
+	WorkerLink(const WorkerLink &link) = delete;
+	WorkerLink &operator=(const WorkerLink &link) = delete;
+
+	bool Open(uint16_t port); // Zero picks any free port, see GetPort().
+	void Close();
+
+	bool IsOpen() const { return m_socket != invalidSocket; }
+	uint16_t GetPort() const { return m_port; }
+
+	// For handing the bound socket to the server replacing this one, see Handoff.h. POSIX only.
+	int GetDescriptor() const;
+	bool Adopt(int descriptor); // Takes ownership, the port is whatever it's bound to.
+
+	bool Send(uint16_t toPort, uint8_t type, uint32_t clientId, const void *payload = nullptr, size_t size = 0);
+	bool Receive(WorkerMessage &message, double timeout); // False if nothing arrived in time.
+
+private:
+#ifdef _WIN32
+	static constexpr uint64_t invalidSocket = ~0ull;
+	uint64_t m_socket = invalidSocket;
+#else
+	static constexpr int invalidSocket = -1;
+	int m_socket = invalidSocket;
+#endif
+	uint16_t m_port = 0;
+
+	uint8_t m_receiveBuffer[16 + workerMessageMaxPayload];
+
+};
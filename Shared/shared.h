@@ -19,14 +19,30 @@ enum class PongPackets : int
 	PONG_PLAYER_COUNTDOWN, // Count down till the game commences.
 	PONG_PLAYER_CONNECTED, // Player has connected.
 	PONG_PLAYER_DISCONNECTED, // Player has disconnected.
-	PONG_PLAYER_REQUEST_PEERS, // New player requests peer info.
+	PONG_PLAYER_REQUEST_PEERS, // Unused, joining players are sent a PONG_MATCH_SNAPSHOT instead.
 
-	PONG_BALL_RESET, // Resets the ball to default.
-	PONG_BALL_VELOCITY, // Return ball's current velocity.
+	PONG_BALL_RESET, // Resets the ball to default. Server timestamp and the simulation's random counter after the reset.
+	PONG_BALL_VELOCITY, // Return ball's current velocity. Server timestamp, position and velocity the ball had at that time.
 	PONG_BALL_BOUNCE, // Paddle bounce off of bounds
 
-	PONG_GAME_STARTED, // Game has commenced.
-	PONG_GAME_ENDED, // Game has finished.
+	PONG_GAME_STARTED, // Game has commenced. The match seed and random counter, so clients can predict the ball's resets.
+	PONG_GAME_ENDED, // Sent to spectators when the match they're watching closes, or there was nothing to watch.
+
+	PONG_LATENCY_PROBE, // Benchmark only, carries the timestamps of each stage a relayed input goes through.
+
+	PONG_PING, // Sequence and sender's send time, answered straight away with a pong. Either end can ping.
+	PONG_PONG, // Echoes the ping's sequence and send time back. The server's pongs also carry its own time, for clock sync.
+
+	PONG_ROLLBACK_START, // Server is running the match as rollback, the clients simulate it. Seed and input delay.
+	PONG_ROLLBACK_INPUT, // Client's recent inputs, first tick, count then one byte each, and its newest final checksum's tick and value. Relayed as is.
+
+	PONG_MATCH_QUEUED, // Waiting in the matchmaking queue, with how many are queued. The first PONG_PLAYER_CONNECTED after it is us.
+
+	PONG_SESSION_TOKEN, // Sent on connect. Token and the seconds a dropped player's slot is held for, zero if it isn't.
+	PONG_SESSION_RESUME, // Client's token from its last connection, sent in answer to the new one's. Takes its held slot back, answered with its side or false if it's gone.
+	PONG_MATCH_SNAPSHOT, // The whole match, sent to anyone joining or resuming it. See Match::GetJoinSnapshot().
+	PONG_PLAYER_AWAY, // Peer dropped and the match is paused waiting for them, or they're back.
+	PONG_SPECTATE, // Watch a match by ID, zero for whichever the server has on screen. A PONG_MATCH_SNAPSHOT every tick follows, no input's taken.
 
 	PONG_PACKET_COUNT // MAX
 };